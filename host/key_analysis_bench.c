@@ -0,0 +1,174 @@
+// The cross-keying analysis over a library of 10,000 keys, first all of one format and then
+// spread over every format. The library is made up in RAM in place of key_library's, while the
+// scratch files go through the storage shim, which counts the I/O they would cost on the SD
+// card. Every run is checked against a brute force count. A last run over a library past
+// KEY_ANALYSIS_MAX_KEYS must compare the keys it can and report the rest as left out.
+
+#include "key_analysis.h"
+#include "key_bench.h"
+#include "key_bitting.h"
+#include "key_formats.h"
+#include "key_library.h"
+
+#define KEY_BENCH_KEYS 10000
+#define KEY_BENCH_LEFT_OUT 100
+// Keys of one format held per block, as in key_analysis.c
+#define KEY_BENCH_BLOCK 256
+// Size of one scratch index record, as in key_analysis.c
+#define KEY_BENCH_RECORD 24
+
+typedef struct {
+    uint8_t format_index;
+    KeyBitting bitting;
+} KeyBenchKey;
+
+static KeyBenchKey library[KEY_ANALYSIS_MAX_KEYS + KEY_BENCH_LEFT_OUT];
+static uint32_t library_keys;
+
+bool key_library_for_each(Storage* storage, KeyLibraryCallback callback, void* context) {
+    UNUSED(storage);
+    char name[KEY_LIBRARY_NAME_SIZE];
+    for(uint32_t i = 0; i < library_keys; i++) {
+        snprintf(name, sizeof(name), "key%05u", (unsigned)i);
+        if(!callback(name, context)) return false;
+    }
+    return true;
+}
+
+KeyFileStatus key_library_read(
+    Storage* storage,
+    const char* name,
+    uint32_t* format_index,
+    KeyBitting* bitting) {
+    UNUSED(storage);
+    uint32_t i = strtoul(name + 3, NULL, 10);
+    *format_index = library[i].format_index;
+    *bitting = library[i].bitting;
+    return KeyFileOk;
+}
+
+// A narrow spread of depths, so that duplicates and keys one cut apart turn up
+static void key_bench_library(uint32_t keys, bool one_format, uint64_t* state) {
+    library_keys = keys;
+    for(uint32_t i = 0; i < keys; i++) {
+        KeyBenchKey* key = &library[i];
+        key->format_index = one_format ? 0 : key_bench_random(state) % FORMAT_NUM;
+        memset(&key->bitting, 0, sizeof(KeyBitting));
+        uint8_t min = key_format_catalog.min_depth_ind[key->format_index];
+        for(uint8_t pin = 0; pin < key_format_catalog.pin_num[key->format_index]; pin++) {
+            key_bitting_set(&key->bitting, pin, min + key_bench_random(state) % 3);
+        }
+    }
+}
+
+static bool key_bench_check(const KeyAnalysisSummary* summary) {
+    KeyAnalysisSummary expected = {.keys = KEY_BENCH_KEYS};
+    uint32_t format_keys[FORMAT_NUM] = {0};
+    for(uint32_t i = 0; i < KEY_BENCH_KEYS; i++) {
+        format_keys[library[i].format_index]++;
+        for(uint32_t j = i + 1; j < KEY_BENCH_KEYS; j++) {
+            if(library[i].format_index != library[j].format_index) continue;
+            expected.pairs++;
+            uint8_t hamming = key_bitting_hamming(&library[i].bitting, &library[j].bitting);
+            if(hamming == 0) expected.duplicates++;
+            if(hamming == 1) expected.one_cut_apart++;
+        }
+    }
+    for(uint32_t f = 0; f < FORMAT_NUM; f++) {
+        if(format_keys[f] >= 2) expected.formats++;
+    }
+    return memcmp(&expected, summary, sizeof(KeyAnalysisSummary)) == 0;
+}
+
+// Past the limit only the pair count is checked, which needs no brute force
+static bool key_bench_check_left_out(const KeyAnalysisSummary* summary) {
+    uint32_t format_keys[FORMAT_NUM] = {0};
+    for(uint32_t i = 0; i < KEY_ANALYSIS_MAX_KEYS; i++) {
+        format_keys[library[i].format_index]++;
+    }
+    uint32_t pairs = 0;
+    for(uint32_t f = 0; f < FORMAT_NUM; f++) {
+        if(format_keys[f] >= 2) pairs += format_keys[f] * (format_keys[f] - 1) / 2;
+    }
+    return summary->keys == KEY_ANALYSIS_MAX_KEYS && summary->left_out == KEY_BENCH_LEFT_OUT &&
+           summary->pairs == pairs;
+}
+
+// Block loads of the compare pass, each of which used to scan the whole index
+static uint64_t key_bench_block_loads(void) {
+    uint32_t format_keys[FORMAT_NUM] = {0};
+    for(uint32_t i = 0; i < KEY_BENCH_KEYS; i++) {
+        format_keys[library[i].format_index]++;
+    }
+    uint64_t loads = 0;
+    for(uint32_t f = 0; f < FORMAT_NUM; f++) {
+        if(format_keys[f] < 2) continue;
+        uint64_t blocks = (format_keys[f] + KEY_BENCH_BLOCK - 1) / KEY_BENCH_BLOCK;
+        loads += blocks * (blocks + 1) / 2;
+    }
+    return loads;
+}
+
+int main(void) {
+    Storage* storage = NULL;
+    storage_simply_mkdir(storage, "build");
+    storage_simply_mkdir(storage, STORAGE_APP_DATA_PATH_PREFIX);
+    uint64_t state = 0x4B4559;
+    bool result = true;
+    printf(
+        "%-14s %8s %10s %9s %8s %8s %10s %12s\n",
+        "library",
+        "seconds",
+        "pairs",
+        "one cut",
+        "seeks",
+        "reads",
+        "read KB",
+        "scan-all KB");
+    for(int run = 0; run < 2; run++) {
+        bool one_format = run == 0;
+        key_bench_library(KEY_BENCH_KEYS, one_format, &state);
+        KeyAnalysisSummary summary;
+        memset(&key_shim_storage_stats, 0, sizeof(key_shim_storage_stats));
+        double start = key_bench_now();
+        bool ok = key_analysis_run(storage, &summary);
+        double seconds = key_bench_now() - start;
+        KeyShimStorageStats stats = key_shim_storage_stats;
+        uint64_t scan_all = key_bench_block_loads() * KEY_BENCH_KEYS * KEY_BENCH_RECORD;
+        printf(
+            "%-14s %8.3f %10lu %9lu %8llu %8llu %10llu %12llu\n",
+            one_format ? "one format" : "every format",
+            seconds,
+            (unsigned long)summary.pairs,
+            (unsigned long)summary.one_cut_apart,
+            (unsigned long long)stats.seeks,
+            (unsigned long long)stats.reads,
+            (unsigned long long)stats.read_bytes / 1024,
+            (unsigned long long)scan_all / 1024);
+        if(!ok || !key_bench_check(&summary)) {
+            fprintf(
+                stderr,
+                "%s: the analysis does not match a brute force count\n",
+                one_format ? "one format" : "every format");
+            result = false;
+        }
+    }
+
+    key_bench_library(KEY_ANALYSIS_MAX_KEYS + KEY_BENCH_LEFT_OUT, false, &state);
+    KeyAnalysisSummary summary;
+    double start = key_bench_now();
+    bool ok = key_analysis_run(storage, &summary);
+    printf(
+        "%-14s %8.3f %10lu %9lu, %lu keys left out\n",
+        "past the limit",
+        key_bench_now() - start,
+        (unsigned long)summary.pairs,
+        (unsigned long)summary.one_cut_apart,
+        (unsigned long)summary.left_out);
+    if(!ok || !key_bench_check_left_out(&summary)) {
+        fprintf(stderr, "past the limit: keys left out of the analysis were not reported\n");
+        result = false;
+    }
+    storage_simply_remove(storage, KEY_ANALYSIS_REPORT_PATH);
+    return result ? 0 : 1;
+}
@@ -0,0 +1,275 @@
+// Backup archives round trip in RAM. A full backup of random keys, one in ten with a long undo
+// history and one in fifty a removed record, is packed and read back: every record must come
+// back as written and every key file must parse to its key. Then single bits are flipped all
+// over the stream, and no key may come back with data other than what was backed up; the reader
+// must call it BadHash or Corrupt. Archives cut short, with a bad header, or written to a card
+// that fails must never read as whole.
+
+#include "key_backup.h"
+#include "key_bench.h"
+#include "key_file.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEY_TEST_KEYS 3000
+#define KEY_TEST_HISTORY_EVERY 10
+#define KEY_TEST_REMOVED_EVERY 50
+#define KEY_TEST_FLIPS 500
+#define KEY_TEST_CUTS 500
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+    size_t position; // next to read
+    size_t fail_at; // writes past this fail, 0 for never
+} KeyTestArchive;
+
+typedef struct {
+    char name[KEY_NAMES_NAME_SIZE];
+    bool removed;
+    uint32_t format_index;
+    KeyBitting bitting;
+    uint8_t file[KEY_BACKUP_FILE_MAX];
+    size_t size;
+} KeyTestKey;
+
+static KeyTestKey keys[KEY_TEST_KEYS];
+
+static bool key_test_archive_write(const void* data, size_t size, void* context) {
+    KeyTestArchive* archive = context;
+    if(archive->fail_at && archive->size + size > archive->fail_at) return false;
+    if(archive->size + size > archive->capacity) {
+        archive->capacity = (archive->size + size) * 2;
+        archive->data = realloc(archive->data, archive->capacity);
+    }
+    memcpy(archive->data + archive->size, data, size);
+    archive->size += size;
+    return true;
+}
+
+static size_t key_test_archive_read(void* data, size_t size, void* context) {
+    KeyTestArchive* archive = context;
+    if(size > archive->size - archive->position) size = archive->size - archive->position;
+    memcpy(data, archive->data + archive->position, size);
+    archive->position += size;
+    return size;
+}
+
+static bool key_test_file_write(const char* text, size_t size, void* context) {
+    KeyTestKey* key = context;
+    if(key->size + size > sizeof(key->file)) return false;
+    memcpy(key->file + key->size, text, size);
+    key->size += size;
+    return true;
+}
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+} KeyTestFile;
+
+static size_t key_test_file_read(void* data, size_t size, void* context) {
+    KeyTestFile* file = context;
+    if(size > file->size) size = file->size;
+    memcpy(data, file->data, size);
+    file->data += size;
+    file->size -= size;
+    return size;
+}
+
+// A key as the app saves it. Those with a history got to their bitting one depth step at a time
+// from a first bitting, so the history leads to the bitting the way key_file_parse wants.
+static void key_test_key(KeyTestKey* key, uint32_t index, uint64_t* state) {
+    snprintf(key->name, sizeof(key->name), "key %lu", (unsigned long)index);
+    key->removed = index % KEY_TEST_REMOVED_EVERY == KEY_TEST_REMOVED_EVERY - 1;
+    key->format_index = key_bench_random(state) % FORMAT_NUM;
+    const uint8_t pin_num = key_format_catalog.pin_num[key->format_index];
+    const uint8_t min = key_format_catalog.min_depth_ind[key->format_index];
+    const uint8_t spread = key_format_catalog.max_depth_ind[key->format_index] - min + 1;
+    const uint8_t macs = key_format_catalog.macs[key->format_index];
+    memset(&key->bitting, 0, sizeof(KeyBitting));
+    for(uint8_t pin = 0; pin < pin_num; pin++) {
+        key_bitting_set(&key->bitting, pin, min);
+    }
+    static KeyHistory history;
+    key_history_init(&history);
+    uint32_t steps = index % KEY_TEST_HISTORY_EVERY ? pin_num :
+                                                      50 + key_bench_random(state) % 200;
+    for(uint32_t step = 0; step < steps; step++) {
+        uint8_t pin = key_bench_random(state) % pin_num;
+        uint8_t old_depth = key_bitting_get(&key->bitting, pin);
+        uint8_t new_depth = min + key_bench_random(state) % spread;
+        key_bitting_set(&key->bitting, pin, new_depth);
+        if(new_depth == old_depth ||
+           key_bitting_macs_violations(&key->bitting, pin_num, macs)) {
+            key_bitting_set(&key->bitting, pin, old_depth);
+            continue;
+        }
+        key_history_edit(&history, pin, old_depth, new_depth);
+    }
+    key->size = 0;
+    key_file_write(
+        key->format_index,
+        &key->bitting,
+        index % KEY_TEST_HISTORY_EVERY ? NULL : &history,
+        key_test_file_write,
+        key);
+}
+
+// Read the archive to its end. Keys that come back Ok must be byte for byte what was backed up;
+// those are counted in ok, and those the reader caught in bad.
+static KeyBackupStatus
+    key_test_restore(KeyTestArchive* archive, uint32_t* ok, uint32_t* bad, uint32_t* wrong) {
+    archive->position = 0;
+    KeyBackupReader* reader = key_backup_reader_alloc(key_test_archive_read, archive);
+    KeyBackupHeader header;
+    KeyBackupStatus status = key_backup_reader_header(reader, &header);
+    KeyBackupRecord record;
+    while(status == KeyBackupOk || status == KeyBackupBadHash) {
+        status = key_backup_reader_next(reader, &record);
+        if(status == KeyBackupBadHash) (*bad)++;
+        if(status != KeyBackupOk || record.type != KeyBackupRecordKey) continue;
+        uint32_t index = strtoul(record.name + strlen("key "), NULL, 10);
+        if(index >= KEY_TEST_KEYS || strcmp(record.name, keys[index].name) ||
+           keys[index].removed || record.size != keys[index].size ||
+           memcmp(record.data, keys[index].file, record.size)) {
+            (*wrong)++;
+        } else {
+            (*ok)++;
+        }
+    }
+    key_backup_reader_free(reader);
+    return status;
+}
+
+int main(void) {
+    uint64_t state = 0x4B4559;
+    KeyTestArchive archive = {0};
+    bool result = true;
+
+    size_t key_bytes = 0;
+    uint32_t removed = 0;
+    KeyBackupWriter* writer = key_backup_writer_alloc(true, 1, key_test_archive_write, &archive);
+    for(uint32_t index = 0; index < KEY_TEST_KEYS; index++) {
+        KeyTestKey* key = &keys[index];
+        key_test_key(key, index, &state);
+        KeyBackupStatus status;
+        if(key->removed) {
+            status = key_backup_writer_add_removed(writer, key->name);
+            removed++;
+        } else {
+            status = key_backup_writer_add_key(writer, key->name, key->file, key->size);
+            key_bytes += key->size;
+        }
+        if(status != KeyBackupOk) result = false;
+    }
+    if(key_backup_writer_finish(writer) != KeyBackupOk) result = false;
+    key_backup_writer_free(writer);
+
+    // Every record comes back in order, and every key file parses to its key
+    archive.position = 0;
+    KeyBackupReader* reader = key_backup_reader_alloc(key_test_archive_read, &archive);
+    KeyBackupHeader header;
+    if(key_backup_reader_header(reader, &header) != KeyBackupOk || !header.full ||
+       header.sequence != 1)
+        result = false;
+    uint32_t records = 0;
+    uint32_t mismatches = 0;
+    KeyBackupRecord record;
+    KeyBackupStatus status;
+    while((status = key_backup_reader_next(reader, &record)) == KeyBackupOk) {
+        const KeyTestKey* key = &keys[records++ % KEY_TEST_KEYS];
+        KeyTestFile file = {.data = record.data, .size = record.size};
+        uint32_t format_index;
+        KeyBitting bitting;
+        if(strcmp(record.name, key->name) ||
+           record.type != (key->removed ? KeyBackupRecordRemoved : KeyBackupRecordKey)) {
+            mismatches++;
+        } else if(
+            !key->removed &&
+            (record.size != key->size || memcmp(record.data, key->file, key->size) ||
+             key_file_parse(key_test_file_read, &file, &format_index, &bitting, NULL) !=
+                 KeyFileOk ||
+             format_index != key->format_index || !key_bitting_equal(&bitting, &key->bitting))) {
+            mismatches++;
+        }
+    }
+    key_backup_reader_free(reader);
+    printf(
+        "%lu keys and %lu removed: %lu bytes of key files packed to %lu, %.2f to 1\n",
+        (unsigned long)(KEY_TEST_KEYS - removed),
+        (unsigned long)removed,
+        (unsigned long)key_bytes,
+        (unsigned long)archive.size,
+        (double)key_bytes / archive.size);
+    if(status != KeyBackupEnd || records != KEY_TEST_KEYS || mismatches) {
+        fprintf(
+            stderr,
+            "key_backup: %lu of %lu records read back, %lu not as written\n",
+            (unsigned long)records,
+            (unsigned long)KEY_TEST_KEYS,
+            (unsigned long)mismatches);
+        result = false;
+    }
+
+    // Removed records carry no hash, so only keys are held to what was backed up
+    uint32_t bad = 0;
+    uint32_t wrong = 0;
+    uint32_t corrupt = 0;
+    for(uint32_t flip = 0; flip < KEY_TEST_FLIPS; flip++) {
+        size_t at = sizeof(KeyBackupHeader) +
+                    key_bench_random(&state) % (archive.size - sizeof(KeyBackupHeader));
+        uint8_t bit = 1 << key_bench_random(&state) % 8;
+        uint32_t ok = 0;
+        archive.data[at] ^= bit;
+        if(key_test_restore(&archive, &ok, &bad, &wrong) == KeyBackupCorrupt) corrupt++;
+        archive.data[at] ^= bit;
+    }
+    printf(
+        "%lu bits flipped: %lu keys caught by their hash, %lu archives corrupt, %lu keys wrong\n",
+        (unsigned long)KEY_TEST_FLIPS,
+        (unsigned long)bad,
+        (unsigned long)corrupt,
+        (unsigned long)wrong);
+    if(wrong) {
+        fprintf(stderr, "key_backup: flipped bits gave keys that were never backed up\n");
+        result = false;
+    }
+
+    // Cut anywhere, an archive must end Corrupt, with the keys before the cut intact
+    const size_t size = archive.size;
+    uint32_t cuts_whole = 0;
+    wrong = 0;
+    for(uint32_t cut = 0; cut < KEY_TEST_CUTS; cut++) {
+        uint32_t ok = 0;
+        archive.size = key_bench_random(&state) % size;
+        if(key_test_restore(&archive, &ok, &bad, &wrong) != KeyBackupCorrupt) cuts_whole++;
+    }
+    archive.size = size;
+    archive.data[0] ^= 1;
+    uint32_t ok = 0;
+    if(key_test_restore(&archive, &ok, &bad, &wrong) != KeyBackupCorrupt || ok) cuts_whole++;
+    archive.data[0] ^= 1;
+    if(cuts_whole || wrong) {
+        fprintf(stderr, "key_backup: archives cut short or with a bad header read as whole\n");
+        result = false;
+    }
+
+    // A card that fails part way through
+    KeyTestArchive failing = {.fail_at = size / 2};
+    writer = key_backup_writer_alloc(true, 1, key_test_archive_write, &failing);
+    for(uint32_t index = 0; index < KEY_TEST_KEYS; index++) {
+        const KeyTestKey* key = &keys[index];
+        if(!key->removed) key_backup_writer_add_key(writer, key->name, key->file, key->size);
+    }
+    if(key_backup_writer_finish(writer) != KeyBackupIoError) {
+        fprintf(stderr, "key_backup: a failed write was not reported\n");
+        result = false;
+    }
+    key_backup_writer_free(writer);
+    free(failing.data);
+    free(archive.data);
+    return result ? 0 : 1;
+}
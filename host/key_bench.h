@@ -0,0 +1,28 @@
+#ifndef KEY_BENCH_H
+#define KEY_BENCH_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Shared by the host benchmarks and tests
+
+static inline double key_bench_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// xorshift64*, so every run sees the same keys
+static inline uint32_t key_bench_random(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return (uint32_t)((*state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+// Keep a result the compiler would otherwise drop along with the loop that made it
+static inline void key_bench_keep(uint64_t value) {
+    __asm__ volatile("" : : "r"(value));
+}
+
+#endif // KEY_BENCH_H
@@ -0,0 +1,161 @@
+// Packed bittings against the uint8_t depth arrays the app used before them. Every format is
+// timed on the same random keys, and the two agree on every answer or the run fails.
+
+#include "key_bench.h"
+#include "key_bitting.h"
+#include "key_formats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEY_BENCH_KEYS 4096
+#define KEY_BENCH_ROUNDS 200
+
+// The array code, as the input callback and the save path had it. Kept out of line, as the
+// packed calls into the library are.
+
+static __attribute__((noinline)) uint32_t
+    array_macs_violations(const uint8_t* depth, uint8_t pin_num, uint8_t macs) {
+    uint32_t violations = 0;
+    for(uint8_t i = 0; i + 1 < pin_num; i++) {
+        int diff = depth[i + 1] - depth[i];
+        if(diff > macs || -diff > macs) violations |= 1u << i;
+    }
+    return violations;
+}
+
+static __attribute__((noinline)) bool
+    array_in_range(const uint8_t* depth, uint8_t pin_num, uint8_t min, uint8_t max) {
+    for(uint8_t i = 0; i < pin_num; i++) {
+        if(depth[i] < min || depth[i] > max) return false;
+    }
+    return true;
+}
+
+static __attribute__((noinline)) bool
+    array_equal(const uint8_t* a, const uint8_t* b, uint8_t pin_num) {
+    return memcmp(a, b, pin_num) == 0;
+}
+
+static __attribute__((noinline)) uint64_t
+    array_hash(const uint8_t* depth, uint8_t pin_num) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for(uint8_t i = 0; i < pin_num; i++) {
+        hash = (hash ^ depth[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+typedef struct {
+    const char* name;
+    double array;
+    double packed;
+} KeyBenchTiming;
+
+static KeyBenchTiming timings[] = {
+    {.name = "macs"},
+    {.name = "range"},
+    {.name = "equal"},
+    {.name = "hash"},
+};
+
+#define KEY_BENCH_TIME(timing, body)                                \
+    do {                                                            \
+        double start = key_bench_now();                             \
+        for(int round = 0; round < KEY_BENCH_ROUNDS; round++) body; \
+        timing += key_bench_now() - start;                          \
+    } while(0)
+
+int main(void) {
+    uint8_t* arrays = malloc(KEY_BENCH_KEYS * KEY_BITTING_MAX_PINS);
+    KeyBitting* packed = malloc(KEY_BENCH_KEYS * sizeof(KeyBitting));
+    uint64_t state = 0x4B4559;
+    unsigned mismatches = 0;
+    uint64_t keys = 0;
+
+    for(uint32_t format_index = 0; format_index < FORMAT_NUM; format_index++) {
+        uint8_t pin_num = key_format_catalog.pin_num[format_index];
+        uint8_t min = key_format_catalog.min_depth_ind[format_index];
+        uint8_t max = key_format_catalog.max_depth_ind[format_index];
+        uint8_t macs = key_format_catalog.macs[format_index];
+        for(uint32_t k = 0; k < KEY_BENCH_KEYS; k++) {
+            uint8_t* depth = &arrays[k * KEY_BITTING_MAX_PINS];
+            memset(&packed[k], 0, sizeof(KeyBitting));
+            // one depth in a few past the format's range, so both range answers come up
+            for(uint8_t pin = 0; pin < pin_num; pin++) {
+                uint32_t r = key_bench_random(&state);
+                depth[pin] = (r % 8) ? min + r / 8 % (max - min + 1) : (r / 8) & 0xF;
+                key_bitting_set(&packed[k], pin, depth[pin]);
+            }
+        }
+        for(uint32_t k = 0; k < KEY_BENCH_KEYS; k++) {
+            const uint8_t* depth = &arrays[k * KEY_BITTING_MAX_PINS];
+            const uint8_t* other = &arrays[(k ^ 1) * KEY_BITTING_MAX_PINS];
+            if(array_macs_violations(depth, pin_num, macs) !=
+                   key_bitting_macs_violations(&packed[k], pin_num, macs) ||
+               array_in_range(depth, pin_num, min, max) !=
+                   key_bitting_in_range(&packed[k], pin_num, min, max) ||
+               array_equal(depth, other, pin_num) !=
+                   key_bitting_equal(&packed[k], &packed[k ^ 1])) {
+                mismatches++;
+            }
+        }
+
+        uint64_t sum = 0;
+        KEY_BENCH_TIME(timings[0].array, {
+            for(uint32_t k = 0; k < KEY_BENCH_KEYS; k++)
+                sum += array_macs_violations(&arrays[k * KEY_BITTING_MAX_PINS], pin_num, macs);
+        });
+        KEY_BENCH_TIME(timings[0].packed, {
+            for(uint32_t k = 0; k < KEY_BENCH_KEYS; k++)
+                sum += key_bitting_macs_violations(&packed[k], pin_num, macs);
+        });
+        KEY_BENCH_TIME(timings[1].array, {
+            for(uint32_t k = 0; k < KEY_BENCH_KEYS; k++)
+                sum += array_in_range(&arrays[k * KEY_BITTING_MAX_PINS], pin_num, min, max);
+        });
+        KEY_BENCH_TIME(timings[1].packed, {
+            for(uint32_t k = 0; k < KEY_BENCH_KEYS; k++)
+                sum += key_bitting_in_range(&packed[k], pin_num, min, max);
+        });
+        KEY_BENCH_TIME(timings[2].array, {
+            for(uint32_t k = 0; k < KEY_BENCH_KEYS; k++)
+                sum += array_equal(
+                    &arrays[k * KEY_BITTING_MAX_PINS],
+                    &arrays[(k ^ 1) * KEY_BITTING_MAX_PINS],
+                    pin_num);
+        });
+        KEY_BENCH_TIME(timings[2].packed, {
+            for(uint32_t k = 0; k < KEY_BENCH_KEYS; k++)
+                sum += key_bitting_equal(&packed[k], &packed[k ^ 1]);
+        });
+        KEY_BENCH_TIME(timings[3].array, {
+            for(uint32_t k = 0; k < KEY_BENCH_KEYS; k++)
+                sum += array_hash(&arrays[k * KEY_BITTING_MAX_PINS], pin_num);
+        });
+        KEY_BENCH_TIME(timings[3].packed, {
+            for(uint32_t k = 0; k < KEY_BENCH_KEYS; k++)
+                sum += key_bitting_hash(&packed[k], pin_num);
+        });
+        key_bench_keep(sum);
+        keys += (uint64_t)KEY_BENCH_KEYS * KEY_BENCH_ROUNDS;
+    }
+
+    printf("%llu keys over %u formats\n", (unsigned long long)keys, FORMAT_NUM);
+    printf("%-6s %10s %10s %8s\n", "op", "array ns", "packed ns", "speedup");
+    for(size_t i = 0; i < sizeof(timings) / sizeof(timings[0]); i++) {
+        printf(
+            "%-6s %10.2f %10.2f %7.1fx\n",
+            timings[i].name,
+            timings[i].array * 1e9 / keys,
+            timings[i].packed * 1e9 / keys,
+            timings[i].array / timings[i].packed);
+    }
+    free(packed);
+    free(arrays);
+    if(mismatches) {
+        fprintf(stderr, "%u keys answered differently\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,214 @@
+// The duplicate key hash set against a brute force search. Keys are saved the way the library
+// saves them: a find first, and an add only when no other key has the same bitting. Some keys
+// are saved again and again under new names, past what the set keeps of one hash. Hashes that
+// no split can part are added to a set of their own, which must turn them away rather than
+// grow. Both parts live in RAM.
+
+#include "key_bench.h"
+#include "key_bitting.h"
+#include "key_dupes.h"
+#include "key_formats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEY_TEST_KEYS 20000
+// Every so often a key is saved under this many names, past what the set keeps of one hash
+#define KEY_TEST_COPIES (KEY_DUPES_HASH_ENTRIES + 4)
+#define KEY_TEST_COPIES_EVERY 500
+// Hashes alike in every bit a bucket index can use
+#define KEY_TEST_UNSPLITTABLE 100
+
+typedef struct {
+    uint8_t* data;
+    uint32_t size;
+    uint32_t capacity;
+    uint64_t reads;
+} KeyTestPart;
+
+typedef struct {
+    uint32_t format_index;
+    KeyBitting bitting;
+} KeyTestKey;
+
+static KeyTestPart parts[2];
+static KeyTestKey keys[KEY_TEST_KEYS];
+static bool holes;
+
+static bool key_test_read(
+    KeyDupesPart part,
+    uint32_t offset,
+    void* data,
+    size_t size,
+    void* context) {
+    (void)context;
+    KeyTestPart* p = &parts[part];
+    p->reads++;
+    if(offset + size > p->size) return false;
+    memcpy(data, p->data + offset, size);
+    return true;
+}
+
+static bool key_test_write(
+    KeyDupesPart part,
+    uint32_t offset,
+    const void* data,
+    size_t size,
+    void* context) {
+    (void)context;
+    KeyTestPart* p = &parts[part];
+    // Files on the SD card grow by appending, so a write past the end would leave a hole
+    if(offset > p->size) holes = true;
+    if(offset + size > p->capacity) {
+        p->capacity = (offset + size) * 2;
+        p->data = realloc(p->data, p->capacity);
+    }
+    memcpy(p->data + offset, data, size);
+    if(offset + size > p->size) p->size = offset + size;
+    return true;
+}
+
+typedef struct {
+    uint32_t key;
+    int32_t found; // another key with the same format and bitting, -1 if none
+} KeyTestMatch;
+
+// As key_library_dupes_match does with key files, the candidate's own key has the last word
+static bool key_test_match(const char* name, uint32_t record, void* context) {
+    (void)record;
+    KeyTestMatch* match = context;
+    uint32_t other = strtoul(name + 1, NULL, 10);
+    if(other == match->key || keys[other].format_index != keys[match->key].format_index ||
+       !key_bitting_equal(&keys[other].bitting, &keys[match->key].bitting))
+        return false;
+    match->found = other;
+    return true;
+}
+
+static int32_t key_test_brute_force(uint32_t key) {
+    for(uint32_t other = 0; other < key; other++) {
+        if(keys[other].format_index == keys[key].format_index &&
+           key_bitting_equal(&keys[other].bitting, &keys[key].bitting))
+            return other;
+    }
+    return -1;
+}
+
+// One key in seven has depths of two values only, so plenty of keys come up twice
+static void key_test_key(KeyTestKey* key, uint32_t index, uint64_t* state) {
+    key->format_index = key_bench_random(state) % FORMAT_NUM;
+    memset(&key->bitting, 0, sizeof(KeyBitting));
+    uint8_t min = key_format_catalog.min_depth_ind[key->format_index];
+    uint8_t spread = index % 7 ? key_format_catalog.max_depth_ind[key->format_index] - min + 1 :
+                                 2;
+    for(uint8_t pin = 0; pin < key_format_catalog.pin_num[key->format_index]; pin++) {
+        key_bitting_set(&key->bitting, pin, min + key_bench_random(state) % spread);
+    }
+}
+
+static bool key_test_create(KeyDupes* dupes) {
+    parts[KeyDupesPartBuckets].size = 0;
+    parts[KeyDupesPartNames].size = 0;
+    return key_dupes_create(dupes, key_test_read, key_test_write, NULL) == KeyDupesOk;
+}
+
+static bool key_test_reopen(void) {
+    KeyDupes reopened;
+    return key_dupes_open(&reopened, key_test_read, key_test_write, NULL) == KeyDupesOk;
+}
+
+int main(void) {
+    KeyDupes dupes;
+    bool result = true;
+
+    // Alike in every bit a bucket index can use, so the first bucket fills and stays full
+    uint32_t unsplittable_full = 0;
+    result &= key_test_create(&dupes);
+    for(uint32_t i = 1; i <= KEY_TEST_UNSPLITTABLE; i++) {
+        uint32_t hash = 0x5A5A5 | i << KEY_DUPES_MAX_BUCKET_BITS;
+        if(key_dupes_add(&dupes, hash, "u", NULL) == KeyDupesFull) unsplittable_full++;
+    }
+    if(dupes.header.bucket_bits != 0 || !key_test_reopen() ||
+       unsplittable_full != KEY_TEST_UNSPLITTABLE - KEY_DUPES_BUCKET_ENTRIES) {
+        fprintf(stderr, "key_dupes: hashes no split can part grew the table\n");
+        result = false;
+    }
+
+    uint64_t state = 0x4B4559;
+    uint32_t wrong = 0;
+    uint32_t duplicates = 0;
+    uint32_t full = 0;
+    uint32_t expected_full = 0;
+    result &= key_test_create(&dupes);
+    char name[KEY_NAMES_NAME_SIZE];
+    for(uint32_t key = 0; key < KEY_TEST_KEYS && result; key++) {
+        key_test_key(&keys[key], key, &state);
+        uint32_t hash = key_dupes_hash(keys[key].format_index, &keys[key].bitting);
+        KeyTestMatch match = {.key = key, .found = -1};
+        KeyDupesStatus status = key_dupes_find(&dupes, hash, key_test_match, &match);
+        int32_t expected = key_test_brute_force(key);
+        if((status == KeyDupesOk) != (expected >= 0)) wrong++;
+        if(status == KeyDupesOk) {
+            duplicates++;
+            continue;
+        }
+        uint32_t copies = key % KEY_TEST_COPIES_EVERY ? 1 : KEY_TEST_COPIES;
+        if(copies > KEY_DUPES_HASH_ENTRIES) expected_full += copies - KEY_DUPES_HASH_ENTRIES;
+        for(uint32_t copy = 0; copy < copies; copy++) {
+            snprintf(name, sizeof(name), "k%lu", (unsigned long)key);
+            status = key_dupes_add(&dupes, hash, name, NULL);
+            if(status == KeyDupesFull) {
+                full++;
+            } else if(status != KeyDupesOk) {
+                result = false;
+            }
+        }
+        if(key % 5000 == 0) result &= key_test_reopen();
+    }
+
+    uint64_t bucket_reads = parts[KeyDupesPartBuckets].reads;
+    uint64_t name_reads = parts[KeyDupesPartNames].reads;
+    for(uint32_t i = 0; i < 1000; i++) {
+        KeyTestMatch match = {.key = key_bench_random(&state) % KEY_TEST_KEYS, .found = -1};
+        key_dupes_find(
+            &dupes,
+            key_dupes_hash(keys[match.key].format_index, &keys[match.key].bitting),
+            key_test_match,
+            &match);
+    }
+    bucket_reads = parts[KeyDupesPartBuckets].reads - bucket_reads;
+    name_reads = parts[KeyDupesPartNames].reads - name_reads;
+
+    printf(
+        "%lu keys, %lu duplicates, %lu buckets, %lu KB of buckets, %lu KB of names\n",
+        (unsigned long)KEY_TEST_KEYS,
+        (unsigned long)duplicates,
+        1ul << dupes.header.bucket_bits,
+        (unsigned long)parts[KeyDupesPartBuckets].size / 1024,
+        (unsigned long)parts[KeyDupesPartNames].size / 1024);
+    printf(
+        "per find: %.2f bucket reads, %.2f name reads\n",
+        bucket_reads / 1000.0,
+        name_reads / 1000.0);
+    printf(
+        "%lu copies past %u per hash turned away, %lu unsplittable hashes turned away\n",
+        (unsigned long)full,
+        KEY_DUPES_HASH_ENTRIES,
+        (unsigned long)unsplittable_full);
+    if(wrong) {
+        fprintf(
+            stderr, "key_dupes: %lu finds disagree with brute force\n", (unsigned long)wrong);
+        result = false;
+    }
+    if(full != expected_full) {
+        fprintf(stderr, "key_dupes: copies of one key were not capped\n");
+        result = false;
+    }
+    if(holes || !key_test_reopen()) {
+        fprintf(stderr, "key_dupes: the set was left unsound\n");
+        result = false;
+    }
+    free(parts[KeyDupesPartBuckets].data);
+    free(parts[KeyDupesPartNames].data);
+    return result ? 0 : 1;
+}
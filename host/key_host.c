@@ -0,0 +1,576 @@
+// Companion command line tool for the shop PC. It links the same catalog, bitting and file code
+// as the app, so whatever it writes is byte for byte what the Flipper would write.
+
+#include "key_bitting.h"
+#include "key_codebook.h"
+#include "key_file.h"
+#include "key_formats.h"
+#include "key_gcode.h"
+#include "key_history.h"
+#include "key_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The app reads code book sources through a 64 byte line buffer and drops the rest of a longer
+// line, so the same cut is made here
+#define KEY_HOST_LINE_SIZE 64
+// Source lines parsed per task
+#define KEY_HOST_LINES_PER_TASK 1024
+// Pins fixed by each enumeration task; the rest are walked inside the task
+#define KEY_HOST_PREFIX_PINS 3
+
+typedef struct {
+    char* data;
+    size_t size;
+} KeyHostText;
+
+static bool key_host_read_file(const char* path, KeyHostText* text) {
+    FILE* file = fopen(path, "rb");
+    if(!file) {
+        perror(path);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    text->data = malloc(size + 1);
+    text->size = fread(text->data, 1, size, file);
+    text->data[text->size] = '\0';
+    fclose(file);
+    return text->size == (size_t)size;
+}
+
+static bool key_host_write_file(const char* path, const void* data, size_t size) {
+    FILE* file = fopen(path, "wb");
+    bool result = file && fwrite(data, 1, size, file) == size;
+    if(file && fclose(file)) result = false;
+    if(!result) perror(path);
+    return result;
+}
+
+static int32_t key_host_format(const char* name) {
+    int32_t format_index = key_format_find(name);
+    if(format_index < 0) fprintf(stderr, "%s: unknown format, see the formats command\n", name);
+    return format_index;
+}
+
+// A growing output buffer
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} KeyHostBuffer;
+
+static void key_host_append(KeyHostBuffer* buffer, const char* data, size_t size) {
+    if(buffer->size + size > buffer->capacity) {
+        buffer->capacity = (buffer->size + size) * 2;
+        buffer->data = realloc(buffer->data, buffer->capacity);
+    }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+}
+
+static bool key_host_buffer_write(const char* text, size_t size, void* context) {
+    key_host_append(context, text, size);
+    return true;
+}
+
+static int key_host_formats(void) {
+    printf("%-12s %-24s pins depths macs\n", "format", "manufacturer");
+    for(uint32_t i = 0; i < FORMAT_NUM; i++) {
+        printf(
+            "%-12s %-24s %4u %3u-%-2u %4u\n",
+            key_format_info[i].format_name,
+            key_format_info[i].manufacturer,
+            key_format_catalog.pin_num[i],
+            key_format_catalog.min_depth_ind[i],
+            key_format_catalog.max_depth_ind[i],
+            key_format_catalog.macs[i]);
+    }
+    return 0;
+}
+
+typedef struct {
+    KeyFormat format;
+    uint8_t prefix_pins;
+    const KeyBitting* prefixes; // of the current batch
+    KeyHostBuffer* buffers; // one per prefix, NULL when only counting
+    uint64_t* counts;
+} KeyHostEnumerate;
+
+static uint64_t key_host_walk(
+    const KeyFormat* format,
+    KeyBitting* bitting,
+    uint8_t pin,
+    KeyHostBuffer* buffer) {
+    if(pin == format->pin_num) {
+        if(buffer) {
+            char line[KEY_BITTING_MAX_PINS * 3 + 1];
+            size_t length = key_bitting_to_str(bitting, format->pin_num, line, sizeof(line));
+            line[length++] = '\n';
+            key_host_append(buffer, line, length);
+        }
+        return 1;
+    }
+    uint8_t previous = key_bitting_get(bitting, pin - 1);
+    int low = previous - format->macs;
+    int high = previous + format->macs;
+    if(low < format->min_depth_ind) low = format->min_depth_ind;
+    if(high > format->max_depth_ind) high = format->max_depth_ind;
+    uint64_t count = 0;
+    for(int depth = low; depth <= high; depth++) {
+        key_bitting_set(bitting, pin, depth);
+        count += key_host_walk(format, bitting, pin + 1, buffer);
+    }
+    key_bitting_set(bitting, pin, 0);
+    return count;
+}
+
+static void key_host_enumerate_task(size_t index, unsigned worker, void* context) {
+    (void)worker;
+    KeyHostEnumerate* enumerate = context;
+    KeyBitting bitting = enumerate->prefixes[index];
+    enumerate->counts[index] = key_host_walk(
+        &enumerate->format,
+        &bitting,
+        enumerate->prefix_pins,
+        enumerate->buffers ? &enumerate->buffers[index] : NULL);
+}
+
+// Every prefix of prefix_pins cuts that keeps to the MACS, in order
+static size_t key_host_prefixes(const KeyFormat* format, uint8_t prefix_pins, KeyBitting* out) {
+    size_t count = 0;
+    uint8_t depths = format->max_depth_ind - format->min_depth_ind + 1;
+    size_t total = 1;
+    for(uint8_t pin = 0; pin < prefix_pins; pin++) {
+        total *= depths;
+    }
+    for(size_t i = 0; i < total; i++) {
+        KeyBitting bitting = {0};
+        size_t rest = i;
+        for(int pin = prefix_pins - 1; pin >= 0; pin--) {
+            key_bitting_set(&bitting, pin, format->min_depth_ind + rest % depths);
+            rest /= depths;
+        }
+        if(!key_bitting_macs_violations(&bitting, prefix_pins, format->macs)) {
+            if(out) out[count] = bitting;
+            count++;
+        }
+    }
+    return count;
+}
+
+// Write or count every bitting of a format. The output is kept in order by running one first
+// depth at a time, which also bounds the memory held for it.
+static int key_host_enumerate(int argc, char** argv, unsigned workers) {
+    if(argc < 1) return -1;
+    int32_t format_index = key_host_format(argv[0]);
+    if(format_index < 0) return 1;
+    FILE* out = NULL;
+    if(argc > 1 && !(out = fopen(argv[1], "wb"))) {
+        perror(argv[1]);
+        return 1;
+    }
+    KeyHostEnumerate enumerate = {0};
+    key_format_load(format_index, &enumerate.format);
+    enumerate.prefix_pins = enumerate.format.pin_num < KEY_HOST_PREFIX_PINS ?
+                                enumerate.format.pin_num :
+                                KEY_HOST_PREFIX_PINS;
+    size_t prefix_num = key_host_prefixes(&enumerate.format, enumerate.prefix_pins, NULL);
+    KeyBitting* prefixes = malloc(prefix_num * sizeof(KeyBitting));
+    key_host_prefixes(&enumerate.format, enumerate.prefix_pins, prefixes);
+    enumerate.counts = calloc(prefix_num, sizeof(uint64_t));
+    if(out) enumerate.buffers = calloc(prefix_num, sizeof(KeyHostBuffer));
+
+    uint64_t total = 0;
+    bool result = true;
+    for(size_t first = 0; first < prefix_num && result;) {
+        size_t last = first;
+        while(last < prefix_num &&
+              key_bitting_get(&prefixes[last], 0) == key_bitting_get(&prefixes[first], 0))
+            last++;
+        enumerate.prefixes = prefixes + first;
+        if(out) memset(enumerate.buffers, 0, prefix_num * sizeof(KeyHostBuffer));
+        key_pool_run(last - first, workers, key_host_enumerate_task, &enumerate);
+        for(size_t i = 0; i < last - first; i++) {
+            total += enumerate.counts[i];
+            if(!out) continue;
+            KeyHostBuffer* buffer = &enumerate.buffers[i];
+            if(fwrite(buffer->data, 1, buffer->size, out) != buffer->size) result = false;
+            free(buffer->data);
+        }
+        first = last;
+    }
+    if(out && fclose(out)) result = false;
+    if(!result) perror(argv[1]);
+    printf(
+        "%s: %llu bittings keep to the MACS of %u\n",
+        key_format_info[format_index].format_name,
+        (unsigned long long)total,
+        enumerate.format.macs);
+    free(enumerate.buffers);
+    free(enumerate.counts);
+    free(prefixes);
+    return result ? 0 : 1;
+}
+
+typedef enum {
+    KeyHostLineSkip, // blank or comment
+    KeyHostLineOk,
+    KeyHostLineBad,
+    KeyHostLineRange,
+} KeyHostLineStatus;
+
+// A code book source, split and parsed the way the app compiles it
+typedef struct {
+    KeyFormat format;
+    KeyHostText text;
+    char** lines;
+    size_t line_num;
+    char (*codes)[KEY_CODEBOOK_CODE_SIZE];
+    KeyBitting* bittings;
+    uint8_t* status;
+    uint32_t* macs; // breaks, which the app loads but which no real key has
+} KeyHostSource;
+
+static void key_host_source_task(size_t index, unsigned worker, void* context) {
+    (void)worker;
+    KeyHostSource* source = context;
+    size_t end = (index + 1) * KEY_HOST_LINES_PER_TASK;
+    if(end > source->line_num) end = source->line_num;
+    const KeyFormat* format = &source->format;
+    for(size_t line = index * KEY_HOST_LINES_PER_TASK; line < end; line++) {
+        KeyBitting* bitting = &source->bittings[line];
+        if(!key_codebook_parse_line(
+               source->lines[line], format->pin_num, source->codes[line], bitting)) {
+            source->status[line] = source->codes[line][0] ? KeyHostLineBad : KeyHostLineSkip;
+        } else if(!key_bitting_in_range(
+                      bitting, format->pin_num, format->min_depth_ind, format->max_depth_ind)) {
+            source->status[line] = KeyHostLineRange;
+        } else {
+            source->status[line] = KeyHostLineOk;
+            source->macs[line] =
+                key_bitting_macs_violations(bitting, format->pin_num, format->macs);
+        }
+    }
+}
+
+static bool key_host_source_open(
+    KeyHostSource* source,
+    const char* format_name,
+    const char* path,
+    unsigned workers) {
+    memset(source, 0, sizeof(KeyHostSource));
+    int32_t format_index = key_host_format(format_name);
+    if(format_index < 0 || !key_host_read_file(path, &source->text)) return false;
+    key_format_load(format_index, &source->format);
+
+    // Same lines as the app's reader: split at '\n', keep 63 bytes of each
+    size_t capacity = 1;
+    for(size_t i = 0; i < source->text.size; i++) {
+        if(source->text.data[i] == '\n') capacity++;
+    }
+    source->lines = malloc(capacity * sizeof(char*));
+    char* line = source->text.data;
+    char* end = source->text.data + source->text.size;
+    while(line < end) {
+        char* newline = memchr(line, '\n', end - line);
+        char* line_end = newline ? newline : end;
+        if(line_end - line > KEY_HOST_LINE_SIZE - 1) line_end = line + KEY_HOST_LINE_SIZE - 1;
+        *line_end = '\0';
+        source->lines[source->line_num++] = line;
+        line = newline ? newline + 1 : end;
+    }
+
+    source->codes = calloc(source->line_num, KEY_CODEBOOK_CODE_SIZE);
+    source->bittings = calloc(source->line_num, sizeof(KeyBitting));
+    source->status = calloc(source->line_num, 1);
+    source->macs = calloc(source->line_num, sizeof(uint32_t));
+    size_t tasks = (source->line_num + KEY_HOST_LINES_PER_TASK - 1) / KEY_HOST_LINES_PER_TASK;
+    key_pool_run(tasks, workers, key_host_source_task, source);
+    return true;
+}
+
+static void key_host_source_close(KeyHostSource* source) {
+    free(source->macs);
+    free(source->status);
+    free(source->bittings);
+    free(source->codes);
+    free(source->lines);
+    free(source->text.data);
+}
+
+// Report everything that would stop the app compiling the book, and MACS breaks
+static int key_host_validate(int argc, char** argv, unsigned workers) {
+    if(argc < 2) return -1;
+    KeyHostSource source;
+    if(!key_host_source_open(&source, argv[0], argv[1], workers)) return 1;
+    size_t codes = 0;
+    size_t errors = 0;
+    size_t macs = 0;
+    const char* previous = NULL;
+    for(size_t line = 0; line < source.line_num; line++) {
+        const char* code = source.codes[line];
+        const char* error = NULL;
+        switch(source.status[line]) {
+        case KeyHostLineSkip:
+            continue;
+        case KeyHostLineBad:
+            error = "bad line";
+            break;
+        case KeyHostLineRange:
+            error = "depth out of range";
+            break;
+        default:
+            if(previous && key_codebook_compare(previous, code) >= 0) {
+                error = key_codebook_compare(previous, code) ? "out of order" : "duplicate code";
+            }
+            previous = code;
+            codes++;
+            break;
+        }
+        if(error) {
+            printf("%s:%zu: %s: %s\n", argv[1], line + 1, code, error);
+            errors++;
+        } else if(source.macs[line]) {
+            printf("%s:%zu: %s: breaks the MACS\n", argv[1], line + 1, code);
+            macs++;
+        }
+    }
+    if(codes > KEY_CODEBOOK_MAX_ENTRIES) {
+        printf("%s: %zu codes, a book holds %u\n", argv[1], codes, KEY_CODEBOOK_MAX_ENTRIES);
+        errors++;
+    }
+    printf("%zu codes, %zu errors, %zu MACS breaks\n", codes, errors, macs);
+    key_host_source_close(&source);
+    return errors ? 1 : 0;
+}
+
+static bool key_host_file_write(uint32_t offset, const void* data, size_t size, void* context) {
+    return pwrite(fileno(context), data, size, offset) == (ssize_t)size;
+}
+
+// Compile a code book exactly as the app does on first use
+static int key_host_codebook(int argc, char** argv, unsigned workers) {
+    if(argc < 3) return -1;
+    KeyHostSource source;
+    if(!key_host_source_open(&source, argv[0], argv[1], workers)) return 1;
+    FILE* book = fopen(argv[2], "wb");
+    if(!book) {
+        perror(argv[2]);
+        key_host_source_close(&source);
+        return 1;
+    }
+    KeyCodebookBuilder* builder =
+        key_codebook_builder_alloc(source.format.pin_num, key_host_file_write, book);
+    KeyCodebookStatus status = KeyCodebookOk;
+    size_t line = 0;
+    for(; line < source.line_num && status == KeyCodebookOk; line++) {
+        if(source.status[line] == KeyHostLineSkip) continue;
+        if(source.status[line] != KeyHostLineOk) {
+            status = KeyCodebookBadSource;
+        } else {
+            status = key_codebook_builder_add(builder, source.codes[line], &source.bittings[line]);
+        }
+    }
+    // Stamped with the source's time, as the app does. A copy to the card that changes the time
+    // only costs a compile on the Flipper.
+    struct stat source_stat;
+    uint32_t source_timestamp = stat(argv[1], &source_stat) == 0 ? source_stat.st_mtime : 0;
+    if(status == KeyCodebookOk) {
+        status = key_codebook_builder_finish(builder, source.text.size, source_timestamp);
+    } else {
+        printf("%s:%zu: %s: stopped here\n", argv[1], line, source.codes[line - 1]);
+    }
+    key_codebook_builder_free(builder);
+    if(fclose(book)) status = KeyCodebookIoError;
+    if(status != KeyCodebookOk) remove(argv[2]);
+    key_host_source_close(&source);
+    return status == KeyCodebookOk ? 0 : 1;
+}
+
+typedef struct {
+    const char* out_dir;
+    char** paths;
+    KeyFileStatus* status;
+} KeyHostConvert;
+
+static size_t key_host_text_read(void* data, size_t size, void* context) {
+    KeyHostText* text = context;
+    if(size > text->size) size = text->size;
+    memcpy(data, text->data, size);
+    text->data += size;
+    text->size -= size;
+    return size;
+}
+
+static void key_host_convert_task(size_t index, unsigned worker, void* context) {
+    (void)worker;
+    KeyHostConvert* convert = context;
+    const char* path = convert->paths[index];
+    KeyHostText text;
+    KeyFileStatus status = KeyFileIoError;
+    if(key_host_read_file(path, &text)) {
+        KeyHostText reader = text;
+        uint32_t format_index;
+        KeyBitting bitting;
+        KeyHistory* history = malloc(sizeof(KeyHistory));
+        status = key_file_parse(key_host_text_read, &reader, &format_index, &bitting, history);
+        if(status == KeyFileOk) {
+            KeyHostBuffer out = {0};
+            key_file_write(format_index, &bitting, history, key_host_buffer_write, &out);
+            const char* name = strrchr(path, '/');
+            size_t size = strlen(convert->out_dir) + strlen(name ? name : path) + 2;
+            char* out_path = malloc(size);
+            snprintf(out_path, size, "%s/%s", convert->out_dir, name ? name + 1 : path);
+            if(!key_host_write_file(out_path, out.data, out.size)) status = KeyFileIoError;
+            free(out_path);
+            free(out.data);
+        }
+        free(history);
+        free(text.data);
+    }
+    convert->status[index] = status;
+}
+
+// Rewrite saved keys in the current file version, as the app would save them
+static int key_host_convert(int argc, char** argv, unsigned workers) {
+    if(argc < 2) return -1;
+    KeyHostConvert convert = {
+        .out_dir = argv[0],
+        .paths = argv + 1,
+        .status = calloc(argc - 1, sizeof(KeyFileStatus)),
+    };
+    mkdir(convert.out_dir, 0755);
+    key_pool_run(argc - 1, workers, key_host_convert_task, &convert);
+    static const char* messages[] = {
+        [KeyFileIoError] = "could not be read or written",
+        [KeyFileBadHeader] = "is not a key file of a known version",
+        [KeyFileUnknownFormat] = "has an unknown format",
+        [KeyFileBadBitting] = "has a bad bitting",
+        [KeyFileOutOfRange] = "has a depth out of range",
+        [KeyFileMacs] = "breaks the MACS",
+    };
+    int failed = 0;
+    for(int i = 0; i < argc - 1; i++) {
+        if(convert.status[i] == KeyFileOk) continue;
+        printf("%s %s\n", convert.paths[i], messages[convert.status[i]]);
+        failed++;
+    }
+    printf("%d converted, %d failed\n", argc - 1 - failed, failed);
+    free(convert.status);
+    return failed ? 1 : 0;
+}
+
+typedef struct {
+    FILE* queue;
+    FILE* out;
+} KeyHostGcode;
+
+static bool key_host_gcode_read_line(char* line, size_t size, void* context) {
+    KeyHostGcode* gcode = context;
+    if(!fgets(line, size, gcode->queue)) return false;
+    size_t length = strcspn(line, "\n");
+    if(line[length] != '\n') {
+        // Drop the rest of a long line, as the app does
+        int c;
+        while((c = fgetc(gcode->queue)) != EOF && c != '\n') {
+        }
+    }
+    line[length] = '\0';
+    return true;
+}
+
+static bool key_host_gcode_rewind(void* context) {
+    KeyHostGcode* gcode = context;
+    return fseek(gcode->queue, 0, SEEK_SET) == 0;
+}
+
+static bool key_host_gcode_write(const char* text, size_t size, void* context) {
+    KeyHostGcode* gcode = context;
+    return fwrite(text, 1, size, gcode->out) == size;
+}
+
+// Stream the toolpath of a cutting queue, the same file the app exports
+static int key_host_gcode(int argc, char** argv) {
+    if(argc < 2) return -1;
+    int32_t format_index = key_host_format(argv[0]);
+    if(format_index < 0) return 1;
+    KeyHostGcode gcode = {.queue = fopen(argv[1], "rb"), .out = stdout};
+    if(!gcode.queue) {
+        perror(argv[1]);
+        return 1;
+    }
+    if(argc > 2 && !(gcode.out = fopen(argv[2], "wb"))) {
+        perror(argv[2]);
+        fclose(gcode.queue);
+        return 1;
+    }
+    KeyGcodeTotals totals;
+    bool result = key_gcode_run(
+        format_index,
+        key_host_gcode_read_line,
+        key_host_gcode_rewind,
+        key_host_gcode_write,
+        &gcode,
+        &totals);
+    fclose(gcode.queue);
+    if(gcode.out != stdout && fclose(gcode.out)) result = false;
+    if(!result) {
+        perror(argc > 2 ? argv[2] : "stdout");
+        return 1;
+    }
+    fprintf(
+        stderr,
+        "%u keys, %u cuts, %u tools, %u bad lines, about %u min %u s\n",
+        totals.keys,
+        totals.cuts,
+        totals.tools,
+        totals.errors,
+        totals.seconds / 60,
+        totals.seconds % 60);
+    return totals.errors ? 1 : 0;
+}
+
+static const char* key_host_usage =
+    "usage: keycopier [-j workers] command ...\n"
+    "  formats                          list the key formats\n"
+    "  enumerate FORMAT [OUT]           count, or write, every bitting keeping to the MACS\n"
+    "  validate FORMAT SOURCE           check a code book source\n"
+    "  codebook FORMAT SOURCE BOOK.kcb  compile a code book as the app would\n"
+    "  convert OUT_DIR FILE.keycopy...  rewrite saved keys in the current version\n"
+    "  gcode FORMAT QUEUE [OUT]         write the toolpath of a cutting queue\n";
+
+int main(int argc, char** argv) {
+    unsigned workers = key_pool_workers();
+    argc--;
+    argv++;
+    if(argc >= 2 && !strcmp(argv[0], "-j")) {
+        workers = atoi(argv[1]) > 0 ? (unsigned)atoi(argv[1]) : 1;
+        argc -= 2;
+        argv += 2;
+    }
+    int result = -1;
+    if(argc < 1) {
+    } else if(!strcmp(argv[0], "formats")) {
+        result = key_host_formats();
+    } else if(!strcmp(argv[0], "enumerate")) {
+        result = key_host_enumerate(argc - 1, argv + 1, workers);
+    } else if(!strcmp(argv[0], "validate")) {
+        result = key_host_validate(argc - 1, argv + 1, workers);
+    } else if(!strcmp(argv[0], "codebook")) {
+        result = key_host_codebook(argc - 1, argv + 1, workers);
+    } else if(!strcmp(argv[0], "convert")) {
+        result = key_host_convert(argc - 1, argv + 1, workers);
+    } else if(!strcmp(argv[0], "gcode")) {
+        result = key_host_gcode(argc - 1, argv + 1);
+    }
+    if(result < 0) {
+        fputs(key_host_usage, stderr);
+        return 2;
+    }
+    return result;
+}
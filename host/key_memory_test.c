@@ -0,0 +1,229 @@
+// The memory budgets of key_memory.h, held to the app code that builds on a PC. Each call the
+// app wraps in a probe is made here the way its callback makes it, under a probe of the same
+// name: on a thread with the app's stack, or the GUI's for drawing, with every block taken from
+// the heap counted by the shim. Each call starts from fresh low-water marks, so each gets its
+// own figures. The test fails when key_memory_check finds a probe over budget, and when a call
+// made to take more than the budget gets past the check. Heap taken by the firmware, such as
+// the storage service's file buffers, is not counted here; strict debug builds on the Flipper
+// count it.
+
+#include "key_analysis.h"
+#include "key_backup.h"
+#include "key_bench.h"
+#include "key_bitting.h"
+#include "key_file.h"
+#include "key_formats.h"
+#include "key_identify.h"
+#include "key_library.h"
+#include "key_memory.h"
+#include "key_pinning.h"
+#include "key_render.h"
+#include <stdio.h>
+#include <string.h>
+
+// The app's stack from application.fam, and the firmware GUI service's, doubled: glibc's
+// snprintf alone takes close to 3 KB of stack here, where the Flipper's takes a few hundred bytes
+#define KEY_TEST_STACK_SCALE 2
+#define KEY_TEST_APP_STACK (4 * 1024 * KEY_TEST_STACK_SCALE)
+#define KEY_TEST_GUI_STACK (2 * 1024 * KEY_TEST_STACK_SCALE)
+#define KEY_TEST_LIBRARY_KEYS 2000
+#define KEY_TEST_BACKUP_KEYS 500
+#define KEY_TEST_JOB_LINES 1000
+
+typedef struct {
+    uint8_t format_index;
+    KeyBitting bitting;
+} KeyTestKey;
+
+static KeyTestKey library[KEY_TEST_LIBRARY_KEYS];
+static uint64_t state = 0x4B4559;
+
+// The library is made up in RAM in place of key_library's, as in key_analysis_bench
+bool key_library_for_each(Storage* storage, KeyLibraryCallback callback, void* context) {
+    UNUSED(storage);
+    char name[KEY_LIBRARY_NAME_SIZE];
+    for(uint32_t i = 0; i < KEY_TEST_LIBRARY_KEYS; i++) {
+        snprintf(name, sizeof(name), "key%05u", (unsigned)i);
+        if(!callback(name, context)) return false;
+    }
+    return true;
+}
+
+KeyFileStatus key_library_read(
+    Storage* storage,
+    const char* name,
+    uint32_t* format_index,
+    KeyBitting* bitting) {
+    UNUSED(storage);
+    uint32_t i = strtoul(name + 3, NULL, 10);
+    *format_index = library[i].format_index;
+    *bitting = library[i].bitting;
+    return KeyFileOk;
+}
+
+// Depths one step apart at most, so every key keeps to its format's MACS
+static void key_test_bitting(uint32_t format_index, KeyBitting* bitting) {
+    memset(bitting, 0, sizeof(KeyBitting));
+    uint8_t min = key_format_catalog.min_depth_ind[format_index];
+    for(uint8_t pin = 0; pin < key_format_catalog.pin_num[format_index]; pin++) {
+        key_bitting_set(bitting, pin, min + key_bench_random(&state) % 2);
+    }
+}
+
+static void key_test_identify(void) {
+    KeyIdentifyObservation observation = {
+        .pin_num = key_format_catalog.pin_num[0],
+        .sides = key_format_catalog.sides[0],
+        .stop = key_format_catalog.stop[0],
+        .first_pin = key_format_catalog.first_pin[0],
+        .pin_increment = key_format_catalog.pin_increment[0],
+    };
+    KeyIdentifyMatch matches[KEY_IDENTIFY_MATCHES];
+    KEY_MEMORY_BEGIN();
+    key_identify_rank(&observation, matches, KEY_IDENTIFY_MATCHES);
+    KEY_MEMORY_END("identify");
+}
+
+typedef struct {
+    uint32_t line;
+} KeyTestJob;
+
+static bool key_test_job_read_line(char* line, size_t size, void* context) {
+    KeyTestJob* job = context;
+    if(job->line == KEY_TEST_JOB_LINES) return false;
+    KeyBitting bitting;
+    key_test_bitting(0, &bitting);
+    char text[KEY_BITTING_MAX_PINS * 3];
+    key_bitting_to_str(&bitting, key_format_catalog.pin_num[0], text, sizeof(text));
+    snprintf(line, size, "door %lu,%s", (unsigned long)job->line++, text);
+    return true;
+}
+
+// Plans and archives go to the SD card in the app, so nothing written is kept
+static bool key_test_drop(const char* text, size_t size, void* context) {
+    UNUSED(text);
+    UNUSED(size);
+    UNUSED(context);
+    return true;
+}
+
+static void key_test_rekey(void) {
+    KeyTestJob job = {0};
+    KeyPinningTotals totals;
+    KEY_MEMORY_BEGIN();
+    key_pinning_run(0, key_test_job_read_line, key_test_drop, &job, &totals);
+    KEY_MEMORY_END("rekey");
+}
+
+typedef struct {
+    uint8_t data[KEY_BACKUP_FILE_MAX];
+    size_t size;
+} KeyTestFile;
+
+static bool key_test_file_write(const char* text, size_t size, void* context) {
+    KeyTestFile* file = context;
+    if(file->size + size > sizeof(file->data)) return false;
+    memcpy(file->data + file->size, text, size);
+    file->size += size;
+    return true;
+}
+
+static bool key_test_archive_write(const void* data, size_t size, void* context) {
+    return key_test_drop(data, size, context);
+}
+
+static void key_test_backup(void) {
+    static KeyTestFile file;
+    char name[KEY_LIBRARY_NAME_SIZE];
+    KEY_MEMORY_BEGIN();
+    KeyBackupWriter* writer = key_backup_writer_alloc(true, 1, key_test_archive_write, NULL);
+    for(uint32_t i = 0; i < KEY_TEST_BACKUP_KEYS; i++) {
+        snprintf(name, sizeof(name), "key%05u", (unsigned)i);
+        file.size = 0;
+        key_file_write(
+            library[i].format_index, &library[i].bitting, NULL, key_test_file_write, &file);
+        key_backup_writer_add_key(writer, name, file.data, file.size);
+    }
+    key_backup_writer_finish(writer);
+    key_backup_writer_free(writer);
+    KEY_MEMORY_END("backup");
+}
+
+static void key_test_analyze(void) {
+    KeyAnalysisSummary summary;
+    KEY_MEMORY_BEGIN();
+    key_analysis_run(NULL, &summary);
+    KEY_MEMORY_END("analyze");
+}
+
+static void key_test_app(void* context) {
+    UNUSED(context);
+    key_memory_init();
+    key_shim_memory_reset();
+    key_test_identify();
+    key_shim_memory_reset();
+    key_test_rekey();
+    key_shim_memory_reset();
+    key_test_backup();
+    key_shim_memory_reset();
+    key_test_analyze();
+}
+
+static void key_test_draw(void* context) {
+    UNUSED(context);
+    static Canvas canvas;
+    static KeyRenderGeometry geometry;
+    for(uint32_t format_index = 0; format_index < FORMAT_NUM; format_index++) {
+        KeyFormat format;
+        key_format_load(format_index, &format);
+        key_render_geometry(&geometry, &format);
+        KeyBitting bitting;
+        key_test_bitting(format_index, &bitting);
+        key_shim_memory_reset();
+        KEY_MEMORY_BEGIN();
+        key_render_draw(&canvas, &geometry, &bitting, 0);
+        key_render_marks(&canvas, &geometry, &bitting, &bitting, 0);
+        KEY_MEMORY_END("draw");
+    }
+}
+
+// Takes more heap than any call may
+static void key_test_over(void* context) {
+    UNUSED(context);
+    key_memory_init();
+    key_shim_memory_reset();
+    KEY_MEMORY_BEGIN();
+    void* block = malloc(KEY_MEMORY_HEAP_BUDGET + 1);
+    key_bench_keep((uintptr_t)block);
+    free(block);
+    KEY_MEMORY_END("over");
+}
+
+int main(void) {
+    storage_simply_mkdir(NULL, "build");
+    storage_simply_mkdir(NULL, STORAGE_APP_DATA_PATH_PREFIX);
+    for(uint32_t i = 0; i < KEY_TEST_LIBRARY_KEYS; i++) {
+        library[i].format_index = key_bench_random(&state) % FORMAT_NUM;
+        key_test_bitting(library[i].format_index, &library[i].bitting);
+    }
+    bool result = true;
+
+    key_shim_thread_run(key_test_app, NULL, KEY_TEST_APP_STACK);
+    key_shim_thread_run(key_test_draw, NULL, KEY_TEST_GUI_STACK);
+    static char report[KEY_MEMORY_REPORT_SIZE];
+    key_memory_report(report, sizeof(report));
+    printf("%s\n", report);
+    const char* over = key_memory_check();
+    if(over) {
+        fprintf(stderr, "key_memory: %s is over the memory budget\n", over);
+        result = false;
+    }
+
+    key_shim_thread_run(key_test_over, NULL, KEY_TEST_APP_STACK);
+    over = key_memory_check();
+    if(!over || strcmp(over, "over")) {
+        fprintf(stderr, "key_memory: a call over the heap budget was not caught\n");
+        result = false;
+    }
+    return result ? 0 : 1;
+}
@@ -0,0 +1,209 @@
+// The name index against a brute force list. Random inserts, removes and prefix searches run
+// over a pool of names that share prefixes and differ in case, so blocks split, empty and move.
+// Every search must list what the brute force list holds, in the same order, and the index must
+// reopen clean throughout. At the end every name is removed and nothing may be left. Both parts
+// live in RAM.
+
+#include "key_bench.h"
+#include "key_names.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEY_TEST_POOL 4000
+#define KEY_TEST_OPERATIONS 40000
+#define KEY_TEST_LIST_EVERY 1000
+
+typedef struct {
+    uint8_t* data;
+    uint32_t size;
+    uint32_t capacity;
+} KeyTestPart;
+
+static KeyTestPart parts[2];
+static bool holes;
+static char pool[KEY_TEST_POOL][KEY_NAMES_NAME_SIZE];
+static bool present[KEY_TEST_POOL];
+
+static bool key_test_read(
+    KeyNamesPart part,
+    uint32_t offset,
+    void* data,
+    size_t size,
+    void* context) {
+    (void)context;
+    KeyTestPart* p = &parts[part];
+    if(offset + size > p->size) return false;
+    memcpy(data, p->data + offset, size);
+    return true;
+}
+
+static bool key_test_write(
+    KeyNamesPart part,
+    uint32_t offset,
+    const void* data,
+    size_t size,
+    void* context) {
+    (void)context;
+    KeyTestPart* p = &parts[part];
+    // Files on the SD card grow by appending, so a write past the end would leave a hole
+    if(offset > p->size) holes = true;
+    if(offset + size > p->capacity) {
+        p->capacity = (offset + size) * 2;
+        p->data = realloc(p->data, p->capacity);
+    }
+    memcpy(p->data + offset, data, size);
+    if(offset + size > p->size) p->size = offset + size;
+    return true;
+}
+
+static bool key_test_truncate(KeyNamesPart part, uint32_t size, void* context) {
+    (void)context;
+    if(size > parts[part].size) return false;
+    parts[part].size = size;
+    return true;
+}
+
+// Few letters, so names share long prefixes and some differ only in case
+static void key_test_name(char* name, uint64_t* state) {
+    static const char letters[] = "abAB01 -";
+    size_t length = 1 + key_bench_random(state) % (key_bench_random(state) % 4 ? 8 : 31);
+    for(size_t i = 0; i < length; i++) {
+        name[i] = letters[key_bench_random(state) % (sizeof(letters) - 1)];
+    }
+    name[length] = '\0';
+}
+
+typedef struct {
+    const char* names[KEY_TEST_POOL];
+    uint32_t count;
+    bool overflow;
+} KeyTestList;
+
+static bool key_test_collect(const char* name, void* context) {
+    KeyTestList* list = context;
+    if(list->count == KEY_TEST_POOL) {
+        list->overflow = true;
+        return false;
+    }
+    // The block a name came from is gone by the time the search returns
+    list->names[list->count++] = strdup(name);
+    return true;
+}
+
+static int key_test_order(const void* a, const void* b) {
+    return key_names_compare(*(const char* const*)a, *(const char* const*)b);
+}
+
+// What a search for prefix should list
+static void key_test_brute_force(KeyTestList* list, const char* prefix) {
+    list->count = 0;
+    for(uint32_t i = 0; i < KEY_TEST_POOL; i++) {
+        if(present[i] && key_names_has_prefix(pool[i], prefix))
+            list->names[list->count++] = pool[i];
+    }
+    qsort(list->names, list->count, sizeof(list->names[0]), key_test_order);
+}
+
+static bool key_test_search(const KeyNames* names, const char* prefix) {
+    static KeyTestList found;
+    static KeyTestList expected;
+    found.count = 0;
+    found.overflow = false;
+    bool same = key_names_search(names, prefix, key_test_collect, &found) == KeyNamesOk;
+    key_test_brute_force(&expected, prefix);
+    same = same && !found.overflow && found.count == expected.count;
+    for(uint32_t i = 0; i < found.count; i++) {
+        if(same && strcmp(found.names[i], expected.names[i])) same = false;
+        free((void*)found.names[i]);
+    }
+    return same;
+}
+
+static bool key_test_in_pool(uint32_t count, const char* name) {
+    for(uint32_t i = 0; i < count; i++) {
+        if(!strcmp(pool[i], name)) return true;
+    }
+    return false;
+}
+
+static bool key_test_reopen(void) {
+    KeyNames reopened;
+    return key_names_open(
+               &reopened, key_test_read, key_test_write, key_test_truncate, NULL) ==
+           KeyNamesOk;
+}
+
+int main(void) {
+    uint64_t state = 0x4B4559;
+    for(uint32_t i = 0; i < KEY_TEST_POOL; i++) {
+        do {
+            key_test_name(pool[i], &state);
+        } while(key_test_in_pool(i, pool[i]));
+    }
+
+    KeyNames names;
+    bool result = key_names_create(
+                      &names, key_test_read, key_test_write, key_test_truncate, NULL) ==
+                  KeyNamesOk;
+    uint32_t wrong = 0;
+    uint32_t searches = 0;
+    uint16_t max_blocks = 0;
+    for(uint32_t operation = 0; operation < KEY_TEST_OPERATIONS && result; operation++) {
+        uint32_t i = key_bench_random(&state) % KEY_TEST_POOL;
+        uint32_t kind = key_bench_random(&state) % 10;
+        if(kind < 6) {
+            if(key_names_insert(&names, pool[i]) != KeyNamesOk) wrong++;
+            present[i] = true;
+        } else if(kind < 9) {
+            KeyNamesStatus expected = present[i] ? KeyNamesOk : KeyNamesNotFound;
+            if(key_names_remove(&names, pool[i]) != expected) wrong++;
+            present[i] = false;
+        } else {
+            char prefix[KEY_NAMES_NAME_SIZE];
+            size_t length = key_bench_random(&state) % 4;
+            snprintf(prefix, sizeof(prefix), "%.*s", (int)length, pool[i]);
+            if(!key_test_search(&names, prefix)) wrong++;
+            searches++;
+        }
+        if(names.header.blocks > max_blocks) max_blocks = names.header.blocks;
+        if(operation % KEY_TEST_LIST_EVERY == 0) {
+            if(!key_test_search(&names, "")) wrong++;
+            if(!key_test_reopen()) result = false;
+        }
+    }
+    uint32_t count = 0;
+    for(uint32_t i = 0; i < KEY_TEST_POOL; i++) {
+        count += present[i];
+    }
+    printf(
+        "%lu operations, %lu searches, %lu names in %u blocks, at most %u blocks\n",
+        (unsigned long)KEY_TEST_OPERATIONS,
+        (unsigned long)searches,
+        (unsigned long)names.header.names,
+        names.header.blocks,
+        max_blocks);
+    if(names.header.names != count) wrong++;
+    if(key_names_insert(&names, "") != KeyNamesBadName ||
+       key_names_insert(&names, "a name far too long for the index") != KeyNamesBadName)
+        wrong++;
+
+    for(uint32_t i = 0; i < KEY_TEST_POOL; i++) {
+        if(present[i] && key_names_remove(&names, pool[i]) != KeyNamesOk) wrong++;
+        present[i] = false;
+    }
+    if(names.header.names || names.header.blocks || parts[KeyNamesPartBlocks].size) wrong++;
+
+    if(wrong) {
+        fprintf(
+            stderr, "key_names: %lu operations disagree with brute force\n", (unsigned long)wrong);
+        result = false;
+    }
+    if(holes || !key_test_reopen()) {
+        fprintf(stderr, "key_names: the index was left unsound\n");
+        result = false;
+    }
+    free(parts[KeyNamesPartBlocks].data);
+    free(parts[KeyNamesPartDirectory].data);
+    return result ? 0 : 1;
+}
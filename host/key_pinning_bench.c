@@ -0,0 +1,131 @@
+// Large rekey jobs through the pinning planner: cylinders of random change keys, with a new
+// master key every few hundred lines. A job is made up one line at a time as the planner asks
+// for it, and the plan is counted and dropped as it is written, so the run also shows that
+// memory stays flat however long the job is. Jobs of every format are planned as well.
+
+#include "key_bench.h"
+#include "key_bitting.h"
+#include "key_formats.h"
+#include "key_pinning.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#define KEY_BENCH_MASTER_EVERY 500
+#define KEY_BENCH_FORMAT_LINES 100000
+
+typedef struct {
+    uint64_t state;
+    uint32_t lines;
+    uint32_t line; // next to feed
+    uint32_t cylinders;
+    uint32_t format_index;
+    bool master;
+    uint64_t written;
+} KeyBenchJob;
+
+// A bitting that keeps to the format's MACS
+static void key_bench_bitting(KeyBenchJob* job, char* str, size_t size) {
+    uint8_t pin_num = key_format_catalog.pin_num[job->format_index];
+    int min = key_format_catalog.min_depth_ind[job->format_index];
+    int max = key_format_catalog.max_depth_ind[job->format_index];
+    int macs = key_format_catalog.macs[job->format_index];
+    KeyBitting bitting = {0};
+    int depth = min + key_bench_random(&job->state) % (max - min + 1);
+    for(uint8_t pin = 0; pin < pin_num; pin++) {
+        if(pin > 0) {
+            depth += (int)(key_bench_random(&job->state) % (2 * macs + 1)) - macs;
+            if(depth < min) depth = min;
+            if(depth > max) depth = max;
+        }
+        key_bitting_set(&bitting, pin, depth);
+    }
+    key_bitting_to_str(&bitting, pin_num, str, size);
+}
+
+static bool key_bench_read_line(char* line, size_t size, void* context) {
+    KeyBenchJob* job = context;
+    if(job->line == job->lines) return false;
+    uint32_t n = job->line++;
+    char bitting[KEY_BITTING_MAX_PINS * 3 + 1];
+    if(n == 0) {
+        snprintf(line, size, "FORMAT,%s", key_format_info[job->format_index].format_name);
+    } else if(n % KEY_BENCH_MASTER_EVERY == 0) {
+        // every other master block is change keys alone
+        job->master = !job->master;
+        if(job->master) {
+            key_bench_bitting(job, bitting, sizeof(bitting));
+            snprintf(line, size, "MASTER,%s", bitting);
+        } else {
+            snprintf(line, size, "MASTER,");
+        }
+    } else {
+        key_bench_bitting(job, bitting, sizeof(bitting));
+        snprintf(line, size, "door %lu,%s", (unsigned long)n, bitting);
+        job->cylinders++;
+    }
+    return true;
+}
+
+static bool key_bench_write(const char* text, size_t size, void* context) {
+    (void)text;
+    KeyBenchJob* job = context;
+    job->written += size;
+    return true;
+}
+
+static long key_bench_max_rss_kb(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Plan a job and print its row; false if any cylinder was not planned
+static bool key_bench_job(const char* label, uint32_t format_index, uint32_t lines) {
+    KeyBenchJob job = {.state = 0x4B4559, .lines = lines, .format_index = format_index};
+    KeyPinningTotals totals;
+    double start = key_bench_now();
+    bool ok = key_pinning_run(0, key_bench_read_line, key_bench_write, &job, &totals);
+    double seconds = key_bench_now() - start;
+    printf(
+        "%-6s %10lu %10.3f %12.0f %10lu %12llu %10ld\n",
+        label,
+        (unsigned long)job.lines,
+        seconds,
+        totals.cylinders / seconds,
+        (unsigned long)totals.chambers,
+        (unsigned long long)job.written,
+        key_bench_max_rss_kb());
+    if(ok && !totals.errors && totals.cylinders == job.cylinders) return true;
+    fprintf(
+        stderr,
+        "%s: planned %lu of %lu cylinders, %lu errors\n",
+        label,
+        (unsigned long)totals.cylinders,
+        (unsigned long)job.cylinders,
+        (unsigned long)totals.errors);
+    return false;
+}
+
+int main(void) {
+    static const uint32_t sizes[] = {10000, 1000000, 4000000};
+    bool result = true;
+    printf(
+        "%-6s %10s %10s %12s %10s %12s %10s\n",
+        "format",
+        "lines",
+        "seconds",
+        "cylinders/s",
+        "chambers",
+        "plan bytes",
+        "max RSS KB");
+    for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        result &= key_bench_job(key_format_info[0].format_name, 0, sizes[i]);
+    }
+    for(uint32_t format_index = 1; format_index < FORMAT_NUM; format_index++) {
+        result &= key_bench_job(
+            key_format_info[format_index].format_name, format_index, KEY_BENCH_FORMAT_LINES);
+    }
+    return result ? 0 : 1;
+}
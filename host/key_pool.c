@@ -0,0 +1,105 @@
+#include "key_pool.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// The indices a worker has yet to run. The owner takes from the front, thieves from the back.
+typedef struct {
+    pthread_mutex_t lock;
+    size_t begin;
+    size_t end;
+} KeyPoolQueue;
+
+typedef struct {
+    KeyPoolQueue* queues;
+    unsigned workers;
+    KeyPoolTask task;
+    void* context;
+} KeyPool;
+
+typedef struct {
+    KeyPool* pool;
+    unsigned worker;
+} KeyPoolWorker;
+
+unsigned key_pool_workers(void) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    return online > 0 ? (unsigned)online : 1;
+}
+
+static bool key_pool_take(KeyPoolQueue* queue, size_t* index) {
+    pthread_mutex_lock(&queue->lock);
+    bool taken = queue->begin < queue->end;
+    if(taken) *index = queue->begin++;
+    pthread_mutex_unlock(&queue->lock);
+    return taken;
+}
+
+// Move the back half of the first non-empty queue after ours into ours and take one of it
+static bool key_pool_steal(KeyPool* pool, unsigned thief, size_t* index) {
+    for(unsigned i = 1; i < pool->workers; i++) {
+        KeyPoolQueue* victim = &pool->queues[(thief + i) % pool->workers];
+        pthread_mutex_lock(&victim->lock);
+        size_t left = victim->end - victim->begin;
+        size_t begin = victim->end - (left + 1) / 2;
+        size_t end = victim->end;
+        victim->end = begin;
+        pthread_mutex_unlock(&victim->lock);
+        if(begin == end) continue;
+
+        KeyPoolQueue* queue = &pool->queues[thief];
+        pthread_mutex_lock(&queue->lock);
+        queue->begin = begin + 1;
+        queue->end = end;
+        pthread_mutex_unlock(&queue->lock);
+        *index = begin;
+        return true;
+    }
+    return false;
+}
+
+// No task adds work, so once every queue is empty there is nothing left to steal
+static void* key_pool_worker(void* context) {
+    KeyPoolWorker* worker = context;
+    KeyPool* pool = worker->pool;
+    size_t index;
+    while(key_pool_take(&pool->queues[worker->worker], &index) ||
+          key_pool_steal(pool, worker->worker, &index)) {
+        pool->task(index, worker->worker, pool->context);
+    }
+    return NULL;
+}
+
+void key_pool_run(size_t count, unsigned workers, KeyPoolTask task, void* context) {
+    if(workers > count) workers = count ? count : 1;
+    KeyPool pool = {
+        .queues = calloc(workers, sizeof(KeyPoolQueue)),
+        .workers = workers,
+        .task = task,
+        .context = context,
+    };
+    KeyPoolWorker* worker = calloc(workers, sizeof(KeyPoolWorker));
+    pthread_t* threads = calloc(workers, sizeof(pthread_t));
+    for(unsigned i = 0; i < workers; i++) {
+        pthread_mutex_init(&pool.queues[i].lock, NULL);
+        pool.queues[i].begin = count * i / workers;
+        pool.queues[i].end = count * (i + 1) / workers;
+        worker[i].pool = &pool;
+        worker[i].worker = i;
+    }
+    // The calling thread is worker 0
+    for(unsigned i = 1; i < workers; i++) {
+        pthread_create(&threads[i], NULL, key_pool_worker, &worker[i]);
+    }
+    key_pool_worker(&worker[0]);
+    for(unsigned i = 1; i < workers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    for(unsigned i = 0; i < workers; i++) {
+        pthread_mutex_destroy(&pool.queues[i].lock);
+    }
+    free(threads);
+    free(worker);
+    free(pool.queues);
+}
@@ -0,0 +1,17 @@
+#ifndef KEY_POOL_H
+#define KEY_POOL_H
+
+#include <stddef.h>
+
+// Called once for every index, on whichever worker got to it
+typedef void (*KeyPoolTask)(size_t index, unsigned worker, void* context);
+
+// Online cores, at least 1
+unsigned key_pool_workers(void);
+
+// Run task for indices 0 to count - 1 on workers threads and wait for all of them. Each worker
+// starts on an even share of the indices and, once it runs out, steals half of what is left of
+// another worker's share, so uneven tasks still keep every core busy.
+void key_pool_run(size_t count, unsigned workers, KeyPoolTask task, void* context);
+
+#endif // KEY_POOL_H
@@ -0,0 +1,95 @@
+// The measure screen's contour drawing, timed by key class. Every format is drawn on the same
+// random keys at random pans; a frame is a cleared canvas and one key_render_draw, as the draw
+// callback has. Each format is timed a few times over and the fastest run kept, so a busy
+// machine does not swing the numbers from one run to the next.
+
+#include "key_bench.h"
+#include "key_bitting.h"
+#include "key_formats.h"
+#include "key_render.h"
+#include <stdio.h>
+#include <string.h>
+
+#define KEY_BENCH_KEYS 256
+#define KEY_BENCH_ROUNDS 40
+#define KEY_BENCH_RUNS 5
+
+typedef struct {
+    uint64_t frames;
+    double seconds;
+} KeyBenchClass;
+
+// By sides - 1, then stop - 1
+static const char* const key_bench_class_names[2][2] = {
+    {"single shoulder", "single tip"},
+    {"double shoulder", "double tip"},
+};
+
+int main(void) {
+    static KeyBenchClass classes[2][2];
+    static KeyBitting bittings[KEY_BENCH_KEYS];
+    static int16_t views_px[KEY_BENCH_KEYS];
+    static Canvas canvas;
+    static KeyRenderGeometry geometry;
+    uint64_t state = 0x4B4559;
+    uint64_t pixels = 0;
+
+    for(uint32_t format_index = 0; format_index < FORMAT_NUM; format_index++) {
+        KeyFormat format;
+        key_format_load(format_index, &format);
+        key_render_geometry(&geometry, &format);
+        const int spread = format.max_depth_ind - format.min_depth_ind + 1;
+        const int pan_px = geometry.length_px > KEY_RENDER_WIDTH ?
+                               geometry.length_px - KEY_RENDER_WIDTH + 1 :
+                               1;
+        for(uint32_t key = 0; key < KEY_BENCH_KEYS; key++) {
+            memset(&bittings[key], 0, sizeof(KeyBitting));
+            for(uint8_t pin = 0; pin < format.pin_num; pin++) {
+                key_bitting_set(
+                    &bittings[key],
+                    pin,
+                    format.min_depth_ind + key_bench_random(&state) % spread);
+            }
+            views_px[key] = key_bench_random(&state) % pan_px;
+        }
+
+        double fastest = 0;
+        for(uint32_t run = 0; run < KEY_BENCH_RUNS; run++) {
+            double start = key_bench_now();
+            for(uint32_t round = 0; round < KEY_BENCH_ROUNDS; round++) {
+                for(uint32_t key = 0; key < KEY_BENCH_KEYS; key++) {
+                    memset(canvas.xbm, 0, sizeof(canvas.xbm));
+                    canvas_set_color(&canvas, ColorBlack);
+                    key_render_draw(&canvas, &geometry, &bittings[key], views_px[key]);
+                }
+                pixels += canvas.xbm[KEY_RENDER_LAYER_BYTES / 2];
+            }
+            double seconds = key_bench_now() - start;
+            if(!run || seconds < fastest) fastest = seconds;
+        }
+        KeyBenchClass* class = &classes[format.sides == 2][format.stop == 2];
+        class->seconds += fastest;
+        class->frames += (uint64_t)KEY_BENCH_ROUNDS * KEY_BENCH_KEYS;
+    }
+    key_bench_keep(pixels);
+
+    printf("%u formats, %u keys each\n", FORMAT_NUM, KEY_BENCH_KEYS);
+    printf("%-16s %10s %10s\n", "class", "frames", "ns/frame");
+    uint64_t frames = 0;
+    double seconds = 0;
+    for(int sides = 0; sides < 2; sides++) {
+        for(int stop = 0; stop < 2; stop++) {
+            const KeyBenchClass* class = &classes[sides][stop];
+            if(!class->frames) continue;
+            printf(
+                "%-16s %10llu %10.1f\n",
+                key_bench_class_names[sides][stop],
+                (unsigned long long)class->frames,
+                class->seconds * 1e9 / class->frames);
+            frames += class->frames;
+            seconds += class->seconds;
+        }
+    }
+    printf("%-16s %10llu %10.1f\n", "all", (unsigned long long)frames, seconds * 1e9 / frames);
+    return 0;
+}
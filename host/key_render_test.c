@@ -0,0 +1,193 @@
+// Flanks of the contour renderer against the drill angle. Every depth of every pin of every
+// format is cut alone on an uncut blank and drawn both by key_render_draw, on a canvas,
+// and into a layer. The two must agree pixel for pixel, and every column of each flank must
+// sit within half a pixel of the exact flank of its drill angle, with no gaps between columns.
+
+#include "key_bitting.h"
+#include "key_copier.h"
+#include "key_formats.h"
+#include "key_render.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    uint32_t flanks;
+    uint32_t columns;
+    uint32_t off_angle; // columns more than half a pixel from the exact flank
+    uint32_t gaps;
+    double max_error_px;
+} KeyTestFlanks;
+
+static bool key_test_pixel(const uint8_t* xbm, int x, int y) {
+    return xbm[y * KEY_RENDER_STRIDE + x / 8] & (1 << (x % 8));
+}
+
+// key_render_draw also draws a tick over each pin center, which layers leave out
+static void key_test_clear_ticks(uint8_t* xbm, const KeyRenderGeometry* geometry, int view_px) {
+    for(uint8_t pin = 0; pin < geometry->pin_num; pin++) {
+        int x = geometry->pin_center_px[pin] - view_px;
+        if(x < 0 || x >= KEY_RENDER_WIDTH) continue;
+        for(int y = geometry->top_contour_px - 5; y <= geometry->top_contour_px; y++) {
+            xbm[y * KEY_RENDER_STRIDE + x / 8] &= ~(1 << (x % 8));
+        }
+    }
+}
+
+// Walk one flank out from the pin edge at edge_px, step columns at a time, over run_px more
+// columns. Each column's cut is its pixel nearest the uncut edge at contour_px, which lies the
+// other way from down. The uncut edge itself is left out, as the contour on either side of a
+// pin runs along it; a column with nothing below it is cut 0.
+static void key_test_flank(
+    KeyTestFlanks* flanks,
+    const uint8_t* layer,
+    double columns_per_row,
+    int edge_px,
+    int step,
+    int contour_px,
+    int down,
+    int depth_px,
+    int run_px) {
+    flanks->flanks++;
+    int last_px = depth_px;
+    for(int column = 0; column <= run_px; column++) {
+        int x = edge_px + step * column;
+        int cut_px = 0;
+        for(int row_px = 1; row_px <= depth_px; row_px++) {
+            if(key_test_pixel(layer, x, contour_px + down * row_px)) {
+                cut_px = row_px;
+                break;
+            }
+        }
+        flanks->columns++;
+        double exact_px = fmax(depth_px - column / columns_per_row, 0);
+        double error_px = fabs(cut_px - exact_px);
+        if(error_px > flanks->max_error_px) flanks->max_error_px = error_px;
+        if(error_px > 0.5 + 1e-9) flanks->off_angle++;
+        for(int row_px = max(cut_px, 1); row_px < last_px - 1; row_px++) {
+            if(!key_test_pixel(layer, x, contour_px + down * row_px)) {
+                flanks->gaps++;
+                break;
+            }
+        }
+        last_px = cut_px;
+    }
+}
+
+int main(void) {
+    static KeyRenderGeometry geometry;
+    static Canvas canvas;
+    static uint8_t layer[KEY_RENDER_LAYER_BYTES];
+    uint32_t mismatches = 0;
+    bool result = true;
+    printf(
+        "%-6s %6s %7s %8s %10s %6s %10s\n",
+        "format",
+        "angle",
+        "flanks",
+        "columns",
+        "off angle",
+        "gaps",
+        "max error");
+    for(uint32_t format_index = 0; format_index < FORMAT_NUM; format_index++) {
+        KeyFormat format;
+        key_format_load(format_index, &format);
+        key_render_geometry(&geometry, &format);
+        // tan(angle/2) is how far a flank runs for each row it drops
+        const double columns_per_row = tan(format.drill_angle / 2.0 / 180 * M_PI);
+        const int half_width_px = geometry.pin_half_width_px;
+        KeyTestFlanks flanks = {0};
+        for(uint8_t pin = 0; pin < format.pin_num; pin++) {
+            for(uint8_t depth = format.min_depth_ind + 1; depth <= format.max_depth_ind;
+                depth++) {
+                KeyBitting bitting = {0};
+                for(uint8_t i = 0; i < format.pin_num; i++) {
+                    key_bitting_set(&bitting, i, i == pin ? depth : format.min_depth_ind);
+                }
+                const int center_px = KEY_RENDER_WIDTH / 2;
+                const int16_t view_px = geometry.pin_center_px[pin] - center_px;
+                memset(&canvas, 0, sizeof(canvas));
+                canvas_set_color(&canvas, ColorBlack);
+                key_render_draw(&canvas, &geometry, &bitting, view_px);
+                key_render_layer(&geometry, &bitting, view_px, layer);
+                key_test_clear_ticks(canvas.xbm, &geometry, view_px);
+                key_test_clear_ticks(layer, &geometry, view_px);
+                if(memcmp(canvas.xbm, layer, KEY_RENDER_LAYER_BYTES) != 0) mismatches++;
+
+                // Flanks run to the uncut edge, or stop short of the neighbour pin
+                const int depth_px = geometry.depth_px[depth];
+                const int run_px = min(
+                    geometry.depth_run_px[depth], geometry.pin_step_px - 2 * half_width_px - 1);
+                // and those past the end pins stop at the shoulder and the level contour
+                const int left_run_px =
+                    pin == 0 ? min(run_px, center_px - half_width_px + view_px - 1) : run_px;
+                const int right_run_px =
+                    pin == format.pin_num - 1 ?
+                        min(run_px,
+                            geometry.level_contour_px - view_px - center_px - half_width_px - 1) :
+                        run_px;
+                key_test_flank(
+                    &flanks,
+                    layer,
+                    columns_per_row,
+                    center_px - half_width_px,
+                    -1,
+                    geometry.top_contour_px,
+                    1,
+                    depth_px,
+                    left_run_px);
+                key_test_flank(
+                    &flanks,
+                    layer,
+                    columns_per_row,
+                    center_px + half_width_px,
+                    1,
+                    geometry.top_contour_px,
+                    1,
+                    depth_px,
+                    right_run_px);
+                if(format.sides == 2) {
+                    key_test_flank(
+                        &flanks,
+                        layer,
+                        columns_per_row,
+                        center_px - half_width_px,
+                        -1,
+                        geometry.bottom_contour_px,
+                        -1,
+                        depth_px,
+                        left_run_px);
+                    key_test_flank(
+                        &flanks,
+                        layer,
+                        columns_per_row,
+                        center_px + half_width_px,
+                        1,
+                        geometry.bottom_contour_px,
+                        -1,
+                        depth_px,
+                        right_run_px);
+                }
+            }
+        }
+        printf(
+            "%-6s %6u %7lu %8lu %10lu %6lu %10.3f\n",
+            key_format_info[format_index].format_name,
+            format.drill_angle,
+            (unsigned long)flanks.flanks,
+            (unsigned long)flanks.columns,
+            (unsigned long)flanks.off_angle,
+            (unsigned long)flanks.gaps,
+            flanks.max_error_px);
+        if(flanks.off_angle || flanks.gaps) result = false;
+    }
+    if(mismatches) {
+        fprintf(
+            stderr,
+            "%lu keys drawn differently on a canvas and in a layer\n",
+            (unsigned long)mismatches);
+        result = false;
+    }
+    if(!result) fprintf(stderr, "key_render: flanks stray from the drill angle\n");
+    return result ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+// Stress test of the measure frame snapshot: one writer thread publishes frames as fast as it
+// can while reader threads read them. Every word of a frame holds its generation, so a reader
+// that sees two generations in one copy has a torn frame. Each reader must also never see the
+// generation go backwards.
+
+#include "key_snapshot.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define KEY_TEST_READERS 3
+#define KEY_TEST_FRAMES 5000000
+// About the size of KeyCopierFrame
+#define KEY_TEST_FRAME_WORDS 64
+
+typedef struct {
+    uint32_t words[KEY_TEST_FRAME_WORDS];
+} KeyTestFrame;
+
+typedef struct {
+    KeySnapshot snapshot;
+    KeyTestFrame slots[2];
+    atomic_bool done;
+} KeyTestShared;
+
+typedef struct {
+    KeyTestShared* shared;
+    uint64_t reads;
+    uint64_t retries;
+    uint64_t torn;
+    uint64_t backwards;
+    uint64_t generations_seen;
+} KeyTestReader;
+
+static void* key_test_writer(void* context) {
+    KeyTestShared* shared = context;
+    KeyTestFrame frame;
+    for(uint32_t generation = 1; generation <= KEY_TEST_FRAMES; generation++) {
+        for(int i = 0; i < KEY_TEST_FRAME_WORDS; i++) {
+            frame.words[i] = generation;
+        }
+        key_snapshot_publish(&shared->snapshot, &frame);
+    }
+    atomic_store(&shared->done, true);
+    return NULL;
+}
+
+static void* key_test_reader(void* context) {
+    KeyTestReader* reader = context;
+    KeyTestFrame frame;
+    uint32_t last = 0;
+    bool done = false;
+    // one more read after the writer is done, so the last frame is checked too
+    while(!done) {
+        done = atomic_load(&reader->shared->done);
+        reader->retries += key_snapshot_read(&reader->shared->snapshot, &frame);
+        reader->reads++;
+        for(int i = 1; i < KEY_TEST_FRAME_WORDS; i++) {
+            if(frame.words[i] != frame.words[0]) {
+                reader->torn++;
+                break;
+            }
+        }
+        if(frame.words[0] < last) reader->backwards++;
+        if(frame.words[0] != last) reader->generations_seen++;
+        last = frame.words[0];
+    }
+    if(last != KEY_TEST_FRAMES) reader->backwards++;
+    return NULL;
+}
+
+int main(void) {
+    KeyTestShared* shared = calloc(1, sizeof(KeyTestShared));
+    key_snapshot_init(&shared->snapshot, shared->slots, sizeof(KeyTestFrame));
+    atomic_init(&shared->done, false);
+    KeyTestReader readers[KEY_TEST_READERS] = {0};
+    pthread_t threads[KEY_TEST_READERS + 1];
+    for(int i = 0; i < KEY_TEST_READERS; i++) {
+        readers[i].shared = shared;
+        pthread_create(&threads[i + 1], NULL, key_test_reader, &readers[i]);
+    }
+    pthread_create(&threads[0], NULL, key_test_writer, shared);
+    for(int i = 0; i <= KEY_TEST_READERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    bool result = true;
+    for(int i = 0; i < KEY_TEST_READERS; i++) {
+        const KeyTestReader* reader = &readers[i];
+        printf(
+            "reader %d: %llu reads, %llu retries, %llu frames seen, %llu torn, %llu backwards\n",
+            i,
+            (unsigned long long)reader->reads,
+            (unsigned long long)reader->retries,
+            (unsigned long long)reader->generations_seen,
+            (unsigned long long)reader->torn,
+            (unsigned long long)reader->backwards);
+        if(reader->torn || reader->backwards) result = false;
+    }
+    free(shared);
+    if(!result) fprintf(stderr, "key_snapshot: readers saw inconsistent frames\n");
+    return result ? 0 : 1;
+}
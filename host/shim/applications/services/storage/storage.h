@@ -0,0 +1,56 @@
+#ifndef KEY_SHIM_STORAGE_H
+#define KEY_SHIM_STORAGE_H
+
+// Storage files backed by the PC's own, under build/apps_data. Every call is counted, so a
+// benchmark can report the I/O it would cost on the SD card.
+
+#include <furi.h>
+
+#define RECORD_STORAGE "storage"
+#define STORAGE_APP_DATA_PATH_PREFIX "build/apps_data"
+
+typedef enum {
+    FSAM_READ = 1,
+    FSAM_WRITE = 2,
+    FSAM_READ_WRITE = 3,
+} FS_AccessMode;
+
+typedef enum {
+    FSOM_OPEN_EXISTING = 1,
+    FSOM_OPEN_ALWAYS = 2,
+    FSOM_OPEN_APPEND = 4,
+    FSOM_CREATE_NEW = 8,
+    FSOM_CREATE_ALWAYS = 16,
+} FS_OpenMode;
+
+typedef struct Storage Storage;
+typedef struct File File;
+
+typedef struct {
+    uint64_t opens;
+    uint64_t seeks;
+    uint64_t reads;
+    uint64_t read_bytes;
+    uint64_t writes;
+    uint64_t written_bytes;
+} KeyShimStorageStats;
+
+extern KeyShimStorageStats key_shim_storage_stats;
+
+File* storage_file_alloc(Storage* storage);
+void storage_file_free(File* file);
+bool storage_file_open(
+    File* file,
+    const char* path,
+    FS_AccessMode access_mode,
+    FS_OpenMode mode);
+bool storage_file_close(File* file);
+size_t storage_file_read(File* file, void* data, size_t size);
+size_t storage_file_write(File* file, const void* data, size_t size);
+bool storage_file_seek(File* file, uint32_t offset, bool from_start);
+uint64_t storage_file_tell(File* file);
+uint64_t storage_file_size(File* file);
+bool storage_simply_mkdir(Storage* storage, const char* path);
+bool storage_simply_remove(Storage* storage, const char* path);
+
+#endif // KEY_SHIM_STORAGE_H
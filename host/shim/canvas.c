@@ -0,0 +1,74 @@
+#include <gui/canvas.h>
+
+void canvas_set_color(Canvas* canvas, Color color) {
+    canvas->color = color;
+}
+
+void canvas_draw_dot(Canvas* canvas, int32_t x, int32_t y) {
+    if(x < 0 || x >= KEY_SHIM_CANVAS_WIDTH || y < 0 || y >= KEY_SHIM_CANVAS_HEIGHT) return;
+    uint8_t* byte = &canvas->xbm[y * (KEY_SHIM_CANVAS_WIDTH / 8) + x / 8];
+    uint8_t bit = 1 << (x % 8);
+    if(canvas->color == ColorWhite) {
+        *byte &= ~bit;
+    } else if(canvas->color == ColorXOR) {
+        *byte ^= bit;
+    } else {
+        *byte |= bit;
+    }
+}
+
+// Stepped the way u8g2_DrawLine does
+void canvas_draw_line(Canvas* canvas, int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+    bool steep = abs(y2 - y1) > abs(x2 - x1);
+    if(steep) {
+        int32_t t = x1;
+        x1 = y1;
+        y1 = t;
+        t = x2;
+        x2 = y2;
+        y2 = t;
+    }
+    if(x1 > x2) {
+        int32_t t = x1;
+        x1 = x2;
+        x2 = t;
+        t = y1;
+        y1 = y2;
+        y2 = t;
+    }
+    const int32_t dx = x2 - x1;
+    const int32_t dy = abs(y2 - y1);
+    const int32_t step_y = y2 > y1 ? 1 : -1;
+    int32_t error = dx / 2;
+    for(int32_t x = x1, y = y1; x <= x2; x++) {
+        if(steep) {
+            canvas_draw_dot(canvas, y, x);
+        } else {
+            canvas_draw_dot(canvas, x, y);
+        }
+        error -= dy;
+        if(error < 0) {
+            y += step_y;
+            error += dx;
+        }
+    }
+}
+
+void canvas_draw_str(Canvas* canvas, int32_t x, int32_t y, const char* str) {
+    UNUSED(canvas);
+    UNUSED(x);
+    UNUSED(y);
+    UNUSED(str);
+}
+
+void canvas_draw_str_aligned(
+    Canvas* canvas,
+    int32_t x,
+    int32_t y,
+    Align horizontal,
+    Align vertical,
+    const char* str) {
+    UNUSED(horizontal);
+    UNUSED(vertical);
+    canvas_draw_str(canvas, x, y, str);
+}
@@ -0,0 +1,80 @@
+#include <furi.h>
+#include <stdarg.h>
+
+struct FuriString {
+    char* data;
+    size_t size;
+    size_t capacity;
+};
+
+static void furi_string_reserve(FuriString* string, size_t size) {
+    if(size + 1 <= string->capacity) return;
+    string->capacity = (size + 1) * 2;
+    string->data = realloc(string->data, string->capacity);
+}
+
+FuriString* furi_string_alloc(void) {
+    FuriString* string = calloc(1, sizeof(FuriString));
+    furi_string_reserve(string, 15);
+    string->data[0] = '\0';
+    return string;
+}
+
+void furi_string_free(FuriString* string) {
+    free(string->data);
+    free(string);
+}
+
+void furi_string_reset(FuriString* string) {
+    string->size = 0;
+    string->data[0] = '\0';
+}
+
+void furi_string_cat_str(FuriString* string, const char* text) {
+    size_t size = strlen(text);
+    furi_string_reserve(string, string->size + size);
+    memcpy(string->data + string->size, text, size + 1);
+    string->size += size;
+}
+
+void furi_string_set(FuriString* string, const char* text) {
+    furi_string_reset(string);
+    furi_string_cat_str(string, text);
+}
+
+const char* furi_string_get_cstr(const FuriString* string) {
+    return string->data;
+}
+
+size_t furi_string_size(const FuriString* string) {
+    return string->size;
+}
+
+static int furi_string_cat_vprintf(FuriString* string, const char* format, va_list args) {
+    va_list copy;
+    va_copy(copy, args);
+    int size = vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+    if(size < 0) return size;
+    furi_string_reserve(string, string->size + size);
+    vsnprintf(string->data + string->size, size + 1, format, args);
+    string->size += size;
+    return size;
+}
+
+int furi_string_printf(FuriString* string, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    furi_string_reset(string);
+    int size = furi_string_cat_vprintf(string, format, args);
+    va_end(args);
+    return size;
+}
+
+int furi_string_cat_printf(FuriString* string, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int size = furi_string_cat_vprintf(string, format, args);
+    va_end(args);
+    return size;
+}
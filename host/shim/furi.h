@@ -0,0 +1,56 @@
+#ifndef KEY_SHIM_FURI_H
+#define KEY_SHIM_FURI_H
+
+// The few Furi calls the storage bound modules make, for building them on a PC
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNUSED(x) (void)(x)
+#define FURI_LOG_E(tag, ...) (fprintf(stderr, "[%s] ", tag), fprintf(stderr, __VA_ARGS__), \
+                              fputc('\n', stderr))
+#define FURI_LOG_W FURI_LOG_E
+#define FURI_LOG_I(tag, ...) key_shim_log_drop(tag, __VA_ARGS__)
+#define FURI_LOG_D(tag, ...) key_shim_log_drop(tag, __VA_ARGS__)
+#define FURI_CRITICAL_ENTER()
+#define FURI_CRITICAL_EXIT()
+#define furi_crash(message) (fprintf(stderr, "furi_crash: %s\n", message), abort())
+
+// Heap and thread stack figures for key_memory, from memmgr.c. Only a program linked the way
+// key_memory_test is gets real ones.
+typedef void* FuriThreadId;
+FuriThreadId furi_thread_get_current_id(void);
+uint32_t furi_thread_get_stack_space(FuriThreadId thread_id);
+size_t memmgr_get_free_heap(void);
+size_t memmgr_get_minimum_free_heap(void);
+// Run fn on a thread of its own whose stack is watched as if it were stack_size bytes, and wait
+// for it to finish
+void key_shim_thread_run(void (*fn)(void* context), void* context, size_t stack_size);
+// Forget the low-water marks of the heap and of the calling thread's stack, so that the next call
+// gets figures of its own rather than only those past the deepest call before it
+void key_shim_memory_reset(void);
+
+// Info and debug logs are left out, but their arguments are still used
+static inline void key_shim_log_drop(const char* tag, ...) {
+    (void)tag;
+}
+
+typedef struct FuriString FuriString;
+
+FuriString* furi_string_alloc(void);
+void furi_string_free(FuriString* string);
+void furi_string_set(FuriString* string, const char* text);
+void furi_string_reset(FuriString* string);
+const char* furi_string_get_cstr(const FuriString* string);
+size_t furi_string_size(const FuriString* string);
+// Not checked as printf formats: the app's are written for the Flipper, where uint32_t is an
+// unsigned long
+int furi_string_printf(FuriString* string, const char* format, ...);
+int furi_string_cat_printf(FuriString* string, const char* format, ...);
+void furi_string_cat_str(FuriString* string, const char* text);
+
+#endif // KEY_SHIM_FURI_H
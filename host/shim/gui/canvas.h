@@ -0,0 +1,43 @@
+#ifndef KEY_SHIM_CANVAS_H
+#define KEY_SHIM_CANVAS_H
+
+// A 128x64 canvas drawn into an XBM bitmap, in the layout of the app's layers, so a test can
+// compare what key_render_draw draws with a layer bit for bit. Text is left out.
+
+#include <furi.h>
+
+#define KEY_SHIM_CANVAS_WIDTH 128
+#define KEY_SHIM_CANVAS_HEIGHT 64
+
+typedef enum {
+    ColorWhite = 0,
+    ColorBlack = 1,
+    ColorXOR = 2,
+} Color;
+
+typedef enum {
+    AlignLeft,
+    AlignRight,
+    AlignTop,
+    AlignBottom,
+    AlignCenter,
+} Align;
+
+typedef struct Canvas {
+    uint8_t xbm[KEY_SHIM_CANVAS_WIDTH / 8 * KEY_SHIM_CANVAS_HEIGHT];
+    Color color;
+} Canvas;
+
+void canvas_set_color(Canvas* canvas, Color color);
+void canvas_draw_dot(Canvas* canvas, int32_t x, int32_t y);
+void canvas_draw_line(Canvas* canvas, int32_t x1, int32_t y1, int32_t x2, int32_t y2);
+void canvas_draw_str(Canvas* canvas, int32_t x, int32_t y, const char* str);
+void canvas_draw_str_aligned(
+    Canvas* canvas,
+    int32_t x,
+    int32_t y,
+    Align horizontal,
+    Align vertical,
+    const char* str);
+
+#endif // KEY_SHIM_CANVAS_H
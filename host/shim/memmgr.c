@@ -0,0 +1,172 @@
+// The Flipper's heap and thread stacks, for key_memory on a PC. A program linked with --wrap for
+// malloc, calloc, realloc and free has every block its own code takes counted against a heap of
+// KEY_SHIM_HEAP_SIZE bytes, with the 8 bytes FreeRTOS adds to each. Threads from
+// key_shim_thread_run paint their stack first, and the free stack is what the paint says was
+// never reached, the way FreeRTOS keeps its high water mark.
+
+#include <furi.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define KEY_SHIM_HEAP_SIZE (128 * 1024)
+#define KEY_SHIM_BLOCK_OVERHEAD 8
+// A host thread takes far more than the app's stack just to start; only stack_size is counted
+#define KEY_SHIM_THREAD_STACK (256 * 1024)
+#define KEY_SHIM_PAINT 0xA5
+// Left unpainted under the painter's own frame, for the memset that does the painting
+#define KEY_SHIM_PAINT_MARGIN 256
+
+void* __real_malloc(size_t size);
+void __real_free(void* ptr);
+
+// Each block keeps its size in front of it
+typedef union {
+    size_t size;
+    max_align_t align;
+} KeyShimBlock;
+
+static pthread_mutex_t key_shim_heap_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t key_shim_heap_used;
+static size_t key_shim_heap_peak;
+
+void* __wrap_malloc(size_t size) {
+    KeyShimBlock* block = __real_malloc(sizeof(KeyShimBlock) + size);
+    if(!block) return NULL;
+    block->size = size;
+    pthread_mutex_lock(&key_shim_heap_lock);
+    key_shim_heap_used += size + KEY_SHIM_BLOCK_OVERHEAD;
+    if(key_shim_heap_used > key_shim_heap_peak) key_shim_heap_peak = key_shim_heap_used;
+    pthread_mutex_unlock(&key_shim_heap_lock);
+    return block + 1;
+}
+
+void __wrap_free(void* ptr) {
+    if(!ptr) return;
+    KeyShimBlock* block = (KeyShimBlock*)ptr - 1;
+    pthread_mutex_lock(&key_shim_heap_lock);
+    key_shim_heap_used -= block->size + KEY_SHIM_BLOCK_OVERHEAD;
+    pthread_mutex_unlock(&key_shim_heap_lock);
+    __real_free(block);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    if(size && count > SIZE_MAX / size) return NULL;
+    void* ptr = __wrap_malloc(count * size);
+    if(ptr) memset(ptr, 0, count * size);
+    return ptr;
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    if(!ptr) return __wrap_malloc(size);
+    void* moved = __wrap_malloc(size);
+    if(!moved) return NULL;
+    size_t old_size = ((KeyShimBlock*)ptr - 1)->size;
+    memcpy(moved, ptr, old_size < size ? old_size : size);
+    __wrap_free(ptr);
+    return moved;
+}
+
+size_t memmgr_get_free_heap(void) {
+    pthread_mutex_lock(&key_shim_heap_lock);
+    size_t used = key_shim_heap_used;
+    pthread_mutex_unlock(&key_shim_heap_lock);
+    return used < KEY_SHIM_HEAP_SIZE ? KEY_SHIM_HEAP_SIZE - used : 0;
+}
+
+size_t memmgr_get_minimum_free_heap(void) {
+    pthread_mutex_lock(&key_shim_heap_lock);
+    size_t peak = key_shim_heap_peak;
+    pthread_mutex_unlock(&key_shim_heap_lock);
+    return peak < KEY_SHIM_HEAP_SIZE ? KEY_SHIM_HEAP_SIZE - peak : 0;
+}
+
+typedef struct {
+    const uint8_t* low; // lowest byte of the stack
+    const uint8_t* painted; // end of the paint
+    const uint8_t* top; // where the thread's own calls start
+    size_t size; // stack the thread is held to
+} KeyShimStack;
+
+static __thread KeyShimStack key_shim_stack;
+// Numbered as started, as pthread ids are handed out again once a thread is joined; 0 for main
+static __thread uintptr_t key_shim_thread_id;
+static uintptr_t key_shim_threads;
+
+FuriThreadId furi_thread_get_current_id(void) {
+    return (FuriThreadId)key_shim_thread_id;
+}
+
+// key_memory only asks after the calling thread, so that is the one measured
+uint32_t furi_thread_get_stack_space(FuriThreadId thread_id) {
+    UNUSED(thread_id);
+    if(!key_shim_stack.low) return UINT32_MAX;
+    const uint8_t* reached = key_shim_stack.low;
+    while(reached < key_shim_stack.painted && *reached == KEY_SHIM_PAINT) reached++;
+    size_t used = key_shim_stack.top - reached;
+    return used < key_shim_stack.size ? key_shim_stack.size - used : 0;
+}
+
+typedef struct {
+    void (*fn)(void* context);
+    void* context;
+    size_t stack_size;
+    uint8_t* stack;
+} KeyShimThread;
+
+// Paint the stack from its low end up to just under the caller
+static __attribute__((noinline)) void key_shim_paint(void) {
+    const uint8_t* here = __builtin_frame_address(0);
+    key_shim_stack.painted = here - KEY_SHIM_PAINT_MARGIN;
+    memset(
+        (uint8_t*)key_shim_stack.low,
+        KEY_SHIM_PAINT,
+        key_shim_stack.painted - key_shim_stack.low);
+}
+
+void key_shim_memory_reset(void) {
+    pthread_mutex_lock(&key_shim_heap_lock);
+    key_shim_heap_peak = key_shim_heap_used;
+    pthread_mutex_unlock(&key_shim_heap_lock);
+    if(key_shim_stack.low) key_shim_paint();
+}
+
+static void* key_shim_thread(void* context) {
+    KeyShimThread* thread = context;
+    key_shim_thread_id = __atomic_add_fetch(&key_shim_threads, 1, __ATOMIC_RELAXED);
+    key_shim_stack.low = thread->stack;
+    key_shim_stack.top = __builtin_frame_address(0);
+    key_shim_stack.size = thread->stack_size;
+    key_shim_paint();
+    thread->fn(thread->context);
+    return NULL;
+}
+
+void key_shim_thread_run(void (*fn)(void* context), void* context, size_t stack_size) {
+    const size_t page = sysconf(_SC_PAGESIZE);
+    uint8_t* memory = mmap(
+        NULL,
+        page + KEY_SHIM_THREAD_STACK,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,
+        0);
+    if(memory == MAP_FAILED) furi_crash("No memory for a thread stack");
+    // A thread that runs off its stack faults here rather than writing over something else
+    mprotect(memory, page, PROT_NONE);
+    KeyShimThread thread = {
+        .fn = fn,
+        .context = context,
+        .stack_size = stack_size,
+        .stack = memory + page,
+    };
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, thread.stack, KEY_SHIM_THREAD_STACK);
+    pthread_t id;
+    if(pthread_create(&id, &attr, key_shim_thread, &thread)) furi_crash("No thread");
+    pthread_join(id, NULL);
+    pthread_attr_destroy(&attr);
+    munmap(memory, page + KEY_SHIM_THREAD_STACK);
+}
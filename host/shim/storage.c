@@ -0,0 +1,104 @@
+#include <applications/services/storage/storage.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+KeyShimStorageStats key_shim_storage_stats;
+
+struct File {
+    FILE* file;
+};
+
+File* storage_file_alloc(Storage* storage) {
+    UNUSED(storage);
+    return calloc(1, sizeof(File));
+}
+
+void storage_file_free(File* file) {
+    storage_file_close(file);
+    free(file);
+}
+
+bool storage_file_open(
+    File* file,
+    const char* path,
+    FS_AccessMode access_mode,
+    FS_OpenMode mode) {
+    storage_file_close(file);
+    key_shim_storage_stats.opens++;
+    bool exists = access(path, F_OK) == 0;
+    const char* how;
+    switch(mode) {
+    case FSOM_OPEN_EXISTING:
+        if(!exists) return false;
+        how = access_mode == FSAM_READ ? "rb" : "r+b";
+        break;
+    case FSOM_OPEN_ALWAYS:
+        how = exists ? (access_mode == FSAM_READ ? "rb" : "r+b") : "w+b";
+        break;
+    case FSOM_OPEN_APPEND:
+        how = "ab";
+        break;
+    case FSOM_CREATE_NEW:
+        if(exists) return false;
+        how = "w+b";
+        break;
+    default:
+        how = "w+b";
+        break;
+    }
+    file->file = fopen(path, how);
+    return file->file != NULL;
+}
+
+bool storage_file_close(File* file) {
+    if(!file->file) return false;
+    fclose(file->file);
+    file->file = NULL;
+    return true;
+}
+
+size_t storage_file_read(File* file, void* data, size_t size) {
+    if(!file->file) return 0;
+    key_shim_storage_stats.reads++;
+    size_t read = fread(data, 1, size, file->file);
+    key_shim_storage_stats.read_bytes += read;
+    return read;
+}
+
+size_t storage_file_write(File* file, const void* data, size_t size) {
+    if(!file->file) return 0;
+    key_shim_storage_stats.writes++;
+    size_t written = fwrite(data, 1, size, file->file);
+    key_shim_storage_stats.written_bytes += written;
+    return written;
+}
+
+bool storage_file_seek(File* file, uint32_t offset, bool from_start) {
+    if(!file->file) return false;
+    key_shim_storage_stats.seeks++;
+    return fseek(file->file, offset, from_start ? SEEK_SET : SEEK_CUR) == 0;
+}
+
+uint64_t storage_file_tell(File* file) {
+    return file->file ? (uint64_t)ftell(file->file) : 0;
+}
+
+uint64_t storage_file_size(File* file) {
+    if(!file->file) return 0;
+    long position = ftell(file->file);
+    fseek(file->file, 0, SEEK_END);
+    long size = ftell(file->file);
+    fseek(file->file, position, SEEK_SET);
+    return size;
+}
+
+bool storage_simply_mkdir(Storage* storage, const char* path) {
+    UNUSED(storage);
+    return mkdir(path, 0777) == 0 || errno == EEXIST;
+}
+
+bool storage_simply_remove(Storage* storage, const char* path) {
+    UNUSED(storage);
+    return remove(path) == 0 || errno == ENOENT;
+}
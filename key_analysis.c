@@ -0,0 +1,337 @@
+#include "key_analysis.h"
+#include "key_bitting.h"
+#include "key_formats.h"
+#include "key_library.h"
+
+#define TAG "KeyAnalysis"
+
+// Scratch files: every key's packed bitting in library order, the same records grouped by
+// format, and each key's name at a fixed offset
+#define KEY_ANALYSIS_INDEX_PATH STORAGE_APP_DATA_PATH_PREFIX "/.analysis_keys.tmp"
+#define KEY_ANALYSIS_GROUPED_PATH STORAGE_APP_DATA_PATH_PREFIX "/.analysis_grouped.tmp"
+#define KEY_ANALYSIS_NAMES_PATH STORAGE_APP_DATA_PATH_PREFIX "/.analysis_names.tmp"
+// Keys of one format held in RAM per block. Two blocks are compared at a time.
+#define KEY_ANALYSIS_BLOCK 256
+#define KEY_ANALYSIS_READ_BATCH 16
+
+typedef struct {
+    KeyBitting bitting;
+    uint16_t ord;
+    uint8_t format_index;
+    uint8_t reserved;
+} KeyAnalysisRecord;
+
+typedef struct {
+    uint16_t a;
+    uint16_t b;
+    uint16_t distance;
+    uint8_t hamming;
+} KeyAnalysisPair;
+
+typedef struct {
+    KeyBitting bittings[KEY_ANALYSIS_BLOCK];
+    uint16_t ords[KEY_ANALYSIS_BLOCK];
+    uint16_t count;
+} KeyAnalysisBlock;
+
+typedef struct {
+    KeyAnalysisPair top[KEY_ANALYSIS_TOP_PAIRS]; // max-heap, the farthest kept pair on top
+    uint16_t top_count;
+    uint32_t hamming_hist[KEY_BITTING_MAX_PINS + 1];
+} KeyAnalysisRanking;
+
+typedef struct {
+    Storage* storage;
+    File* index;
+    File* grouped;
+    File* names;
+    uint32_t format_keys[FORMAT_NUM];
+    uint32_t format_start[FORMAT_NUM]; // first record of the format in the grouped file
+    uint16_t ord;
+    uint32_t left_out;
+} KeyAnalysisCollect;
+
+static bool key_analysis_collect_callback(const char* name, void* context) {
+    KeyAnalysisCollect* collect = context;
+    // Only counted, so the report can say how many were left out
+    if(collect->ord == KEY_ANALYSIS_MAX_KEYS) {
+        collect->left_out++;
+        return true;
+    }
+    KeyAnalysisRecord record = {0};
+    uint32_t format_index;
+    if(key_library_read(collect->storage, name, &format_index, &record.bitting) != KeyFileOk) {
+        FURI_LOG_W(TAG, "skipping %s", name);
+        return true;
+    }
+    char name_record[KEY_LIBRARY_NAME_SIZE] = {0};
+    strncpy(name_record, name, sizeof(name_record) - 1);
+    record.ord = collect->ord;
+    record.format_index = format_index;
+    if(storage_file_write(collect->index, &record, sizeof(record)) != sizeof(record)) return false;
+    if(storage_file_write(collect->names, name_record, sizeof(name_record)) !=
+       sizeof(name_record))
+        return false;
+    collect->format_keys[format_index]++;
+    collect->ord++;
+    return true;
+}
+
+// Copy the index into the grouped file one format after another, so that any block of a format
+// is one seek and one contiguous read. One scan of the index per format with pairs to compare,
+// each stopping at the format's last key.
+static bool key_analysis_group(KeyAnalysisCollect* collect) {
+    KeyAnalysisRecord batch[KEY_ANALYSIS_READ_BATCH];
+    uint32_t start = 0;
+    for(uint8_t format_index = 0; format_index < FORMAT_NUM; format_index++) {
+        uint32_t left = collect->format_keys[format_index];
+        collect->format_start[format_index] = start;
+        if(left < 2) continue;
+        start += left;
+        if(!storage_file_seek(collect->index, 0, true)) return false;
+        size_t read;
+        while(left > 0 && (read = storage_file_read(collect->index, batch, sizeof(batch)) /
+                                  sizeof(batch[0])) > 0) {
+            size_t kept = 0;
+            for(size_t i = 0; i < read; i++) {
+                if(batch[i].format_index == format_index) batch[kept++] = batch[i];
+            }
+            size_t size = kept * sizeof(batch[0]);
+            if(storage_file_write(collect->grouped, batch, size) != size) return false;
+            left -= kept;
+        }
+        if(left > 0) return false;
+    }
+    return true;
+}
+
+// Load count keys from record first of the grouped file
+static void key_analysis_load_block(
+    File* grouped,
+    uint32_t first,
+    uint32_t count,
+    KeyAnalysisBlock* block) {
+    KeyAnalysisRecord batch[KEY_ANALYSIS_READ_BATCH];
+    block->count = 0;
+    if(count > KEY_ANALYSIS_BLOCK) count = KEY_ANALYSIS_BLOCK;
+    if(!storage_file_seek(grouped, first * sizeof(KeyAnalysisRecord), true)) return;
+    while(block->count < count) {
+        size_t want = count - block->count;
+        if(want > KEY_ANALYSIS_READ_BATCH) want = KEY_ANALYSIS_READ_BATCH;
+        size_t read = storage_file_read(grouped, batch, want * sizeof(batch[0])) /
+                      sizeof(batch[0]);
+        for(size_t i = 0; i < read; i++) {
+            block->bittings[block->count] = batch[i].bitting;
+            block->ords[block->count] = batch[i].ord;
+            block->count++;
+        }
+        if(read < want) return;
+    }
+}
+
+static inline bool key_analysis_pair_closer(const KeyAnalysisPair* a, const KeyAnalysisPair* b) {
+    return a->hamming < b->hamming || (a->hamming == b->hamming && a->distance < b->distance);
+}
+
+static void key_analysis_heap_sift_down(KeyAnalysisRanking* ranking, uint16_t i) {
+    KeyAnalysisPair* heap = ranking->top;
+    while(true) {
+        uint16_t largest = i, l = 2 * i + 1, r = 2 * i + 2;
+        if(l < ranking->top_count && key_analysis_pair_closer(&heap[largest], &heap[l]))
+            largest = l;
+        if(r < ranking->top_count && key_analysis_pair_closer(&heap[largest], &heap[r]))
+            largest = r;
+        if(largest == i) return;
+        KeyAnalysisPair tmp = heap[i];
+        heap[i] = heap[largest];
+        heap[largest] = tmp;
+        i = largest;
+    }
+}
+
+static void key_analysis_rank(KeyAnalysisRanking* ranking, const KeyAnalysisPair* pair) {
+    KeyAnalysisPair* heap = ranking->top;
+    if(ranking->top_count < KEY_ANALYSIS_TOP_PAIRS) {
+        uint16_t i = ranking->top_count++;
+        heap[i] = *pair;
+        while(i > 0 && key_analysis_pair_closer(&heap[(i - 1) / 2], &heap[i])) {
+            KeyAnalysisPair tmp = heap[i];
+            heap[i] = heap[(i - 1) / 2];
+            heap[(i - 1) / 2] = tmp;
+            i = (i - 1) / 2;
+        }
+    } else if(key_analysis_pair_closer(pair, &heap[0])) {
+        heap[0] = *pair;
+        key_analysis_heap_sift_down(ranking, 0);
+    }
+}
+
+// All pairs between two blocks, or within one block when a == b
+static void key_analysis_compare_blocks(
+    const KeyAnalysisBlock* a,
+    const KeyAnalysisBlock* b,
+    KeyAnalysisRanking* ranking,
+    KeyAnalysisSummary* summary) {
+    for(uint16_t i = 0; i < a->count; i++) {
+        const KeyBitting* bitting = &a->bittings[i];
+        for(uint16_t j = (a == b) ? i + 1 : 0; j < b->count; j++) {
+            KeyAnalysisPair pair = {
+                .a = a->ords[i],
+                .b = b->ords[j],
+                .hamming = key_bitting_hamming(bitting, &b->bittings[j]),
+            };
+            ranking->hamming_hist[pair.hamming]++;
+            if(ranking->top_count == KEY_ANALYSIS_TOP_PAIRS &&
+               pair.hamming > ranking->top[0].hamming)
+                continue;
+            pair.distance = key_bitting_distance(bitting, &b->bittings[j]);
+            key_analysis_rank(ranking, &pair);
+        }
+        summary->pairs += (a == b) ? a->count - i - 1 : b->count;
+    }
+}
+
+static const char* key_analysis_label(uint8_t hamming, uint8_t pin_num) {
+    if(hamming == 0) return "duplicate";
+    if(hamming == 1) return "cross-keying risk";
+    if(hamming * 2 <= pin_num) return "possible master relation";
+    return "";
+}
+
+static void key_analysis_read_name(File* names, uint16_t ord, char* name) {
+    name[0] = '\0';
+    if(storage_file_seek(names, ord * KEY_LIBRARY_NAME_SIZE, true)) {
+        storage_file_read(names, name, KEY_LIBRARY_NAME_SIZE);
+    }
+    name[KEY_LIBRARY_NAME_SIZE - 1] = '\0';
+}
+
+static void key_analysis_write_format(
+    File* report,
+    File* names,
+    uint8_t format_index,
+    uint32_t keys,
+    KeyAnalysisRanking* ranking,
+    FuriString* line) {
+    uint8_t pin_num = key_format_catalog.pin_num[format_index];
+    furi_string_printf(
+        line,
+        "== %s %s: %lu keys ==\n",
+        key_format_info[format_index].manufacturer,
+        key_format_info[format_index].format_name,
+        keys);
+    for(uint8_t h = 0; h <= pin_num; h++) {
+        if(ranking->hamming_hist[h] == 0) continue;
+        furi_string_cat_printf(line, "%u cuts apart: %lu pairs\n", h, ranking->hamming_hist[h]);
+    }
+    storage_file_write(report, furi_string_get_cstr(line), furi_string_size(line));
+
+    // pop the heap from the farthest pair, then write closest first
+    uint16_t count = ranking->top_count;
+    while(ranking->top_count > 1) {
+        KeyAnalysisPair tmp = ranking->top[0];
+        ranking->top[0] = ranking->top[--ranking->top_count];
+        ranking->top[ranking->top_count] = tmp;
+        key_analysis_heap_sift_down(ranking, 0);
+    }
+    char name_a[KEY_LIBRARY_NAME_SIZE];
+    char name_b[KEY_LIBRARY_NAME_SIZE];
+    for(uint16_t i = 0; i < count; i++) {
+        const KeyAnalysisPair* pair = &ranking->top[i];
+        key_analysis_read_name(names, pair->a, name_a);
+        key_analysis_read_name(names, pair->b, name_b);
+        furi_string_printf(
+            line,
+            "%u cuts / %u steps: %s <-> %s %s\n",
+            pair->hamming,
+            pair->distance,
+            name_a,
+            name_b,
+            key_analysis_label(pair->hamming, pin_num));
+        storage_file_write(report, furi_string_get_cstr(line), furi_string_size(line));
+    }
+    storage_file_write(report, "\n", 1);
+}
+
+bool key_analysis_run(Storage* storage, KeyAnalysisSummary* summary) {
+    memset(summary, 0, sizeof(KeyAnalysisSummary));
+    KeyAnalysisCollect* collect = malloc(sizeof(KeyAnalysisCollect));
+    memset(collect, 0, sizeof(KeyAnalysisCollect));
+    collect->storage = storage;
+    collect->index = storage_file_alloc(storage);
+    collect->grouped = storage_file_alloc(storage);
+    collect->names = storage_file_alloc(storage);
+    File* report = storage_file_alloc(storage);
+    bool result = false;
+
+    do {
+        // Pass 1: one read of every saved key into the packed scratch index
+        if(!storage_file_open(
+               collect->index, KEY_ANALYSIS_INDEX_PATH, FSAM_READ_WRITE, FSOM_CREATE_ALWAYS))
+            break;
+        if(!storage_file_open(
+               collect->names, KEY_ANALYSIS_NAMES_PATH, FSAM_READ_WRITE, FSOM_CREATE_ALWAYS))
+            break;
+        if(!key_library_for_each(storage, key_analysis_collect_callback, collect)) break;
+        summary->keys = collect->ord;
+        summary->left_out = collect->left_out;
+        if(!storage_file_open(
+               collect->grouped, KEY_ANALYSIS_GROUPED_PATH, FSAM_READ_WRITE, FSOM_CREATE_ALWAYS))
+            break;
+        if(!key_analysis_group(collect)) break;
+        if(!storage_file_open(report, KEY_ANALYSIS_REPORT_PATH, FSAM_WRITE, FSOM_CREATE_ALWAYS))
+            break;
+        FuriString* line = furi_string_alloc();
+        if(summary->left_out) {
+            furi_string_printf(
+                line,
+                "Partial: the first %lu keys were compared, %lu were left out\n\n",
+                summary->keys,
+                summary->left_out);
+            storage_file_write(report, furi_string_get_cstr(line), furi_string_size(line));
+        }
+
+        // Pass 2: per format, compare blocks of keys pairwise
+        KeyAnalysisBlock* block_a = malloc(sizeof(KeyAnalysisBlock));
+        KeyAnalysisBlock* block_b = malloc(sizeof(KeyAnalysisBlock));
+        KeyAnalysisRanking* ranking = malloc(sizeof(KeyAnalysisRanking));
+        for(uint8_t format_index = 0; format_index < FORMAT_NUM; format_index++) {
+            uint32_t keys = collect->format_keys[format_index];
+            uint32_t start = collect->format_start[format_index];
+            if(keys < 2) continue;
+            summary->formats++;
+            memset(ranking, 0, sizeof(KeyAnalysisRanking));
+            for(uint32_t a = 0; a < keys; a += KEY_ANALYSIS_BLOCK) {
+                key_analysis_load_block(collect->grouped, start + a, keys - a, block_a);
+                key_analysis_compare_blocks(block_a, block_a, ranking, summary);
+                for(uint32_t b = a + KEY_ANALYSIS_BLOCK; b < keys; b += KEY_ANALYSIS_BLOCK) {
+                    key_analysis_load_block(collect->grouped, start + b, keys - b, block_b);
+                    key_analysis_compare_blocks(block_a, block_b, ranking, summary);
+                }
+            }
+            summary->duplicates += ranking->hamming_hist[0];
+            summary->one_cut_apart += ranking->hamming_hist[1];
+            key_analysis_write_format(
+                report, collect->names, format_index, keys, ranking, line);
+        }
+        furi_string_free(line);
+        free(ranking);
+        free(block_b);
+        free(block_a);
+        result = true;
+    } while(0);
+
+    storage_file_close(report);
+    storage_file_free(report);
+    storage_file_close(collect->names);
+    storage_file_free(collect->names);
+    storage_file_close(collect->grouped);
+    storage_file_free(collect->grouped);
+    storage_file_close(collect->index);
+    storage_file_free(collect->index);
+    storage_simply_remove(storage, KEY_ANALYSIS_NAMES_PATH);
+    storage_simply_remove(storage, KEY_ANALYSIS_GROUPED_PATH);
+    storage_simply_remove(storage, KEY_ANALYSIS_INDEX_PATH);
+    free(collect);
+    return result;
+}
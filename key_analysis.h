@@ -0,0 +1,26 @@
+#ifndef KEY_ANALYSIS_H
+#define KEY_ANALYSIS_H
+
+#include <applications/services/storage/storage.h>
+#include <furi.h>
+
+#define KEY_ANALYSIS_REPORT_PATH STORAGE_APP_DATA_PATH_PREFIX "/analysis.txt"
+// Closest pairs listed in the report for each format
+#define KEY_ANALYSIS_TOP_PAIRS 32
+// Keys are numbered with 16 bits; any past this are left out of the analysis
+#define KEY_ANALYSIS_MAX_KEYS UINT16_MAX
+
+typedef struct {
+    uint32_t keys; // compared
+    uint32_t left_out; // past KEY_ANALYSIS_MAX_KEYS, so the analysis is partial
+    uint32_t formats; // formats with at least two keys
+    uint32_t pairs;
+    uint32_t duplicates; // same format and bitting
+    uint32_t one_cut_apart; // cross-keying risk
+} KeyAnalysisSummary;
+
+// Compare every pair of saved keys that share a format and write a ranked report to
+// KEY_ANALYSIS_REPORT_PATH. Memory use is bounded no matter how large the library is.
+bool key_analysis_run(Storage* storage, KeyAnalysisSummary* summary);
+
+#endif // KEY_ANALYSIS_H
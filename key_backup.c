@@ -0,0 +1,320 @@
+#include "key_backup.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define KEY_BACKUP_MIN_MATCH 3
+#define KEY_BACKUP_MAX_MATCH 34
+#define KEY_BACKUP_MAX_LITERALS 128
+#define KEY_BACKUP_HASH_SIZE 256
+// Candidates tried per byte; key files repeat whole lines, so the first few find them
+#define KEY_BACKUP_CHAIN_DEPTH 16
+#define KEY_BACKUP_IO_SIZE 64
+
+static uint32_t key_backup_fnv(uint32_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = data;
+    for(size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t key_backup_hash(const char* name, const void* data, size_t size) {
+    // The name's '\0' goes in too, so no name and file run together like another pair
+    uint32_t hash = key_backup_fnv(2166136261u, name, strlen(name) + 1);
+    hash = key_backup_fnv(hash, data, size);
+    return hash ? hash : 1;
+}
+
+struct KeyBackupWriter {
+    KeyBackupWriteCallback write;
+    void* context;
+    bool failed;
+    uint32_t records;
+
+    // Stream positions: buffer[0] is base, and packed..end are added but not yet packed
+    uint8_t buffer[2 * KEY_BACKUP_WINDOW];
+    uint32_t base;
+    uint32_t packed;
+    uint32_t end;
+    uint32_t literals; // start of the literal run not yet written
+    // Position + 1 of the last 3 bytes of each hash, and of the ones before them
+    uint32_t head[KEY_BACKUP_HASH_SIZE];
+    uint32_t chain[KEY_BACKUP_WINDOW];
+
+    uint8_t out[KEY_BACKUP_IO_SIZE];
+    uint8_t out_size;
+};
+
+static void key_backup_writer_flush(KeyBackupWriter* writer) {
+    if(writer->out_size && !writer->write(writer->out, writer->out_size, writer->context))
+        writer->failed = true;
+    writer->out_size = 0;
+}
+
+static void key_backup_writer_emit(KeyBackupWriter* writer, uint8_t byte) {
+    writer->out[writer->out_size++] = byte;
+    if(writer->out_size == KEY_BACKUP_IO_SIZE) key_backup_writer_flush(writer);
+}
+
+static inline uint8_t key_backup_writer_at(const KeyBackupWriter* writer, uint32_t position) {
+    return writer->buffer[position - writer->base];
+}
+
+static inline uint8_t key_backup_hash3(const KeyBackupWriter* writer, uint32_t position) {
+    const uint8_t* bytes = &writer->buffer[position - writer->base];
+    return (uint8_t)((bytes[0] << 2) ^ (bytes[1] << 1) ^ bytes[2] ^ (bytes[0] >> 5));
+}
+
+static void key_backup_writer_insert(KeyBackupWriter* writer, uint32_t position) {
+    if(position + KEY_BACKUP_MIN_MATCH > writer->end) return;
+    uint8_t hash = key_backup_hash3(writer, position);
+    writer->chain[position % KEY_BACKUP_WINDOW] = writer->head[hash];
+    writer->head[hash] = position + 1;
+}
+
+static void key_backup_writer_emit_literals(KeyBackupWriter* writer) {
+    uint32_t count = writer->packed - writer->literals;
+    if(!count) return;
+    key_backup_writer_emit(writer, (uint8_t)(count - 1));
+    for(uint32_t position = writer->literals; position < writer->packed; position++) {
+        key_backup_writer_emit(writer, key_backup_writer_at(writer, position));
+    }
+    writer->literals = writer->packed;
+}
+
+// Pack the byte at packed, as a literal or the start of the longest match in the window
+static void key_backup_writer_pack(KeyBackupWriter* writer) {
+    const uint32_t position = writer->packed;
+    uint32_t available = writer->end - position;
+    if(available > KEY_BACKUP_MAX_MATCH) available = KEY_BACKUP_MAX_MATCH;
+    uint32_t best_length = 0;
+    uint32_t best_distance = 0;
+    if(available >= KEY_BACKUP_MIN_MATCH) {
+        uint32_t candidate = writer->head[key_backup_hash3(writer, position)];
+        for(uint8_t depth = 0; candidate && depth < KEY_BACKUP_CHAIN_DEPTH; depth++) {
+            uint32_t start = candidate - 1;
+            if(start < writer->base || position - start > KEY_BACKUP_WINDOW) break;
+            uint32_t length = 0;
+            while(length < available && key_backup_writer_at(writer, start + length) ==
+                                            key_backup_writer_at(writer, position + length))
+                length++;
+            if(length > best_length) {
+                best_length = length;
+                best_distance = position - start;
+            }
+            uint32_t next = writer->chain[start % KEY_BACKUP_WINDOW];
+            if(next >= candidate) break;
+            candidate = next;
+        }
+    }
+    key_backup_writer_insert(writer, position);
+    if(best_length < KEY_BACKUP_MIN_MATCH) {
+        writer->packed++;
+        if(writer->packed - writer->literals == KEY_BACKUP_MAX_LITERALS)
+            key_backup_writer_emit_literals(writer);
+        return;
+    }
+    key_backup_writer_emit_literals(writer);
+    key_backup_writer_emit(
+        writer,
+        (uint8_t)(0x80 | (best_length - KEY_BACKUP_MIN_MATCH) << 2 | (best_distance - 1) >> 8));
+    key_backup_writer_emit(writer, (uint8_t)(best_distance - 1));
+    for(uint32_t skipped = position + 1; skipped < position + best_length; skipped++) {
+        key_backup_writer_insert(writer, skipped);
+    }
+    writer->packed = position + best_length;
+    writer->literals = writer->packed;
+}
+
+static void key_backup_writer_put(KeyBackupWriter* writer, const void* data, size_t size) {
+    const uint8_t* bytes = data;
+    for(size_t i = 0; i < size; i++) {
+        // Slide by a window once full. What is kept holds the whole literal run, which is never
+        // more than KEY_BACKUP_MAX_LITERALS behind the lookahead.
+        if(writer->end - writer->base == sizeof(writer->buffer)) {
+            memmove(writer->buffer, writer->buffer + KEY_BACKUP_WINDOW, KEY_BACKUP_WINDOW);
+            writer->base += KEY_BACKUP_WINDOW;
+        }
+        writer->buffer[writer->end++ - writer->base] = bytes[i];
+        if(writer->end - writer->packed > KEY_BACKUP_MAX_MATCH) key_backup_writer_pack(writer);
+    }
+}
+
+KeyBackupWriter* key_backup_writer_alloc(
+    bool full,
+    uint32_t sequence,
+    KeyBackupWriteCallback write,
+    void* context) {
+    KeyBackupWriter* writer = malloc(sizeof(KeyBackupWriter));
+    memset(writer, 0, sizeof(KeyBackupWriter));
+    writer->write = write;
+    writer->context = context;
+    KeyBackupHeader header = {
+        .magic = KEY_BACKUP_MAGIC,
+        .version = KEY_BACKUP_VERSION,
+        .full = full,
+        .sequence = sequence,
+    };
+    if(!write(&header, sizeof(header), context)) writer->failed = true;
+    return writer;
+}
+
+static void key_backup_writer_put_name(KeyBackupWriter* writer, uint8_t type, const char* name) {
+    uint8_t prefix[2] = {type, (uint8_t)strlen(name)};
+    key_backup_writer_put(writer, prefix, sizeof(prefix));
+    key_backup_writer_put(writer, name, prefix[1]);
+    writer->records++;
+}
+
+KeyBackupStatus key_backup_writer_add_key(
+    KeyBackupWriter* writer,
+    const char* name,
+    const void* data,
+    size_t size) {
+    if(size > KEY_BACKUP_FILE_MAX) return KeyBackupTooLarge;
+    key_backup_writer_put_name(writer, KeyBackupRecordKey, name);
+    uint32_t hash = key_backup_hash(name, data, size);
+    uint16_t length = size;
+    key_backup_writer_put(writer, &hash, sizeof(hash));
+    key_backup_writer_put(writer, &length, sizeof(length));
+    key_backup_writer_put(writer, data, size);
+    return writer->failed ? KeyBackupIoError : KeyBackupOk;
+}
+
+KeyBackupStatus key_backup_writer_add_removed(KeyBackupWriter* writer, const char* name) {
+    key_backup_writer_put_name(writer, KeyBackupRecordRemoved, name);
+    return writer->failed ? KeyBackupIoError : KeyBackupOk;
+}
+
+KeyBackupStatus key_backup_writer_finish(KeyBackupWriter* writer) {
+    uint8_t type = KeyBackupRecordEnd;
+    key_backup_writer_put(writer, &type, sizeof(type));
+    key_backup_writer_put(writer, &writer->records, sizeof(writer->records));
+    while(writer->packed < writer->end) key_backup_writer_pack(writer);
+    key_backup_writer_emit_literals(writer);
+    key_backup_writer_flush(writer);
+    return writer->failed ? KeyBackupIoError : KeyBackupOk;
+}
+
+void key_backup_writer_free(KeyBackupWriter* writer) {
+    free(writer);
+}
+
+struct KeyBackupReader {
+    KeyBackupReadCallback read;
+    void* context;
+    uint32_t records;
+
+    uint8_t in[KEY_BACKUP_IO_SIZE];
+    uint8_t in_size;
+    uint8_t in_position;
+
+    uint8_t window[KEY_BACKUP_WINDOW];
+    uint32_t position; // bytes unpacked so far
+    uint8_t literals; // left in the current run
+    uint8_t match; // left in the current match
+    uint16_t distance;
+    bool corrupt;
+
+    uint8_t data[KEY_BACKUP_FILE_MAX];
+};
+
+static bool key_backup_reader_raw(KeyBackupReader* reader, uint8_t* byte) {
+    if(reader->in_position == reader->in_size) {
+        reader->in_size = reader->read(reader->in, sizeof(reader->in), reader->context);
+        reader->in_position = 0;
+        if(!reader->in_size) return false;
+    }
+    *byte = reader->in[reader->in_position++];
+    return true;
+}
+
+// Exactly size bytes of the unpacked stream, or false when it ends or breaks first
+static bool key_backup_reader_get(KeyBackupReader* reader, void* data, size_t size) {
+    uint8_t* bytes = data;
+    for(size_t i = 0; i < size; i++) {
+        uint8_t byte;
+        if(reader->match) {
+            byte = reader->window[(reader->position - reader->distance) % KEY_BACKUP_WINDOW];
+            reader->match--;
+        } else {
+            if(!reader->literals) {
+                uint8_t control;
+                if(!key_backup_reader_raw(reader, &control)) return false;
+                if(control < 0x80) {
+                    reader->literals = control + 1;
+                } else {
+                    uint8_t low;
+                    if(!key_backup_reader_raw(reader, &low)) return false;
+                    reader->distance = ((control & 0x03) << 8 | low) + 1;
+                    reader->match = ((control >> 2) & 0x1F) + KEY_BACKUP_MIN_MATCH;
+                    if(reader->distance > reader->position) {
+                        reader->corrupt = true;
+                        return false;
+                    }
+                    i--;
+                    continue;
+                }
+            }
+            if(!key_backup_reader_raw(reader, &byte)) return false;
+            reader->literals--;
+        }
+        reader->window[reader->position++ % KEY_BACKUP_WINDOW] = byte;
+        bytes[i] = byte;
+    }
+    return true;
+}
+
+KeyBackupReader* key_backup_reader_alloc(KeyBackupReadCallback read, void* context) {
+    KeyBackupReader* reader = malloc(sizeof(KeyBackupReader));
+    memset(reader, 0, sizeof(KeyBackupReader));
+    reader->read = read;
+    reader->context = context;
+    return reader;
+}
+
+KeyBackupStatus key_backup_reader_header(KeyBackupReader* reader, KeyBackupHeader* header) {
+    uint8_t* bytes = (uint8_t*)header;
+    for(size_t i = 0; i < sizeof(KeyBackupHeader); i++) {
+        if(!key_backup_reader_raw(reader, &bytes[i])) return KeyBackupCorrupt;
+    }
+    if(header->magic != KEY_BACKUP_MAGIC || header->version != KEY_BACKUP_VERSION)
+        return KeyBackupCorrupt;
+    return KeyBackupOk;
+}
+
+KeyBackupStatus key_backup_reader_next(KeyBackupReader* reader, KeyBackupRecord* record) {
+    uint8_t type;
+    if(!key_backup_reader_get(reader, &type, sizeof(type))) return KeyBackupCorrupt;
+    if(type == KeyBackupRecordEnd) {
+        uint32_t records;
+        if(!key_backup_reader_get(reader, &records, sizeof(records)) ||
+           records != reader->records)
+            return KeyBackupCorrupt;
+        return KeyBackupEnd;
+    }
+    uint8_t length;
+    if((type != KeyBackupRecordKey && type != KeyBackupRecordRemoved) ||
+       !key_backup_reader_get(reader, &length, sizeof(length)) || !length ||
+       length >= KEY_NAMES_NAME_SIZE || !key_backup_reader_get(reader, record->name, length))
+        return KeyBackupCorrupt;
+    record->name[length] = '\0';
+    record->type = type;
+    record->hash = 0;
+    record->size = 0;
+    record->data = reader->data;
+    reader->records++;
+    if(type == KeyBackupRecordRemoved) return KeyBackupOk;
+    if(!key_backup_reader_get(reader, &record->hash, sizeof(record->hash)) ||
+       !key_backup_reader_get(reader, &record->size, sizeof(record->size)) ||
+       record->size > KEY_BACKUP_FILE_MAX ||
+       !key_backup_reader_get(reader, reader->data, record->size))
+        return KeyBackupCorrupt;
+    bool same = key_backup_hash(record->name, reader->data, record->size) == record->hash;
+    return same ? KeyBackupOk : KeyBackupBadHash;
+}
+
+void key_backup_reader_free(KeyBackupReader* reader) {
+    free(reader);
+}
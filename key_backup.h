@@ -0,0 +1,94 @@
+#ifndef KEY_BACKUP_H
+#define KEY_BACKUP_H
+
+#include "key_names.h"
+
+#define KEY_BACKUP_MAGIC 0x31424B4B // "KKB1"
+#define KEY_BACKUP_VERSION 1
+// Matches reach this far back, across key files, so the lines every key file shares cost a few
+// bytes each time. A power of two.
+#define KEY_BACKUP_WINDOW 1024
+// Larger than any key file the app writes, history included
+#define KEY_BACKUP_FILE_MAX 2048
+
+// A backup archive is a KeyBackupHeader and then a packed stream of records:
+//   type (KeyBackupRecordType), name length, name
+//   for a key: uint32 key_backup_hash, uint16 size, the key file itself
+//   for the end: uint32 count of the records before it
+// The stream is LZ77 over a KEY_BACKUP_WINDOW window, byte aligned. A control byte below 0x80
+// is followed by that many plus one literal bytes. Otherwise its low 5 bits above bit 1 are the
+// match length minus 3, and its low 2 bits and the next byte are the distance minus 1.
+typedef enum {
+    KeyBackupRecordEnd,
+    KeyBackupRecordKey,
+    KeyBackupRecordRemoved, // renamed or deleted since the archive before
+} KeyBackupRecordType;
+
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t full; // 1 for the whole library, 0 for what changed since the archive before
+    uint16_t reserved;
+    uint32_t sequence;
+} KeyBackupHeader;
+
+typedef struct {
+    KeyBackupRecordType type;
+    char name[KEY_NAMES_NAME_SIZE];
+    uint32_t hash;
+    uint16_t size;
+    const uint8_t* data; // size bytes, valid until the next record is read
+} KeyBackupRecord;
+
+typedef enum {
+    KeyBackupOk,
+    KeyBackupEnd,
+    KeyBackupCorrupt, // bad header, bad stream, or an archive cut short
+    KeyBackupBadHash, // the record was read, but its data is not what was backed up
+    KeyBackupTooLarge,
+    KeyBackupIoError,
+} KeyBackupStatus;
+
+// Archives are streamed, never seeked
+typedef bool (*KeyBackupWriteCallback)(const void* data, size_t size, void* context);
+// Fill data with up to size bytes; return 0 at the end
+typedef size_t (*KeyBackupReadCallback)(void* data, size_t size, void* context);
+
+// FNV-1a of the name and then the key file, so a restore also catches a garbled name. Never 0.
+uint32_t key_backup_hash(const char* name, const void* data, size_t size);
+
+typedef struct KeyBackupWriter KeyBackupWriter;
+
+// Writes the header straight away; check key_backup_writer_finish for errors
+KeyBackupWriter* key_backup_writer_alloc(
+    bool full,
+    uint32_t sequence,
+    KeyBackupWriteCallback write,
+    void* context);
+
+KeyBackupStatus key_backup_writer_add_key(
+    KeyBackupWriter* writer,
+    const char* name,
+    const void* data,
+    size_t size);
+
+KeyBackupStatus key_backup_writer_add_removed(KeyBackupWriter* writer, const char* name);
+
+// Write the end record and flush the stream
+KeyBackupStatus key_backup_writer_finish(KeyBackupWriter* writer);
+
+void key_backup_writer_free(KeyBackupWriter* writer);
+
+typedef struct KeyBackupReader KeyBackupReader;
+
+KeyBackupReader* key_backup_reader_alloc(KeyBackupReadCallback read, void* context);
+
+KeyBackupStatus key_backup_reader_header(KeyBackupReader* reader, KeyBackupHeader* header);
+
+// The next record, its hash checked. After BadHash the reader goes on to the next record as
+// usual; after anything else but Ok it is done.
+KeyBackupStatus key_backup_reader_next(KeyBackupReader* reader, KeyBackupRecord* record);
+
+void key_backup_reader_free(KeyBackupReader* reader);
+
+#endif // KEY_BACKUP_H
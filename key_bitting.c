@@ -0,0 +1,171 @@
+#include "key_bitting.h"
+
+// SWAR helpers. Depths are spread from nibbles into byte lanes so every lane has room for the
+// carries and borrows of the comparisons below without touching its neighbours.
+#define LANES_01 0x0101010101010101ULL
+#define LANES_0F 0x0F0F0F0F0F0F0F0FULL
+#define LANES_40 0x4040404040404040ULL
+#define LANES_80 0x8080808080808080ULL
+#define NIBBLES_1 0x1111111111111111ULL
+#define NIBBLES_CARRY 0x1111111111111110ULL
+
+// High bit set in every lane where a - b > n, for lane values and n in 0..15
+static inline uint64_t lanes_diff_above(uint64_t a, uint64_t b, uint8_t n) {
+    uint64_t t = (a + LANES_40) - b; // 64 + a - b, never borrows
+    return ((t + LANES_01 * (127 - 64 - n)) | t) & LANES_80;
+}
+
+// One bit per lane, lane k to bit k
+static inline uint8_t lanes_to_bits(uint64_t high_bits) {
+    return (uint8_t)(((high_bits >> 7) * 0x0102040810204080ULL) >> 56);
+}
+
+// Interleave two 8 bit masks, a to the even bits and b to the odd bits
+static inline uint32_t bits_interleave(uint8_t a, uint8_t b) {
+    uint32_t x = a, y = b;
+    x = (x | (x << 4)) & 0x0F0F;
+    x = (x | (x << 2)) & 0x3333;
+    x = (x | (x << 1)) & 0x5555;
+    y = (y | (y << 4)) & 0x0F0F;
+    y = (y | (y << 2)) & 0x3333;
+    y = (y | (y << 1)) & 0x5555;
+    return x | (y << 1);
+}
+
+static inline uint64_t nibble_mask(uint8_t pin_num, uint8_t word) {
+    int pins = (int)pin_num - word * KEY_BITTING_PINS_PER_WORD;
+    if(pins <= 0) return 0;
+    if(pins >= KEY_BITTING_PINS_PER_WORD) return ~0ULL;
+    return (1ULL << (pins * 4)) - 1;
+}
+
+void key_bitting_fill(KeyBitting* bitting, uint8_t pin_num, uint8_t depth) {
+    uint64_t all = LANES_01 * 0x11 * (depth & 0xF);
+    for(uint8_t i = 0; i < KEY_BITTING_WORDS; i++) {
+        bitting->w[i] = all & nibble_mask(pin_num, i);
+    }
+}
+
+uint32_t key_bitting_macs_violations(const KeyBitting* bitting, uint8_t pin_num, uint8_t macs) {
+    if(pin_num < 2) return 0;
+    uint32_t violations = 0;
+    // only the words where a pair starts; most formats fit in the first
+    uint8_t words = (pin_num - 2) / KEY_BITTING_PINS_PER_WORD + 1;
+    for(uint8_t i = 0; i < words; i++) {
+        uint64_t a = bitting->w[i];
+        uint64_t next = (i + 1 < KEY_BITTING_WORDS) ? bitting->w[i + 1] : 0;
+        uint64_t b = (a >> 4) | (next << 60); // pin j + 1 lined up under pin j
+        // pairs starting on even pins, then pairs starting on odd pins
+        uint64_t a_even = a & LANES_0F, b_even = b & LANES_0F;
+        uint64_t a_odd = (a >> 4) & LANES_0F, b_odd = (b >> 4) & LANES_0F;
+        uint8_t even = lanes_to_bits(
+            lanes_diff_above(a_even, b_even, macs) | lanes_diff_above(b_even, a_even, macs));
+        uint8_t odd = lanes_to_bits(
+            lanes_diff_above(a_odd, b_odd, macs) | lanes_diff_above(b_odd, a_odd, macs));
+        violations |= bits_interleave(even, odd) << (i * KEY_BITTING_PINS_PER_WORD);
+    }
+    uint8_t pairs = pin_num - 1;
+    return pairs >= 32 ? violations : violations & ((1u << pairs) - 1);
+}
+
+// Adding 15 - max to every depth carries out of a nibble only where some depth is past max,
+// and taking min away borrows only where some depth is below min. A carry or borrow passed on
+// from the nibble below still means a bad depth, so the nibbles need no spreading out and
+// nothing branches on the depths. Nonzero if any depth under mask is out of range.
+static inline uint64_t
+    nibbles_out_of_range(uint64_t w, uint64_t mask, uint8_t min_depth, uint8_t max_depth) {
+    uint64_t x = w & mask;
+    uint64_t up = NIBBLES_1 * (15 - max_depth) & mask;
+    uint64_t down = NIBBLES_1 * min_depth & mask;
+    uint64_t sum = x + up, difference = x - down;
+    // bit 4k is the carry or borrow into nibble k; the top nibble's shows as wrapping
+    return (((sum ^ x ^ up) | (difference ^ x ^ down)) & NIBBLES_CARRY) | (sum < x) |
+           (x < down);
+}
+
+bool key_bitting_in_range(
+    const KeyBitting* bitting,
+    uint8_t pin_num,
+    uint8_t min_depth,
+    uint8_t max_depth) {
+    // every format in the catalog fits in the first word
+    if(pin_num <= KEY_BITTING_PINS_PER_WORD) {
+        return !nibbles_out_of_range(
+            bitting->w[0], nibble_mask(pin_num, 0), min_depth, max_depth);
+    }
+    return !(
+        nibbles_out_of_range(bitting->w[0], ~0ULL, min_depth, max_depth) |
+        nibbles_out_of_range(bitting->w[1], nibble_mask(pin_num, 1), min_depth, max_depth));
+}
+
+uint64_t key_bitting_hash(const KeyBitting* bitting, uint8_t pin_num) {
+    // murmur3 finalizer over both words and the pin count
+    uint64_t h = bitting->w[0] ^ (bitting->w[1] * 0x9E3779B97F4A7C15ULL) ^ pin_num;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+uint8_t key_bitting_hamming(const KeyBitting* a, const KeyBitting* b) {
+    uint8_t count = 0;
+    for(uint8_t i = 0; i < KEY_BITTING_WORDS; i++) {
+        uint64_t x = a->w[i] ^ b->w[i];
+        x = (x | (x >> 1) | (x >> 2) | (x >> 3)) & 0x1111111111111111ULL;
+        count += __builtin_popcountll(x);
+    }
+    return count;
+}
+
+static inline uint64_t lanes_abs_diff(uint64_t a, uint64_t b) {
+    uint64_t d1 = (a + LANES_40) - b; // 64 + a - b
+    uint64_t d2 = (b + LANES_40) - a; // 64 + b - a
+    uint64_t a_ge_b = ((d1 >> 6) & LANES_01) * 0xFF;
+    return ((d1 & a_ge_b) | (d2 & ~a_ge_b)) & LANES_0F;
+}
+
+uint16_t key_bitting_distance(const KeyBitting* a, const KeyBitting* b) {
+    uint16_t sum = 0;
+    for(uint8_t i = 0; i < KEY_BITTING_WORDS; i++) {
+        uint64_t lo = lanes_abs_diff(a->w[i] & LANES_0F, b->w[i] & LANES_0F);
+        uint64_t hi = lanes_abs_diff((a->w[i] >> 4) & LANES_0F, (b->w[i] >> 4) & LANES_0F);
+        // every lane is at most 15, so the byte sums cannot overflow
+        sum += ((lo + hi) * LANES_01) >> 56;
+    }
+    return sum;
+}
+
+size_t key_bitting_to_str(const KeyBitting* bitting, uint8_t pin_num, char* str, size_t size) {
+    size_t len = 0;
+    if(size == 0) return 0;
+    for(uint8_t i = 0; i < pin_num && len + 3 < size; i++) {
+        uint8_t depth = key_bitting_get(bitting, i);
+        if(i > 0) str[len++] = '-';
+        if(depth >= 10) str[len++] = '0' + depth / 10;
+        str[len++] = '0' + depth % 10;
+    }
+    str[len] = '\0';
+    return len;
+}
+
+bool key_bitting_from_str(KeyBitting* bitting, uint8_t pin_num, const char* str) {
+    KeyBitting parsed = {0};
+    uint8_t pin = 0;
+    while(*str && pin < pin_num) {
+        if(*str < '0' || *str > '9') {
+            str++;
+            continue;
+        }
+        uint16_t depth = 0;
+        while(*str >= '0' && *str <= '9') {
+            depth = depth * 10 + (*str++ - '0');
+            if(depth > KEY_BITTING_MAX_DEPTH) return false;
+        }
+        key_bitting_set(&parsed, pin++, depth);
+    }
+    if(pin < pin_num) return false;
+    *bitting = parsed;
+    return true;
+}
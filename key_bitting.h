@@ -0,0 +1,64 @@
+#ifndef KEY_BITTING_H
+#define KEY_BITTING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define KEY_BITTING_PINS_PER_WORD 16
+#define KEY_BITTING_WORDS 2
+#define KEY_BITTING_MAX_PINS (KEY_BITTING_PINS_PER_WORD * KEY_BITTING_WORDS)
+#define KEY_BITTING_MAX_DEPTH 15
+
+// A bitting with one depth per nibble, pin 0 in the lowest nibble of w[0].
+// Nibbles past the last pin are always kept at zero so that whole words can be compared.
+typedef struct {
+    uint64_t w[KEY_BITTING_WORDS];
+} KeyBitting;
+
+static inline uint8_t key_bitting_get(const KeyBitting* bitting, uint8_t pin) {
+    uint8_t shift = (pin % KEY_BITTING_PINS_PER_WORD) * 4;
+    return (bitting->w[pin / KEY_BITTING_PINS_PER_WORD] >> shift) & 0xF;
+}
+
+static inline void key_bitting_set(KeyBitting* bitting, uint8_t pin, uint8_t depth) {
+    uint8_t shift = (pin % KEY_BITTING_PINS_PER_WORD) * 4;
+    uint64_t* word = &bitting->w[pin / KEY_BITTING_PINS_PER_WORD];
+    *word = (*word & ~((uint64_t)0xF << shift)) | ((uint64_t)(depth & 0xF) << shift);
+}
+
+// Pair bits touching this pin in a mask from key_bitting_macs_violations
+static inline uint32_t key_bitting_pin_pairs(uint8_t pin) {
+    return (3u << pin) >> 1;
+}
+
+void key_bitting_fill(KeyBitting* bitting, uint8_t pin_num, uint8_t depth);
+
+// Bit i is set when pins i and i + 1 differ by more than macs
+uint32_t key_bitting_macs_violations(const KeyBitting* bitting, uint8_t pin_num, uint8_t macs);
+
+bool key_bitting_in_range(
+    const KeyBitting* bitting,
+    uint8_t pin_num,
+    uint8_t min_depth,
+    uint8_t max_depth);
+
+static inline bool key_bitting_equal(const KeyBitting* a, const KeyBitting* b) {
+    return ((a->w[0] ^ b->w[0]) | (a->w[1] ^ b->w[1])) == 0;
+}
+
+uint64_t key_bitting_hash(const KeyBitting* bitting, uint8_t pin_num);
+
+// Number of cuts that differ
+uint8_t key_bitting_hamming(const KeyBitting* a, const KeyBitting* b);
+
+// Sum of absolute depth differences over all cuts
+uint16_t key_bitting_distance(const KeyBitting* a, const KeyBitting* b);
+
+// "1-2-3" form used in saved files; returns the string length
+size_t key_bitting_to_str(const KeyBitting* bitting, uint8_t pin_num, char* str, size_t size);
+
+// Parse the "1-2-3" form; fails if there are fewer than pin_num depths or a depth is too big
+bool key_bitting_from_str(KeyBitting* bitting, uint8_t pin_num, const char* str);
+
+#endif // KEY_BITTING_H
@@ -0,0 +1,229 @@
+#include "key_caliper.h"
+#include <stdio.h>
+#include <string.h>
+
+#define KEY_CALIPER_SCALE 10000 // readings are parsed to four decimals
+#define KEY_CALIPER_UM_PER_INCH 25400
+
+bool key_caliper_parse(const char* text, KeyCaliperUnit unit, uint16_t* length) {
+    uint64_t scaled = 0;
+    uint32_t fraction = 0; // decimals seen after the point, 0 before it
+    bool digits = false;
+    while(*text == ' ') text++;
+    for(; (*text >= '0' && *text <= '9') || *text == '.'; text++) {
+        if(*text == '.') {
+            if(fraction) return false;
+            fraction = 1;
+            continue;
+        }
+        if(scaled > 1000000) return false; // no key is that big, in inches or mm
+        if(fraction > 4) continue; // finer than the catalog, dropped
+        scaled = scaled * 10 + (*text - '0');
+        if(fraction) fraction++;
+        digits = true;
+    }
+    if(!digits) return false;
+    for(uint32_t decimals = fraction ? fraction - 1 : 0; decimals < 4; decimals++) {
+        scaled *= 10;
+    }
+    while(*text == ' ') text++;
+    if(!strcmp(text, "mm")) {
+        unit = KeyCaliperMm;
+    } else if(!strcmp(text, "in") || !strcmp(text, "\"")) {
+        unit = KeyCaliperInch;
+    } else if(*text != '\0') {
+        return false;
+    }
+    if(unit == KeyCaliperMm) {
+        scaled = (scaled * 10 + KEY_CALIPER_UM_PER_INCH / 200) / (KEY_CALIPER_UM_PER_INCH / 100);
+    }
+    if(scaled > UINT16_MAX) return false;
+    *length = (uint16_t)scaled;
+    return true;
+}
+
+// Nearest depth to a reading, and the next nearest for when the reading is ambiguous
+static uint8_t key_caliper_snap(
+    const KeyFormat* format,
+    uint16_t reading,
+    uint8_t* other,
+    bool* ambiguous,
+    bool* out_of_range) {
+    const int32_t step = format->depth_step;
+    int32_t below = (int32_t)format->uncut_depth - reading; // how far below the uncut blade
+    int32_t steps = below >= 0 ? (2 * below + step) / (2 * step) :
+                                 -((-2 * below + step) / (2 * step));
+    int32_t error = below - steps * step;
+    int32_t depth = format->min_depth_ind + steps;
+    *out_of_range = depth < format->min_depth_ind || depth > format->max_depth_ind;
+    *ambiguous = !*out_of_range &&
+                 100 * (error < 0 ? -error : error) > step * KEY_CALIPER_AMBIGUOUS_PERCENT;
+    if(depth < format->min_depth_ind) depth = format->min_depth_ind;
+    if(depth > format->max_depth_ind) depth = format->max_depth_ind;
+    int32_t next = depth + (error > 0 ? 1 : -1);
+    *other = next >= format->min_depth_ind && next <= format->max_depth_ind ? next : depth;
+    return depth;
+}
+
+bool key_caliper_decode(
+    const KeyFormat* format,
+    const uint16_t* readings,
+    KeyCaliperResult* result) {
+    uint8_t other[KEY_BITTING_MAX_PINS];
+    memset(result, 0, sizeof(KeyCaliperResult));
+    for(uint8_t pin = 0; pin < format->pin_num; pin++) {
+        bool ambiguous;
+        bool out_of_range;
+        uint8_t depth =
+            key_caliper_snap(format, readings[pin], &other[pin], &ambiguous, &out_of_range);
+        key_bitting_set(&result->bitting, pin, depth);
+        if(ambiguous) result->ambiguous |= 1u << pin;
+        if(out_of_range) result->out_of_range |= 1u << pin;
+    }
+
+    // An ambiguous cut next to a MACS break may just as well be the other depth; take it when
+    // that clears the break without making a new one
+    result->macs = key_bitting_macs_violations(&result->bitting, format->pin_num, format->macs);
+    for(uint8_t pin = 0; result->macs && pin < format->pin_num; pin++) {
+        uint32_t pairs = key_bitting_pin_pairs(pin);
+        if(!(result->ambiguous & (1u << pin)) || !(result->macs & pairs)) continue;
+        KeyBitting bitting = result->bitting;
+        key_bitting_set(&bitting, pin, other[pin]);
+        uint32_t macs = key_bitting_macs_violations(&bitting, format->pin_num, format->macs);
+        if(macs & pairs) continue;
+        result->bitting = bitting;
+        result->macs = macs;
+        result->resolved |= 1u << pin;
+    }
+    return !(result->ambiguous & ~result->resolved) && !result->out_of_range && !result->macs;
+}
+
+static void key_caliper_pins(char* out, size_t size, const char* label, uint32_t mask) {
+    size_t length = strlen(out);
+    if(!mask) return;
+    const char* separator = length > 0 && out[length - 1] == ',' ? "" : "; ";
+    length += snprintf(out + length, size - length, "%s%s", separator, label);
+    for(uint8_t pin = 0; pin < KEY_BITTING_MAX_PINS && length < size; pin++) {
+        if(mask & (1u << pin)) length += snprintf(out + length, size - length, " %u", pin + 1);
+    }
+}
+
+static bool key_caliper_print(KeyCaliperWrite write, void* context, const char* text) {
+    return write(text, strlen(text), context);
+}
+
+// Cut a line at the next comma, trimming blanks; returns the field and moves line past it
+static char* key_caliper_field(char** line) {
+    char* field = *line;
+    char* end = strchr(field, ',');
+    if(end) {
+        *end = '\0';
+        *line = end + 1;
+    } else {
+        *line = NULL;
+    }
+    while(*field == ' ' || *field == '\t') field++;
+    size_t length = strlen(field);
+    while(length > 0 &&
+          (field[length - 1] == ' ' || field[length - 1] == '\t' || field[length - 1] == '\r'))
+        field[--length] = '\0';
+    return field;
+}
+
+bool key_caliper_run(
+    uint32_t format_index,
+    KeyCaliperReadLine read_line,
+    KeyCaliperWrite write,
+    void* context,
+    KeyCaliperTotals* totals) {
+    memset(totals, 0, sizeof(KeyCaliperTotals));
+    KeyFormat format;
+    key_format_load(format_index, &format);
+    KeyCaliperUnit unit = KeyCaliperInch;
+    char line[KEY_CALIPER_LINE_SIZE];
+    char out[KEY_CALIPER_NAME_SIZE + KEY_BITTING_MAX_PINS * 20];
+    char pattern[KEY_BITTING_MAX_PINS * 3];
+    uint16_t readings[KEY_BITTING_MAX_PINS];
+    uint32_t line_number = 0;
+
+    snprintf(
+        out,
+        sizeof(out),
+        "# format,%s\n# key,bitting,notes\n",
+        key_format_info[format_index].format_name);
+    if(!key_caliper_print(write, context, out)) return false;
+    while(read_line(line, sizeof(line), context)) {
+        line_number++;
+        char* rest = line;
+        const char* name = key_caliper_field(&rest);
+        const char* error = NULL;
+        if(name[0] == '\0' || name[0] == '#') continue;
+
+        if(!strcmp(name, "FORMAT")) {
+            int32_t index = rest ? key_format_find(key_caliper_field(&rest)) : -1;
+            if(index < 0) {
+                error = "unknown format";
+            } else {
+                format_index = index;
+                key_format_load(format_index, &format);
+                snprintf(out, sizeof(out), "# format,%s\n", key_format_info[index].format_name);
+                if(!key_caliper_print(write, context, out)) return false;
+            }
+        } else if(!strcmp(name, "UNIT")) {
+            const char* value = rest ? key_caliper_field(&rest) : "";
+            if(!strcmp(value, "in")) {
+                unit = KeyCaliperInch;
+            } else if(!strcmp(value, "mm")) {
+                unit = KeyCaliperMm;
+            } else {
+                error = "unknown unit";
+            }
+        } else {
+            uint8_t count = 0;
+            while(rest && !error) {
+                const char* reading = key_caliper_field(&rest);
+                if(count == format.pin_num) {
+                    error = "too many readings";
+                } else if(!key_caliper_parse(reading, unit, &readings[count++])) {
+                    error = "bad reading";
+                }
+            }
+            if(!error && count < format.pin_num) error = "too few readings";
+            if(!error) {
+                KeyCaliperResult result;
+                bool clean = key_caliper_decode(&format, readings, &result);
+                totals->keys++;
+                if(clean) totals->clean++;
+                if(result.ambiguous & ~result.resolved) totals->ambiguous++;
+                if(result.out_of_range) totals->out_of_range++;
+                if(result.macs) totals->macs++;
+                key_bitting_to_str(&result.bitting, format.pin_num, pattern, sizeof(pattern));
+                snprintf(out, sizeof(out), "%.*s,%s,", KEY_CALIPER_NAME_SIZE, name, pattern);
+                if(clean && !result.resolved) strncat(out, "ok", sizeof(out) - strlen(out) - 1);
+                key_caliper_pins(out, sizeof(out), "between depths at", result.ambiguous);
+                key_caliper_pins(out, sizeof(out), "settled by MACS at", result.resolved);
+                key_caliper_pins(out, sizeof(out), "out of range at", result.out_of_range);
+                key_caliper_pins(out, sizeof(out), "MACS broken after", result.macs);
+                strncat(out, "\n", sizeof(out) - strlen(out) - 1);
+                if(!key_caliper_print(write, context, out)) return false;
+            }
+        }
+        if(error) {
+            totals->errors++;
+            snprintf(out, sizeof(out), "# line %lu: %s\n", (unsigned long)line_number, error);
+            if(!key_caliper_print(write, context, out)) return false;
+        }
+    }
+    snprintf(
+        out,
+        sizeof(out),
+        "# keys,%lu\n# clean,%lu\n# ambiguous,%lu\n# out of range,%lu\n# MACS broken,%lu\n"
+        "# errors,%lu\n",
+        (unsigned long)totals->keys,
+        (unsigned long)totals->clean,
+        (unsigned long)totals->ambiguous,
+        (unsigned long)totals->out_of_range,
+        (unsigned long)totals->macs,
+        (unsigned long)totals->errors);
+    return key_caliper_print(write, context, out);
+}
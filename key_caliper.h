@@ -0,0 +1,66 @@
+#ifndef KEY_CALIPER_H
+#define KEY_CALIPER_H
+
+#include "key_bitting.h"
+#include "key_formats.h"
+
+// A reading further than this share of a depth step from the nearest depth is ambiguous
+#define KEY_CALIPER_AMBIGUOUS_PERCENT 25
+#define KEY_CALIPER_LINE_SIZE 256
+#define KEY_CALIPER_NAME_SIZE 32
+
+typedef enum {
+    KeyCaliperInch,
+    KeyCaliperMm,
+} KeyCaliperUnit;
+
+// Bit i of each mask is about pin i, except macs, which is per pair as from
+// key_bitting_macs_violations
+typedef struct {
+    KeyBitting bitting;
+    uint32_t ambiguous; // the reading fell between two depths
+    uint32_t resolved; // ambiguous, and taken as the other depth to keep to the MACS
+    uint32_t out_of_range; // beyond the shallowest or deepest cut; the nearest end is used
+    uint32_t macs;
+} KeyCaliperResult;
+
+typedef struct {
+    uint32_t keys;
+    uint32_t clean; // every cut snapped clearly and the key keeps to the MACS
+    uint32_t ambiguous;
+    uint32_t out_of_range;
+    uint32_t macs;
+    uint32_t errors; // lines that could not be read
+} KeyCaliperTotals;
+
+typedef bool (*KeyCaliperReadLine)(char* line, size_t size, void* context);
+typedef bool (*KeyCaliperWrite)(const char* text, size_t size, void* context);
+
+// Remaining material under a cut of this depth, as the spec sheets measure it
+static inline int32_t key_caliper_remaining(const KeyFormat* format, uint8_t depth) {
+    return (int32_t)format->uncut_depth -
+           (int32_t)(depth - format->min_depth_ind) * format->depth_step;
+}
+
+// Parse a reading such as "0.245", ".245in" or "6.22mm" into catalog length units. Bare numbers
+// are in unit.
+bool key_caliper_parse(const char* text, KeyCaliperUnit unit, uint16_t* length);
+
+// Snap one reading per pin to depths of the format. Returns true when no cut is left ambiguous or
+// out of range and the key keeps to the MACS.
+bool key_caliper_decode(
+    const KeyFormat* format,
+    const uint16_t* readings,
+    KeyCaliperResult* result);
+
+// Decode a file of "name,reading,reading,..." lines, one line in and one line out at a time.
+// "FORMAT,<format name>" and "UNIT,in" or "UNIT,mm" apply to the lines that follow. Blank lines
+// and # comments are skipped. The totals of the whole batch are written at the end.
+bool key_caliper_run(
+    uint32_t format_index,
+    KeyCaliperReadLine read_line,
+    KeyCaliperWrite write,
+    void* context,
+    KeyCaliperTotals* totals);
+
+#endif // KEY_CALIPER_H
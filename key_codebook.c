@@ -0,0 +1,406 @@
+#include "key_codebook.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Largest encoded block: every entry with a full code and 32 pins
+#define KEY_CODEBOOK_BLOCK_MAX \
+    (KEY_CODEBOOK_BLOCK_ENTRIES * (1 + KEY_CODEBOOK_CODE_SIZE - 1 + KEY_BITTING_MAX_PINS / 2))
+#define KEY_CODEBOOK_MAX_BUCKET_BITS 13
+#define KEY_CODEBOOK_WRITE_CHUNK 64
+
+_Static_assert(
+    (1 << KEY_CODEBOOK_MAX_BUCKET_BITS) >= KEY_CODEBOOK_MAX_ENTRIES,
+    "a bucket per entry must fit in the bucket bits");
+_Static_assert(KEY_CODEBOOK_CODE_SIZE - 1 <= 0xF, "code lengths are stored in a nibble");
+
+struct KeyCodebookBuilder {
+    KeyCodebookWriteCallback write;
+    void* context;
+    uint8_t pin_num;
+    uint32_t offset; // where the current block goes
+    uint32_t entries;
+    char last_code[KEY_CODEBOOK_CODE_SIZE];
+    KeyCodebookIndexEntry* index;
+    uint32_t index_capacity;
+    uint32_t* postings; // bitting hash << 16 | entry number
+    uint32_t postings_capacity;
+    uint16_t block_size;
+    uint8_t block[KEY_CODEBOOK_BLOCK_MAX];
+};
+
+static inline size_t key_codebook_bitting_size(uint8_t pin_num) {
+    return (pin_num + 1) / 2;
+}
+
+static inline uint16_t key_codebook_bitting_hash(const KeyBitting* bitting, uint8_t pin_num) {
+    return (uint16_t)key_bitting_hash(bitting, pin_num);
+}
+
+static inline uint32_t key_codebook_blocks(uint32_t entries) {
+    return (entries + KEY_CODEBOOK_BLOCK_ENTRIES - 1) / KEY_CODEBOOK_BLOCK_ENTRIES;
+}
+
+// Uppercase copy of a code; false if it is empty, too long or not alphanumeric
+static bool key_codebook_normalize(const char* code, size_t length, char* out) {
+    if(length == 0 || length >= KEY_CODEBOOK_CODE_SIZE) return false;
+    for(size_t i = 0; i < length; i++) {
+        char c = code[i];
+        if(c >= 'a' && c <= 'z') c -= 'a' - 'A';
+        if(!((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))) return false;
+        out[i] = c;
+    }
+    out[length] = '\0';
+    return true;
+}
+
+int key_codebook_compare(const char* a, const char* b) {
+    size_t length_a = strlen(a);
+    size_t length_b = strlen(b);
+    if(length_a != length_b) return length_a < length_b ? -1 : 1;
+    return strcmp(a, b);
+}
+
+bool key_codebook_parse_line(const char* line, uint8_t pin_num, char* code, KeyBitting* bitting) {
+    code[0] = '\0';
+    while(*line == ' ' || *line == '\t') line++;
+    if(*line == '\0' || *line == '#' || *line == '\r' || *line == '\n') return false;
+    size_t length = strcspn(line, " \t,;");
+    if(!key_codebook_normalize(line, length, code)) {
+        size_t shown = length < KEY_CODEBOOK_CODE_SIZE ? length : KEY_CODEBOOK_CODE_SIZE - 1;
+        memcpy(code, line, shown);
+        code[shown] = '\0';
+        return false;
+    }
+    return key_bitting_from_str(bitting, pin_num, line + length);
+}
+
+KeyCodebookBuilder*
+    key_codebook_builder_alloc(uint8_t pin_num, KeyCodebookWriteCallback write, void* context) {
+    KeyCodebookBuilder* builder = malloc(sizeof(KeyCodebookBuilder));
+    memset(builder, 0, sizeof(KeyCodebookBuilder));
+    builder->write = write;
+    builder->context = context;
+    builder->pin_num = pin_num;
+    builder->offset = sizeof(KeyCodebookHeader);
+    return builder;
+}
+
+void key_codebook_builder_free(KeyCodebookBuilder* builder) {
+    free(builder->postings);
+    free(builder->index);
+    free(builder);
+}
+
+static bool key_codebook_builder_flush(KeyCodebookBuilder* builder) {
+    if(builder->block_size == 0) return true;
+    if(!builder->write(builder->offset, builder->block, builder->block_size, builder->context))
+        return false;
+    builder->offset += builder->block_size;
+    builder->block_size = 0;
+    return true;
+}
+
+KeyCodebookStatus key_codebook_builder_add(
+    KeyCodebookBuilder* builder,
+    const char* code,
+    const KeyBitting* bitting) {
+    char normal[KEY_CODEBOOK_CODE_SIZE];
+    if(!key_codebook_normalize(code, strlen(code), normal)) return KeyCodebookBadSource;
+    if(builder->entries == KEY_CODEBOOK_MAX_ENTRIES) return KeyCodebookBadSource;
+    if(builder->entries > 0 && key_codebook_compare(builder->last_code, normal) >= 0)
+        return KeyCodebookBadSource;
+
+    uint32_t entry = builder->entries;
+    size_t shared = 0;
+    if(entry % KEY_CODEBOOK_BLOCK_ENTRIES == 0) {
+        if(!key_codebook_builder_flush(builder)) return KeyCodebookIoError;
+        uint32_t block = entry / KEY_CODEBOOK_BLOCK_ENTRIES;
+        if(block == builder->index_capacity) {
+            builder->index_capacity = builder->index_capacity ? builder->index_capacity * 2 : 16;
+            builder->index = realloc(
+                builder->index, builder->index_capacity * sizeof(KeyCodebookIndexEntry));
+        }
+        memset(builder->index[block].first_code, 0, KEY_CODEBOOK_CODE_SIZE);
+        strcpy(builder->index[block].first_code, normal);
+        builder->index[block].offset = builder->offset;
+    } else {
+        while(normal[shared] && normal[shared] == builder->last_code[shared]) shared++;
+    }
+    if(entry == builder->postings_capacity) {
+        builder->postings_capacity = builder->postings_capacity ? builder->postings_capacity * 2 :
+                                                                  64;
+        builder->postings =
+            realloc(builder->postings, builder->postings_capacity * sizeof(uint32_t));
+    }
+    builder->postings[entry] =
+        (uint32_t)key_codebook_bitting_hash(bitting, builder->pin_num) << 16 | entry;
+
+    size_t suffix = strlen(normal) - shared;
+    uint8_t* p = builder->block + builder->block_size;
+    *p++ = shared << 4 | suffix;
+    memcpy(p, normal + shared, suffix);
+    p += suffix;
+    for(size_t i = 0; i < key_codebook_bitting_size(builder->pin_num); i++) {
+        *p++ = bitting->w[i / 8] >> (8 * (i % 8));
+    }
+    builder->block_size = p - builder->block;
+    strcpy(builder->last_code, normal);
+    builder->entries++;
+    return KeyCodebookOk;
+}
+
+static int key_codebook_posting_compare(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+KeyCodebookStatus key_codebook_builder_finish(
+    KeyCodebookBuilder* builder,
+    uint32_t source_size,
+    uint32_t source_timestamp) {
+    if(!key_codebook_builder_flush(builder)) return KeyCodebookIoError;
+    KeyCodebookHeader header = {
+        .magic = KEY_CODEBOOK_MAGIC,
+        .version = KEY_CODEBOOK_VERSION,
+        .pin_num = builder->pin_num,
+        .entries = builder->entries,
+        .source_size = source_size,
+        .source_timestamp = source_timestamp,
+        .index_offset = builder->offset,
+    };
+    while((1u << header.bucket_bits) < builder->entries) header.bucket_bits++;
+    uint32_t buckets = 1u << header.bucket_bits;
+    uint32_t blocks = key_codebook_blocks(builder->entries);
+    header.buckets_offset = header.index_offset + blocks * sizeof(KeyCodebookIndexEntry);
+    header.postings_offset = header.buckets_offset + (buckets + 1) * sizeof(uint16_t);
+
+    if(blocks > 0 && !builder->write(
+                         header.index_offset,
+                         builder->index,
+                         blocks * sizeof(KeyCodebookIndexEntry),
+                         builder->context))
+        return KeyCodebookIoError;
+
+    // Sort entry numbers by bucket, then write where each bucket starts and the entries
+    uint32_t mask = buckets - 1;
+    for(uint32_t i = 0; i < builder->entries; i++) {
+        uint32_t posting = builder->postings[i];
+        builder->postings[i] = ((posting >> 16) & mask) << 16 | (posting & 0xFFFF);
+    }
+    if(builder->entries > 0) {
+        qsort(
+            builder->postings,
+            builder->entries,
+            sizeof(uint32_t),
+            key_codebook_posting_compare);
+    }
+    uint16_t chunk[KEY_CODEBOOK_WRITE_CHUNK];
+    uint32_t offset = header.buckets_offset;
+    uint32_t posting = 0;
+    for(uint32_t bucket = 0; bucket <= buckets; bucket++) {
+        while(posting < builder->entries && (builder->postings[posting] >> 16) < bucket)
+            posting++;
+        size_t slot = bucket % KEY_CODEBOOK_WRITE_CHUNK;
+        chunk[slot] = posting;
+        if(slot == KEY_CODEBOOK_WRITE_CHUNK - 1 || bucket == buckets) {
+            size_t size = (slot + 1) * sizeof(uint16_t);
+            if(!builder->write(offset, chunk, size, builder->context)) return KeyCodebookIoError;
+            offset += size;
+        }
+    }
+    for(uint32_t i = 0; i < builder->entries; i++) {
+        size_t slot = i % KEY_CODEBOOK_WRITE_CHUNK;
+        chunk[slot] = builder->postings[i] & 0xFFFF;
+        if(slot == KEY_CODEBOOK_WRITE_CHUNK - 1 || i == builder->entries - 1) {
+            size_t size = (slot + 1) * sizeof(uint16_t);
+            if(!builder->write(offset, chunk, size, builder->context)) return KeyCodebookIoError;
+            offset += size;
+        }
+    }
+
+    // Header last, so a book cut short by an error never looks valid
+    if(!builder->write(0, &header, sizeof(header), builder->context)) return KeyCodebookIoError;
+    return KeyCodebookOk;
+}
+
+KeyCodebookStatus key_codebook_open(
+    KeyCodebook* book,
+    uint8_t pin_num,
+    KeyCodebookReadCallback read,
+    void* context) {
+    book->read = read;
+    book->context = context;
+    if(!read(0, &book->header, sizeof(KeyCodebookHeader), context)) return KeyCodebookIoError;
+    const KeyCodebookHeader* header = &book->header;
+    if(header->magic != KEY_CODEBOOK_MAGIC || header->version != KEY_CODEBOOK_VERSION ||
+       header->entries > KEY_CODEBOOK_MAX_ENTRIES ||
+       header->bucket_bits > KEY_CODEBOOK_MAX_BUCKET_BITS)
+        return KeyCodebookCorrupt;
+    // A book compiled for another pin count can't be decoded
+    if(header->pin_num != pin_num) return KeyCodebookCorrupt;
+    return KeyCodebookOk;
+}
+
+// Step to the next entry of a block. code holds the previous code of the block, or "".
+static const uint8_t* key_codebook_decode_entry(
+    const uint8_t* p,
+    const uint8_t* end,
+    uint8_t pin_num,
+    char* code,
+    KeyBitting* bitting) {
+    if(p >= end) return NULL;
+    size_t shared = *p >> 4;
+    size_t suffix = *p & 0xF;
+    size_t bitting_size = key_codebook_bitting_size(pin_num);
+    p++;
+    if(shared + suffix >= KEY_CODEBOOK_CODE_SIZE || shared > strlen(code) ||
+       p + suffix + bitting_size > end)
+        return NULL;
+    memcpy(code + shared, p, suffix);
+    code[shared + suffix] = '\0';
+    p += suffix;
+    memset(bitting, 0, sizeof(KeyBitting));
+    for(size_t i = 0; i < bitting_size; i++) {
+        bitting->w[i / 8] |= (uint64_t)p[i] << (8 * (i % 8));
+    }
+    return p + bitting_size;
+}
+
+static KeyCodebookStatus key_codebook_read_block(
+    const KeyCodebook* book,
+    uint32_t block,
+    uint8_t* data,
+    const uint8_t** end) {
+    KeyCodebookIndexEntry entry;
+    if(!book->read(
+           book->header.index_offset + block * sizeof(KeyCodebookIndexEntry),
+           &entry,
+           sizeof(entry),
+           book->context))
+        return KeyCodebookIoError;
+    if(entry.offset < sizeof(KeyCodebookHeader) || entry.offset >= book->header.index_offset)
+        return KeyCodebookCorrupt;
+    size_t size = book->header.index_offset - entry.offset;
+    if(size > KEY_CODEBOOK_BLOCK_MAX) size = KEY_CODEBOOK_BLOCK_MAX;
+    if(!book->read(entry.offset, data, size, book->context)) return KeyCodebookIoError;
+    *end = data + size;
+    return KeyCodebookOk;
+}
+
+static inline uint32_t key_codebook_block_entries(const KeyCodebook* book, uint32_t block) {
+    uint32_t left = book->header.entries - block * KEY_CODEBOOK_BLOCK_ENTRIES;
+    return left < KEY_CODEBOOK_BLOCK_ENTRIES ? left : KEY_CODEBOOK_BLOCK_ENTRIES;
+}
+
+KeyCodebookStatus
+    key_codebook_find_code(const KeyCodebook* book, const char* code, KeyBitting* bitting) {
+    char wanted[KEY_CODEBOOK_CODE_SIZE];
+    if(!key_codebook_normalize(code, strlen(code), wanted)) return KeyCodebookNotFound;
+    uint32_t blocks = key_codebook_blocks(book->header.entries);
+    if(blocks == 0) return KeyCodebookNotFound;
+
+    // Last block whose first code is not past the wanted one
+    uint32_t low = 0;
+    uint32_t high = blocks;
+    while(high - low > 1) {
+        uint32_t middle = low + (high - low) / 2;
+        KeyCodebookIndexEntry entry;
+        if(!book->read(
+               book->header.index_offset + middle * sizeof(KeyCodebookIndexEntry),
+               &entry,
+               sizeof(entry),
+               book->context))
+            return KeyCodebookIoError;
+        entry.first_code[KEY_CODEBOOK_CODE_SIZE - 1] = '\0';
+        if(key_codebook_compare(entry.first_code, wanted) <= 0) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+
+    uint8_t* data = malloc(KEY_CODEBOOK_BLOCK_MAX);
+    const uint8_t* end;
+    KeyCodebookStatus status = key_codebook_read_block(book, low, data, &end);
+    if(status == KeyCodebookOk) {
+        status = KeyCodebookNotFound;
+        char current[KEY_CODEBOOK_CODE_SIZE] = "";
+        KeyBitting current_bitting;
+        const uint8_t* p = data;
+        for(uint32_t i = 0; i < key_codebook_block_entries(book, low); i++) {
+            p = key_codebook_decode_entry(p, end, book->header.pin_num, current, &current_bitting);
+            if(!p) {
+                status = KeyCodebookCorrupt;
+                break;
+            }
+            int order = key_codebook_compare(current, wanted);
+            if(order > 0) break;
+            if(order == 0) {
+                *bitting = current_bitting;
+                status = KeyCodebookOk;
+                break;
+            }
+        }
+    }
+    free(data);
+    return status;
+}
+
+KeyCodebookStatus
+    key_codebook_find_bitting(const KeyCodebook* book, const KeyBitting* bitting, char* code) {
+    const KeyCodebookHeader* header = &book->header;
+    uint32_t bucket =
+        key_codebook_bitting_hash(bitting, header->pin_num) & ((1u << header->bucket_bits) - 1);
+    uint16_t range[2];
+    if(!book->read(
+           header->buckets_offset + bucket * sizeof(uint16_t),
+           range,
+           sizeof(range),
+           book->context))
+        return KeyCodebookIoError;
+    if(range[0] > range[1] || range[1] > header->entries) return KeyCodebookCorrupt;
+
+    uint8_t* data = malloc(KEY_CODEBOOK_BLOCK_MAX);
+    const uint8_t* end = data;
+    uint32_t loaded_block = UINT32_MAX;
+    KeyCodebookStatus status = KeyCodebookNotFound;
+    for(uint32_t posting = range[0]; posting < range[1] && status == KeyCodebookNotFound;
+        posting++) {
+        uint16_t entry;
+        if(!book->read(
+               header->postings_offset + posting * sizeof(uint16_t),
+               &entry,
+               sizeof(entry),
+               book->context)) {
+            status = KeyCodebookIoError;
+            break;
+        }
+        if(entry >= header->entries) {
+            status = KeyCodebookCorrupt;
+            break;
+        }
+        uint32_t block = entry / KEY_CODEBOOK_BLOCK_ENTRIES;
+        if(block != loaded_block) {
+            status = key_codebook_read_block(book, block, data, &end);
+            if(status != KeyCodebookOk) break;
+            status = KeyCodebookNotFound;
+            loaded_block = block;
+        }
+        // Codes are front coded, so walk the block up to the entry
+        char current[KEY_CODEBOOK_CODE_SIZE] = "";
+        KeyBitting current_bitting;
+        const uint8_t* p = data;
+        for(uint32_t i = 0; i <= entry % KEY_CODEBOOK_BLOCK_ENTRIES && p; i++) {
+            p = key_codebook_decode_entry(p, end, header->pin_num, current, &current_bitting);
+        }
+        if(!p) {
+            status = KeyCodebookCorrupt;
+        } else if(key_bitting_equal(&current_bitting, bitting)) {
+            strcpy(code, current);
+            status = KeyCodebookOk;
+        }
+    }
+    free(data);
+    return status;
+}
@@ -0,0 +1,102 @@
+#ifndef KEY_CODEBOOK_H
+#define KEY_CODEBOOK_H
+
+#include "key_bitting.h"
+
+// Codes are up to 11 letters or digits, stored uppercase
+#define KEY_CODEBOOK_CODE_SIZE 12
+#define KEY_CODEBOOK_BLOCK_ENTRIES 32
+// Entries are numbered with 16 bits and the builder keeps 4 bytes of RAM per entry
+#define KEY_CODEBOOK_MAX_ENTRIES 8192
+#define KEY_CODEBOOK_MAGIC 0x3142434B // "KCB1"
+#define KEY_CODEBOOK_VERSION 2
+
+// A compiled code book file:
+//   KeyCodebookHeader
+//   blocks of KEY_CODEBOOK_BLOCK_ENTRIES entries, in key_codebook_compare order of code. Each
+//     entry is one byte (prefix shared with the previous code << 4 | suffix length), the suffix,
+//     then (pin_num + 1) / 2 bytes of packed bitting. The first entry of a block shares nothing.
+//   index_offset: KeyCodebookIndexEntry per block, for binary search on the code
+//   buckets_offset: (1 << bucket_bits) + 1 uint16 starts into the postings, by bitting hash
+//   postings_offset: uint16 entry numbers, grouped by bucket
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t pin_num;
+    uint8_t bucket_bits;
+    uint8_t reserved;
+    uint32_t entries;
+    // Size and modification time of the text the book was compiled from, to spot stale books
+    uint32_t source_size;
+    uint32_t source_timestamp;
+    uint32_t index_offset;
+    uint32_t buckets_offset;
+    uint32_t postings_offset;
+} KeyCodebookHeader;
+
+typedef struct {
+    char first_code[KEY_CODEBOOK_CODE_SIZE];
+    uint32_t offset;
+} KeyCodebookIndexEntry;
+
+typedef enum {
+    KeyCodebookOk,
+    KeyCodebookNotFound,
+    KeyCodebookMissing, // no book for this format
+    KeyCodebookCorrupt,
+    KeyCodebookBadSource, // bad line, out of order code or too many entries
+    KeyCodebookIoError,
+} KeyCodebookStatus;
+
+// Positional file access, so the book code does not depend on where the file lives
+typedef bool (*KeyCodebookReadCallback)(uint32_t offset, void* data, size_t size, void* context);
+typedef bool (
+    *KeyCodebookWriteCallback)(uint32_t offset, const void* data, size_t size, void* context);
+
+// Order of codes in a book: shorter codes first, then by character
+int key_codebook_compare(const char* a, const char* b);
+
+// Parse one "CODE 1-2-3-4-5" line of a code book source. Returns false for blank lines and
+// # comments with code set to "", and for bad lines with code set to the offending text.
+bool key_codebook_parse_line(const char* line, uint8_t pin_num, char* code, KeyBitting* bitting);
+
+typedef struct KeyCodebookBuilder KeyCodebookBuilder;
+
+KeyCodebookBuilder*
+    key_codebook_builder_alloc(uint8_t pin_num, KeyCodebookWriteCallback write, void* context);
+
+// Entries must be added in key_codebook_compare order of code
+KeyCodebookStatus key_codebook_builder_add(
+    KeyCodebookBuilder* builder,
+    const char* code,
+    const KeyBitting* bitting);
+
+// Write the index, the hash buckets and the header
+KeyCodebookStatus key_codebook_builder_finish(
+    KeyCodebookBuilder* builder,
+    uint32_t source_size,
+    uint32_t source_timestamp);
+
+void key_codebook_builder_free(KeyCodebookBuilder* builder);
+
+typedef struct {
+    KeyCodebookReadCallback read;
+    void* context;
+    KeyCodebookHeader header;
+} KeyCodebook;
+
+KeyCodebookStatus key_codebook_open(
+    KeyCodebook* book,
+    uint8_t pin_num,
+    KeyCodebookReadCallback read,
+    void* context);
+
+// Binary search of the block index, then one block read
+KeyCodebookStatus
+    key_codebook_find_code(const KeyCodebook* book, const char* code, KeyBitting* bitting);
+
+// Hash bucket lookup, then one block read per candidate
+KeyCodebookStatus
+    key_codebook_find_bitting(const KeyCodebook* book, const KeyBitting* bitting, char* code);
+
+#endif // KEY_CODEBOOK_H
@@ -1,9 +1,20 @@
 #include "key_copier.h"
 #include "key_copier_icons.h"
+#include "key_analysis.h"
+#include "key_bitting.h"
+#include "key_caliper.h"
+#include "key_history.h"
+#include "key_identify.h"
+#include "key_library.h"
+#include "key_macs.h"
+#include "key_memory.h"
+#include "key_power.h"
+#include "key_render.h"
+#include "key_snapshot.h"
+#include "key_trace.h"
 #include "key_formats.h"
 #include <applications/services/dialogs/dialogs.h>
 #include <applications/services/storage/storage.h>
-#include <flipper_format.h>
 #include <furi.h>
 #include <furi_hal.h>
 #include <gui/gui.h>
@@ -13,20 +24,46 @@
 #include <gui/modules/widget.h>
 #include <gui/view.h>
 #include <gui/view_dispatcher.h>
-#include <math.h>
+#include <input/input.h>
 #include <notification/notification.h>
 #include <notification/notification_messages.h>
+#include <toolbox/path.h>
 #include <stdbool.h>
 
 #define TAG "KeyCopier"
 
 #define BACKLIGHT_ON 1
+// How close the selected pin may get to a screen edge before the view pans
+#define VIEW_MARGIN_PX 24
+// Saved keys listed by a search; type more of the name to narrow it down past these
+#define SEARCH_RESULTS 24
+// Keyring session keys held in RAM before they are written out together
+#define SESSION_KEYS 16
+// Room is left in a key name for a space and a five digit number
+#define SESSION_BASE_SIZE (KEY_LIBRARY_NAME_SIZE - 6)
 
 typedef enum {
     KeyCopierSubmenuIndexMeasure,
     KeyCopierSubmenuIndexConfigure,
     KeyCopierSubmenuIndexSave,
+    KeyCopierSubmenuIndexSession,
     KeyCopierSubmenuIndexLoad,
+    KeyCopierSubmenuIndexSearch,
+    KeyCopierSubmenuIndexRename,
+    KeyCopierSubmenuIndexReference,
+    KeyCopierSubmenuIndexIdentify,
+    KeyCopierSubmenuIndexCaliper,
+    KeyCopierSubmenuIndexCaliperBatch,
+    KeyCopierSubmenuIndexCodeLookup,
+    KeyCopierSubmenuIndexFindCode,
+    KeyCopierSubmenuIndexRekey,
+    KeyCopierSubmenuIndexCutQueue,
+    KeyCopierSubmenuIndexBackup,
+    KeyCopierSubmenuIndexRestore,
+    KeyCopierSubmenuIndexAnalyze,
+    KeyCopierSubmenuIndexTrace,
+    KeyCopierSubmenuIndexStats,
+    KeyCopierSubmenuIndexMemory,
     KeyCopierSubmenuIndexAbout,
 } KeyCopierSubmenuIndex;
 
@@ -36,11 +73,95 @@ typedef enum {
     KeyCopierViewConfigure_i,
     KeyCopierViewConfigure_e,
     KeyCopierViewSave,
+    KeyCopierViewSession,
+    KeyCopierViewSessionEnd,
     KeyCopierViewLoad,
+    KeyCopierViewSearch,
+    KeyCopierViewSearchResults,
+    KeyCopierViewRename,
+    KeyCopierViewReference,
+    KeyCopierViewIdentify,
+    KeyCopierViewMatches,
     KeyCopierViewMeasure,
+    KeyCopierViewCaliper,
+    KeyCopierViewCaliperBatch,
+    KeyCopierViewCodeLookup,
+    KeyCopierViewFindCode,
+    KeyCopierViewRekey,
+    KeyCopierViewCutQueue,
+    KeyCopierViewBackup,
+    KeyCopierViewRestore,
+    KeyCopierViewAnalyze,
+    KeyCopierViewTrace,
+    KeyCopierViewStats,
+    KeyCopierViewMemory,
+    KeyCopierViewResult,
     KeyCopierViewAbout,
 } KeyCopierView;
 
+typedef struct {
+    uint32_t format_index;
+    FuriString* key_name_str;
+    uint8_t pin_slc; // The pin that is being adjusted
+    KeyBitting bitting; // The cutting depth of each pin
+    bool data_loaded;
+    KeyFormat format;
+    KeyRenderGeometry geometry; // pixel layout of format, redone only when the format changes
+    int16_t view_px; // how far the screen is panned right of the key shoulder
+    bool follow; // pan with pin_slc; off keeps the view still while aligning a real key
+    KeyHistory history;
+    KeyMacsTable macs; // allowed depths of format, redone with the geometry
+    uint8_t blocked; // neighbour pin, counted from 1, that stopped the last depth step; 0 if none
+    KeyBitting reference; // saved key the measured one is checked against
+    uint32_t reference_format;
+    bool has_reference;
+    bool overlay; // show where the measured key and the reference differ
+} KeyCopierModel;
+
+// What the measure view draws. The app thread owns KeyCopierModel and publishes a frame after
+// every change, so the GUI thread only ever sees whole frames and never takes a lock.
+typedef struct {
+    uint32_t format_index;
+    KeyBitting bitting;
+    KeyRenderGeometry geometry;
+    int16_t view_px;
+    uint8_t pin_slc;
+    uint8_t blocked;
+    bool follow;
+    bool overlay; // of reference, which is then in format_index
+    KeyBitting reference;
+    uint32_t session_key; // number of the keyring key being measured, 0 outside a session
+} KeyCopierFrame;
+
+// A contour drawn once into a bitmap and kept until its key or the pan changes
+typedef struct {
+    uint8_t xbm[KEY_RENDER_LAYER_BYTES];
+    uint32_t format_index;
+    KeyBitting bitting;
+    int16_t view_px;
+    bool valid;
+} KeyCopierLayer;
+
+// The layers belong to the GUI thread: only the draw callback touches them
+typedef struct {
+    KeySnapshot snapshot;
+    KeyCopierFrame slots[2];
+    KeyCopierLayer live;
+    KeyCopierLayer reference;
+    uint8_t overlay[KEY_RENDER_LAYER_BYTES]; // live XOR reference
+} KeyCopierFrames;
+
+// Readings are remaining material in catalog length units; unit only changes how they show
+typedef struct {
+    uint32_t format_index;
+    KeyFormat format;
+    uint16_t readings[KEY_BITTING_MAX_PINS];
+    uint8_t pin;
+    KeyCaliperUnit unit;
+    KeyCaliperResult result;
+    bool clean;
+} KeyCopierCaliperModel;
+
 typedef struct {
     ViewDispatcher* view_dispatcher;
     NotificationApp* notifications;
@@ -48,9 +169,47 @@ typedef struct {
     TextInput* text_input;
     VariableItemList* variable_item_list_config;
     View* view_measure;
+    KeyCopierModel* model;
+    KeyCopierFrame frame; // last one published, to skip redraws that would change nothing
     View* view_config_e;
     View* view_save;
+    View* view_session;
+    View* view_session_end;
+    // Keyring session: keys measured and not yet written, named session_base and a number
+    KeyLibraryBatchKey session_keys[SESSION_KEYS];
+    uint8_t session_count;
+    bool session_active;
+    char session_base[SESSION_BASE_SIZE];
+    uint32_t session_first;
+    uint32_t session_next; // of the key being measured
+    uint32_t session_saved;
+    uint32_t session_done; // saved or name taken, always the first ones
+    FuriString* session_notes; // keys saved as a copy of another, or not saved
     View* view_load;
+    View* view_search;
+    Submenu* submenu_search;
+    char search_results[SEARCH_RESULTS][KEY_LIBRARY_NAME_SIZE];
+    uint8_t search_count;
+    bool search_more; // there were more matches than fit
+    View* view_rename;
+    View* view_reference;
+    VariableItemList* variable_item_list_identify;
+    Submenu* submenu_matches;
+    KeyIdentifyObservation observation;
+    KeyIdentifyMatch matches[KEY_IDENTIFY_MATCHES];
+    View* view_caliper;
+    View* view_caliper_batch;
+    View* view_code_lookup;
+    View* view_find_code;
+    View* view_rekey;
+    View* view_cut_queue;
+    View* view_backup;
+    View* view_restore;
+    View* view_analyze;
+    View* view_trace;
+    View* view_stats;
+    View* view_memory;
+    Widget* widget_result;
     Widget* widget_about;
     VariableItem* key_name_item;
     VariableItem* format_item;
@@ -60,30 +219,149 @@ typedef struct {
 
     DialogsApp* dialogs;
     FuriString* file_path;
+
+    KeyPower power;
+    FuriPubSub* input_events;
+    FuriPubSubSubscription* input_subscription;
+    volatile uint32_t last_input; // written by the input service thread
 } KeyCopierApp;
 
-typedef struct {
-    uint32_t format_index;
-    FuriString* key_name_str;
-    uint8_t pin_slc; // The pin that is being adjusted
-    uint8_t* depth; // The cutting depth
-    bool data_loaded;
-    KeyFormat format;
-} KeyCopierModel;
+// Probe names of the view transitions, so each view's heap cost shows on the memory screen
+static const char* const key_copier_view_probes[] = {
+    [KeyCopierViewSubmenu] = "view_submenu",
+    [KeyCopierViewTextInput] = "view_text_input",
+    [KeyCopierViewConfigure_i] = "view_configure_i",
+    [KeyCopierViewConfigure_e] = "view_configure_e",
+    [KeyCopierViewSave] = "view_save",
+    [KeyCopierViewSession] = "view_session",
+    [KeyCopierViewSessionEnd] = "view_session_end",
+    [KeyCopierViewLoad] = "view_load",
+    [KeyCopierViewSearch] = "view_search",
+    [KeyCopierViewSearchResults] = "view_search_results",
+    [KeyCopierViewRename] = "view_rename",
+    [KeyCopierViewReference] = "view_reference",
+    [KeyCopierViewIdentify] = "view_identify",
+    [KeyCopierViewMatches] = "view_matches",
+    [KeyCopierViewMeasure] = "view_measure",
+    [KeyCopierViewCaliper] = "view_caliper",
+    [KeyCopierViewCaliperBatch] = "view_caliper_batch",
+    [KeyCopierViewCodeLookup] = "view_code_lookup",
+    [KeyCopierViewFindCode] = "view_find_code",
+    [KeyCopierViewRekey] = "view_rekey",
+    [KeyCopierViewCutQueue] = "view_cut_queue",
+    [KeyCopierViewBackup] = "view_backup",
+    [KeyCopierViewRestore] = "view_restore",
+    [KeyCopierViewAnalyze] = "view_analyze",
+    [KeyCopierViewTrace] = "view_trace",
+    [KeyCopierViewStats] = "view_stats",
+    [KeyCopierViewMemory] = "view_memory",
+    [KeyCopierViewResult] = "view_result",
+    [KeyCopierViewAbout] = "view_about",
+};
 
-void initialize_model(KeyCopierModel* model) {
-    if(model->depth != NULL) {
-        free(model->depth);
-    }
-    model->format_index = 0;
-    memcpy(&model->format, &all_formats[model->format_index], sizeof(KeyFormat));
-    model->depth = (uint8_t*)malloc((model->format.pin_num + 1) * sizeof(uint8_t));
-    for(uint8_t i = 0; i <= model->format.pin_num; i++) {
-        model->depth[i] = model->format.min_depth_ind;
+// Switch views under a memory probe: the exit of the old view, the enter of the new one and
+// anything the enter does, such as setting up a text input
+static void key_copier_switch_to_view(KeyCopierApp* app, KeyCopierView view) {
+    KEY_MEMORY_BEGIN();
+    view_dispatcher_switch_to_view(app->view_dispatcher, view);
+    KEY_MEMORY_END(key_copier_view_probes[view]);
+}
+
+static inline int key_copier_max_view_px(const KeyRenderGeometry* geometry) {
+    return max(geometry->length_px + VIEW_MARGIN_PX - KEY_RENDER_WIDTH, 0);
+}
+
+// Pan just enough to keep the selected pin away from the screen edges
+static void key_copier_follow(KeyCopierModel* model) {
+    int max_view_px = key_copier_max_view_px(&model->geometry);
+    if(max_view_px == 0) {
+        model->view_px = 0;
+        return;
     }
+    if(!model->follow) return;
+    int center_px = model->geometry.pin_center_px[model->pin_slc - 1];
+    int view_px = model->view_px;
+    if(center_px - view_px < VIEW_MARGIN_PX) view_px = center_px - VIEW_MARGIN_PX;
+    if(center_px - view_px > KEY_RENDER_WIDTH - VIEW_MARGIN_PX)
+        view_px = center_px - (KEY_RENDER_WIDTH - VIEW_MARGIN_PX);
+    model->view_px = min(max(view_px, 0), max_view_px);
+}
+
+static void key_copier_set_format(KeyCopierModel* model, uint32_t format_index) {
+    model->format_index = format_index;
+    key_format_load(format_index, &model->format);
+    key_render_geometry(&model->geometry, &model->format);
+    key_macs_table(&model->macs, &model->format);
+    model->view_px = 0;
+}
+
+void initialize_model(KeyCopierModel* model) {
+    key_copier_set_format(model, 0);
+    key_bitting_fill(&model->bitting, model->format.pin_num, model->format.min_depth_ind);
     model->pin_slc = 1;
+    model->follow = true;
     model->data_loaded = 0;
+    model->blocked = 0;
+    model->has_reference = false;
+    model->overlay = false;
     model->key_name_str = furi_string_alloc();
+    key_history_init(&model->history);
+}
+
+// Swap in a whole new key, keeping the one it replaces in the undo history
+static void key_copier_replace(
+    KeyCopierModel* model,
+    uint32_t format_index,
+    const KeyBitting* bitting) {
+    if(format_index == model->format_index && key_bitting_equal(bitting, &model->bitting)) return;
+    KeyHistoryState before = {.format_index = model->format_index, .bitting = model->bitting};
+    KeyHistoryState after = {.format_index = format_index, .bitting = *bitting};
+    key_history_replace(&model->history, &before, &after);
+    if(format_index != model->format_index) key_copier_set_format(model, format_index);
+    model->bitting = *bitting;
+}
+
+// The key with every cut at its shallowest, as a newly chosen format starts
+static void key_copier_replace_blank(KeyCopierModel* model, uint32_t format_index) {
+    KeyBitting bitting;
+    key_bitting_fill(
+        &bitting,
+        key_format_catalog.pin_num[format_index],
+        key_format_catalog.min_depth_ind[format_index]);
+    key_copier_replace(model, format_index, &bitting);
+}
+
+// The geometry follows from the format, so it needs no comparing
+static bool key_copier_frame_equal(const KeyCopierFrame* a, const KeyCopierFrame* b) {
+    return a->format_index == b->format_index && key_bitting_equal(&a->bitting, &b->bitting) &&
+           a->view_px == b->view_px && a->pin_slc == b->pin_slc && a->blocked == b->blocked &&
+           a->follow == b->follow && a->overlay == b->overlay &&
+           a->session_key == b->session_key &&
+           (!a->overlay || key_bitting_equal(&a->reference, &b->reference));
+}
+
+static void key_copier_publish(KeyCopierApp* app) {
+    const KeyCopierModel* model = app->model;
+    KeyCopierFrame frame = {
+        .format_index = model->format_index,
+        .bitting = model->bitting,
+        .geometry = model->geometry,
+        .view_px = model->view_px,
+        .pin_slc = model->pin_slc,
+        .blocked = model->blocked,
+        .follow = model->follow,
+        .overlay = model->overlay && model->has_reference &&
+                   model->reference_format == model->format_index,
+        .reference = model->reference,
+        .session_key = app->session_active ? app->session_next : 0,
+    };
+    bool changed = !key_copier_frame_equal(&frame, &app->frame);
+    key_power_redraw(&app->power, changed);
+    if(!changed) return;
+    app->frame = frame;
+    KeyCopierFrames* frames = view_get_model(app->view_measure);
+    key_snapshot_publish(&frames->snapshot, &frame);
+    view_commit_model(app->view_measure, true);
 }
 
 static uint32_t key_copier_navigation_exit_callback(void* _context) {
@@ -100,580 +378,1557 @@ static void key_copier_submenu_callback(void* context, uint32_t index) {
     KeyCopierApp* app = (KeyCopierApp*)context;
     switch(index) {
     case KeyCopierSubmenuIndexMeasure:
-        view_dispatcher_switch_to_view(app->view_dispatcher, KeyCopierViewMeasure);
+        key_copier_switch_to_view(app, KeyCopierViewMeasure);
         break;
     case KeyCopierSubmenuIndexConfigure:
-        view_dispatcher_switch_to_view(app->view_dispatcher, KeyCopierViewConfigure_e);
+        key_copier_switch_to_view(app, KeyCopierViewConfigure_e);
         break;
     case KeyCopierSubmenuIndexSave:
-        view_dispatcher_switch_to_view(app->view_dispatcher, KeyCopierViewSave);
+        key_copier_switch_to_view(app, KeyCopierViewSave);
+        break;
+    case KeyCopierSubmenuIndexSession:
+        key_copier_switch_to_view(app, KeyCopierViewSession);
         break;
     case KeyCopierSubmenuIndexLoad:
-        view_dispatcher_switch_to_view(app->view_dispatcher, KeyCopierViewLoad);
+        key_copier_switch_to_view(app, KeyCopierViewLoad);
+        break;
+    case KeyCopierSubmenuIndexSearch:
+        key_copier_switch_to_view(app, KeyCopierViewSearch);
+        break;
+    case KeyCopierSubmenuIndexRename:
+        key_copier_switch_to_view(app, KeyCopierViewRename);
+        break;
+    case KeyCopierSubmenuIndexReference:
+        key_copier_switch_to_view(app, KeyCopierViewReference);
+        break;
+    case KeyCopierSubmenuIndexIdentify:
+        key_copier_switch_to_view(app, KeyCopierViewIdentify);
+        break;
+    case KeyCopierSubmenuIndexCaliper:
+        key_copier_switch_to_view(app, KeyCopierViewCaliper);
+        break;
+    case KeyCopierSubmenuIndexCaliperBatch:
+        key_copier_switch_to_view(app, KeyCopierViewCaliperBatch);
+        break;
+    case KeyCopierSubmenuIndexCodeLookup:
+        key_copier_switch_to_view(app, KeyCopierViewCodeLookup);
+        break;
+    case KeyCopierSubmenuIndexFindCode:
+        key_copier_switch_to_view(app, KeyCopierViewFindCode);
+        break;
+    case KeyCopierSubmenuIndexRekey:
+        key_copier_switch_to_view(app, KeyCopierViewRekey);
+        break;
+    case KeyCopierSubmenuIndexCutQueue:
+        key_copier_switch_to_view(app, KeyCopierViewCutQueue);
+        break;
+    case KeyCopierSubmenuIndexBackup:
+        key_copier_switch_to_view(app, KeyCopierViewBackup);
+        break;
+    case KeyCopierSubmenuIndexRestore:
+        key_copier_switch_to_view(app, KeyCopierViewRestore);
+        break;
+    case KeyCopierSubmenuIndexAnalyze:
+        key_copier_switch_to_view(app, KeyCopierViewAnalyze);
+        break;
+    case KeyCopierSubmenuIndexTrace:
+        key_copier_switch_to_view(app, KeyCopierViewTrace);
+        break;
+    case KeyCopierSubmenuIndexStats:
+        key_copier_switch_to_view(app, KeyCopierViewStats);
+        break;
+    case KeyCopierSubmenuIndexMemory:
+        key_copier_switch_to_view(app, KeyCopierViewMemory);
         break;
     case KeyCopierSubmenuIndexAbout:
-        view_dispatcher_switch_to_view(app->view_dispatcher, KeyCopierViewAbout);
+        key_copier_switch_to_view(app, KeyCopierViewAbout);
         break;
     default:
         break;
     }
 }
 
-char* manufacturers[COUNT_OF(all_formats)];
-void initialize_manufacturers(char** manufacturers) {
+const char* manufacturers[FORMAT_NUM];
+void initialize_manufacturers(const char** manufacturers) {
     // Populate the manufacturers array
-    for(size_t i = 0; i < COUNT_OF(all_formats); i++) {
-        manufacturers[i] = all_formats[i].manufacturer;
+    for(size_t i = 0; i < FORMAT_NUM; i++) {
+        manufacturers[i] = key_format_info[i].manufacturer;
     }
 }
 
 static void key_copier_format_change(VariableItem* item) {
+    KEY_TRACE_BEGIN("format_change");
+    KEY_MEMORY_BEGIN();
     KeyCopierApp* app = variable_item_get_context(item);
-    KeyCopierModel* model = view_get_model(app->view_measure);
+    KeyCopierModel* model = app->model;
     if(model->data_loaded) {
         variable_item_set_current_value_index(item, model->format_index);
     }
     uint8_t format_index = variable_item_get_current_value_index(item);
     if(format_index != model->format_index) {
-        model->format_index = format_index;
-        model->format = all_formats[format_index];
-        if(model->depth != NULL) {
-            free(model->depth);
-        }
-        model->depth = (uint8_t*)malloc((model->format.pin_num + 1) * sizeof(uint8_t));
-        for(uint8_t i = 0; i <= model->format.pin_num; i++) {
-            model->depth[i] = model->format.min_depth_ind;
-        }
+        key_copier_replace_blank(model, format_index);
         model->pin_slc = 1;
+        key_copier_publish(app);
     }
     model->data_loaded = false;
-    variable_item_set_current_value_text(item, model->format.format_name);
-    variable_item_set_current_value_text(app->format_name_item, model->format.manufacturer);
-    model->format = all_formats[model->format_index];
+    variable_item_set_current_value_text(item, key_format_info[model->format_index].format_name);
+    variable_item_set_current_value_text(
+        app->format_name_item, key_format_info[model->format_index].manufacturer);
+    KEY_MEMORY_END("format_change");
+    KEY_TRACE_END("format_change");
 }
 
 static const char* format_config_label = "Key Format";
 static const char* format_name_config_label = "Brand";
 static void key_copier_config_enter_callback(void* context) {
+    KEY_TRACE_BEGIN("config_rebuild");
+    KEY_MEMORY_BEGIN();
     KeyCopierApp* app = (KeyCopierApp*)context;
-    KeyCopierModel* my_model = view_get_model(app->view_measure);
+    KeyCopierModel* my_model = app->model;
     variable_item_list_reset(app->variable_item_list_config);
     // Recreate this view every time we enter it so that it's always updated
     app->format_item = variable_item_list_add(
         app->variable_item_list_config,
         format_config_label,
-        COUNT_OF(all_formats),
+        FORMAT_NUM,
         key_copier_format_change,
         app);
 
-    app->format_name_item = variable_item_list_add(
-        app->variable_item_list_config, format_name_config_label, 0, NULL, NULL);
-    View* view_config_i = variable_item_list_get_view(app->variable_item_list_config);
-    variable_item_set_current_value_index(app->format_item, my_model->format_index);
-    variable_item_set_current_value_text(app->format_name_item, my_model->format.manufacturer);
-    key_copier_format_change(app->format_item);
-    view_set_previous_callback(view_config_i, key_copier_navigation_submenu_callback);
-    view_dispatcher_remove_view(
-        app->view_dispatcher, KeyCopierViewConfigure_i); // delete the last one
-    view_dispatcher_add_view(app->view_dispatcher, KeyCopierViewConfigure_i, view_config_i);
-    view_dispatcher_switch_to_view(app->view_dispatcher, KeyCopierViewConfigure_i); // recreate it
+    app->format_name_item = variable_item_list_add(
+        app->variable_item_list_config, format_name_config_label, 0, NULL, NULL);
+    View* view_config_i = variable_item_list_get_view(app->variable_item_list_config);
+    variable_item_set_current_value_index(app->format_item, my_model->format_index);
+    variable_item_set_current_value_text(
+        app->format_name_item, key_format_info[my_model->format_index].manufacturer);
+    key_copier_format_change(app->format_item);
+    view_set_previous_callback(view_config_i, key_copier_navigation_submenu_callback);
+    view_dispatcher_remove_view(
+        app->view_dispatcher, KeyCopierViewConfigure_i); // delete the last one
+    view_dispatcher_add_view(app->view_dispatcher, KeyCopierViewConfigure_i, view_config_i);
+    key_copier_switch_to_view(app, KeyCopierViewConfigure_i); // recreate it
+    KEY_MEMORY_END("config_rebuild");
+    KEY_TRACE_END("config_rebuild");
+}
+
+static void key_copier_show_result(KeyCopierApp* app, const char* text) {
+    widget_reset(app->widget_result);
+    widget_add_text_scroll_element(app->widget_result, 0, 0, 128, 64, text);
+    key_copier_switch_to_view(app, KeyCopierViewResult);
+}
+
+static const char* key_copier_file_message(KeyFileStatus status) {
+    switch(status) {
+    case KeyFileBadHeader:
+        return "Not a key file, or saved by a newer version of the app";
+    case KeyFileUnknownFormat:
+        return "The key's format is not in this version of the app";
+    case KeyFileBadBitting:
+        return "The bitting does not match the key's format";
+    case KeyFileOutOfRange:
+        return "A depth is outside the key's format";
+    case KeyFileMacs:
+        return "Adjacent cuts break the MACS of the key's format";
+    default:
+        return "Could not read the key file";
+    }
+}
+
+// Measure the saved key at app->file_path
+static KeyFileStatus key_copier_load_key(KeyCopierApp* app, Storage* storage) {
+    KeyCopierModel* model = app->model;
+    KEY_TRACE_BEGIN("load");
+    KEY_MEMORY_BEGIN();
+    uint32_t format_index;
+    KeyBitting bitting;
+    // A loaded key carries on with the history saved with it
+    KeyHistory* history = malloc(sizeof(KeyHistory));
+    KeyFileStatus status = key_library_read_path(
+        storage, furi_string_get_cstr(app->file_path), &format_index, &bitting, history);
+    if(status == KeyFileOk) {
+        key_copier_set_format(model, format_index);
+        model->bitting = bitting;
+        model->history = *history;
+        model->data_loaded = true;
+        // The old pin may be past the new format's last one
+        model->pin_slc = 1;
+        key_copier_follow(model);
+        key_copier_publish(app);
+    }
+    free(history);
+    KEY_MEMORY_END("load");
+    KEY_TRACE_END("load");
+    return status;
+}
+
+static const char* key_name_entry_text = "Enter name";
+// The same key is already saved as existing: ask whether to save it again anyway ("Save"), or
+// to measure the saved one instead ("Use it")
+static DialogMessageButton key_copier_ask_duplicate(KeyCopierApp* app, FuriString* existing) {
+    FuriString* text = furi_string_alloc_printf(
+        "This key is saved\nas %s", furi_string_get_cstr(existing));
+    DialogMessage* message = dialog_message_alloc();
+    dialog_message_set_header(message, "Already saved", 64, 0, AlignCenter, AlignTop);
+    dialog_message_set_text(message, furi_string_get_cstr(text), 64, 32, AlignCenter, AlignCenter);
+    dialog_message_set_buttons(message, "Save", NULL, "Use it");
+    DialogMessageButton button = dialog_message_show(app->dialogs, message);
+    dialog_message_free(message);
+    furi_string_free(text);
+    return button;
+}
+
+// Load the saved key named existing and show it on the measure screen, as Load would
+static void key_copier_use_duplicate(KeyCopierApp* app, Storage* storage, FuriString* existing) {
+    key_library_path(app->file_path, furi_string_get_cstr(existing));
+    KeyFileStatus status = key_copier_load_key(app, storage);
+    if(status != KeyFileOk) {
+        key_copier_show_result(app, key_copier_file_message(status));
+        return;
+    }
+    furi_string_set(app->model->key_name_str, furi_string_get_cstr(existing));
+    key_copier_switch_to_view(app, KeyCopierViewMeasure);
+}
+
+static void key_copier_file_saver(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    KeyCopierModel* model = app->model;
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    FuriString* existing = furi_string_alloc();
+    KEY_TRACE_BEGIN("duplicate_check");
+    bool duplicate = key_library_find_duplicate(
+        storage, model->format_index, &model->bitting, app->temp_buffer, existing);
+    KEY_TRACE_END("duplicate_check");
+    DialogMessageButton button =
+        duplicate ? key_copier_ask_duplicate(app, existing) : DialogMessageButtonLeft;
+    if(button != DialogMessageButtonLeft) {
+        if(button == DialogMessageButtonRight) {
+            key_copier_use_duplicate(app, storage, existing);
+        } else {
+            key_copier_switch_to_view(app, KeyCopierViewSubmenu);
+        }
+        furi_string_free(existing);
+        furi_record_close(RECORD_STORAGE);
+        return;
+    }
+    furi_string_free(existing);
+
+    KEY_TRACE_BEGIN("save");
+    KEY_MEMORY_BEGIN();
+    furi_string_set(model->key_name_str, app->temp_buffer);
+    FuriString* file_path = furi_string_alloc();
+    furi_string_printf(
+        file_path,
+        "%s/%s%s",
+        STORAGE_APP_DATA_PATH_PREFIX,
+        furi_string_get_cstr(model->key_name_str),
+        KEY_COPIER_FILE_EXTENSION);
+
+    storage_simply_mkdir(storage, STORAGE_APP_DATA_PATH_PREFIX);
+    FURI_LOG_D(TAG, "mkdir finished");
+    if(!key_library_write_path(
+           storage,
+           furi_string_get_cstr(file_path),
+           model->format_index,
+           &model->bitting,
+           &model->history)) {
+        FURI_LOG_E(TAG, "Failed to save %s", furi_string_get_cstr(file_path));
+    } else {
+        key_library_names_update(storage, NULL, furi_string_get_cstr(model->key_name_str));
+        key_library_dupes_update(
+            storage,
+            model->format_index,
+            &model->bitting,
+            furi_string_get_cstr(model->key_name_str));
+        key_library_backup_note(storage, furi_string_get_cstr(model->key_name_str));
+    }
+    furi_record_close(RECORD_STORAGE);
+    furi_string_free(file_path);
+    KEY_MEMORY_END("save");
+    KEY_TRACE_END("save");
+
+    key_copier_switch_to_view(app, KeyCopierViewSubmenu);
+}
+
+static void key_copier_view_save_callback(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    // Header to display on the text input screen.
+    text_input_set_header_text(app->text_input, key_name_entry_text);
+
+    // Copy the current name into the temporary buffer.
+    strncpy(
+        app->temp_buffer, furi_string_get_cstr(app->model->key_name_str), app->temp_buffer_size);
+
+    // Configure the text input.  When user enters text and clicks OK, key_copier_file_saver be called.
+    bool clear_previous_text = false;
+    text_input_set_result_callback(
+        app->text_input,
+        key_copier_file_saver,
+        app,
+        app->temp_buffer,
+        app->temp_buffer_size,
+        clear_previous_text);
+
+    view_set_previous_callback(
+        text_input_get_view(app->text_input), key_copier_navigation_submenu_callback);
+
+    // Show text input dialog.
+    key_copier_switch_to_view(app, KeyCopierViewTextInput);
+}
+
+// Write out the keyring keys held so far, with one storage session for the lot. Keys are dealt
+// with in order, so those done are always the session's first ones; the rest are held, to be
+// tried again first. Keys saved as a copy of another, or not saved because their name was
+// taken, go in the session notes.
+static void key_copier_session_flush(KeyCopierApp* app) {
+    if(!app->session_count) return;
+    KEY_TRACE_BEGIN("session_flush");
+    KEY_MEMORY_BEGIN();
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    storage_simply_mkdir(storage, STORAGE_APP_DATA_PATH_PREFIX);
+    size_t done = key_library_save_batch(storage, app->session_keys, app->session_count);
+    furi_record_close(RECORD_STORAGE);
+    KEY_MEMORY_END("session_flush");
+    KEY_TRACE_END("session_flush");
+    if(done < app->session_count) {
+        FURI_LOG_E(TAG, "Wrote %u of %u keyring keys", done, app->session_count);
+    }
+    for(size_t i = 0; i < done; i++) {
+        const KeyLibraryBatchKey* key = &app->session_keys[i];
+        if(key->name_taken) {
+            char bitting[KEY_BITTING_MAX_PINS * 3];
+            key_bitting_to_str(
+                &key->bitting,
+                key_format_catalog.pin_num[key->format_index],
+                bitting,
+                sizeof(bitting));
+            furi_string_cat_printf(
+                app->session_notes, "\n%s not saved, name taken: %s", key->name, bitting);
+        } else {
+            app->session_saved++;
+            if(key->duplicate[0]) {
+                furi_string_cat_printf(
+                    app->session_notes,
+                    "\n%s is already saved as %s",
+                    key->name,
+                    key->duplicate);
+            }
+        }
+    }
+    app->session_done += done;
+    app->session_count -= done;
+    memmove(
+        app->session_keys,
+        app->session_keys + done,
+        app->session_count * sizeof(KeyLibraryBatchKey));
+}
+
+// Keys from the last session that could not be written are only let go when the user says so
+static bool key_copier_session_discard(KeyCopierApp* app) {
+    FuriString* text = furi_string_alloc_printf(
+        "%u keys of %s\nare not saved yet", app->session_count, app->session_base);
+    DialogMessage* message = dialog_message_alloc();
+    dialog_message_set_header(message, "Not saved", 64, 0, AlignCenter, AlignTop);
+    dialog_message_set_text(message, furi_string_get_cstr(text), 64, 32, AlignCenter, AlignCenter);
+    dialog_message_set_buttons(message, "Discard", NULL, "Keep");
+    bool discard = dialog_message_show(app->dialogs, message) == DialogMessageButtonLeft;
+    dialog_message_free(message);
+    furi_string_free(text);
+    return discard;
+}
+
+static uint32_t key_copier_navigation_session_end_callback(void* _context) {
+    UNUSED(_context);
+    return KeyCopierViewSessionEnd;
+}
+
+// Measure a whole keyring in the current format without leaving the measure screen. OK keeps
+// each key and starts the next; Back writes out the rest and ends the session.
+static void key_copier_session_start(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    KeyCopierModel* model = app->model;
+    strncpy(app->session_base, app->temp_buffer, sizeof(app->session_base) - 1);
+    app->session_base[sizeof(app->session_base) - 1] = '\0';
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    app->session_first = key_library_next_in_series(storage, app->session_base);
+    furi_record_close(RECORD_STORAGE);
+    app->session_next = app->session_first;
+    app->session_saved = 0;
+    app->session_done = 0;
+    furi_string_reset(app->session_notes);
+    app->session_active = true;
+    key_copier_replace_blank(model, model->format_index);
+    model->pin_slc = 1;
+    key_copier_follow(model);
+    key_copier_publish(app);
+    view_set_previous_callback(app->view_measure, key_copier_navigation_session_end_callback);
+    key_copier_switch_to_view(app, KeyCopierViewMeasure);
+}
+
+static void key_copier_view_session_callback(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    key_copier_session_flush(app);
+    if(app->session_count) {
+        if(!key_copier_session_discard(app)) {
+            key_copier_switch_to_view(app, KeyCopierViewSubmenu);
+            return;
+        }
+        app->session_count = 0;
+    }
+    text_input_set_header_text(app->text_input, "Keyring name");
+    strncpy(app->temp_buffer, app->session_base, app->temp_buffer_size);
+    text_input_set_result_callback(
+        app->text_input,
+        key_copier_session_start,
+        app,
+        app->temp_buffer,
+        SESSION_BASE_SIZE,
+        false);
+    view_set_previous_callback(
+        text_input_get_view(app->text_input), key_copier_navigation_submenu_callback);
+    key_copier_switch_to_view(app, KeyCopierViewTextInput);
+}
+
+// Identify choices: index 0 is always "?", leaving the feature out of the fit
+#define IDENTIFY_PINS_MIN 3
+#define IDENTIFY_PINS_NUM 10
+#define IDENTIFY_LENGTH_STEP KEY_FORMAT_INCH(0.005)
+#define IDENTIFY_FIRST_PIN_MIN KEY_FORMAT_INCH(0.080)
+#define IDENTIFY_FIRST_PIN_NUM 49 // up to 0.320in
+#define IDENTIFY_SPACING_MIN KEY_FORMAT_INCH(0.080)
+#define IDENTIFY_SPACING_NUM 25 // up to 0.200in
+
+static const char* identify_sides_text[] = {"?", "Single", "Double"};
+static const char* identify_stop_text[] = {"?", "Shoulder", "Tip"};
+
+static void key_copier_identify_length_text(VariableItem* item, uint16_t length) {
+    char text[10];
+    if(length) {
+        snprintf(
+            text,
+            sizeof(text),
+            "%u.%03uin",
+            length / KEY_FORMAT_UNITS_PER_INCH,
+            length % KEY_FORMAT_UNITS_PER_INCH / 10);
+    } else {
+        snprintf(text, sizeof(text), "?");
+    }
+    variable_item_set_current_value_text(item, text);
+}
+
+static void key_copier_identify_pins_change(VariableItem* item) {
+    KeyCopierApp* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    char text[4] = "?";
+    app->observation.pin_num = index ? IDENTIFY_PINS_MIN + index - 1 : 0;
+    if(index) snprintf(text, sizeof(text), "%u", app->observation.pin_num);
+    variable_item_set_current_value_text(item, text);
+}
+
+static void key_copier_identify_sides_change(VariableItem* item) {
+    KeyCopierApp* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    app->observation.sides = index;
+    variable_item_set_current_value_text(item, identify_sides_text[index]);
+}
+
+static void key_copier_identify_stop_change(VariableItem* item) {
+    KeyCopierApp* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    app->observation.stop = index;
+    variable_item_set_current_value_text(item, identify_stop_text[index]);
+}
+
+static void key_copier_identify_first_pin_change(VariableItem* item) {
+    KeyCopierApp* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    app->observation.first_pin =
+        index ? IDENTIFY_FIRST_PIN_MIN + (index - 1) * IDENTIFY_LENGTH_STEP : 0;
+    key_copier_identify_length_text(item, app->observation.first_pin);
+}
+
+static void key_copier_identify_spacing_change(VariableItem* item) {
+    KeyCopierApp* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    app->observation.pin_increment =
+        index ? IDENTIFY_SPACING_MIN + (index - 1) * IDENTIFY_LENGTH_STEP : 0;
+    key_copier_identify_length_text(item, app->observation.pin_increment);
+}
+
+static void key_copier_match_callback(void* context, uint32_t index) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    KeyCopierModel* model = app->model;
+    key_copier_replace_blank(model, app->matches[index].format_index);
+    model->pin_slc = 1;
+    model->data_loaded = false;
+    key_copier_publish(app);
+    // Straight to the contour, to check the match against the real key
+    key_copier_switch_to_view(app, KeyCopierViewMeasure);
+}
+
+// OK on any row ranks the catalog against what has been entered so far
+static void key_copier_identify_enter_callback(void* context, uint32_t index) {
+    UNUSED(index);
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    KEY_TRACE_BEGIN("identify");
+    KEY_MEMORY_BEGIN();
+    uint8_t count = key_identify_rank(&app->observation, app->matches, KEY_IDENTIFY_MATCHES);
+    KEY_MEMORY_END("identify");
+    KEY_TRACE_END("identify");
+    submenu_reset(app->submenu_matches);
+    submenu_set_header(app->submenu_matches, "Best fit first");
+    for(uint8_t match = 0; match < count; match++) {
+        uint16_t format_index = app->matches[match].format_index;
+        uint32_t score = app->matches[match].score;
+        char label[48];
+        snprintf(
+            label,
+            sizeof(label),
+            "%s %s %lu.%03lu",
+            key_format_info[format_index].format_name,
+            key_format_info[format_index].manufacturer,
+            (unsigned long)(score / KEY_FORMAT_UNITS_PER_INCH),
+            (unsigned long)(score % KEY_FORMAT_UNITS_PER_INCH / 10));
+        submenu_add_item(app->submenu_matches, label, match, key_copier_match_callback, app);
+    }
+    key_copier_switch_to_view(app, KeyCopierViewMatches);
+}
+
+static uint32_t key_copier_navigation_identify_callback(void* _context) {
+    UNUSED(_context);
+    return KeyCopierViewIdentify;
+}
+
+// Runs on the file browser's worker thread, only for the entries it loads around the cursor, so
+// the list scrolls on while icons are drawn
+static bool key_copier_load_item_callback(
+    FuriString* path,
+    void* context,
+    uint8_t** icon,
+    FuriString* item_name) {
+    UNUSED(item_name);
+    return key_library_thumbnail(context, furi_string_get_cstr(path), *icon);
+}
+
+// Pick a saved key into app->file_path, with its thumbnail beside each file
+static bool key_copier_browse_keys(KeyCopierApp* app, Storage* storage) {
+    DialogsFileBrowserOptions browser_options;
+    storage_simply_mkdir(storage, STORAGE_APP_DATA_PATH_PREFIX);
+    KeyLibraryThumbnails* thumbnails = malloc(sizeof(KeyLibraryThumbnails));
+    key_library_thumbnails_open(thumbnails, storage);
+    dialog_file_browser_set_basic_options(&browser_options, KEY_COPIER_FILE_EXTENSION, &I_icon);
+    browser_options.base_path = STORAGE_APP_DATA_PATH_PREFIX;
+    browser_options.item_loader_callback = key_copier_load_item_callback;
+    browser_options.item_loader_context = thumbnails;
+    furi_string_set(app->file_path, browser_options.base_path);
+    bool selected =
+        dialog_file_browser_show(app->dialogs, app->file_path, app->file_path, &browser_options);
+    key_library_thumbnails_close(thumbnails);
+    free(thumbnails);
+    return selected;
+}
+
+static void key_copier_view_load_callback(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    KeyFileStatus status = KeyFileOk;
+    if(key_copier_browse_keys(app, storage)) {
+        status = key_copier_load_key(app, storage);
+    }
+    furi_record_close(RECORD_STORAGE);
+    if(status != KeyFileOk) {
+        key_copier_show_result(app, key_copier_file_message(status));
+    } else {
+        key_copier_switch_to_view(app, KeyCopierViewSubmenu);
+    }
+}
+
+static bool key_copier_search_collect(const char* name, void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    if(app->search_count == SEARCH_RESULTS) {
+        app->search_more = true;
+        return false;
+    }
+    strcpy(app->search_results[app->search_count++], name);
+    return true;
+}
+
+static void key_copier_search_pick_callback(void* context, uint32_t index) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    key_library_path(app->file_path, app->search_results[index]);
+    bool gone = !storage_file_exists(storage, furi_string_get_cstr(app->file_path));
+    KeyFileStatus status = gone ? KeyFileIoError : key_copier_load_key(app, storage);
+    if(gone) {
+        // Renamed or deleted outside the app, where the index is not kept: have it rebuilt
+        // on the next search, which finds a new name too
+        storage_simply_remove(storage, KEY_LIBRARY_NAMES_DIRECTORY);
+    }
+    furi_record_close(RECORD_STORAGE);
+    if(gone) {
+        key_copier_show_result(app, "That key was renamed or deleted.\nSearch again.");
+    } else if(status != KeyFileOk) {
+        key_copier_show_result(app, key_copier_file_message(status));
+    } else {
+        key_copier_switch_to_view(app, KeyCopierViewSubmenu);
+    }
+}
+
+// The text input has no hook for each key press, so every OK lists the names so far; back
+// returns to the input with the text kept, to type on
+static void key_copier_search(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    KEY_TRACE_BEGIN("search");
+    KEY_MEMORY_BEGIN();
+    KeyLibraryNames names;
+    app->search_count = 0;
+    app->search_more = false;
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    KeyNamesStatus status = key_library_names_open(storage, &names);
+    if(status == KeyNamesOk) {
+        status =
+            key_names_search(&names.index, app->temp_buffer, key_copier_search_collect, app);
+        key_library_names_close(&names);
+    }
+    furi_record_close(RECORD_STORAGE);
+    KEY_MEMORY_END("search");
+    KEY_TRACE_END("search");
+
+    if(status != KeyNamesOk) {
+        key_copier_show_result(app, "Could not read the name index.\nCheck the SD card.");
+        return;
+    }
+    if(app->search_count == 0) {
+        key_copier_show_result(app, "No saved key starts with that.");
+        return;
+    }
+    submenu_reset(app->submenu_search);
+    submenu_set_header(app->submenu_search, app->search_more ? "First matches" : "Matches");
+    for(uint8_t result = 0; result < app->search_count; result++) {
+        submenu_add_item(
+            app->submenu_search,
+            app->search_results[result],
+            result,
+            key_copier_search_pick_callback,
+            app);
+    }
+    key_copier_switch_to_view(app, KeyCopierViewSearchResults);
+}
+
+static const char* key_search_entry_text = "Name starts with";
+static void key_copier_view_search_callback(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    text_input_set_header_text(app->text_input, key_search_entry_text);
+    bool clear_previous_text = true;
+    text_input_set_result_callback(
+        app->text_input,
+        key_copier_search,
+        app,
+        app->temp_buffer,
+        app->temp_buffer_size,
+        clear_previous_text);
+    view_set_previous_callback(
+        text_input_get_view(app->text_input), key_copier_navigation_submenu_callback);
+    key_copier_switch_to_view(app, KeyCopierViewTextInput);
+}
+
+static uint32_t key_copier_navigation_search_callback(void* _context) {
+    UNUSED(_context);
+    return KeyCopierViewTextInput;
+}
+
+static void key_copier_rename(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    KEY_TRACE_BEGIN("rename");
+    KEY_MEMORY_BEGIN();
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    bool renamed =
+        key_library_rename(storage, furi_string_get_cstr(app->file_path), app->temp_buffer);
+    furi_record_close(RECORD_STORAGE);
+    KEY_MEMORY_END("rename");
+    KEY_TRACE_END("rename");
+    if(renamed) {
+        key_copier_switch_to_view(app, KeyCopierViewSubmenu);
+    } else {
+        key_copier_show_result(app, "Could not rename the key.\nIs the name taken?");
+    }
+}
+
+static const char* key_rename_entry_text = "New name";
+static void key_copier_view_rename_callback(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    bool selected = key_copier_browse_keys(app, storage);
+    furi_record_close(RECORD_STORAGE);
+    if(!selected) {
+        key_copier_switch_to_view(app, KeyCopierViewSubmenu);
+        return;
+    }
+    FuriString* name = furi_string_alloc();
+    path_extract_filename(app->file_path, name, true);
+    strncpy(app->temp_buffer, furi_string_get_cstr(name), app->temp_buffer_size);
+    furi_string_free(name);
+    text_input_set_header_text(app->text_input, key_rename_entry_text);
+    bool clear_previous_text = false;
+    text_input_set_result_callback(
+        app->text_input,
+        key_copier_rename,
+        app,
+        app->temp_buffer,
+        app->temp_buffer_size,
+        clear_previous_text);
+    view_set_previous_callback(
+        text_input_get_view(app->text_input), key_copier_navigation_submenu_callback);
+    key_copier_switch_to_view(app, KeyCopierViewTextInput);
+}
+
+// A saved key to check the measured one against. The copy is measured in the reference's
+// format, so a key of another format is swapped for a blank one first.
+static void key_copier_view_reference_callback(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    KeyCopierModel* model = app->model;
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    KeyFileStatus status = KeyFileOk;
+    bool selected = key_copier_browse_keys(app, storage);
+    if(selected) {
+        KEY_TRACE_BEGIN("reference");
+        KEY_MEMORY_BEGIN();
+        uint32_t format_index;
+        KeyBitting bitting;
+        status = key_library_read_path(
+            storage, furi_string_get_cstr(app->file_path), &format_index, &bitting, NULL);
+        if(status == KeyFileOk) {
+            if(format_index != model->format_index) {
+                key_copier_replace_blank(model, format_index);
+                model->pin_slc = 1;
+            }
+            model->reference = bitting;
+            model->reference_format = format_index;
+            model->has_reference = true;
+            model->overlay = true;
+            key_copier_follow(model);
+            key_copier_publish(app);
+        }
+        KEY_MEMORY_END("reference");
+        KEY_TRACE_END("reference");
+    }
+    furi_record_close(RECORD_STORAGE);
+    if(status != KeyFileOk) {
+        key_copier_show_result(app, key_copier_file_message(status));
+    } else {
+        key_copier_switch_to_view(app, selected ? KeyCopierViewMeasure : KeyCopierViewSubmenu);
+    }
+}
+
+static const char* key_copier_codebook_message(KeyCodebookStatus status) {
+    switch(status) {
+    case KeyCodebookNotFound:
+        return "Not in the code book.";
+    case KeyCodebookMissing:
+        return "No code book for this format.\nAdd <format name>.txt with\n"
+               "\"CODE 1-2-3-4-5\" lines to\n" KEY_LIBRARY_CODEBOOK_FOLDER;
+    case KeyCodebookCorrupt:
+        return "Code book is damaged\nor for another format.\nDelete the .kcb file.";
+    case KeyCodebookBadSource:
+        return "Code book source has a bad\nline or codes out of order.\n"
+               "The log names the line.";
+    default:
+        return "Code book read failed.\nCheck the SD card.";
+    }
+}
+
+static const char* key_code_entry_text = "Enter key code";
+static void key_copier_code_lookup(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    KeyCopierModel* model = app->model;
+    KEY_TRACE_BEGIN("code_lookup");
+    KEY_MEMORY_BEGIN();
+    KeyCodebook book;
+    KeyBitting bitting;
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    KeyCodebookStatus status = key_library_codebook_open(storage, model->format_index, &book);
+    if(status == KeyCodebookOk) {
+        status = key_codebook_find_code(&book, app->temp_buffer, &bitting);
+        key_library_codebook_close(&book);
+    }
+    furi_record_close(RECORD_STORAGE);
+    KEY_MEMORY_END("code_lookup");
+    KEY_TRACE_END("code_lookup");
+
+    if(status == KeyCodebookOk) {
+        key_copier_replace(model, model->format_index, &bitting);
+        model->pin_slc = 1;
+        key_copier_follow(model);
+        key_copier_publish(app);
+        key_copier_switch_to_view(app, KeyCopierViewMeasure);
+    } else {
+        key_copier_show_result(app, key_copier_codebook_message(status));
+    }
+}
+
+static void key_copier_view_code_lookup_callback(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    text_input_set_header_text(app->text_input, key_code_entry_text);
+    bool clear_previous_text = true;
+    text_input_set_result_callback(
+        app->text_input,
+        key_copier_code_lookup,
+        app,
+        app->temp_buffer,
+        KEY_CODEBOOK_CODE_SIZE,
+        clear_previous_text);
+    view_set_previous_callback(
+        text_input_get_view(app->text_input), key_copier_navigation_submenu_callback);
+    key_copier_switch_to_view(app, KeyCopierViewTextInput);
+}
+
+static void key_copier_view_find_code_callback(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    KeyCopierModel* model = app->model;
+    KEY_TRACE_BEGIN("find_code");
+    KEY_MEMORY_BEGIN();
+    KeyCodebook book;
+    char code[KEY_CODEBOOK_CODE_SIZE];
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    KeyCodebookStatus status = key_library_codebook_open(storage, model->format_index, &book);
+    if(status == KeyCodebookOk) {
+        status = key_codebook_find_bitting(&book, &model->bitting, code);
+        key_library_codebook_close(&book);
+    }
+    furi_record_close(RECORD_STORAGE);
+    KEY_MEMORY_END("find_code");
+    KEY_TRACE_END("find_code");
+
+    if(status == KeyCodebookOk) {
+        char bitting_buffer[KEY_BITTING_MAX_PINS * 3];
+        key_bitting_to_str(
+            &model->bitting, model->format.pin_num, bitting_buffer, sizeof(bitting_buffer));
+        FuriString* text = furi_string_alloc_printf(
+            "%s %s\nBitting: %s\n\nKey code: %s",
+            key_format_info[model->format_index].manufacturer,
+            key_format_info[model->format_index].format_name,
+            bitting_buffer,
+            code);
+        key_copier_show_result(app, furi_string_get_cstr(text));
+        furi_string_free(text);
+    } else {
+        key_copier_show_result(app, key_copier_codebook_message(status));
+    }
+}
+
+static void key_copier_view_rekey_callback(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    KeyCopierModel* model = app->model;
+    DialogsFileBrowserOptions browser_options;
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    storage_simply_mkdir(storage, STORAGE_APP_DATA_PATH_PREFIX);
+    dialog_file_browser_set_basic_options(&browser_options, KEY_LIBRARY_JOB_EXTENSION, &I_icon);
+    browser_options.base_path = STORAGE_APP_DATA_PATH_PREFIX;
+    furi_string_set(app->file_path, browser_options.base_path);
+    if(!dialog_file_browser_show(app->dialogs, app->file_path, app->file_path, &browser_options)) {
+        furi_record_close(RECORD_STORAGE);
+        key_copier_switch_to_view(app, KeyCopierViewSubmenu);
+        return;
+    }
+    KEY_TRACE_BEGIN("rekey");
+    KEY_MEMORY_BEGIN();
+    KeyPinningTotals totals;
+    FuriString* plan_path = furi_string_alloc();
+    bool done = key_library_plan_job(
+        storage, furi_string_get_cstr(app->file_path), model->format_index, plan_path, &totals);
+    furi_record_close(RECORD_STORAGE);
+    KEY_MEMORY_END("rekey");
+    KEY_TRACE_END("rekey");
+
+    FuriString* text = furi_string_alloc();
+    if(done) {
+        furi_string_printf(
+            text,
+            "Cylinders: %lu\nChambers: %lu\nBad lines: %lu\n\nBottom pins:",
+            totals.cylinders,
+            totals.chambers,
+            totals.errors);
+        for(uint8_t pin = 0; pin <= KEY_BITTING_MAX_DEPTH; pin++) {
+            if(totals.bottom_pins[pin])
+                furi_string_cat_printf(text, "\n #%u x %lu", pin, totals.bottom_pins[pin]);
+        }
+        furi_string_cat_str(text, "\nMaster wafers:");
+        for(uint8_t size = 1; size <= KEY_BITTING_MAX_DEPTH; size++) {
+            if(totals.master_pins[size])
+                furi_string_cat_printf(text, "\n #%u x %lu", size, totals.master_pins[size]);
+        }
+        furi_string_cat_printf(
+            text,
+            "\nDrivers: %lu\n\nPlan:\n%s",
+            totals.driver_pins,
+            furi_string_get_cstr(plan_path));
+    } else {
+        furi_string_set(text, "Rekey plan failed.\nCheck the SD card.");
+    }
+    key_copier_show_result(app, furi_string_get_cstr(text));
+    furi_string_free(text);
+    furi_string_free(plan_path);
+}
+
+static void key_copier_view_cut_queue_callback(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    DialogsFileBrowserOptions browser_options;
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    storage_simply_mkdir(storage, STORAGE_APP_DATA_PATH_PREFIX);
+    dialog_file_browser_set_basic_options(&browser_options, KEY_LIBRARY_QUEUE_EXTENSION, &I_icon);
+    browser_options.base_path = STORAGE_APP_DATA_PATH_PREFIX;
+    furi_string_set(app->file_path, browser_options.base_path);
+    if(!dialog_file_browser_show(app->dialogs, app->file_path, app->file_path, &browser_options)) {
+        furi_record_close(RECORD_STORAGE);
+        key_copier_switch_to_view(app, KeyCopierViewSubmenu);
+        return;
+    }
+    KEY_TRACE_BEGIN("gcode");
+    KEY_MEMORY_BEGIN();
+    KeyGcodeTotals totals;
+    FuriString* gcode_path = furi_string_alloc();
+    bool done = key_library_export_gcode(
+        storage,
+        furi_string_get_cstr(app->file_path),
+        app->model->format_index,
+        gcode_path,
+        &totals);
+    furi_record_close(RECORD_STORAGE);
+    KEY_MEMORY_END("gcode");
+    KEY_TRACE_END("gcode");
+
+    FuriString* text = furi_string_alloc();
+    if(done) {
+        furi_string_printf(
+            text,
+            "Keys: %lu\nCuts: %lu\nTools: %lu\nBad lines: %lu\nMachine time: %lu min %lu s\n\n"
+            "G-code:\n%s",
+            totals.keys,
+            totals.cuts,
+            totals.tools,
+            totals.errors,
+            totals.seconds / 60,
+            totals.seconds % 60,
+            furi_string_get_cstr(gcode_path));
+    } else {
+        furi_string_set(text, "Toolpath export failed.\nCheck the SD card.");
+    }
+    key_copier_show_result(app, furi_string_get_cstr(text));
+    furi_string_free(text);
+    furi_string_free(gcode_path);
+}
+
+static void key_copier_view_backup_callback(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    KEY_TRACE_BEGIN("backup");
+    KEY_MEMORY_BEGIN();
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    KeyLibraryBackupTotals totals;
+    FuriString* archive_path = furi_string_alloc();
+    bool done = key_library_backup(storage, archive_path, &totals);
+    furi_record_close(RECORD_STORAGE);
+    KEY_MEMORY_END("backup");
+    KEY_TRACE_END("backup");
+
+    FuriString* text = furi_string_alloc();
+    if(!done) {
+        furi_string_set(text, "Backup failed.\nCheck the SD card.");
+    } else if(!totals.sequence) {
+        furi_string_set(text, "Nothing has changed since the last backup.");
+    } else {
+        furi_string_printf(
+            text,
+            "%s backup\nKeys: %lu\nRemoved: %lu\nSkipped: %lu\nPacked: %lu of %lu bytes\n\n"
+            "Archive:\n%s",
+            totals.full ? "Full" : "Incremental",
+            totals.keys,
+            totals.removed,
+            totals.skipped,
+            totals.archive_bytes,
+            totals.key_bytes,
+            furi_string_get_cstr(archive_path));
+    }
+    key_copier_show_result(app, furi_string_get_cstr(text));
+    furi_string_free(text);
+    furi_string_free(archive_path);
+}
+
+static void key_copier_view_restore_callback(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    DialogMessage* message = dialog_message_alloc();
+    dialog_message_set_header(message, "Restore keys?", 64, 0, AlignCenter, AlignTop);
+    dialog_message_set_text(
+        message, "Keys of the same name\nare replaced", 64, 32, AlignCenter, AlignCenter);
+    dialog_message_set_buttons(message, "Cancel", NULL, "Restore");
+    DialogMessageButton button = dialog_message_show(app->dialogs, message);
+    dialog_message_free(message);
+    if(button != DialogMessageButtonRight) {
+        key_copier_switch_to_view(app, KeyCopierViewSubmenu);
+        return;
+    }
+    KEY_TRACE_BEGIN("restore");
+    KEY_MEMORY_BEGIN();
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    KeyLibraryRestoreTotals totals;
+    bool done = key_library_restore(storage, &totals);
+    furi_record_close(RECORD_STORAGE);
+    KEY_MEMORY_END("restore");
+    KEY_TRACE_END("restore");
+
+    FuriString* text = furi_string_alloc();
+    if(!totals.archives) {
+        furi_string_set(text, "No backups found in\n" KEY_LIBRARY_BACKUP_FOLDER);
+    } else {
+        furi_string_printf(
+            text,
+            "%s\nArchives: %lu\nKeys: %lu\nRemoved: %lu\nBad hashes: %lu",
+            done ? "Restore complete" : "Restore stopped early",
+            totals.archives,
+            totals.keys,
+            totals.removed,
+            totals.bad);
+    }
+    key_copier_show_result(app, furi_string_get_cstr(text));
+    furi_string_free(text);
+}
+
+static void key_copier_view_trace_callback(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    KEY_MEMORY_BEGIN();
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    storage_simply_mkdir(storage, STORAGE_APP_DATA_PATH_PREFIX);
+    bool done = key_trace_export(storage, KEY_TRACE_PATH);
+    furi_record_close(RECORD_STORAGE);
+    KEY_MEMORY_END("trace_export");
+    key_copier_show_result(
+        app,
+        done ? "Trace saved to\n" KEY_TRACE_PATH "\n\nOpen it in chrome://tracing or Perfetto." :
+               "Trace export failed.\nCheck the SD card.");
 }
 
-static const char* key_name_entry_text = "Enter name";
-static void key_copier_file_saver(void* context) {
+static void key_copier_view_stats_callback(void* context) {
     KeyCopierApp* app = (KeyCopierApp*)context;
-    KeyCopierModel* model = view_get_model(app->view_measure);
-    bool redraw = true;
-    with_view_model(
-        app->view_measure,
-        KeyCopierModel * model,
-        { furi_string_set(model->key_name_str, app->temp_buffer); },
-        redraw);
-    FuriString* file_path = furi_string_alloc();
-    furi_string_printf(
-        file_path,
-        "%s/%s%s",
-        STORAGE_APP_DATA_PATH_PREFIX,
-        furi_string_get_cstr(model->key_name_str),
-        KEY_COPIER_FILE_EXTENSION);
+    char text[192];
+    key_power_tick(&app->power, furi_get_tick(), app->last_input);
+    key_power_report(&app->power, text, sizeof(text));
+    key_copier_show_result(app, text);
+}
+
+static void key_copier_view_memory_callback(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    // Too big for the app stack, which is what this screen is watching
+    char* text = malloc(KEY_MEMORY_REPORT_SIZE);
+    key_memory_report(text, KEY_MEMORY_REPORT_SIZE);
+    key_memory_log();
+    key_copier_show_result(app, text);
+    free(text);
+}
 
+static void key_copier_view_analyze_callback(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    KeyAnalysisSummary summary;
+    KEY_TRACE_BEGIN("analyze");
+    KEY_MEMORY_BEGIN();
     Storage* storage = furi_record_open(RECORD_STORAGE);
     storage_simply_mkdir(storage, STORAGE_APP_DATA_PATH_PREFIX);
-    FURI_LOG_D(TAG, "mkdir finished");
-    FlipperFormat* flipper_format = flipper_format_file_alloc(storage);
-    do {
-        const uint32_t version = 1;
-        const uint32_t pin_num_buffer = (uint32_t)model->format.pin_num;
-        const uint32_t macs_buffer = (uint32_t)model->format.macs;
-        FuriString* buffer = furi_string_alloc();
-        if(!flipper_format_file_open_always(flipper_format, furi_string_get_cstr(file_path)))
-            break;
-        if(!flipper_format_write_header_cstr(flipper_format, "Flipper Key Copier File", version))
-            break;
-        if(!flipper_format_write_string_cstr(
-               flipper_format, "Manufacturer", model->format.manufacturer))
-            break;
-        if(!flipper_format_write_string_cstr(
-               flipper_format, "Format Name", model->format.format_name))
-            break;
-        if(!flipper_format_write_string_cstr(
-               flipper_format, "Data Sheet", model->format.format_link))
-            break;
-        if(!flipper_format_write_uint32(flipper_format, "Number of Pins", &pin_num_buffer, 1))
-            break;
-        if(!flipper_format_write_uint32(
-               flipper_format, "Maximum Adjacent Cut Specification (MACS)", &macs_buffer, 1))
-            break;
-        for(int i = 0; i < model->format.pin_num; i++) {
-            if(i < model->format.pin_num - 1) {
-                furi_string_cat_printf(buffer, "%d-", model->depth[i]);
-            } else {
-                furi_string_cat_printf(buffer, "%d", model->depth[i]);
-            }
+    bool done = key_analysis_run(storage, &summary);
+    furi_record_close(RECORD_STORAGE);
+    KEY_MEMORY_END("analyze");
+    KEY_TRACE_END("analyze");
+
+    FuriString* text = furi_string_alloc();
+    if(done) {
+        furi_string_printf(
+            text,
+            "Keys: %lu\nFormats shared: %lu\nPairs compared: %lu\nDuplicates: %lu\n"
+            "One cut apart: %lu\n\nFull report:\n%s",
+            summary.keys,
+            summary.formats,
+            summary.pairs,
+            summary.duplicates,
+            summary.one_cut_apart,
+            KEY_ANALYSIS_REPORT_PATH);
+        if(summary.left_out) {
+            furi_string_cat_printf(
+                text, "\n\nPartial: %lu keys were left out.", summary.left_out);
         }
-        if(!flipper_format_write_string(flipper_format, "Bitting Pattern", buffer)) break;
-        furi_string_free(buffer);
-        // signal that the file was written successfully
-    } while(0);
-    flipper_format_free(flipper_format);
+    } else {
+        furi_string_set(text, "Analysis failed.\nCheck the SD card.");
+    }
+    key_copier_show_result(app, furi_string_get_cstr(text));
+    furi_string_free(text);
+}
+
+// Up and Down step a reading by 0.001in, or by 0.01mm in mm, five steps at a time when held
+#define CALIPER_INCH_STEP (KEY_FORMAT_UNITS_PER_INCH / 1000)
+#define CALIPER_REPEAT_STEPS 5
 
-    view_dispatcher_switch_to_view(app->view_dispatcher, KeyCopierViewSubmenu);
+static uint32_t key_copier_caliper_mm100(uint16_t length) {
+    return ((uint32_t)length * 254 + 500) / 1000;
 }
 
-static void key_copier_view_save_callback(void* context) {
-    KeyCopierApp* app = (KeyCopierApp*)context;
-    // Header to display on the text input screen.
-    text_input_set_header_text(app->text_input, key_name_entry_text);
+static void
+    key_copier_caliper_text(char* text, size_t size, uint16_t length, KeyCaliperUnit unit) {
+    if(unit == KeyCaliperMm) {
+        unsigned mm100 = key_copier_caliper_mm100(length);
+        snprintf(text, size, "%u.%02umm", mm100 / 100, mm100 % 100);
+    } else {
+        unsigned thou = (length + CALIPER_INCH_STEP / 2) / CALIPER_INCH_STEP;
+        snprintf(text, size, "%u.%03uin", thou / 1000, thou % 1000);
+    }
+}
 
-    // Copy the current name into the temporary buffer.
-    bool redraw = false;
+static void key_copier_caliper_step(KeyCopierCaliperModel* model, int delta) {
+    int32_t reading = model->readings[model->pin];
+    if(model->unit == KeyCaliperMm) {
+        // Step in whole hundredths so the mm shown never drifts from rounding
+        int32_t mm100 = (int32_t)key_copier_caliper_mm100(reading) + delta;
+        reading = (max(mm100, 0) * 1000 + 127) / 254;
+    } else {
+        reading = (reading + CALIPER_INCH_STEP / 2) / CALIPER_INCH_STEP * CALIPER_INCH_STEP +
+                  delta * CALIPER_INCH_STEP;
+    }
+    model->readings[model->pin] = min(max(reading, 0), KEY_FORMAT_UNITS_PER_INCH);
+    model->clean = key_caliper_decode(&model->format, model->readings, &model->result);
+}
+
+// Start from what the measure screen shows, so only the cuts that differ need stepping
+static void key_copier_view_caliper_enter_callback(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    const KeyCopierModel* key = app->model;
     with_view_model(
-        app->view_measure,
-        KeyCopierModel * model,
+        app->view_caliper,
+        KeyCopierCaliperModel * model,
         {
-            strncpy(
-                app->temp_buffer,
-                furi_string_get_cstr(model->key_name_str),
-                app->temp_buffer_size);
+            model->format_index = key->format_index;
+            model->format = key->format;
+            for(uint8_t pin = 0; pin < key->format.pin_num; pin++) {
+                model->readings[pin] =
+                    key_caliper_remaining(&key->format, key_bitting_get(&key->bitting, pin));
+            }
+            model->pin = key->pin_slc - 1;
+            model->clean = key_caliper_decode(&model->format, model->readings, &model->result);
         },
-        redraw);
+        true);
+}
 
-    // Configure the text input.  When user enters text and clicks OK, key_copier_file_saver be called.
-    bool clear_previous_text = false;
-    text_input_set_result_callback(
-        app->text_input,
-        key_copier_file_saver,
-        app,
-        app->temp_buffer,
-        app->temp_buffer_size,
-        clear_previous_text);
+static void key_copier_view_caliper_draw_callback(Canvas* canvas, void* context) {
+    const KeyCopierCaliperModel* model = context;
+    const KeyCaliperResult* result = &model->result;
+    char text[24];
+    canvas_set_font(canvas, FontSecondary);
+    canvas_draw_str(canvas, 0, 8, key_format_info[model->format_index].format_name);
+    snprintf(text, sizeof(text), "Cut %u/%u", model->pin + 1, model->format.pin_num);
+    canvas_draw_str_aligned(canvas, 128, 0, AlignRight, AlignTop, text);
 
-    view_set_previous_callback(
-        text_input_get_view(app->text_input), key_copier_navigation_submenu_callback);
+    canvas_set_font(canvas, FontPrimary);
+    key_copier_caliper_text(text, sizeof(text), model->readings[model->pin], model->unit);
+    canvas_draw_str_aligned(canvas, 64, 22, AlignCenter, AlignBottom, text);
 
-    // Show text input dialog.
-    view_dispatcher_switch_to_view(app->view_dispatcher, KeyCopierViewTextInput);
+    uint32_t bit = 1u << model->pin;
+    uint8_t depth = key_bitting_get(&result->bitting, model->pin);
+    canvas_set_font(canvas, FontSecondary);
+    if(result->out_of_range & bit) {
+        snprintf(text, sizeof(text), "Out of range, %u?", depth);
+    } else if(result->resolved & bit) {
+        snprintf(text, sizeof(text), "Between, %u by MACS", depth);
+    } else if(result->ambiguous & bit) {
+        snprintf(text, sizeof(text), "Between depths, %u?", depth);
+    } else if(result->macs & key_bitting_pin_pairs(model->pin)) {
+        snprintf(text, sizeof(text), "Depth %u, MACS!", depth);
+    } else {
+        snprintf(text, sizeof(text), "Depth %u", depth);
+    }
+    canvas_draw_str_aligned(canvas, 64, 33, AlignCenter, AlignBottom, text);
+
+    // Every cut, with the flagged ones underlined and the selected one framed
+    uint32_t flagged = (result->ambiguous & ~result->resolved) | result->out_of_range |
+                       result->macs | (result->macs << 1);
+    int pitch = min(128 / model->format.pin_num, 12);
+    int left = (128 - pitch * model->format.pin_num) / 2;
+    for(uint8_t pin = 0; pin < model->format.pin_num; pin++) {
+        int x = left + pin * pitch;
+        text[0] = "0123456789ABCDEF"[key_bitting_get(&result->bitting, pin)];
+        text[1] = '\0';
+        canvas_draw_str_aligned(canvas, x + pitch / 2, 46, AlignCenter, AlignBottom, text);
+        if(pin == model->pin) canvas_draw_frame(canvas, x, 36, pitch, 12);
+        if(flagged & (1u << pin)) canvas_draw_line(canvas, x + 2, 49, x + pitch - 3, 49);
+    }
+    canvas_draw_str(canvas, 0, 63, model->clean ? "OK: in/mm  Hold OK: use" : "OK: in/mm");
 }
 
-static void key_copier_view_load_callback(void* context) {
+static bool key_copier_view_caliper_input_callback(InputEvent* event, void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    bool consumed = event->key != InputKeyBack;
+    bool use = false;
+    KeyCaliperResult result;
+    with_view_model(
+        app->view_caliper,
+        KeyCopierCaliperModel * model,
+        {
+            int steps = event->type == InputTypeRepeat ? CALIPER_REPEAT_STEPS : 1;
+            if(event->type == InputTypeShort || event->type == InputTypeRepeat) {
+                switch(event->key) {
+                case InputKeyLeft:
+                    if(model->pin > 0) model->pin--;
+                    break;
+                case InputKeyRight:
+                    if(model->pin < model->format.pin_num - 1) model->pin++;
+                    break;
+                case InputKeyUp:
+                    key_copier_caliper_step(model, steps);
+                    break;
+                case InputKeyDown:
+                    key_copier_caliper_step(model, -steps);
+                    break;
+                case InputKeyOk:
+                    if(event->type == InputTypeShort)
+                        model->unit = model->unit == KeyCaliperMm ? KeyCaliperInch :
+                                                                    KeyCaliperMm;
+                    break;
+                default:
+                    break;
+                }
+            } else if(event->type == InputTypeLong && event->key == InputKeyOk) {
+                use = model->clean;
+                result = model->result;
+            }
+        },
+        true);
+    if(use) {
+        KeyCopierModel* model = app->model;
+        key_copier_replace(model, model->format_index, &result.bitting);
+        model->data_loaded = true;
+        key_copier_follow(model);
+        key_copier_publish(app);
+        key_copier_switch_to_view(app, KeyCopierViewMeasure);
+    }
+    return consumed;
+}
+
+static void key_copier_view_caliper_batch_callback(void* context) {
     KeyCopierApp* app = (KeyCopierApp*)context;
-    KeyCopierModel* model = view_get_model(app->view_measure);
     DialogsFileBrowserOptions browser_options;
     Storage* storage = furi_record_open(RECORD_STORAGE);
     storage_simply_mkdir(storage, STORAGE_APP_DATA_PATH_PREFIX);
-    dialog_file_browser_set_basic_options(&browser_options, KEY_COPIER_FILE_EXTENSION, &I_icon);
+    dialog_file_browser_set_basic_options(
+        &browser_options, KEY_LIBRARY_CALIPER_EXTENSION, &I_icon);
     browser_options.base_path = STORAGE_APP_DATA_PATH_PREFIX;
     furi_string_set(app->file_path, browser_options.base_path);
-    if(dialog_file_browser_show(app->dialogs, app->file_path, app->file_path, &browser_options)) {
-        FlipperFormat* flipper_format = flipper_format_file_alloc(storage);
-        do {
-            if(!flipper_format_file_open_existing(
-                   flipper_format, furi_string_get_cstr(app->file_path)))
-                break;
-            FuriString* format_buffer = furi_string_alloc();
-            FuriString* depth_buffer = furi_string_alloc();
-            if(!flipper_format_read_string(flipper_format, "Format Name", format_buffer)) break;
-            if(!flipper_format_read_string(flipper_format, "Bitting Pattern", depth_buffer)) break;
-            for(size_t i = 0; i < COUNT_OF(all_formats); i++) {
-                if(!strcmp(furi_string_get_cstr(format_buffer), all_formats[i].format_name)) {
-                    model->format_index = (uint32_t)i;
-                    model->format = all_formats[model->format_index];
-                }
-            }
-
-            for(int i = 0; i < model->format.pin_num; i++) {
-                model->depth[i] = (uint8_t)(furi_string_get_char(depth_buffer, i * 2) - '0');
-            }
-            model->data_loaded = true;
-            // signal that the file was read successfully
-        } while(0);
-        flipper_format_free(flipper_format);
+    if(!dialog_file_browser_show(app->dialogs, app->file_path, app->file_path, &browser_options)) {
         furi_record_close(RECORD_STORAGE);
+        key_copier_switch_to_view(app, KeyCopierViewSubmenu);
+        return;
+    }
+    KEY_TRACE_BEGIN("calipers");
+    KEY_MEMORY_BEGIN();
+    KeyCaliperTotals totals;
+    FuriString* decoded_path = furi_string_alloc();
+    bool done = key_library_decode_calipers(
+        storage,
+        furi_string_get_cstr(app->file_path),
+        app->model->format_index,
+        decoded_path,
+        &totals);
+    furi_record_close(RECORD_STORAGE);
+    KEY_MEMORY_END("calipers");
+    KEY_TRACE_END("calipers");
+
+    FuriString* text = furi_string_alloc();
+    if(done) {
+        furi_string_printf(
+            text,
+            "Keys: %lu\nClean: %lu\nBetween depths: %lu\nOut of range: %lu\nMACS: %lu\n"
+            "Bad lines: %lu\n\nDecoded:\n%s",
+            totals.keys,
+            totals.clean,
+            totals.ambiguous,
+            totals.out_of_range,
+            totals.macs,
+            totals.errors,
+            furi_string_get_cstr(decoded_path));
+    } else {
+        furi_string_set(text, "Caliper batch failed.\nCheck the SD card.");
     }
-    view_dispatcher_switch_to_view(app->view_dispatcher, KeyCopierViewSubmenu);
+    key_copier_show_result(app, furi_string_get_cstr(text));
+    furi_string_free(text);
+    furi_string_free(decoded_path);
 }
 
-static void key_copier_view_measure_draw_callback(Canvas* canvas, void* model) {
-    static double inches_per_px = (double)INCHES_PER_PX;
-    canvas_set_bitmap_mode(canvas, true);
-    KeyCopierModel* my_model = (KeyCopierModel*)model;
-    KeyFormat my_format = my_model->format;
-    FuriString* buffer = furi_string_alloc();
-    int pin_half_width_px = (int)round((my_format.pin_width_inch / inches_per_px) / 2);
-    int pin_step_px = (int)round(my_format.pin_increment_inch / inches_per_px);
-    double drill_radians =
-        (180 - my_format.drill_angle) / 2 / 180 * (double)M_PI; // Convert angle to radians
-    double tangent = tan(drill_radians);
-    int top_contour_px = (int)round(62 - my_format.uncut_depth_inch / inches_per_px);
-    int bottom_contour_px = 0;
-
-    if(my_format.sides == 2)
-        bottom_contour_px =
-            top_contour_px + (int)round(my_format.uncut_depth_inch / inches_per_px);
-    int post_extra_x_px = 0;
-    int pre_extra_x_px = 0;
-    int bottom_post_extra_x_px = 0; // new
-    int bottom_pre_extra_x_px = 0; // new
-    int level_contour_px =
-    (int)round((my_format.last_pin_inch + my_format.elbow_inch) / inches_per_px);
-    for(int current_pin = 1; current_pin <= my_model->format.pin_num; current_pin += 1) {
-        double current_center_px =
-            my_format.first_pin_inch + (current_pin - 1) * my_format.pin_increment_inch;
-        int pin_center_px = (int)round(current_center_px / inches_per_px);
-
-        furi_string_printf(buffer, "%d", my_model->depth[current_pin - 1]);
-        canvas_draw_str_aligned(
-            canvas,
-            pin_center_px,
-            top_contour_px - 12,
-            AlignCenter,
-            AlignCenter,
-            furi_string_get_cstr(buffer));
+// The backlight stays on while a key is held against the screen, however long aligning takes
+static void key_copier_view_measure_enter_callback(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    key_power_pin(&app->power, true, furi_get_tick());
+#ifdef BACKLIGHT_ON
+    notification_message(app->notifications, &sequence_display_backlight_enforce_on);
+#endif
+}
 
-        canvas_draw_line(
-            canvas,
-            pin_center_px,
-            top_contour_px - 5,
-            pin_center_px,
-            top_contour_px); // the vertical line to indicate pin center
-        int current_depth = my_model->depth[current_pin - 1] - my_format.min_depth_ind;
-        int current_depth_px =
-            (int)round(current_depth * my_format.depth_step_inch / inches_per_px);
-        canvas_draw_line(
-            canvas,
-            pin_center_px - pin_half_width_px,
-            top_contour_px + current_depth_px,
-            pin_center_px + pin_half_width_px,
-            top_contour_px + current_depth_px); // draw top pin width horizontal line
-
-        if(my_format.sides == 2) { // new
-            int last_depth = my_model->depth[current_pin - 2] - my_format.min_depth_ind;
-            int next_depth = my_model->depth[current_pin] - my_format.min_depth_ind;
-            int current_depth = my_model->depth[current_pin - 1] - my_format.min_depth_ind;
-            int current_depth_px =
-                (int)round(current_depth * my_format.depth_step_inch / inches_per_px);
-
-            // Draw horizontal line for bottom pin
-            canvas_draw_line(
-                canvas,
-                pin_center_px - pin_half_width_px,
-                bottom_contour_px - current_depth_px,
-                pin_center_px + pin_half_width_px,
-                bottom_contour_px - current_depth_px);
-
-            // Handle first pin for bottom
-            if(current_pin == 1) {
-                canvas_draw_line(
-                    canvas,
-                    0,
-                    bottom_contour_px,
-                    pin_center_px - pin_half_width_px - current_depth_px,
-                    bottom_contour_px);
-                last_depth = 0;
-                bottom_pre_extra_x_px = max(current_depth_px + pin_half_width_px, 0);
-            }
+static void key_copier_view_measure_exit_callback(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    key_power_pin(&app->power, false, furi_get_tick());
+#ifdef BACKLIGHT_ON
+    notification_message(app->notifications, &sequence_display_backlight_enforce_auto);
+#endif
+}
 
-            // Handle left side intersection for bottom
-            if((last_depth + current_depth) > my_format.clearance) {
-                if(current_pin != 1) {
-                    bottom_pre_extra_x_px =
-                        min(max(pin_step_px - bottom_post_extra_x_px, pin_half_width_px),
-                            pin_step_px - pin_half_width_px);
-                }
-                canvas_draw_line(
-                    canvas,
-                    pin_center_px - bottom_pre_extra_x_px,
-                    bottom_contour_px -
-                        max((int)round(
-                                (current_depth_px - (bottom_pre_extra_x_px - pin_half_width_px)) *
-                                tangent),
-                            0),
-                    pin_center_px - pin_half_width_px,
-                    bottom_contour_px - (int)round(current_depth_px * tangent));
-            } else {
-                int last_depth_px =
-                    (int)round(last_depth * my_format.depth_step_inch / inches_per_px);
-                int up_slope_start_x_px = pin_center_px - pin_half_width_px - current_depth_px;
-                canvas_draw_line(
-                    canvas,
-                    pin_center_px - pin_half_width_px - current_depth_px,
-                    bottom_contour_px,
-                    pin_center_px - pin_half_width_px,
-                    bottom_contour_px - (int)round(current_depth_px * tangent));
-                canvas_draw_line(
-                    canvas,
-                    min(pin_center_px - pin_step_px + pin_half_width_px + last_depth_px,
-                        up_slope_start_x_px),
-                    bottom_contour_px,
-                    up_slope_start_x_px,
-                    bottom_contour_px);
-            }
+// Redraw a layer only when the frame shows it for another key or pan; true if it was redrawn
+static bool key_copier_layer(
+    KeyCopierLayer* layer,
+    const KeyCopierFrame* frame,
+    const KeyBitting* bitting) {
+    if(layer->valid && layer->format_index == frame->format_index &&
+       layer->view_px == frame->view_px && key_bitting_equal(&layer->bitting, bitting))
+        return false;
+    key_render_layer(&frame->geometry, bitting, frame->view_px, layer->xbm);
+    layer->format_index = frame->format_index;
+    layer->bitting = *bitting;
+    layer->view_px = frame->view_px;
+    layer->valid = true;
+    return true;
+}
 
-            // Handle right side intersection for bottom
-            if((current_depth + next_depth) > my_format.clearance) {
-                double numerator = (double)current_depth;
-                double denominator = (double)(current_depth + next_depth);
-                double product = (numerator / denominator) * pin_step_px;
-                bottom_post_extra_x_px =
-                    (int)min(max(product, pin_half_width_px), pin_step_px - pin_half_width_px);
-                canvas_draw_line(
-                    canvas,
-                    pin_center_px + pin_half_width_px,
-                    bottom_contour_px - current_depth_px,
-                    pin_center_px + bottom_post_extra_x_px,
-                    bottom_contour_px -
-                        max(current_depth_px -
-                                (int)round((bottom_post_extra_x_px - pin_half_width_px) * tangent),
-                            0));
-            } else {
-                canvas_draw_line(
-                    canvas,
-                    pin_center_px + pin_half_width_px,
-                    bottom_contour_px - (int)round(current_depth_px * tangent),
-                    pin_center_px + pin_half_width_px + current_depth_px,
-                    bottom_contour_px);
-            }
-        }
-        // new end
-
-        int last_depth = my_model->depth[current_pin - 2] - my_format.min_depth_ind;
-        int next_depth = my_model->depth[current_pin] - my_format.min_depth_ind;
-        if(current_pin == 1) {
-            canvas_draw_line(
-                canvas,
-                0,
-                top_contour_px,
-                pin_center_px - pin_half_width_px - current_depth_px,
-                top_contour_px); // draw top shoulder
-            last_depth = 0;
-            pre_extra_x_px = max(current_depth_px + pin_half_width_px, 0);
-            if(my_format.sides == 2) {
-                canvas_draw_line(
-                    canvas,
-                    0,
-                    bottom_contour_px,
-                    pin_center_px - pin_half_width_px - current_depth_px,
-                    bottom_contour_px); // draw bottom shoulder (hidden by level contour)
-            } else {
-                canvas_draw_line(canvas, 0, 62, level_contour_px, 62);
+static void key_copier_view_measure_draw_callback(Canvas* canvas, void* model) {
+    KEY_TRACE_BEGIN("draw");
+    KEY_MEMORY_BEGIN();
+    canvas_set_bitmap_mode(canvas, true);
+    KeyCopierFrame frame;
+    key_snapshot_read(&((KeyCopierFrames*)model)->snapshot, &frame);
+    const KeyRenderGeometry* geometry = &frame.geometry;
+    if(frame.overlay) {
+        // Where both keys are cut alike the two contours cancel out, leaving the differences
+        KeyCopierFrames* frames = model;
+        bool redrawn = key_copier_layer(&frames->live, &frame, &frame.bitting);
+        redrawn |= key_copier_layer(&frames->reference, &frame, &frame.reference);
+        if(redrawn) {
+            for(size_t i = 0; i < KEY_RENDER_LAYER_BYTES; i++) {
+                frames->overlay[i] = frames->live.xbm[i] ^ frames->reference.xbm[i];
             }
         }
-        if(current_pin == my_model->format.pin_num) {
-            next_depth = 0;
-        }
-        if((last_depth + current_depth) > my_format.clearance) { // yes
-            // intersection
+        canvas_draw_xbm(canvas, 0, 0, KEY_RENDER_WIDTH, KEY_RENDER_HEIGHT, frames->overlay);
+        key_render_marks(canvas, geometry, &frame.bitting, &frame.reference, frame.view_px);
+    } else {
+        key_render_draw(canvas, geometry, &frame.bitting, frame.view_px);
+    }
+
+    canvas_draw_icon(
+        canvas,
+        geometry->pin_center_px[frame.pin_slc - 1] - frame.view_px - 2,
+        geometry->top_contour_px - 25,
+        &I_arrow_down);
+    canvas_draw_str(canvas, 100, 10, key_format_info[frame.format_index].format_name);
+    if(frame.blocked) {
+        // The neighbour whose MACS stopped the last step
+        canvas_draw_str(
+            canvas,
+            geometry->pin_center_px[frame.blocked - 1] - frame.view_px - 1,
+            geometry->top_contour_px - 17,
+            "!");
+        canvas_draw_str(canvas, 100, 20, "MACS");
+    } else if(frame.overlay) {
+        canvas_draw_str(canvas, 100, 20, "REF");
+    }
+    if(frame.session_key) {
+        char number[12];
+        snprintf(number, sizeof(number), "#%lu", frame.session_key);
+        canvas_draw_str(canvas, 100, 30, number);
+    }
+    if(key_copier_max_view_px(geometry) > 0) {
+        // Where the shoulder sits off screen, so a real key can be lined up after panning
+        int offset = (int)(frame.view_px * INCHES_PER_PX * 100 + 0.5);
+        char pan[16];
+        snprintf(
+            pan,
+            sizeof(pan),
+            "<%d.%02din%s",
+            offset / 100,
+            offset % 100,
+            frame.follow ? "" : " lock");
+        canvas_draw_str(canvas, 0, 8, pan);
+    }
+    KEY_MEMORY_END("draw");
+    KEY_TRACE_END("draw");
+}
+
+// Move the selected pin to the next depth its neighbours allow, or note the neighbour in the way
+static void key_copier_step_depth(KeyCopierModel* model, bool deeper) {
+    uint8_t pin = model->pin_slc - 1;
+    uint8_t blocker;
+    int8_t depth =
+        key_macs_step(&model->macs, &model->bitting, model->format.pin_num, pin, deeper, &blocker);
+    if(depth < 0) {
+        if(blocker != KEY_MACS_RANGE) model->blocked = blocker + 1;
+        return;
+    }
+    key_history_edit(&model->history, pin, key_bitting_get(&model->bitting, pin), depth);
+    key_bitting_set(&model->bitting, pin, depth);
+}
 
-            if(current_pin != 1) {
-                pre_extra_x_px =
-                    min(max(pin_step_px - post_extra_x_px, pin_half_width_px),
-                        pin_step_px - pin_half_width_px);
+// Undo or redo one change, selecting the cut it touched
+static bool key_copier_history_step(KeyCopierModel* model, bool redo) {
+    KeyHistoryState state = {.format_index = model->format_index, .bitting = model->bitting};
+    if(!(redo ? key_history_redo(&model->history, &state) :
+                key_history_undo(&model->history, &state)))
+        return false;
+    if(state.format_index != model->format_index) {
+        key_copier_set_format(model, state.format_index);
+        model->pin_slc = 1;
+    } else {
+        for(uint8_t pin = 0; pin < model->format.pin_num; pin++) {
+            if(key_bitting_get(&state.bitting, pin) != key_bitting_get(&model->bitting, pin)) {
+                model->pin_slc = pin + 1;
+                break;
             }
-            canvas_draw_line(
-                canvas,
-                pin_center_px - pre_extra_x_px,
-                top_contour_px +
-                    max((int)round(
-                            (current_depth_px - (pre_extra_x_px - pin_half_width_px)) * tangent),
-                        0),
-                pin_center_px - pin_half_width_px,
-                top_contour_px + (int)round(current_depth_px * tangent));
-        } else {
-            int last_depth_px = (int)round(last_depth * my_format.depth_step_inch / inches_per_px);
-            int down_slope_start_x_px = pin_center_px - pin_half_width_px - current_depth_px;
-            canvas_draw_line(
-                canvas,
-                pin_center_px - pin_half_width_px - current_depth_px,
-                top_contour_px,
-                pin_center_px - pin_half_width_px,
-                top_contour_px + (int)round(current_depth_px * tangent));
-            canvas_draw_line(
-                canvas,
-                min(pin_center_px - pin_step_px + pin_half_width_px + last_depth_px,
-                    down_slope_start_x_px),
-                top_contour_px,
-                down_slope_start_x_px,
-                top_contour_px);
-        }
-        if((current_depth + next_depth) > my_format.clearance) { //yes intersection
-            double numerator = (double)current_depth;
-            double denominator = (double)(current_depth + next_depth);
-            double product = (numerator / denominator) * pin_step_px;
-            post_extra_x_px =
-                (int)min(max(product, pin_half_width_px), pin_step_px - pin_half_width_px);
-            canvas_draw_line(
-                canvas,
-                pin_center_px + pin_half_width_px,
-                top_contour_px + current_depth_px,
-                pin_center_px + post_extra_x_px,
-                top_contour_px +
-                    max(current_depth_px -
-                            (int)round((post_extra_x_px - pin_half_width_px) * tangent),
-                        0));
-        } else { // no intersection
-            canvas_draw_line(
-                canvas,
-                pin_center_px + pin_half_width_px,
-                top_contour_px + (int)round(current_depth_px * tangent),
-                pin_center_px + pin_half_width_px + current_depth_px,
-                top_contour_px);
         }
     }
+    model->bitting = state.bitting;
+    key_copier_follow(model);
+    return true;
+}
 
-    int elbow_px = (int)round(my_format.elbow_inch / inches_per_px);
-    canvas_draw_line(canvas, level_contour_px, 62, level_contour_px + elbow_px, 62 - elbow_px);
-    canvas_draw_line(canvas, 0, top_contour_px - 6, 0, top_contour_px);
-    if(my_format.stop == 2) {
-        // Draw a line using level_contour_px if stop equals 2 elbow must be firt pin inch
-        canvas_draw_line(canvas, level_contour_px, top_contour_px, level_contour_px, 63);
-        //  } else {
-        // Otherwise, draw a default line
-        //    canvas_draw_line(canvas, 0, top_contour_px, 0, 63); // too confusing but may want later
+// Hold the key on screen as the next of the keyring, and start the one after from blank in the
+// same format
+static void key_copier_session_add(KeyCopierApp* app) {
+    KeyCopierModel* model = app->model;
+    if(app->session_count == SESSION_KEYS) key_copier_session_flush(app);
+    if(app->session_count == SESSION_KEYS) {
+        // Nothing could be written since the last keys were held, so leave this one on screen
+        notification_message(app->notifications, &sequence_error);
+        return;
     }
+    KeyLibraryBatchKey* key = &app->session_keys[app->session_count++];
+    snprintf(key->name, sizeof(key->name), "%s %lu", app->session_base, app->session_next++);
+    key->format_index = model->format_index;
+    key->bitting = model->bitting;
+    furi_string_set(model->key_name_str, key->name);
+    if(app->session_count == SESSION_KEYS) key_copier_session_flush(app);
+    key_copier_replace_blank(model, model->format_index);
+    model->pin_slc = 1;
+    key_copier_follow(model);
+}
 
-    int slc_pin_px = (int)round(
-        (my_format.first_pin_inch + (my_model->pin_slc - 1) * my_format.pin_increment_inch) /
-        inches_per_px);
-    canvas_draw_icon(canvas, slc_pin_px - 2, top_contour_px - 25, &I_arrow_down);
+static void key_copier_view_session_end_callback(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    key_copier_session_flush(app);
+    app->session_active = false;
+    key_copier_publish(app);
+    view_set_previous_callback(app->view_measure, key_copier_navigation_submenu_callback);
 
-    furi_string_printf(buffer, "%s", my_format.format_name);
-    canvas_draw_str(canvas, 100, 10, furi_string_get_cstr(buffer));
-    furi_string_free(buffer);
+    FuriString* text = furi_string_alloc();
+    if(!app->session_done && !app->session_count) {
+        furi_string_set(text, "No keys were kept.\nPress OK on each key to keep it.");
+    } else {
+        furi_string_printf(
+            text,
+            "Keyring %s\nSaved: %lu keys",
+            app->session_base,
+            app->session_saved);
+        if(app->session_done) {
+            furi_string_cat_printf(
+                text,
+                "\n%s %lu to %lu",
+                app->session_base,
+                app->session_first,
+                app->session_first + app->session_done - 1);
+        }
+        furi_string_cat(text, app->session_notes);
+        if(app->session_count) {
+            furi_string_cat_printf(
+                text,
+                "\n\n%s %lu to %lu were not saved.\nCheck the SD card.",
+                app->session_base,
+                app->session_first + app->session_done,
+                app->session_next - 1);
+        }
+    }
+    key_copier_show_result(app, furi_string_get_cstr(text));
+    furi_string_free(text);
 }
 
 static bool key_copier_view_measure_input_callback(InputEvent* event, void* context) {
     KeyCopierApp* app = (KeyCopierApp*)context;
+    KeyCopierModel* model = app->model;
+    KEY_TRACE_BEGIN("input");
+    KEY_MEMORY_BEGIN();
+    bool changed = true;
+    if(event->type == InputTypeShort || event->type == InputTypeLong) model->blocked = 0;
     if(event->type == InputTypeShort) {
         switch(event->key) {
-        case InputKeyLeft: {
-            bool redraw = true;
-            with_view_model(
-                app->view_measure,
-                KeyCopierModel * model,
-                {
-                    if(model->pin_slc > 1) {
-                        model->pin_slc--;
-                    }
-                },
-                redraw);
+        case InputKeyLeft:
+            if(model->pin_slc > 1) {
+                model->pin_slc--;
+            }
+            key_copier_follow(model);
             break;
-        }
-        case InputKeyRight: {
-            bool redraw = true;
-            with_view_model(
-                app->view_measure,
-                KeyCopierModel * model,
-                {
-                    if(model->pin_slc < model->format.pin_num) {
-                        model->pin_slc++;
-                    }
-                },
-                redraw);
+        case InputKeyRight:
+            if(model->pin_slc < model->format.pin_num) {
+                model->pin_slc++;
+            }
+            key_copier_follow(model);
             break;
-        }
-        case InputKeyUp: {
-            bool redraw = true;
-            with_view_model(
-                app->view_measure,
-                KeyCopierModel * model,
-                {
-                    if(model->depth[model->pin_slc - 1] > model->format.min_depth_ind) {
-                        if(model->pin_slc == 1) { //first pin only limited by the next one
-                            if(model->depth[model->pin_slc] - model->depth[model->pin_slc - 1] <
-                               model->format.macs)
-                                model->depth[model->pin_slc - 1]--;
-                        } else if(model->pin_slc == model->format.pin_num) { // last pin only limited by
-                            // the previous one
-                            if(model->depth[model->pin_slc - 2] -
-                                   model->depth[model->pin_slc - 1] <
-                               model->format.macs) {
-                                model->depth[model->pin_slc - 1]--;
-                            }
-                        } else {
-                            if(model->depth[model->pin_slc] - model->depth[model->pin_slc - 1] <
-                                   model->format.macs &&
-                               model->depth[model->pin_slc - 2] -
-                                       model->depth[model->pin_slc - 1] <
-                                   model->format.macs) {
-                                model->depth[model->pin_slc - 1]--;
-                            }
-                        }
-                    }
-                },
-                redraw);
+        case InputKeyUp:
+            key_copier_step_depth(model, false);
             break;
-        }
-        case InputKeyDown: {
-            bool redraw = true;
-            with_view_model(
-                app->view_measure,
-                KeyCopierModel * model,
-                {
-                    if(model->depth[model->pin_slc - 1] < model->format.max_depth_ind) {
-                        if(model->pin_slc == 1) { //first pin only limited by the next one
-                            if(model->depth[model->pin_slc - 1] - model->depth[model->pin_slc] <
-                               model->format.macs)
-                                model->depth[model->pin_slc - 1]++;
-                        } else if(model->pin_slc == model->format.pin_num) { // last pin only limited by
-                            // the previous one
-                            if(model->depth[model->pin_slc - 1] -
-                                   model->depth[model->pin_slc - 2] <
-                               model->format.macs) {
-                                model->depth[model->pin_slc - 1]++;
-                            }
-                        } else {
-                            if(model->depth[model->pin_slc - 1] - model->depth[model->pin_slc] <
-                                   model->format.macs &&
-                               model->depth[model->pin_slc - 1] -
-                                       model->depth[model->pin_slc - 2] <
-                                   model->format.macs) {
-                                model->depth[model->pin_slc - 1]++;
-                            }
-                        }
-                    }
-                },
-                redraw);
+        case InputKeyDown:
+            key_copier_step_depth(model, true);
+            break;
+        case InputKeyOk:
+            if(app->session_active) {
+                key_copier_session_add(app);
+                break;
+            }
+            model->overlay = !model->overlay;
+            changed = model->has_reference;
             break;
-        }
         default:
             // Handle other keys or do nothing
+            changed = false;
             break;
         }
+    } else if(event->type == InputTypeLong && event->key == InputKeyOk) {
+        model->follow = !model->follow;
+        key_copier_follow(model);
+    } else if(event->type == InputTypeLong && event->key == InputKeyLeft) {
+        changed = key_copier_history_step(model, false);
+    } else if(event->type == InputTypeLong && event->key == InputKeyRight) {
+        changed = key_copier_history_step(model, true);
+    } else {
+        changed = false;
     }
+    if(changed) key_copier_publish(app);
+    KEY_MEMORY_END("input");
+    KEY_TRACE_END("input");
 
     return false;
 }
 
+static void key_copier_input_events_callback(const void* message, void* context) {
+    UNUSED(message);
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    app->last_input = furi_get_tick();
+}
+
+// Outside the measure view, turn the backlight off once the user has left the app idle
+static void key_copier_tick_callback(void* context) {
+    KeyCopierApp* app = (KeyCopierApp*)context;
+    if(key_power_tick(&app->power, furi_get_tick(), app->last_input)) {
+        notification_message(app->notifications, &sequence_display_backlight_off);
+    }
+}
+
 static KeyCopierApp* key_copier_app_alloc() {
     KeyCopierApp* app = (KeyCopierApp*)malloc(sizeof(KeyCopierApp));
+    key_trace_init();
+    key_memory_init();
 
     Gui* gui = furi_record_open(RECORD_GUI);
 
     app->view_dispatcher = view_dispatcher_alloc();
     view_dispatcher_attach_to_gui(app->view_dispatcher, gui, ViewDispatcherTypeFullscreen);
     view_dispatcher_set_event_callback_context(app->view_dispatcher, app);
+    view_dispatcher_set_tick_event_callback(
+        app->view_dispatcher, key_copier_tick_callback, furi_ms_to_ticks(KEY_POWER_TICK_MS));
     app->dialogs = furi_record_open(RECORD_DIALOGS);
     app->file_path = furi_string_alloc();
+    app->session_notes = furi_string_alloc();
     app->submenu = submenu_alloc();
     submenu_set_header(app->submenu, "Key Copier v1.2");
     submenu_add_item(
@@ -682,19 +1937,105 @@ static KeyCopierApp* key_copier_app_alloc() {
         KeyCopierSubmenuIndexConfigure,
         key_copier_submenu_callback,
         app);
+    submenu_add_item(
+        app->submenu,
+        "Identify Format",
+        KeyCopierSubmenuIndexIdentify,
+        key_copier_submenu_callback,
+        app);
     submenu_add_item(
         app->submenu, "Measure", KeyCopierSubmenuIndexMeasure, key_copier_submenu_callback, app);
+    submenu_add_item(
+        app->submenu,
+        "Caliper Entry",
+        KeyCopierSubmenuIndexCaliper,
+        key_copier_submenu_callback,
+        app);
+    submenu_add_item(
+        app->submenu,
+        "Caliper Batch",
+        KeyCopierSubmenuIndexCaliperBatch,
+        key_copier_submenu_callback,
+        app);
     submenu_add_item(
         app->submenu, "Save", KeyCopierSubmenuIndexSave, key_copier_submenu_callback, app);
+    submenu_add_item(
+        app->submenu,
+        "Keyring Session",
+        KeyCopierSubmenuIndexSession,
+        key_copier_submenu_callback,
+        app);
     submenu_add_item(
         app->submenu, "Load", KeyCopierSubmenuIndexLoad, key_copier_submenu_callback, app);
+    submenu_add_item(
+        app->submenu, "Search", KeyCopierSubmenuIndexSearch, key_copier_submenu_callback, app);
+    submenu_add_item(
+        app->submenu, "Rename", KeyCopierSubmenuIndexRename, key_copier_submenu_callback, app);
+    submenu_add_item(
+        app->submenu,
+        "Load Reference",
+        KeyCopierSubmenuIndexReference,
+        key_copier_submenu_callback,
+        app);
+    submenu_add_item(
+        app->submenu,
+        "Code Lookup",
+        KeyCopierSubmenuIndexCodeLookup,
+        key_copier_submenu_callback,
+        app);
+    submenu_add_item(
+        app->submenu,
+        "Find Code",
+        KeyCopierSubmenuIndexFindCode,
+        key_copier_submenu_callback,
+        app);
+    submenu_add_item(
+        app->submenu,
+        "Rekey Planner",
+        KeyCopierSubmenuIndexRekey,
+        key_copier_submenu_callback,
+        app);
+    submenu_add_item(
+        app->submenu,
+        "Cut Queue",
+        KeyCopierSubmenuIndexCutQueue,
+        key_copier_submenu_callback,
+        app);
+    submenu_add_item(
+        app->submenu, "Backup", KeyCopierSubmenuIndexBackup, key_copier_submenu_callback, app);
+    submenu_add_item(
+        app->submenu, "Restore", KeyCopierSubmenuIndexRestore, key_copier_submenu_callback, app);
+    submenu_add_item(
+        app->submenu,
+        "Analyze Library",
+        KeyCopierSubmenuIndexAnalyze,
+        key_copier_submenu_callback,
+        app);
+    submenu_add_item(
+        app->submenu,
+        "Export Trace",
+        KeyCopierSubmenuIndexTrace,
+        key_copier_submenu_callback,
+        app);
+    submenu_add_item(
+        app->submenu,
+        "Session Stats",
+        KeyCopierSubmenuIndexStats,
+        key_copier_submenu_callback,
+        app);
+    submenu_add_item(
+        app->submenu,
+        "Memory Usage",
+        KeyCopierSubmenuIndexMemory,
+        key_copier_submenu_callback,
+        app);
     submenu_add_item(
         app->submenu, "Help", KeyCopierSubmenuIndexAbout, key_copier_submenu_callback, app);
     view_set_previous_callback(
         submenu_get_view(app->submenu), key_copier_navigation_exit_callback);
     view_dispatcher_add_view(
         app->view_dispatcher, KeyCopierViewSubmenu, submenu_get_view(app->submenu));
-    view_dispatcher_switch_to_view(app->view_dispatcher, KeyCopierViewSubmenu);
+    key_copier_switch_to_view(app, KeyCopierViewSubmenu);
 
     app->text_input = text_input_alloc();
     view_dispatcher_add_view(
@@ -705,15 +2046,76 @@ static KeyCopierApp* key_copier_app_alloc() {
     app->view_measure = view_alloc();
     view_set_draw_callback(app->view_measure, key_copier_view_measure_draw_callback);
     view_set_input_callback(app->view_measure, key_copier_view_measure_input_callback);
+    view_set_enter_callback(app->view_measure, key_copier_view_measure_enter_callback);
+    view_set_exit_callback(app->view_measure, key_copier_view_measure_exit_callback);
     view_set_previous_callback(app->view_measure, key_copier_navigation_submenu_callback);
     view_set_context(app->view_measure, app);
-    view_allocate_model(app->view_measure, ViewModelTypeLockFree, sizeof(KeyCopierModel));
-    KeyCopierModel* model = view_get_model(app->view_measure);
-
-    initialize_model(model);
+    view_allocate_model(app->view_measure, ViewModelTypeLockFree, sizeof(KeyCopierFrames));
+    KeyCopierFrames* frames = view_get_model(app->view_measure);
+    key_snapshot_init(&frames->snapshot, frames->slots, sizeof(KeyCopierFrame));
+    frames->live.valid = false;
+    frames->reference.valid = false;
+    app->model = malloc(sizeof(KeyCopierModel));
+    initialize_model(app->model);
+    app->frame.pin_slc = 0; // no real frame has pin 0, so the first one is always published
+    key_copier_publish(app);
     view_dispatcher_add_view(app->view_dispatcher, KeyCopierViewMeasure, app->view_measure);
 
+    app->view_caliper = view_alloc();
+    view_set_draw_callback(app->view_caliper, key_copier_view_caliper_draw_callback);
+    view_set_input_callback(app->view_caliper, key_copier_view_caliper_input_callback);
+    view_set_enter_callback(app->view_caliper, key_copier_view_caliper_enter_callback);
+    view_set_previous_callback(app->view_caliper, key_copier_navigation_submenu_callback);
+    view_set_context(app->view_caliper, app);
+    view_allocate_model(app->view_caliper, ViewModelTypeLocking, sizeof(KeyCopierCaliperModel));
+    view_dispatcher_add_view(app->view_dispatcher, KeyCopierViewCaliper, app->view_caliper);
+
+    app->view_caliper_batch = view_alloc();
+    view_set_context(app->view_caliper_batch, app);
+    view_set_enter_callback(app->view_caliper_batch, key_copier_view_caliper_batch_callback);
+    view_set_previous_callback(app->view_caliper_batch, key_copier_navigation_submenu_callback);
+    view_dispatcher_add_view(
+        app->view_dispatcher, KeyCopierViewCaliperBatch, app->view_caliper_batch);
+
     app->variable_item_list_config = variable_item_list_alloc();
+
+    app->variable_item_list_identify = variable_item_list_alloc();
+    VariableItemList* identify = app->variable_item_list_identify;
+    VariableItem* item = variable_item_list_add(
+        identify, "Cuts", IDENTIFY_PINS_NUM + 1, key_copier_identify_pins_change, app);
+    key_copier_identify_pins_change(item);
+    item = variable_item_list_add(
+        identify,
+        "Sides",
+        COUNT_OF(identify_sides_text),
+        key_copier_identify_sides_change,
+        app);
+    key_copier_identify_sides_change(item);
+    item = variable_item_list_add(
+        identify, "Stop", COUNT_OF(identify_stop_text), key_copier_identify_stop_change, app);
+    key_copier_identify_stop_change(item);
+    item = variable_item_list_add(
+        identify,
+        "First cut",
+        IDENTIFY_FIRST_PIN_NUM + 1,
+        key_copier_identify_first_pin_change,
+        app);
+    key_copier_identify_first_pin_change(item);
+    item = variable_item_list_add(
+        identify, "Spacing", IDENTIFY_SPACING_NUM + 1, key_copier_identify_spacing_change, app);
+    key_copier_identify_spacing_change(item);
+    variable_item_list_add(identify, "Show matches", 0, NULL, NULL);
+    variable_item_list_set_enter_callback(identify, key_copier_identify_enter_callback, app);
+    view_set_previous_callback(
+        variable_item_list_get_view(identify), key_copier_navigation_submenu_callback);
+    view_dispatcher_add_view(
+        app->view_dispatcher, KeyCopierViewIdentify, variable_item_list_get_view(identify));
+
+    app->submenu_matches = submenu_alloc();
+    view_set_previous_callback(
+        submenu_get_view(app->submenu_matches), key_copier_navigation_identify_callback);
+    view_dispatcher_add_view(
+        app->view_dispatcher, KeyCopierViewMatches, submenu_get_view(app->submenu_matches));
     app->view_config_e = view_alloc();
     view_set_context(app->view_config_e, app);
     view_set_previous_callback(app->view_config_e, key_copier_navigation_submenu_callback);
@@ -729,12 +2131,118 @@ static KeyCopierApp* key_copier_app_alloc() {
     view_set_previous_callback(app->view_save, key_copier_navigation_submenu_callback);
     view_dispatcher_add_view(app->view_dispatcher, KeyCopierViewSave, app->view_save);
 
+    app->view_session = view_alloc();
+    view_set_context(app->view_session, app);
+    view_set_enter_callback(app->view_session, key_copier_view_session_callback);
+    view_set_previous_callback(app->view_session, key_copier_navigation_submenu_callback);
+    view_dispatcher_add_view(app->view_dispatcher, KeyCopierViewSession, app->view_session);
+
+    app->view_session_end = view_alloc();
+    view_set_context(app->view_session_end, app);
+    view_set_enter_callback(app->view_session_end, key_copier_view_session_end_callback);
+    view_set_previous_callback(app->view_session_end, key_copier_navigation_submenu_callback);
+    view_dispatcher_add_view(
+        app->view_dispatcher, KeyCopierViewSessionEnd, app->view_session_end);
+
     app->view_load = view_alloc();
     view_set_context(app->view_load, app);
     view_set_enter_callback(app->view_load, key_copier_view_load_callback);
     view_set_previous_callback(app->view_load, key_copier_navigation_submenu_callback);
     view_dispatcher_add_view(app->view_dispatcher, KeyCopierViewLoad, app->view_load);
 
+    app->view_search = view_alloc();
+    view_set_context(app->view_search, app);
+    view_set_enter_callback(app->view_search, key_copier_view_search_callback);
+    view_set_previous_callback(app->view_search, key_copier_navigation_submenu_callback);
+    view_dispatcher_add_view(app->view_dispatcher, KeyCopierViewSearch, app->view_search);
+
+    app->submenu_search = submenu_alloc();
+    view_set_previous_callback(
+        submenu_get_view(app->submenu_search), key_copier_navigation_search_callback);
+    view_dispatcher_add_view(
+        app->view_dispatcher,
+        KeyCopierViewSearchResults,
+        submenu_get_view(app->submenu_search));
+
+    app->view_rename = view_alloc();
+    view_set_context(app->view_rename, app);
+    view_set_enter_callback(app->view_rename, key_copier_view_rename_callback);
+    view_set_previous_callback(app->view_rename, key_copier_navigation_submenu_callback);
+    view_dispatcher_add_view(app->view_dispatcher, KeyCopierViewRename, app->view_rename);
+
+    app->view_reference = view_alloc();
+    view_set_context(app->view_reference, app);
+    view_set_enter_callback(app->view_reference, key_copier_view_reference_callback);
+    view_set_previous_callback(app->view_reference, key_copier_navigation_submenu_callback);
+    view_dispatcher_add_view(app->view_dispatcher, KeyCopierViewReference, app->view_reference);
+
+    app->view_code_lookup = view_alloc();
+    view_set_context(app->view_code_lookup, app);
+    view_set_enter_callback(app->view_code_lookup, key_copier_view_code_lookup_callback);
+    view_set_previous_callback(app->view_code_lookup, key_copier_navigation_submenu_callback);
+    view_dispatcher_add_view(
+        app->view_dispatcher, KeyCopierViewCodeLookup, app->view_code_lookup);
+
+    app->view_find_code = view_alloc();
+    view_set_context(app->view_find_code, app);
+    view_set_enter_callback(app->view_find_code, key_copier_view_find_code_callback);
+    view_set_previous_callback(app->view_find_code, key_copier_navigation_submenu_callback);
+    view_dispatcher_add_view(app->view_dispatcher, KeyCopierViewFindCode, app->view_find_code);
+
+    app->view_rekey = view_alloc();
+    view_set_context(app->view_rekey, app);
+    view_set_enter_callback(app->view_rekey, key_copier_view_rekey_callback);
+    view_set_previous_callback(app->view_rekey, key_copier_navigation_submenu_callback);
+    view_dispatcher_add_view(app->view_dispatcher, KeyCopierViewRekey, app->view_rekey);
+
+    app->view_cut_queue = view_alloc();
+    view_set_context(app->view_cut_queue, app);
+    view_set_enter_callback(app->view_cut_queue, key_copier_view_cut_queue_callback);
+    view_set_previous_callback(app->view_cut_queue, key_copier_navigation_submenu_callback);
+    view_dispatcher_add_view(app->view_dispatcher, KeyCopierViewCutQueue, app->view_cut_queue);
+
+    app->view_backup = view_alloc();
+    view_set_context(app->view_backup, app);
+    view_set_enter_callback(app->view_backup, key_copier_view_backup_callback);
+    view_set_previous_callback(app->view_backup, key_copier_navigation_submenu_callback);
+    view_dispatcher_add_view(app->view_dispatcher, KeyCopierViewBackup, app->view_backup);
+
+    app->view_restore = view_alloc();
+    view_set_context(app->view_restore, app);
+    view_set_enter_callback(app->view_restore, key_copier_view_restore_callback);
+    view_set_previous_callback(app->view_restore, key_copier_navigation_submenu_callback);
+    view_dispatcher_add_view(app->view_dispatcher, KeyCopierViewRestore, app->view_restore);
+
+    app->view_analyze = view_alloc();
+    view_set_context(app->view_analyze, app);
+    view_set_enter_callback(app->view_analyze, key_copier_view_analyze_callback);
+    view_set_previous_callback(app->view_analyze, key_copier_navigation_submenu_callback);
+    view_dispatcher_add_view(app->view_dispatcher, KeyCopierViewAnalyze, app->view_analyze);
+
+    app->view_trace = view_alloc();
+    view_set_context(app->view_trace, app);
+    view_set_enter_callback(app->view_trace, key_copier_view_trace_callback);
+    view_set_previous_callback(app->view_trace, key_copier_navigation_submenu_callback);
+    view_dispatcher_add_view(app->view_dispatcher, KeyCopierViewTrace, app->view_trace);
+
+    app->view_stats = view_alloc();
+    view_set_context(app->view_stats, app);
+    view_set_enter_callback(app->view_stats, key_copier_view_stats_callback);
+    view_set_previous_callback(app->view_stats, key_copier_navigation_submenu_callback);
+    view_dispatcher_add_view(app->view_dispatcher, KeyCopierViewStats, app->view_stats);
+
+    app->view_memory = view_alloc();
+    view_set_context(app->view_memory, app);
+    view_set_enter_callback(app->view_memory, key_copier_view_memory_callback);
+    view_set_previous_callback(app->view_memory, key_copier_navigation_submenu_callback);
+    view_dispatcher_add_view(app->view_dispatcher, KeyCopierViewMemory, app->view_memory);
+
+    app->widget_result = widget_alloc();
+    view_set_previous_callback(
+        widget_get_view(app->widget_result), key_copier_navigation_submenu_callback);
+    view_dispatcher_add_view(
+        app->view_dispatcher, KeyCopierViewResult, widget_get_view(app->widget_result));
+
     app->widget_about = widget_alloc();
     widget_add_text_scroll_element(
         app->widget_about,
@@ -753,19 +2261,21 @@ static KeyCopierApp* key_copier_app_alloc() {
         app->view_dispatcher, KeyCopierViewAbout, widget_get_view(app->widget_about));
 
     app->notifications = furi_record_open(RECORD_NOTIFICATION);
-
-#ifdef BACKLIGHT_ON
-    notification_message(app->notifications, &sequence_display_backlight_enforce_on);
-#endif
+    app->last_input = furi_get_tick();
+    key_power_init(&app->power, app->last_input);
+    app->input_events = furi_record_open(RECORD_INPUT_EVENTS);
+    app->input_subscription =
+        furi_pubsub_subscribe(app->input_events, key_copier_input_events_callback, app);
 
     return app;
 }
 
 static void key_copier_app_free(KeyCopierApp* app) {
-#ifdef BACKLIGHT_ON
-    notification_message(app->notifications, &sequence_display_backlight_enforce_auto);
-#endif
-    furi_record_close(RECORD_NOTIFICATION);
+    // One last try for keyring keys the card would not take
+    key_copier_session_flush(app);
+    furi_string_free(app->session_notes);
+    furi_pubsub_unsubscribe(app->input_events, app->input_subscription);
+    furi_record_close(RECORD_INPUT_EVENTS);
 
     view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewTextInput);
     text_input_free(app->text_input);
@@ -773,27 +2283,65 @@ static void key_copier_app_free(KeyCopierApp* app) {
     view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewAbout);
     widget_free(app->widget_about);
     view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewMeasure);
-    with_view_model(
-        app->view_measure,
-        KeyCopierModel * model,
-        {
-            if(model->depth != NULL) {
-                free(model->depth);
-            }
-        },
-        false);
     view_free(app->view_measure);
+    furi_string_free(app->model->key_name_str);
+    free(app->model);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewCaliper);
+    view_free(app->view_caliper);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewCaliperBatch);
+    view_free(app->view_caliper_batch);
     view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewConfigure_e);
     view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewConfigure_i);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewSession);
+    view_free(app->view_session);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewSessionEnd);
+    view_free(app->view_session_end);
     view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewSave);
     view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewLoad);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewSearch);
+    view_free(app->view_search);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewSearchResults);
+    submenu_free(app->submenu_search);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewRename);
+    view_free(app->view_rename);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewReference);
+    view_free(app->view_reference);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewCodeLookup);
+    view_free(app->view_code_lookup);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewFindCode);
+    view_free(app->view_find_code);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewRekey);
+    view_free(app->view_rekey);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewCutQueue);
+    view_free(app->view_cut_queue);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewBackup);
+    view_free(app->view_backup);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewRestore);
+    view_free(app->view_restore);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewAnalyze);
+    view_free(app->view_analyze);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewTrace);
+    view_free(app->view_trace);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewStats);
+    view_free(app->view_stats);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewMemory);
+    view_free(app->view_memory);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewResult);
+    widget_free(app->widget_result);
     variable_item_list_free(app->variable_item_list_config);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewIdentify);
+    variable_item_list_free(app->variable_item_list_identify);
+    view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewMatches);
+    submenu_free(app->submenu_matches);
     view_dispatcher_remove_view(app->view_dispatcher, KeyCopierViewSubmenu);
     submenu_free(app->submenu);
     view_dispatcher_free(app->view_dispatcher);
+    furi_record_close(RECORD_NOTIFICATION);
     furi_record_close(RECORD_GUI);
 
     free(app);
+
+    key_memory_log();
 }
 
 int32_t main_key_copier_app(void* _p) {
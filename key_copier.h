@@ -1,3 +1,6 @@
+#ifndef KEY_COPIER_H
+#define KEY_COPIER_H
+
 #define KEY_COPIER_FILE_EXTENSION ".keycopy"
 #define INCHES_PER_PX 0.00978
 
@@ -7,4 +10,6 @@ static inline int min(int a, int b) {
 
 static inline int max(int a, int b) {
     return (a > b) ? a : b;
-}
\ No newline at end of file
+}
+
+#endif // KEY_COPIER_H
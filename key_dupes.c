@@ -0,0 +1,254 @@
+#include "key_dupes.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    KeyDupesEntry entries[KEY_DUPES_BUCKET_ENTRIES];
+} KeyDupesBucket;
+
+// The format index tells the same depths in two formats apart. It is mixed in after the
+// bitting is hashed: taken in with the words, it would land on the first pin, and depth d of
+// format a would hash as depth d ^ a ^ b of format b.
+uint32_t key_dupes_hash(uint32_t format_index, const KeyBitting* bitting) {
+    uint64_t hash = key_bitting_hash(bitting, 0) ^ format_index * 0x9E3779B97F4A7C15ULL;
+    uint32_t folded = (uint32_t)(hash ^ (hash >> 32));
+    return folded ? folded : 1;
+}
+
+static inline uint32_t key_dupes_bucket_offset(uint32_t bucket) {
+    return sizeof(KeyDupesHeader) + bucket * sizeof(KeyDupesBucket);
+}
+
+static inline uint32_t key_dupes_bucket_of(const KeyDupes* dupes, uint32_t hash) {
+    return hash & ((1u << dupes->header.bucket_bits) - 1);
+}
+
+static bool key_dupes_write_header(KeyDupes* dupes) {
+    return dupes->write(
+        KeyDupesPartBuckets, 0, &dupes->header, sizeof(KeyDupesHeader), dupes->context);
+}
+
+// Updates are bracketed by the dirty flag, as the name index does
+static KeyDupesStatus key_dupes_begin(KeyDupes* dupes) {
+    dupes->header.dirty = 1;
+    return key_dupes_write_header(dupes) ? KeyDupesOk : KeyDupesIoError;
+}
+
+// Full is found before anything is written, so it leaves the set as sound as Ok does
+static KeyDupesStatus key_dupes_end(KeyDupes* dupes, KeyDupesStatus status) {
+    if(status != KeyDupesOk && status != KeyDupesFull) return status;
+    dupes->header.dirty = 0;
+    return key_dupes_write_header(dupes) ? status : KeyDupesIoError;
+}
+
+static bool
+    key_dupes_read_bucket(const KeyDupes* dupes, uint32_t bucket, KeyDupesBucket* data) {
+    return dupes->read(
+        KeyDupesPartBuckets,
+        key_dupes_bucket_offset(bucket),
+        data,
+        sizeof(KeyDupesBucket),
+        dupes->context);
+}
+
+static bool key_dupes_write_bucket(KeyDupes* dupes, uint32_t bucket, const KeyDupesBucket* data) {
+    return dupes->write(
+        KeyDupesPartBuckets,
+        key_dupes_bucket_offset(bucket),
+        data,
+        sizeof(KeyDupesBucket),
+        dupes->context);
+}
+
+KeyDupesStatus key_dupes_open(
+    KeyDupes* dupes,
+    KeyDupesReadCallback read,
+    KeyDupesWriteCallback write,
+    void* context) {
+    dupes->read = read;
+    dupes->write = write;
+    dupes->context = context;
+    if(!read(KeyDupesPartBuckets, 0, &dupes->header, sizeof(KeyDupesHeader), context))
+        return KeyDupesIoError;
+    const KeyDupesHeader* header = &dupes->header;
+    if(header->magic != KEY_DUPES_MAGIC || header->version != KEY_DUPES_VERSION ||
+       header->dirty || header->bucket_bits > KEY_DUPES_MAX_BUCKET_BITS)
+        return KeyDupesCorrupt;
+    return KeyDupesOk;
+}
+
+KeyDupesStatus key_dupes_create(
+    KeyDupes* dupes,
+    KeyDupesReadCallback read,
+    KeyDupesWriteCallback write,
+    void* context) {
+    dupes->read = read;
+    dupes->write = write;
+    dupes->context = context;
+    memset(&dupes->header, 0, sizeof(KeyDupesHeader));
+    dupes->header.magic = KEY_DUPES_MAGIC;
+    dupes->header.version = KEY_DUPES_VERSION;
+    KeyDupesBucket* bucket = malloc(sizeof(KeyDupesBucket));
+    memset(bucket, 0, sizeof(KeyDupesBucket));
+    bool result = key_dupes_write_header(dupes) && key_dupes_write_bucket(dupes, 0, bucket);
+    free(bucket);
+    return result ? KeyDupesOk : KeyDupesIoError;
+}
+
+KeyDupesStatus key_dupes_find(
+    const KeyDupes* dupes,
+    uint32_t hash,
+    KeyDupesCallback callback,
+    void* context) {
+    KeyDupesBucket* bucket = malloc(sizeof(KeyDupesBucket));
+    KeyDupesStatus status = KeyDupesIoError;
+    if(key_dupes_read_bucket(dupes, key_dupes_bucket_of(dupes, hash), bucket)) {
+        status = KeyDupesNotFound;
+        for(uint8_t slot = 0; slot < KEY_DUPES_BUCKET_ENTRIES && bucket->entries[slot].hash;
+            slot++) {
+            const KeyDupesEntry* entry = &bucket->entries[slot];
+            if(entry->hash != hash) continue;
+            char name[KEY_NAMES_NAME_SIZE];
+            if(entry->record >= dupes->header.records) {
+                status = KeyDupesCorrupt;
+                break;
+            }
+            if(!dupes->read(
+                   KeyDupesPartNames,
+                   entry->record * KEY_NAMES_NAME_SIZE,
+                   name,
+                   sizeof(name),
+                   dupes->context)) {
+                status = KeyDupesIoError;
+                break;
+            }
+            name[KEY_NAMES_NAME_SIZE - 1] = '\0';
+            if(callback(name, entry->record, context)) {
+                status = KeyDupesOk;
+                break;
+            }
+        }
+    }
+    free(bucket);
+    return status;
+}
+
+static inline uint8_t key_dupes_bucket_size(const KeyDupesBucket* bucket) {
+    uint8_t size = 0;
+    while(size < KEY_DUPES_BUCKET_ENTRIES && bucket->entries[size].hash) size++;
+    return size;
+}
+
+static uint8_t key_dupes_hash_count(const KeyDupesBucket* bucket, uint32_t hash) {
+    uint8_t count = 0;
+    for(uint8_t slot = 0; slot < KEY_DUPES_BUCKET_ENTRIES && bucket->entries[slot].hash;
+        slot++) {
+        if(bucket->entries[slot].hash == hash) count++;
+    }
+    return count;
+}
+
+// Whether doubling would move any of a full bucket's entries, or the one being added, away
+// from the rest. Without this, entries that share every bit up to the max would double the
+// table again and again for nothing.
+static bool
+    key_dupes_splits(const KeyDupes* dupes, const KeyDupesBucket* bucket, uint32_t hash) {
+    const uint32_t bit = 1u << dupes->header.bucket_bits;
+    for(uint8_t slot = 0; slot < KEY_DUPES_BUCKET_ENTRIES; slot++) {
+        if((bucket->entries[slot].hash ^ hash) & bit) return true;
+    }
+    return false;
+}
+
+// Double the table, splitting every bucket with the one it gains. The new buckets land in order
+// past the end of the file, so it only ever grows by appending.
+static KeyDupesStatus key_dupes_grow(KeyDupes* dupes, KeyDupesBucket* low) {
+    if(dupes->header.bucket_bits == KEY_DUPES_MAX_BUCKET_BITS) return KeyDupesFull;
+    const uint32_t buckets = 1u << dupes->header.bucket_bits;
+    KeyDupesBucket* high = malloc(sizeof(KeyDupesBucket));
+    KeyDupesStatus status = KeyDupesOk;
+    for(uint32_t bucket = 0; bucket < buckets && status == KeyDupesOk; bucket++) {
+        if(!key_dupes_read_bucket(dupes, bucket, low)) {
+            status = KeyDupesIoError;
+            break;
+        }
+        uint8_t kept = 0;
+        uint8_t moved = 0;
+        memset(high, 0, sizeof(KeyDupesBucket));
+        for(uint8_t slot = 0; slot < KEY_DUPES_BUCKET_ENTRIES && low->entries[slot].hash;
+            slot++) {
+            KeyDupesEntry entry = low->entries[slot];
+            if(entry.hash & buckets) {
+                high->entries[moved++] = entry;
+            } else {
+                low->entries[kept++] = entry;
+            }
+        }
+        memset(&low->entries[kept], 0, (KEY_DUPES_BUCKET_ENTRIES - kept) * sizeof(KeyDupesEntry));
+        if(!key_dupes_write_bucket(dupes, bucket, low) ||
+           !key_dupes_write_bucket(dupes, bucket + buckets, high))
+            status = KeyDupesIoError;
+    }
+    free(high);
+    dupes->header.bucket_bits++;
+    return status;
+}
+
+KeyDupesStatus
+    key_dupes_add(KeyDupes* dupes, uint32_t hash, const char* name, uint32_t* record) {
+    char data[KEY_NAMES_NAME_SIZE];
+    memset(data, 0, sizeof(data));
+    strncpy(data, name, sizeof(data) - 1);
+    KeyDupesBucket* bucket = malloc(sizeof(KeyDupesBucket));
+    KeyDupesStatus status = key_dupes_begin(dupes);
+    uint32_t index = key_dupes_bucket_of(dupes, hash);
+    if(status == KeyDupesOk && !key_dupes_read_bucket(dupes, index, bucket))
+        status = KeyDupesIoError;
+    if(status == KeyDupesOk && key_dupes_hash_count(bucket, hash) >= KEY_DUPES_HASH_ENTRIES)
+        status = KeyDupesFull;
+    // A full bucket is rare with the hashes spread evenly: at 64 entries it takes most buckets
+    // being well over half full
+    while(status == KeyDupesOk && key_dupes_bucket_size(bucket) == KEY_DUPES_BUCKET_ENTRIES) {
+        if(!key_dupes_splits(dupes, bucket, hash)) {
+            status = KeyDupesFull;
+            break;
+        }
+        status = key_dupes_grow(dupes, bucket);
+        index = key_dupes_bucket_of(dupes, hash);
+        if(status == KeyDupesOk && !key_dupes_read_bucket(dupes, index, bucket))
+            status = KeyDupesIoError;
+    }
+    if(status == KeyDupesOk) {
+        KeyDupesEntry* entry = &bucket->entries[key_dupes_bucket_size(bucket)];
+        entry->hash = hash;
+        entry->record = dupes->header.records;
+        if(!dupes->write(
+               KeyDupesPartNames,
+               entry->record * KEY_NAMES_NAME_SIZE,
+               data,
+               sizeof(data),
+               dupes->context) ||
+           !key_dupes_write_bucket(dupes, index, bucket))
+            status = KeyDupesIoError;
+        if(record) *record = entry->record;
+        dupes->header.records++;
+    }
+    free(bucket);
+    return key_dupes_end(dupes, status);
+}
+
+KeyDupesStatus key_dupes_set_name(KeyDupes* dupes, uint32_t record, const char* name) {
+    if(record >= dupes->header.records) return KeyDupesNotFound;
+    char data[KEY_NAMES_NAME_SIZE];
+    memset(data, 0, sizeof(data));
+    strncpy(data, name, sizeof(data) - 1);
+    // One record is one write, so this needs no dirty flag
+    return dupes->write(
+               KeyDupesPartNames,
+               record * KEY_NAMES_NAME_SIZE,
+               data,
+               sizeof(data),
+               dupes->context) ?
+               KeyDupesOk :
+               KeyDupesIoError;
+}
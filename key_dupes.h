@@ -0,0 +1,109 @@
+#ifndef KEY_DUPES_H
+#define KEY_DUPES_H
+
+#include "key_bitting.h"
+#include "key_names.h"
+
+#define KEY_DUPES_BUCKET_ENTRIES 64
+#define KEY_DUPES_MAX_BUCKET_BITS 20
+// Names kept for one hash. Any of them will do to point at a key saved many times over, and a
+// bucket can't fill up with entries that no split would ever move apart.
+#define KEY_DUPES_HASH_ENTRIES 8
+#define KEY_DUPES_MAGIC 0x31444B4B // "KKD1"
+#define KEY_DUPES_VERSION 2
+
+// A hash set of the saved keys' formats and bittings, so a save can tell in one read whether
+// the same key is already in the library, and under which name. Backups key their manifest the
+// same way by name hash. It is two files. The bucket file
+// is the header and then 1 << bucket_bits buckets of KEY_DUPES_BUCKET_ENTRIES entries, filled
+// from the front; a key goes in the bucket of the low bits of its hash. When one is full the
+// table doubles in place: bucket i keeps the entries whose next hash bit is clear and hands the
+// rest to the new bucket i + (1 << bucket_bits). It only doubles when that bit splits the full
+// bucket; otherwise the add is Full. The name file holds a KEY_NAMES_NAME_SIZE
+// record per entry. Hashes only point at candidates; the key file of a name says whether it is
+// really the same key, so stale entries of renamed or deleted keys do no harm.
+typedef enum {
+    KeyDupesPartBuckets,
+    KeyDupesPartNames,
+} KeyDupesPart;
+
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t dirty; // set while an update is under way, so one cut short is never trusted
+    uint8_t bucket_bits;
+    uint8_t reserved;
+    uint32_t records; // in the name file
+} KeyDupesHeader;
+
+typedef struct {
+    uint32_t hash; // 0 for an empty entry
+    uint32_t record;
+} KeyDupesEntry;
+
+typedef enum {
+    KeyDupesOk,
+    KeyDupesNotFound,
+    KeyDupesCorrupt, // bad header, or an update did not finish
+    KeyDupesFull,
+    KeyDupesIoError,
+} KeyDupesStatus;
+
+// Positional access to either part of the set, so this code does not depend on where it lives
+typedef bool (*KeyDupesReadCallback)(
+    KeyDupesPart part,
+    uint32_t offset,
+    void* data,
+    size_t size,
+    void* context);
+typedef bool (*KeyDupesWriteCallback)(
+    KeyDupesPart part,
+    uint32_t offset,
+    const void* data,
+    size_t size,
+    void* context);
+
+// Called with each name saved under a hash and the record that holds it. Return true when it is
+// the key looked for, which ends the search.
+typedef bool (*KeyDupesCallback)(const char* name, uint32_t record, void* context);
+
+typedef struct {
+    KeyDupesReadCallback read;
+    KeyDupesWriteCallback write;
+    void* context;
+    KeyDupesHeader header;
+} KeyDupes;
+
+// Never 0
+uint32_t key_dupes_hash(uint32_t format_index, const KeyBitting* bitting);
+
+KeyDupesStatus key_dupes_open(
+    KeyDupes* dupes,
+    KeyDupesReadCallback read,
+    KeyDupesWriteCallback write,
+    void* context);
+
+// Start a new, empty set over whatever the files held
+KeyDupesStatus key_dupes_create(
+    KeyDupes* dupes,
+    KeyDupesReadCallback read,
+    KeyDupesWriteCallback write,
+    void* context);
+
+// One bucket read, then one name record read per entry of the same hash, of which there are at
+// most KEY_DUPES_HASH_ENTRIES. Ok once callback returns true, NotFound if it never does.
+KeyDupesStatus key_dupes_find(
+    const KeyDupes* dupes,
+    uint32_t hash,
+    KeyDupesCallback callback,
+    void* context);
+
+// The new entry's record goes in record, when that is not NULL. Full leaves the set as it was,
+// when the hash has KEY_DUPES_HASH_ENTRIES names already or its bucket can't split.
+KeyDupesStatus
+    key_dupes_add(KeyDupes* dupes, uint32_t hash, const char* name, uint32_t* record);
+
+// Point the entry of a record at another name, for a renamed key or to reuse a stale entry
+KeyDupesStatus key_dupes_set_name(KeyDupes* dupes, uint32_t record, const char* name);
+
+#endif // KEY_DUPES_H
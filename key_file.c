@@ -0,0 +1,298 @@
+#include "key_file.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEY_FILE_CHUNK_SIZE 64
+// Long enough for every key and every value we read; longer values are cut and flagged
+#define KEY_FILE_FIELD_SIZE 48
+
+typedef enum {
+    KeyFileFieldOther,
+    KeyFileFieldType,
+    KeyFileFieldVersion,
+    KeyFileFieldFormat,
+    KeyFileFieldPins,
+    KeyFileFieldBitting,
+    KeyFileFieldHistoryPosition,
+    KeyFileFieldHistory,
+} KeyFileField;
+
+typedef struct {
+    char text[KEY_FILE_FIELD_SIZE]; // the key, then the value of the current line
+    uint8_t length;
+    bool truncated;
+    bool in_value;
+    KeyFileField field;
+
+    bool has_type;
+    uint32_t version; // 0 until the Version line
+    int32_t format_index;
+    uint32_t pin_num; // 0 when the file gives none
+
+    // The bitting is parsed as it streams past, so no line buffer has to hold it
+    bool has_bitting;
+    bool bad_bitting;
+    bool in_depth;
+    uint8_t base;
+    uint8_t depth_num;
+    uint8_t depths[KEY_BITTING_MAX_PINS];
+
+    // History steps go straight into the caller's history as they are read
+    KeyHistory* history;
+    bool has_history;
+    bool bad_history;
+    uint32_t history_position;
+    uint8_t entry_digits;
+    uint16_t entry;
+} KeyFileParser;
+
+static int key_file_digit(char c, uint8_t base) {
+    int digit = -1;
+    if(c >= '0' && c <= '9') digit = c - '0';
+    if(c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+    if(c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+    return digit < base ? digit : -1;
+}
+
+static KeyFileField key_file_field(const char* key) {
+    if(!strcmp(key, "Filetype")) return KeyFileFieldType;
+    if(!strcmp(key, "Version")) return KeyFileFieldVersion;
+    if(!strcmp(key, "Format Name")) return KeyFileFieldFormat;
+    if(!strcmp(key, "Number of Pins")) return KeyFileFieldPins;
+    if(!strcmp(key, "Bitting Pattern")) return KeyFileFieldBitting;
+    if(!strcmp(key, "History Position")) return KeyFileFieldHistoryPosition;
+    if(!strcmp(key, "History")) return KeyFileFieldHistory;
+    return KeyFileFieldOther;
+}
+
+static void key_file_bitting_char(KeyFileParser* parser, char c) {
+    int digit = key_file_digit(c, parser->base);
+    if(digit < 0) {
+        // v1 files were read by skipping anything that is not a digit, so any other
+        // character still separates depths
+        parser->in_depth = false;
+        return;
+    }
+    if(!parser->in_depth) {
+        if(parser->depth_num == KEY_BITTING_MAX_PINS) {
+            parser->bad_bitting = true;
+            return;
+        }
+        parser->depths[parser->depth_num++] = 0;
+        parser->in_depth = true;
+    }
+    uint8_t* depth = &parser->depths[parser->depth_num - 1];
+    if(*depth * parser->base + digit > KEY_BITTING_MAX_DEPTH) {
+        parser->bad_bitting = true;
+        return;
+    }
+    *depth = *depth * parser->base + digit;
+}
+
+static void key_file_end_entry(KeyFileParser* parser) {
+    if(parser->entry_digits && !key_history_append(parser->history, parser->entry))
+        parser->bad_history = true;
+    parser->entry_digits = 0;
+    parser->entry = 0;
+}
+
+// Steps are four hex digits each, separated by spaces
+static void key_file_history_char(KeyFileParser* parser, char c) {
+    int digit = key_file_digit(c, 16);
+    if(digit < 0) {
+        key_file_end_entry(parser);
+    } else if(parser->entry_digits == 4) {
+        parser->bad_history = true;
+    } else {
+        parser->entry = parser->entry << 4 | digit;
+        parser->entry_digits++;
+    }
+}
+
+static void key_file_end_line(KeyFileParser* parser) {
+    if(parser->in_value && parser->field == KeyFileFieldHistory) key_file_end_entry(parser);
+    if(parser->in_value && !parser->truncated) {
+        char* value = parser->text;
+        while(parser->length > 0 && (value[parser->length - 1] == ' ' ||
+                                     value[parser->length - 1] == '\r'))
+            parser->length--;
+        value[parser->length] = '\0';
+        switch(parser->field) {
+        case KeyFileFieldType:
+            parser->has_type = !strcmp(value, KEY_FILE_TYPE);
+            break;
+        case KeyFileFieldVersion:
+            parser->version = strtoul(value, NULL, 10);
+            break;
+        case KeyFileFieldFormat:
+            parser->format_index = key_format_find(value);
+            break;
+        case KeyFileFieldPins:
+            parser->pin_num = strtoul(value, NULL, 10);
+            break;
+        case KeyFileFieldHistoryPosition:
+            parser->history_position = strtoul(value, NULL, 10);
+            break;
+        default:
+            break;
+        }
+    }
+    parser->length = 0;
+    parser->truncated = false;
+    parser->in_value = false;
+    parser->in_depth = false;
+}
+
+static void key_file_char(KeyFileParser* parser, char c) {
+    if(c == '\n') {
+        key_file_end_line(parser);
+    } else if(!parser->in_value) {
+        if(c == ':') {
+            parser->text[parser->length] = '\0';
+            parser->field = parser->truncated ? KeyFileFieldOther : key_file_field(parser->text);
+            parser->length = 0;
+            parser->truncated = false;
+            parser->in_value = true;
+            if(parser->field == KeyFileFieldBitting) {
+                parser->has_bitting = true;
+                parser->bad_bitting = false;
+                parser->depth_num = 0;
+                parser->base = parser->version >= 2 ? 16 : 10;
+            }
+            if(parser->field == KeyFileFieldHistory) {
+                if(parser->history) {
+                    key_history_init(parser->history);
+                    parser->has_history = true;
+                    parser->bad_history = false;
+                } else {
+                    parser->field = KeyFileFieldOther;
+                }
+            }
+        } else if(parser->length < KEY_FILE_FIELD_SIZE - 1) {
+            parser->text[parser->length++] = c;
+        } else {
+            parser->truncated = true;
+        }
+    } else if(parser->field == KeyFileFieldBitting) {
+        key_file_bitting_char(parser, c);
+    } else if(parser->field == KeyFileFieldHistory) {
+        key_file_history_char(parser, c);
+    } else if(parser->field != KeyFileFieldOther) {
+        if(parser->length == 0 && c == ' ') return;
+        if(parser->length < KEY_FILE_FIELD_SIZE - 1) {
+            parser->text[parser->length++] = c;
+        } else {
+            parser->truncated = true;
+        }
+    }
+}
+
+KeyFileStatus key_file_parse(
+    KeyFileRead read,
+    void* context,
+    uint32_t* format_index,
+    KeyBitting* bitting,
+    KeyHistory* history) {
+    KeyFileParser parser;
+    memset(&parser, 0, sizeof(parser));
+    parser.format_index = -1;
+    parser.history = history;
+    if(history) key_history_init(history);
+    char chunk[KEY_FILE_CHUNK_SIZE];
+    size_t size;
+    while((size = read(chunk, sizeof(chunk), context)) > 0) {
+        for(size_t i = 0; i < size; i++) {
+            key_file_char(&parser, chunk[i]);
+        }
+    }
+    key_file_end_line(&parser); // the last line may have no line break
+
+    if(!parser.has_type || parser.version < 1 || parser.version > KEY_FILE_VERSION)
+        return KeyFileBadHeader;
+    if(parser.format_index < 0) return KeyFileUnknownFormat;
+    KeyFormat format;
+    key_format_load(parser.format_index, &format);
+    if(!parser.has_bitting || parser.bad_bitting || parser.depth_num != format.pin_num ||
+       (parser.pin_num && parser.pin_num != format.pin_num))
+        return KeyFileBadBitting;
+    KeyBitting parsed = {0};
+    for(uint8_t pin = 0; pin < format.pin_num; pin++) {
+        key_bitting_set(&parsed, pin, parser.depths[pin]);
+    }
+    if(!key_bitting_in_range(&parsed, format.pin_num, format.min_depth_ind, format.max_depth_ind))
+        return KeyFileOutOfRange;
+    // Version 1 was written before the measure screen kept to the MACS, so those keys load as
+    // they were saved
+    if(parser.version >= 2 && key_bitting_macs_violations(&parsed, format.pin_num, format.macs))
+        return KeyFileMacs;
+    // A history that does not fit the key is dropped rather than failing the load
+    if(history && (!parser.has_history || parser.bad_history ||
+                   !key_history_restore(history, parser.history_position, &parsed, &format)))
+        key_history_init(history);
+    *format_index = parser.format_index;
+    *bitting = parsed;
+    return KeyFileOk;
+}
+
+static bool key_file_write_field(
+    KeyFileWrite write,
+    void* context,
+    const char* key,
+    const char* value) {
+    return write(key, strlen(key), context) && write(": ", 2, context) &&
+           write(value, strlen(value), context) && write("\n", 1, context);
+}
+
+static bool
+    key_file_write_number(KeyFileWrite write, void* context, const char* key, uint32_t value) {
+    char number[12];
+    snprintf(number, sizeof(number), "%lu", (unsigned long)value);
+    return key_file_write_field(write, context, key, number);
+}
+
+static bool key_file_write_history(KeyFileWrite write, void* context, const KeyHistory* history) {
+    uint16_t first;
+    uint16_t end;
+    key_history_span(history, &first, &end);
+    if(first == end) return true;
+    if(!key_file_write_number(write, context, "History Position", history->position - first) ||
+       !write("History:", 8, context))
+        return false;
+    for(uint16_t index = first; index < end; index++) {
+        char entry[6];
+        snprintf(entry, sizeof(entry), " %04X", key_history_entry(history, index));
+        if(!write(entry, 5, context)) return false;
+    }
+    return write("\n", 1, context);
+}
+
+bool key_file_write(
+    uint32_t format_index,
+    const KeyBitting* bitting,
+    const KeyHistory* history,
+    KeyFileWrite write,
+    void* context) {
+    const KeyFormatInfo* info = &key_format_info[format_index];
+    uint8_t pin_num = key_format_catalog.pin_num[format_index];
+    char pattern[KEY_BITTING_MAX_PINS * 2];
+    size_t length = 0;
+    for(uint8_t pin = 0; pin < pin_num; pin++) {
+        if(pin > 0) pattern[length++] = '-';
+        pattern[length++] = "0123456789ABCDEF"[key_bitting_get(bitting, pin)];
+    }
+    pattern[length] = '\0';
+    return key_file_write_field(write, context, "Filetype", KEY_FILE_TYPE) &&
+           key_file_write_number(write, context, "Version", KEY_FILE_VERSION) &&
+           key_file_write_field(write, context, "Manufacturer", info->manufacturer) &&
+           key_file_write_field(write, context, "Format Name", info->format_name) &&
+           key_file_write_field(write, context, "Data Sheet", info->format_link) &&
+           key_file_write_number(write, context, "Number of Pins", pin_num) &&
+           key_file_write_number(
+               write,
+               context,
+               "Maximum Adjacent Cut Specification (MACS)",
+               key_format_catalog.macs[format_index]) &&
+           key_file_write_field(write, context, "Bitting Pattern", pattern) &&
+           (!history || key_file_write_history(write, context, history));
+}
@@ -0,0 +1,53 @@
+#ifndef KEY_FILE_H
+#define KEY_FILE_H
+
+#include "key_bitting.h"
+#include "key_formats.h"
+#include "key_history.h"
+
+// Saved keys are Flipper Format text:
+//   Filetype: Flipper Key Copier File
+//   Version: 2
+//   Manufacturer, Format Name, Data Sheet, Number of Pins and MACS lines
+//   Bitting Pattern: 1-A-3-5-2
+//   History Position: 2
+//   History: 0213 0302 0223
+// Version 1 files write each depth in decimal; version 2 writes one hex digit per depth. The
+// history lines are optional: the depth steps of the key as packed by key_history, of which
+// History Position have been made.
+#define KEY_FILE_TYPE "Flipper Key Copier File"
+#define KEY_FILE_VERSION 2
+
+typedef enum {
+    KeyFileOk,
+    KeyFileIoError,
+    KeyFileBadHeader, // not a key file, or a version this build does not know
+    KeyFileUnknownFormat,
+    KeyFileBadBitting, // missing, unreadable or not pin_num depths
+    KeyFileOutOfRange, // a depth outside the format
+    KeyFileMacs, // adjacent depths further apart than the format allows
+} KeyFileStatus;
+
+// Fill data with up to size bytes of the file; return 0 at the end
+typedef size_t (*KeyFileRead)(void* data, size_t size, void* context);
+typedef bool (*KeyFileWrite)(const char* text, size_t size, void* context);
+
+// Read a saved key in one pass through a small stack buffer, without touching the heap. Nothing
+// is written to format_index and bitting unless the key is valid for its format. history may be
+// NULL; otherwise it is left empty unless the file has a history that leads to its bitting.
+KeyFileStatus key_file_parse(
+    KeyFileRead read,
+    void* context,
+    uint32_t* format_index,
+    KeyBitting* bitting,
+    KeyHistory* history);
+
+// Write a key in the current version, with the history of its bitting when history is not NULL
+bool key_file_write(
+    uint32_t format_index,
+    const KeyBitting* bitting,
+    const KeyHistory* history,
+    KeyFileWrite write,
+    void* context);
+
+#endif // KEY_FILE_H
@@ -1,455 +1,182 @@
 #include "key_formats.h"
+#include <string.h>
+
 // all lengths in inches since it's all American formats
 // angle is in degrees
-const KeyFormat all_formats[] = {
-    {.manufacturer = "Kwikset",
-     .format_name = "KW1",
-     .format_link = "https://lsamichigan.org/Tech/Kwikset_KeySpecs.pdf",
-     .first_pin_inch = 0.247,
-     .last_pin_inch = 0.847,
-     .pin_increment_inch = 0.15,
-     .pin_num = 5,
-     .pin_width_inch = 0.084,
-     .elbow_inch = 0.15,
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.329,
-     .deepest_depth_inch = 0.191,
-     .depth_step_inch = 0.023,
-     .min_depth_ind = 1,
-     .max_depth_ind = 7,
-     .macs = 4,
-     .clearance = 3},
-
-    {.manufacturer = "Schlage",
-     .format_name = "SC4",
-     .format_link = "https://lsamichigan.org/Tech/SCHLAGE_KeySpecs.pdf",
-     .first_pin_inch = 0.231,
-     .last_pin_inch = 1.012,
-     .pin_increment_inch = 0.1562,
-     .pin_num = 6,
-     .pin_width_inch = 0.031,
-     .elbow_inch = 0.1,
-     .drill_angle = 90, // This should actually be 100 but the current resolution will make
-     // 100 degrees very ugly and unsuable
-     .uncut_depth_inch = 0.335,
-     .deepest_depth_inch = 0.2,
-     .depth_step_inch = 0.015,
-     .min_depth_ind = 0,
-     .max_depth_ind = 9,
-     .macs = 7,
-     .clearance = 8},
-
-    {.manufacturer = "Arrow",
-     .format_name = "AR4",
-     .format_link = "C2",
-     .first_pin_inch = 0.265,
-     .last_pin_inch = 1.040,
-     .pin_increment_inch = 0.155,
-     .pin_num = 6,
-     .pin_width_inch = 0.060,
-     .elbow_inch = 0.1,
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.312,
-     .deepest_depth_inch = 0.186,
-     .depth_step_inch = 0.014,
-     .min_depth_ind = 0,
-     .max_depth_ind = 9,
-     .macs = 6,
-     .clearance = 7},
-
-    {.manufacturer = "Master Lock",
-     .format_name = "M1",
-     .format_link = "C35",
-     .first_pin_inch = 0.185,
-     .last_pin_inch = 0.689,
-     .pin_increment_inch = 0.126,
-     .pin_num = 5,
-     .pin_width_inch = 0.039,
-     .elbow_inch = 0.1,
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.276,
-     .deepest_depth_inch = 0.171,
-     .depth_step_inch = 0.015,
-     .min_depth_ind = 0,
-     .max_depth_ind = 7,
-     .macs = 7,
-     .clearance = 6},
-
-    {.manufacturer = "American",
-     .format_name = "AM7",
-     .format_link = "C80",
-     .first_pin_inch = 0.157,
-     .last_pin_inch = 0.781,
-     .pin_increment_inch = 0.125,
-     .pin_num = 6,
-     .pin_width_inch = 0.039,
-     .elbow_inch = 0.1,
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.283,
-     .deepest_depth_inch = 0.173,
-     .depth_step_inch = 0.016,
-     .min_depth_ind = 1,
-     .max_depth_ind = 8,
-     .macs = 7,
-     .clearance = 5},
-
-    {.manufacturer = "Yale",
-     .format_name = "Y2",
-     .format_link = "C57",
-     .first_pin_inch = 0.200,
-     .last_pin_inch = 1.025,
-     .pin_increment_inch = 0.165,
-     .pin_num = 6,
-     .pin_width_inch = 0.054,
-     .elbow_inch = 0.1,
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.320,
-     .deepest_depth_inch = 0.149,
-     .depth_step_inch = 0.019,
-     .min_depth_ind = 0,
-     .max_depth_ind = 9,
-     .macs = 9,
-     .clearance = 4},
-
-    {.manufacturer = "Yale",
-     .format_name = "Y11",
-     .format_link = "CX55",
-     .first_pin_inch = 0.124,
-     .last_pin_inch = 0.502,
-     .pin_increment_inch = 0.095,
-     .pin_num = 5,
-     .pin_width_inch = 0.039,
-     .elbow_inch = 0.1,
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.246,
-     .deepest_depth_inch = 0.167,
-     .depth_step_inch = 0.020,
-     .min_depth_ind = 1,
-     .max_depth_ind = 5,
-     .macs = 7,
-     .clearance = 3},
-
-    {.manufacturer = "Sargent",
-     .format_name = "S22",
-     .format_link = "C44",
-     .first_pin_inch = 0.216,
-     .last_pin_inch = 0.996,
-     .pin_increment_inch = 0.156,
-     .pin_num = 6,
-     .pin_width_inch = 0.063,
-     .elbow_inch = 0.1,
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.328, // double check
-     .deepest_depth_inch = 0.148,
-     .depth_step_inch = 0.020,
-     .min_depth_ind = 1,
-     .max_depth_ind = 10,
-     .macs = 7,
-     .clearance = 5},
-
-    {.manufacturer = "National",
-     .format_name = "NA25",
-     .format_link = "C40",
-     .first_pin_inch = 0.250,
-     .last_pin_inch = 0.874,
-     .pin_increment_inch = 0.156,
-     .pin_num = 5,
-     .pin_width_inch = 0.039,
-     .elbow_inch = 0.1,
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.304,
-     .deepest_depth_inch = 0.191,
-     .depth_step_inch = 0.012,
-     .min_depth_ind = 0,
-     .max_depth_ind = 9,
-     .macs = 7,
-     .clearance = 8},
-
-    {.manufacturer = "Corbin",
-     .format_name = "CO88",
-     .format_link = "C14",
-     .first_pin_inch = 0.250,
-     .last_pin_inch = 1.030,
-     .pin_increment_inch = 0.156,
-     .pin_num = 6,
-     .pin_width_inch = 0.047,
-     .elbow_inch = 0.1,
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.343,
-     .deepest_depth_inch = 0.217,
-     .depth_step_inch = 0.014,
-     .min_depth_ind = 1,
-     .max_depth_ind = 10,
-     .macs = 7,
-     .clearance = 8},
-
-    {.manufacturer = "Lockwood",
-     .format_name = "LW4",
-     .format_link = "",
-     .first_pin_inch = 0.245,
-     .last_pin_inch = 0.870,
-     .pin_increment_inch = 0.1562,
-     .pin_num = 5,
-     .pin_width_inch = 0.031,
-     .elbow_inch = 0.1,
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.344,
-     .deepest_depth_inch = 0.203,
-     .depth_step_inch = 0.014,
-     .min_depth_ind = 0,
-     .max_depth_ind = 9,
-     .macs = 9,
-     .clearance = 8},
-
-    {.manufacturer = "Lockwood",
-     .format_name = "LW5",
-     .format_link = "",
-     .first_pin_inch = 0.245,
-     .last_pin_inch = 1.0262,
-     .pin_increment_inch = 0.1562,
-     .pin_num = 6,
-     .pin_width_inch = 0.031,
-     .elbow_inch = 0.1,
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.344,
-     .deepest_depth_inch = 0.203,
-     .depth_step_inch = 0.014,
-     .min_depth_ind = 0,
-     .max_depth_ind = 9,
-     .macs = 9,
-     .clearance = 8},
-
-    {.manufacturer = "National",
-     .format_name = "NA12",
-     .format_link = "C39",
-     .first_pin_inch = 0.150,
-     .last_pin_inch = 0.710,
-     .pin_increment_inch = 0.140,
-     .pin_num = 5,
-     .pin_width_inch = 0.039,
-     .elbow_inch = 0.1,
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.270,
-     .deepest_depth_inch = 0.157,
-     .depth_step_inch = 0.013,
-     .min_depth_ind = 0,
-     .max_depth_ind = 9,
-     .macs = 7,
-     .clearance = 8},
-
-    {.manufacturer = "Russwin",
-     .format_name = "RU45",
-     .format_link = "CX6",
-     .first_pin_inch = 0.250,
-     .last_pin_inch = 1.030,
-     .pin_increment_inch = 0.156,
-     .pin_num = 6,
-     .pin_width_inch = 0.053,
-     .elbow_inch = 0.1,
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.343,
-     .deepest_depth_inch = 0.203,
-     .depth_step_inch = 0.028,
-     .min_depth_ind = 1,
-     .max_depth_ind = 6,
-     .macs = 5,
-     .clearance = 3},
-
-    {.manufacturer = "Ford",
-     .format_name = "H75",
-     .sides = 2,
-     .stop = 2,
-     .format_link = "CX101",
-     .first_pin_inch = 0.201,
-     .last_pin_inch = 0.845,
-     .pin_increment_inch = 0.092,
-     .pin_num = 8,
-     .pin_width_inch = 0.039,
-     .elbow_inch = 0.201, // this should be equal to first pin inch for tip
-     // stopped key line
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.354,
-     .deepest_depth_inch = 0.254,
-     .depth_step_inch = 0.025,
-     .min_depth_ind = 1,
-     .max_depth_ind = 5,
-     .macs = 5,
-     .clearance = 2},
-
-    {.manufacturer = "Chevrolet",
-     .format_name = "B102",
-     .sides = 2,
-     .stop = 2,
-     .format_link = "",
-     .first_pin_inch = 0.205,
-     .last_pin_inch = 1.037,
-     .pin_increment_inch = 0.093,
-     .pin_num = 10,
-     .pin_width_inch = 0.039,
-     .elbow_inch = 0.205, // this should be equal to first pin inch for tip
-     // stopped key line
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.315,
-     .deepest_depth_inch = 0.161,
-     .depth_step_inch = 0.026,
-     .min_depth_ind = 1,
-     .max_depth_ind = 4,
-     .macs = 5,
-     .clearance = 2},
-
-    {.manufacturer = "Dodge",
-     .format_name = "Y159",
-     .sides = 2,
-     .stop = 2,
-     .format_link = "CX102",
-     .first_pin_inch = 0.297,
-     .last_pin_inch = 0.941,
-     .pin_increment_inch = 0.092,
-     .pin_num = 8,
-     .pin_width_inch = 0.039,
-     .elbow_inch = 0.297, // this should be equal to first pin inch for tip
-     // stopped key line
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.339,
-     .deepest_depth_inch = 0.197,
-     .depth_step_inch = 0.047,
-     .min_depth_ind = 1,
-     .max_depth_ind = 4,
-     .macs = 5,
-     .clearance = 1},
-
-    {.manufacturer = "Kawasaki",
-     .format_name = "KA14",
-     .sides = 2,
-     .format_link = "CMC50",
-     .first_pin_inch = 0.098,
-     .last_pin_inch = 0.591,
-     .pin_increment_inch = 0.098,
-     .pin_num = 6,
-     .pin_width_inch = 0.039,
-     .elbow_inch = 0.1, // this should be equal to first pin inch for tip
-     // stopped key line
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.258,
-     .deepest_depth_inch = 0.198,
-     .depth_step_inch = 0.020,
-     .min_depth_ind = 1,
-     .max_depth_ind = 4,
-     .macs = 4,
-     .clearance = 3},
-
-    {.manufacturer = "Yamaha",
-     .format_name = "YM63",
-     .sides = 2,
-     .format_link = "CMC71",
-     .first_pin_inch = 0.157,
-     .last_pin_inch = 0.748,
-     .pin_increment_inch = 0.098,
-     .pin_num = 7,
-     .pin_width_inch = 0.039,
-     .elbow_inch = 0.1, // this should be equal to first pin inch for tip
-     // stopped key line
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.295,
-     .deepest_depth_inch = 0.236,
-     .depth_step_inch = 0.020,
-     .min_depth_ind = 1,
-     .max_depth_ind = 4,
-     .macs = 4,
-     .clearance = 3},
-
-    {.manufacturer = "Best (A2)",
-     .format_name = "SFIC",
-     .stop = 2,
-     .format_link = "C3",
-     .first_pin_inch = 0.250,
-     .last_pin_inch = 0.998,
-     .pin_increment_inch = 0.149,
-     .pin_num = 6,
-     .pin_width_inch = 0.051,
-     .elbow_inch = 0.081, // this should be equal to first pin inch for tip
-     // stopped key line
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.318,
-     .deepest_depth_inch = 0.206,
-     .depth_step_inch = 0.025,
-     .min_depth_ind = 0,
-     .max_depth_ind = 9,
-     .macs = 5,
-     .clearance = 3},
-
-    {.manufacturer = "RV (FIC,GL,Bauer)",
-     .format_name = "RV",
-     .sides = 2,
-     .format_link = "Card",
-     .first_pin_inch = 0.126,
-     .last_pin_inch = 0.504,
-     .pin_increment_inch = 0.094,
-     .pin_num = 5,
-     .pin_width_inch = 0.039,
-     .elbow_inch = 0.126, // this should be equal to first pin inch for tip
-     // stopped key line
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.260,
-     .deepest_depth_inch = 0.181,
-     .depth_step_inch = 0.040,
-     .min_depth_ind = 1,
-     .max_depth_ind = 3,
-     .macs = 3,
-     .clearance = 1},
-
-    {.manufacturer = "Vachette",
-     .format_name = "V5",
-     .format_link = "Card",
-     .first_pin_inch = 0.247,
-     .last_pin_inch = 0.847,
-     .pin_increment_inch = 0.15,
-     .pin_num = 5,
-     .pin_width_inch = 0.084,
-     .elbow_inch = 0.15,
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.329,
-     .deepest_depth_inch = 0.191,
-     .depth_step_inch = 0.023,
-     .min_depth_ind = 1,
-     .max_depth_ind = 7,
-     .macs = 4,
-     .clearance = 3},
-
-    {.manufacturer = "City",
-     .format_name = "5G",
-     .format_link = "Card",
-     .first_pin_inch = 0.247,
-     .last_pin_inch = 0.847,
-     .pin_increment_inch = 0.15,
-     .pin_num = 5,
-     .pin_width_inch = 0.084,
-     .elbow_inch = 0.15,
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.329,
-     .deepest_depth_inch = 0.191,
-     .depth_step_inch = 0.023,
-     .min_depth_ind = 1,
-     .max_depth_ind = 7,
-     .macs = 4,
-     .clearance = 3},
-
-    {.manufacturer = "TESA",
-     .format_name = "TE5",
-     .format_link = "Card",
-     .first_pin_inch = 0.247,
-     .last_pin_inch = 0.847,
-     .pin_increment_inch = 0.15,
-     .pin_num = 5,
-     .pin_width_inch = 0.084,
-     .elbow_inch = 0.15,
-     .drill_angle = 90,
-     .uncut_depth_inch = 0.329,
-     .deepest_depth_inch = 0.191,
-     .depth_step_inch = 0.023,
-     .min_depth_ind = 1,
-     .max_depth_ind = 7,
-     .macs = 4,
-     .clearance = 3},
-
+// sides: 1 single sided, 2 double sided. stop: 1 shoulder stopped, 2 tip stopped
+// clang-format off
+#define KEY_FORMAT_TABLE(X) \
+    /* manufacturer, format_name, format_link, sides, stop, */ \
+    /* first_pin, last_pin, pin_increment, pin_num, pin_width, drill_angle, elbow, */ \
+    /* uncut_depth, deepest_depth, depth_step, min_depth_ind, max_depth_ind, macs, clearance */ \
+    X("Kwikset", "KW1", "https://lsamichigan.org/Tech/Kwikset_KeySpecs.pdf", 1, 1, \
+      0.247, 0.847, 0.15, 5, 0.084, 90, 0.15, \
+      0.329, 0.191, 0.023, 1, 7, 4, 3) \
+    X("Schlage", "SC4", "https://lsamichigan.org/Tech/SCHLAGE_KeySpecs.pdf", 1, 1, \
+      0.231, 1.012, 0.1562, 6, 0.031, 100, 0.1, \
+      0.335, 0.2, 0.015, 0, 9, 7, 8) \
+    X("Arrow", "AR4", "C2", 1, 1, \
+      0.265, 1.040, 0.155, 6, 0.060, 90, 0.1, \
+      0.312, 0.186, 0.014, 0, 9, 6, 7) \
+    X("Master Lock", "M1", "C35", 1, 1, \
+      0.185, 0.689, 0.126, 5, 0.039, 90, 0.1, \
+      0.276, 0.171, 0.015, 0, 7, 7, 6) \
+    X("American", "AM7", "C80", 1, 1, \
+      0.157, 0.781, 0.125, 6, 0.039, 90, 0.1, \
+      0.283, 0.173, 0.016, 1, 8, 7, 5) \
+    X("Yale", "Y2", "C57", 1, 1, \
+      0.200, 1.025, 0.165, 6, 0.054, 90, 0.1, \
+      0.320, 0.149, 0.019, 0, 9, 9, 4) \
+    X("Yale", "Y11", "CX55", 1, 1, \
+      0.124, 0.502, 0.095, 5, 0.039, 90, 0.1, \
+      0.246, 0.167, 0.020, 1, 5, 7, 3) \
+    /* S22 uncut depth: double check */ \
+    X("Sargent", "S22", "C44", 1, 1, \
+      0.216, 0.996, 0.156, 6, 0.063, 90, 0.1, \
+      0.328, 0.148, 0.020, 1, 10, 7, 5) \
+    X("National", "NA25", "C40", 1, 1, \
+      0.250, 0.874, 0.156, 5, 0.039, 90, 0.1, \
+      0.304, 0.191, 0.012, 0, 9, 7, 8) \
+    X("Corbin", "CO88", "C14", 1, 1, \
+      0.250, 1.030, 0.156, 6, 0.047, 90, 0.1, \
+      0.343, 0.217, 0.014, 1, 10, 7, 8) \
+    X("Lockwood", "LW4", "", 1, 1, \
+      0.245, 0.870, 0.1562, 5, 0.031, 90, 0.1, \
+      0.344, 0.203, 0.014, 0, 9, 9, 8) \
+    X("Lockwood", "LW5", "", 1, 1, \
+      0.245, 1.0262, 0.1562, 6, 0.031, 90, 0.1, \
+      0.344, 0.203, 0.014, 0, 9, 9, 8) \
+    X("National", "NA12", "C39", 1, 1, \
+      0.150, 0.710, 0.140, 5, 0.039, 90, 0.1, \
+      0.270, 0.157, 0.013, 0, 9, 7, 8) \
+    X("Russwin", "RU45", "CX6", 1, 1, \
+      0.250, 1.030, 0.156, 6, 0.053, 90, 0.1, \
+      0.343, 0.203, 0.028, 1, 6, 5, 3) \
+    /* For tip stopped keys the elbow should be equal to the first pin for the stop line */ \
+    X("Ford", "H75", "CX101", 2, 2, \
+      0.201, 0.845, 0.092, 8, 0.039, 90, 0.201, \
+      0.354, 0.254, 0.025, 1, 5, 5, 2) \
+    X("Chevrolet", "B102", "", 2, 2, \
+      0.205, 1.037, 0.093, 10, 0.039, 90, 0.205, \
+      0.315, 0.161, 0.026, 1, 4, 5, 2) \
+    X("Dodge", "Y159", "CX102", 2, 2, \
+      0.297, 0.941, 0.092, 8, 0.039, 90, 0.297, \
+      0.339, 0.197, 0.047, 1, 4, 5, 1) \
+    X("Kawasaki", "KA14", "CMC50", 2, 1, \
+      0.098, 0.591, 0.098, 6, 0.039, 90, 0.1, \
+      0.258, 0.198, 0.020, 1, 4, 4, 3) \
+    X("Yamaha", "YM63", "CMC71", 2, 1, \
+      0.157, 0.748, 0.098, 7, 0.039, 90, 0.1, \
+      0.295, 0.236, 0.020, 1, 4, 4, 3) \
+    X("Best (A2)", "SFIC", "C3", 1, 2, \
+      0.250, 0.998, 0.149, 6, 0.051, 90, 0.081, \
+      0.318, 0.206, 0.025, 0, 9, 5, 3) \
+    X("RV (FIC,GL,Bauer)", "RV", "Card", 2, 1, \
+      0.126, 0.504, 0.094, 5, 0.039, 90, 0.126, \
+      0.260, 0.181, 0.040, 1, 3, 3, 1) \
+    X("Vachette", "V5", "Card", 1, 1, \
+      0.247, 0.847, 0.15, 5, 0.084, 90, 0.15, \
+      0.329, 0.191, 0.023, 1, 7, 4, 3) \
+    X("City", "5G", "Card", 1, 1, \
+      0.247, 0.847, 0.15, 5, 0.084, 90, 0.15, \
+      0.329, 0.191, 0.023, 1, 7, 4, 3) \
+    X("TESA", "TE5", "Card", 1, 1, \
+      0.247, 0.847, 0.15, 5, 0.084, 90, 0.15, \
+      0.329, 0.191, 0.023, 1, 7, 4, 3)
+
+// clang-format on
+
+// Column selectors, one per field of a table row
+#define KF_INFO(mf, name, link, ...) \
+    {.manufacturer = mf, .format_name = name, .format_link = link},
+#define KF_SIDES(mf, name, link, sides, ...) sides,
+#define KF_STOP(mf, name, link, sides, stop, ...) stop,
+#define KF_FIRST_PIN(mf, name, link, sides, stop, first, ...) KEY_FORMAT_INCH(first),
+#define KF_LAST_PIN(mf, name, link, sides, stop, first, last, ...) KEY_FORMAT_INCH(last),
+#define KF_PIN_INCREMENT(mf, name, link, sides, stop, first, last, inc, ...) KEY_FORMAT_INCH(inc),
+#define KF_PIN_NUM(mf, name, link, sides, stop, first, last, inc, num, ...) num,
+#define KF_PIN_WIDTH(mf, name, link, sides, stop, first, last, inc, num, width, ...) \
+    KEY_FORMAT_INCH(width),
+#define KF_DRILL_ANGLE(mf, name, link, sides, stop, first, last, inc, num, width, angle, ...) \
+    angle,
+#define KF_ELBOW(mf, name, link, sides, stop, first, last, inc, num, width, angle, elbow, ...) \
+    KEY_FORMAT_INCH(elbow),
+#define KF_UNCUT_DEPTH(                                                                  \
+    mf, name, link, sides, stop, first, last, inc, num, width, angle, elbow, uncut, ...) \
+    KEY_FORMAT_INCH(uncut),
+#define KF_DEEPEST_DEPTH(                                                                      \
+    mf, name, link, sides, stop, first, last, inc, num, width, angle, elbow, uncut, deep, ...) \
+    KEY_FORMAT_INCH(deep),
+#define KF_DEPTH_STEP(                                                                         \
+    mf, name, link, sides, stop, first, last, inc, num, width, angle, elbow, uncut, deep, step, \
+    ...)                                                                                       \
+    KEY_FORMAT_INCH(step),
+#define KF_MIN_DEPTH_IND(                                                                      \
+    mf, name, link, sides, stop, first, last, inc, num, width, angle, elbow, uncut, deep, step, \
+    dmin, ...)                                                                                 \
+    dmin,
+#define KF_MAX_DEPTH_IND(                                                                      \
+    mf, name, link, sides, stop, first, last, inc, num, width, angle, elbow, uncut, deep, step, \
+    dmin, dmax, ...)                                                                           \
+    dmax,
+#define KF_MACS(                                                                               \
+    mf, name, link, sides, stop, first, last, inc, num, width, angle, elbow, uncut, deep, step, \
+    dmin, dmax, macs, ...)                                                                     \
+    macs,
+#define KF_CLEARANCE(                                                                          \
+    mf, name, link, sides, stop, first, last, inc, num, width, angle, elbow, uncut, deep, step, \
+    dmin, dmax, macs, clearance)                                                               \
+    clearance,
+#define KF_COUNT(...) +1
+
+_Static_assert(0 KEY_FORMAT_TABLE(KF_COUNT) == FORMAT_NUM, "FORMAT_NUM does not match the table");
+
+const KeyFormatCatalog key_format_catalog = {
+    .first_pin = {KEY_FORMAT_TABLE(KF_FIRST_PIN)},
+    .last_pin = {KEY_FORMAT_TABLE(KF_LAST_PIN)},
+    .pin_increment = {KEY_FORMAT_TABLE(KF_PIN_INCREMENT)},
+    .pin_width = {KEY_FORMAT_TABLE(KF_PIN_WIDTH)},
+    .elbow = {KEY_FORMAT_TABLE(KF_ELBOW)},
+    .uncut_depth = {KEY_FORMAT_TABLE(KF_UNCUT_DEPTH)},
+    .deepest_depth = {KEY_FORMAT_TABLE(KF_DEEPEST_DEPTH)},
+    .depth_step = {KEY_FORMAT_TABLE(KF_DEPTH_STEP)},
+    .drill_angle = {KEY_FORMAT_TABLE(KF_DRILL_ANGLE)},
+    .sides = {KEY_FORMAT_TABLE(KF_SIDES)},
+    .stop = {KEY_FORMAT_TABLE(KF_STOP)},
+    .pin_num = {KEY_FORMAT_TABLE(KF_PIN_NUM)},
+    .min_depth_ind = {KEY_FORMAT_TABLE(KF_MIN_DEPTH_IND)},
+    .max_depth_ind = {KEY_FORMAT_TABLE(KF_MAX_DEPTH_IND)},
+    .macs = {KEY_FORMAT_TABLE(KF_MACS)},
+    .clearance = {KEY_FORMAT_TABLE(KF_CLEARANCE)},
 };
+
+const KeyFormatInfo key_format_info[FORMAT_NUM] = {KEY_FORMAT_TABLE(KF_INFO)};
+
+void key_format_load(uint32_t index, KeyFormat* format) {
+    const KeyFormatCatalog* c = &key_format_catalog;
+    format->first_pin = c->first_pin[index];
+    format->last_pin = c->last_pin[index];
+    format->pin_increment = c->pin_increment[index];
+    format->pin_width = c->pin_width[index];
+    format->elbow = c->elbow[index];
+    format->uncut_depth = c->uncut_depth[index];
+    format->deepest_depth = c->deepest_depth[index];
+    format->depth_step = c->depth_step[index];
+    format->drill_angle = c->drill_angle[index];
+    format->sides = c->sides[index];
+    format->stop = c->stop[index];
+    format->pin_num = c->pin_num[index];
+    format->min_depth_ind = c->min_depth_ind[index];
+    format->max_depth_ind = c->max_depth_ind[index];
+    format->macs = c->macs[index];
+    format->clearance = c->clearance[index];
+}
+
+int32_t key_format_find(const char* format_name) {
+    for(int32_t i = 0; i < FORMAT_NUM; i++) {
+        if(!strcmp(format_name, key_format_info[i].format_name)) {
+            return i;
+        }
+    }
+    return -1;
+}
@@ -1,32 +1,69 @@
 #ifndef KEY_FORMATS_H
 #define KEY_FORMATS_H
 
+#include <stdint.h>
+
 #define FORMAT_NUM 24
 
+// All lengths are stored as fixed point in ten-thousandths of an inch, which is finer than any
+// spec sheet we copy from and keeps every dimension of a key within 16 bits.
+#define KEY_FORMAT_UNITS_PER_INCH 10000
+#define KEY_FORMAT_INCH(inch) ((uint16_t)((inch) * KEY_FORMAT_UNITS_PER_INCH + 0.5))
+
+// Hot fields: everything the renderer and the input validation touch. Small enough to copy.
 typedef struct {
-    char* manufacturer;
-    char* format_name;
-    char* format_link;
-    int sides;
-    int stop;
-    double first_pin_inch;
-    double last_pin_inch;
-    double pin_increment_inch;
-    int pin_num;
-    double pin_width_inch;
-    double drill_angle;
-    double elbow_inch;
-
-    double uncut_depth_inch;
-    double deepest_depth_inch;
-    double depth_step_inch;
-    int min_depth_ind;
-    int max_depth_ind;
-
-    int macs;
-    int clearance;
+    uint16_t first_pin;
+    uint16_t last_pin;
+    uint16_t pin_increment;
+    uint16_t pin_width;
+    uint16_t elbow;
+    uint16_t uncut_depth;
+    uint16_t deepest_depth;
+    uint16_t depth_step;
+    uint8_t drill_angle; // degrees
+    uint8_t sides;
+    uint8_t stop;
+    uint8_t pin_num;
+    uint8_t min_depth_ind;
+    uint8_t max_depth_ind;
+    uint8_t macs;
+    uint8_t clearance;
 } KeyFormat;
 
-extern const KeyFormat all_formats[FORMAT_NUM];
+// Cold fields: only needed for menus and saved files.
+typedef struct {
+    const char* manufacturer;
+    const char* format_name;
+    const char* format_link;
+} KeyFormatInfo;
+
+// The catalog itself lives in flash as a struct of arrays, one column per hot field.
+typedef struct {
+    uint16_t first_pin[FORMAT_NUM];
+    uint16_t last_pin[FORMAT_NUM];
+    uint16_t pin_increment[FORMAT_NUM];
+    uint16_t pin_width[FORMAT_NUM];
+    uint16_t elbow[FORMAT_NUM];
+    uint16_t uncut_depth[FORMAT_NUM];
+    uint16_t deepest_depth[FORMAT_NUM];
+    uint16_t depth_step[FORMAT_NUM];
+    uint8_t drill_angle[FORMAT_NUM];
+    uint8_t sides[FORMAT_NUM];
+    uint8_t stop[FORMAT_NUM];
+    uint8_t pin_num[FORMAT_NUM];
+    uint8_t min_depth_ind[FORMAT_NUM];
+    uint8_t max_depth_ind[FORMAT_NUM];
+    uint8_t macs[FORMAT_NUM];
+    uint8_t clearance[FORMAT_NUM];
+} KeyFormatCatalog;
+
+extern const KeyFormatCatalog key_format_catalog;
+extern const KeyFormatInfo key_format_info[FORMAT_NUM];
+
+// Gather the hot fields of one catalog entry
+void key_format_load(uint32_t index, KeyFormat* format);
+
+// Catalog index of the format with this name, or -1
+int32_t key_format_find(const char* format_name);
 
 #endif // KEY_FORMATS_H
@@ -0,0 +1,297 @@
+#include "key_gcode.h"
+#include "key_caliper.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEY_GCODE_FIELDS 2
+#define KEY_GCODE_MS_PER_MINUTE 60000
+
+typedef struct {
+    KeyGcodeWrite write;
+    void* context;
+    int32_t x; // where the tool is, in catalog length units
+    int32_t y;
+    uint8_t angle; // of the cutter loaded, 0 before the first
+    bool forward; // the next side is cut from the stop outwards
+    uint32_t key_ms; // estimated time of the key being cut
+    uint32_t job_ms;
+} KeyGcodeMachine;
+
+static bool key_gcode_print(KeyGcodeMachine* machine, const char* text) {
+    return machine->write(text, strlen(text), machine->context);
+}
+
+// Inches to four decimals, which is the resolution of the catalog
+static void key_gcode_inch(char* out, size_t size, int32_t length) {
+    uint32_t magnitude = (uint32_t)abs(length);
+    snprintf(
+        out,
+        size,
+        "%s%lu.%04lu",
+        length < 0 ? "-" : "",
+        (unsigned long)(magnitude / KEY_FORMAT_UNITS_PER_INCH),
+        (unsigned long)(magnitude % KEY_FORMAT_UNITS_PER_INCH));
+}
+
+static void key_gcode_wait(KeyGcodeMachine* machine, uint32_t seconds) {
+    machine->key_ms += seconds * 1000;
+}
+
+// Moves are along one axis at a time; feed is in inches per minute and 0 means a rapid
+static bool key_gcode_move(KeyGcodeMachine* machine, int32_t x, int32_t y, uint32_t feed) {
+    if(x == machine->x && y == machine->y) return true;
+    char line[48];
+    char number[16];
+    uint32_t distance = (uint32_t)abs(x - machine->x) + (uint32_t)abs(y - machine->y);
+    size_t length = snprintf(line, sizeof(line), "%s", feed ? "G1" : "G0");
+    if(x != machine->x) {
+        key_gcode_inch(number, sizeof(number), x);
+        length += snprintf(line + length, sizeof(line) - length, " X%s", number);
+    }
+    if(y != machine->y) {
+        key_gcode_inch(number, sizeof(number), y);
+        length += snprintf(line + length, sizeof(line) - length, " Y%s", number);
+    }
+    if(feed) {
+        length += snprintf(line + length, sizeof(line) - length, " F%lu", (unsigned long)feed);
+    }
+    snprintf(line + length, sizeof(line) - length, "\n");
+    machine->key_ms += distance * (KEY_GCODE_MS_PER_MINUTE / KEY_FORMAT_UNITS_PER_INCH) /
+                       (feed ? feed : KEY_GCODE_FEED_RAPID);
+    machine->x = x;
+    machine->y = y;
+    return key_gcode_print(machine, line);
+}
+
+// Split a line on commas in place, trimming blanks around each field
+static uint8_t key_gcode_split(char* line, char** fields) {
+    uint8_t count = 0;
+    char* field = line;
+    while(count < KEY_GCODE_FIELDS) {
+        char* end = strchr(field, ',');
+        if(end) *end = '\0';
+        while(*field == ' ' || *field == '\t') field++;
+        size_t length = strlen(field);
+        while(length > 0 && (field[length - 1] == ' ' || field[length - 1] == '\t' ||
+                             field[length - 1] == '\r'))
+            field[--length] = '\0';
+        fields[count++] = field;
+        if(!end) break;
+        field = end + 1;
+    }
+    return count;
+}
+
+// Read one queue line, following FORMAT lines. Returns the error, or NULL with *name set for a
+// key that can be cut and left NULL for any other line.
+static const char* key_gcode_parse(
+    char* line,
+    uint32_t* format_index,
+    KeyFormat* format,
+    const char** name,
+    KeyBitting* bitting) {
+    char* fields[KEY_GCODE_FIELDS];
+    uint8_t count = key_gcode_split(line, fields);
+    *name = NULL;
+    if(fields[0][0] == '\0' || fields[0][0] == '#') return NULL;
+    if(count < 2) return "missing bitting";
+    if(!strcmp(fields[0], "FORMAT")) {
+        int32_t index = key_format_find(fields[1]);
+        if(index < 0) return "unknown format";
+        *format_index = index;
+        key_format_load(*format_index, format);
+        return NULL;
+    }
+    if(!key_bitting_from_str(bitting, format->pin_num, fields[1])) return "bad bitting";
+    if(!key_bitting_in_range(
+           bitting, format->pin_num, format->min_depth_ind, format->max_depth_ind))
+        return "depth out of range";
+    if(key_bitting_macs_violations(bitting, format->pin_num, format->macs))
+        return "MACS broken";
+    *name = fields[0];
+    return NULL;
+}
+
+// Text as it may go inside a G-code comment, which the first ')' ends: parentheses are dropped
+// and the rest is cut to fit size
+static void key_gcode_comment(char* comment, size_t size, const char* text) {
+    size_t length = 0;
+    for(; *text && length + 1 < size; text++) {
+        if(*text != '(' && *text != ')') comment[length++] = *text;
+    }
+    comment[length] = '\0';
+}
+
+static bool key_gcode_tool(KeyGcodeMachine* machine, uint8_t angle, KeyGcodeTotals* totals) {
+    if(angle == machine->angle) return true;
+    char out[KEY_GCODE_LINE_SIZE];
+    totals->tools++;
+    snprintf(
+        out,
+        sizeof(out),
+        "M5\n(tool %lu: %u degree V cutter)\nT%lu M6\nM3 S%u\n",
+        (unsigned long)totals->tools,
+        angle,
+        (unsigned long)totals->tools,
+        KEY_GCODE_SPINDLE_RPM);
+    machine->angle = angle;
+    machine->job_ms += KEY_GCODE_TOOL_SECONDS * 1000;
+    return key_gcode_print(machine, out);
+}
+
+// One side: each cut is plunged at one edge of its flat and fed across to the other
+static bool key_gcode_side(
+    KeyGcodeMachine* machine,
+    const KeyFormat* format,
+    const KeyBitting* bitting,
+    KeyGcodeTotals* totals) {
+    const int32_t above = format->uncut_depth + KEY_GCODE_CLEARANCE;
+    const int32_t half_width = format->pin_width / 2;
+    for(uint8_t step = 0; step < format->pin_num; step++) {
+        uint8_t pin = machine->forward ? step : format->pin_num - 1 - step;
+        int32_t bottom = key_caliper_remaining(format, key_bitting_get(bitting, pin));
+        if(bottom >= format->uncut_depth) continue; // the shallowest depth leaves the blade whole
+        int32_t center = format->first_pin + pin * format->pin_increment;
+        int32_t start = machine->forward ? center - half_width : center + half_width;
+        int32_t end = machine->forward ? center + half_width : center - half_width;
+        if(!key_gcode_move(machine, start, machine->y, 0) ||
+           !key_gcode_move(machine, start, above, 0) ||
+           !key_gcode_move(machine, start, bottom, KEY_GCODE_FEED_PLUNGE) ||
+           !key_gcode_move(machine, end, bottom, KEY_GCODE_FEED_CUT) ||
+           !key_gcode_move(machine, end, above, 0))
+            return false;
+        totals->cuts++;
+    }
+    machine->forward = !machine->forward;
+    return key_gcode_move(machine, machine->x, KEY_GCODE_PARK, 0);
+}
+
+static bool key_gcode_key(
+    KeyGcodeMachine* machine,
+    const KeyFormat* format,
+    const char* name,
+    const KeyBitting* bitting,
+    KeyGcodeTotals* totals) {
+    char comment[KEY_GCODE_NAME_SIZE];
+    char pattern[KEY_BITTING_MAX_PINS * 3];
+    // the longest name and bitting, the brackets and the line break
+    char out[sizeof(comment) + sizeof(pattern) + 4];
+    key_gcode_comment(comment, sizeof(comment), name);
+    key_bitting_to_str(bitting, format->pin_num, pattern, sizeof(pattern));
+    machine->key_ms = 0;
+    snprintf(out, sizeof(out), "(%s: %s)\n", comment, pattern);
+    key_gcode_wait(machine, KEY_GCODE_LOAD_SECONDS);
+    // The stop for the blank is its own line, so nothing before it can crowd it out
+    if(!key_gcode_print(machine, out) || !key_gcode_print(machine, "M0 (load blank)\n") ||
+       !key_gcode_side(machine, format, bitting, totals))
+        return false;
+    if(format->sides == 2) {
+        key_gcode_wait(machine, KEY_GCODE_FLIP_SECONDS);
+        if(!key_gcode_print(machine, "M0 (flip the key over)\n") ||
+           !key_gcode_side(machine, format, bitting, totals))
+            return false;
+    }
+    totals->keys++;
+    machine->job_ms += machine->key_ms;
+    snprintf(
+        out,
+        sizeof(out),
+        "(%s cut, about %lu s)\n",
+        comment,
+        (unsigned long)((machine->key_ms + 999) / 1000));
+    return key_gcode_print(machine, out);
+}
+
+// Next group to cut: the smallest cutter angle first, catalog order for the same angle
+static int32_t key_gcode_next_format(const uint16_t* keys) {
+    int32_t next = -1;
+    for(int32_t index = 0; index < FORMAT_NUM; index++) {
+        if(!keys[index]) continue;
+        if(next < 0 ||
+           key_format_catalog.drill_angle[index] < key_format_catalog.drill_angle[next])
+            next = index;
+    }
+    return next;
+}
+
+bool key_gcode_run(
+    uint32_t format_index,
+    KeyGcodeReadLine read_line,
+    KeyGcodeRewind rewind,
+    KeyGcodeWrite write,
+    void* context,
+    KeyGcodeTotals* totals) {
+    memset(totals, 0, sizeof(KeyGcodeTotals));
+    KeyGcodeMachine machine = {.write = write, .context = context, .forward = true};
+    KeyFormat format;
+    KeyBitting bitting;
+    const char* name;
+    char line[KEY_GCODE_LINE_SIZE];
+    char out[KEY_GCODE_LINE_SIZE];
+    char number[16];
+    uint16_t keys[FORMAT_NUM] = {0};
+    const uint32_t first_format = format_index;
+    uint32_t line_number = 0;
+
+    key_gcode_inch(number, sizeof(number), KEY_GCODE_PARK);
+    snprintf(
+        out,
+        sizeof(out),
+        "%%\n(Key Copier toolpath)\n(X along the blade from the stop, Y up from the jaw)\n"
+        "G20 G90 G17 G94\nG0 Y%s\nG0 X0.0000\n",
+        number);
+    if(!key_gcode_print(&machine, out)) return false;
+    machine.y = KEY_GCODE_PARK;
+
+    // Count the keys of each format and report the lines that will be left out
+    key_format_load(format_index, &format);
+    while(read_line(line, sizeof(line), context)) {
+        line_number++;
+        const char* error = key_gcode_parse(line, &format_index, &format, &name, &bitting);
+        if(name && keys[format_index] < UINT16_MAX) keys[format_index]++;
+        if(!error) continue;
+        totals->errors++;
+        snprintf(out, sizeof(out), "(line %lu: %s)\n", (unsigned long)line_number, error);
+        if(!key_gcode_print(&machine, out)) return false;
+    }
+
+    for(int32_t group = key_gcode_next_format(keys); group >= 0;
+        group = key_gcode_next_format(keys)) {
+        key_format_load(group, &format);
+        if(!key_gcode_tool(&machine, format.drill_angle, totals)) return false;
+        char manufacturer[KEY_GCODE_NAME_SIZE];
+        key_gcode_comment(manufacturer, sizeof(manufacturer), key_format_info[group].manufacturer);
+        snprintf(
+            out,
+            sizeof(out),
+            "(%s %s, %u keys, X from the %s)\n",
+            manufacturer,
+            key_format_info[group].format_name,
+            keys[group],
+            format.stop == 2 ? "tip" : "shoulder");
+        if(!key_gcode_print(&machine, out) || !rewind(context)) return false;
+        keys[group] = 0;
+        format_index = first_format;
+        key_format_load(format_index, &format);
+        while(read_line(line, sizeof(line), context)) {
+            key_gcode_parse(line, &format_index, &format, &name, &bitting);
+            if(name && format_index == (uint32_t)group &&
+               !key_gcode_key(&machine, &format, name, &bitting, totals))
+                return false;
+        }
+    }
+
+    totals->seconds = (machine.job_ms + 999) / 1000;
+    snprintf(
+        out,
+        sizeof(out),
+        "M5\n(keys %lu, cuts %lu, tools %lu, bad lines %lu)\n(about %lu min %lu s)\nM30\n%%\n",
+        (unsigned long)totals->keys,
+        (unsigned long)totals->cuts,
+        (unsigned long)totals->tools,
+        (unsigned long)totals->errors,
+        (unsigned long)(totals->seconds / 60),
+        (unsigned long)(totals->seconds % 60));
+    return key_gcode_print(&machine, out);
+}
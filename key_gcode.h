@@ -0,0 +1,52 @@
+#ifndef KEY_GCODE_H
+#define KEY_GCODE_H
+
+#include "key_bitting.h"
+#include "key_formats.h"
+
+#define KEY_GCODE_LINE_SIZE 128
+#define KEY_GCODE_NAME_SIZE 32
+
+// Machine settings. Feeds are in inches per minute; the rapid rate is only used to estimate time,
+// G0 moves run at whatever the machine is set to.
+#define KEY_GCODE_SPINDLE_RPM 12000
+#define KEY_GCODE_FEED_PLUNGE 2
+#define KEY_GCODE_FEED_CUT 4
+#define KEY_GCODE_FEED_RAPID 60
+#define KEY_GCODE_CLEARANCE KEY_FORMAT_INCH(0.05) // above the uncut blade for rapids along it
+#define KEY_GCODE_PARK KEY_FORMAT_INCH(0.75) // above the fixture while a blank is swapped
+// Time allowed for each stop in the estimate
+#define KEY_GCODE_LOAD_SECONDS 30
+#define KEY_GCODE_FLIP_SECONDS 20
+#define KEY_GCODE_TOOL_SECONDS 60
+
+typedef struct {
+    uint32_t keys;
+    uint32_t cuts;
+    uint32_t tools; // tool loads, the first one included
+    uint32_t errors; // queue lines that could not be cut
+    uint32_t seconds; // estimated machine time, stops included
+} KeyGcodeTotals;
+
+// Feed one line of the queue, without the line break. Return false at the end of the queue.
+typedef bool (*KeyGcodeReadLine)(char* line, size_t size, void* context);
+// Go back to the first line of the queue
+typedef bool (*KeyGcodeRewind)(void* context);
+typedef bool (*KeyGcodeWrite)(const char* text, size_t size, void* context);
+
+// Write the toolpath for a queue of "name,bitting" lines. "FORMAT,<format name>" applies to the
+// lines that follow; blank lines and # comments are skipped. X runs along the blade from the
+// stop and Y up from the fixture jaw, in inches. Each cutter angle is one tool and each format
+// one group, so the queue is read once to find the formats and once more per format, and
+// nothing of it is held in memory. Keys of a group are cut in alternate directions so the next
+// one starts where the last one ended; double sided keys stop to be flipped and come back the
+// other way. The estimated time of each key and of the whole job is written as comments.
+bool key_gcode_run(
+    uint32_t format_index,
+    KeyGcodeReadLine read_line,
+    KeyGcodeRewind rewind,
+    KeyGcodeWrite write,
+    void* context,
+    KeyGcodeTotals* totals);
+
+#endif // KEY_GCODE_H
@@ -0,0 +1,152 @@
+#include "key_history.h"
+
+void key_history_init(KeyHistory* history) {
+    history->start = 0;
+    history->count = 0;
+    history->position = 0;
+    history->snapshot_start = 0;
+    history->snapshot_count = 0;
+    history->snapshot_position = 0;
+}
+
+static void key_history_drop_redo(KeyHistory* history) {
+    history->count = history->position;
+    history->snapshot_count = history->snapshot_position;
+}
+
+// Only called with nothing to redo, so the oldest entry is always one that could be undone
+static void key_history_drop_oldest(KeyHistory* history) {
+    uint16_t entry = history->entries[history->start];
+    history->start = (history->start + 1) % KEY_HISTORY_ENTRIES;
+    history->count--;
+    history->position--;
+    if(entry & KEY_HISTORY_SNAPSHOT) {
+        history->snapshot_start = (history->snapshot_start + 1) % KEY_HISTORY_SNAPSHOTS;
+        history->snapshot_count--;
+        history->snapshot_position--;
+    }
+}
+
+static void key_history_push(KeyHistory* history, uint16_t entry) {
+    if(history->count == KEY_HISTORY_ENTRIES) key_history_drop_oldest(history);
+    history->entries[(history->start + history->count) % KEY_HISTORY_ENTRIES] = entry;
+    history->count++;
+    history->position++;
+}
+
+void key_history_edit(KeyHistory* history, uint8_t pin, uint8_t old_depth, uint8_t new_depth) {
+    if(old_depth == new_depth) return;
+    key_history_drop_redo(history);
+    key_history_push(history, KEY_HISTORY_EDIT(pin, old_depth, new_depth));
+}
+
+void key_history_replace(
+    KeyHistory* history,
+    const KeyHistoryState* before,
+    const KeyHistoryState* after) {
+    key_history_drop_redo(history);
+    // Each entry goes at most once, so this is constant time spread over the edits
+    while(history->snapshot_count == KEY_HISTORY_SNAPSHOTS) {
+        key_history_drop_oldest(history);
+    }
+    uint8_t slot = (history->snapshot_start + history->snapshot_count) % KEY_HISTORY_SNAPSHOTS;
+    history->snapshots[slot].before = *before;
+    history->snapshots[slot].after = *after;
+    history->snapshot_count++;
+    history->snapshot_position++;
+    key_history_push(history, KEY_HISTORY_SNAPSHOT | slot);
+}
+
+bool key_history_undo(KeyHistory* history, KeyHistoryState* state) {
+    if(history->position == 0) return false;
+    history->position--;
+    uint16_t entry = key_history_entry(history, history->position);
+    if(entry & KEY_HISTORY_SNAPSHOT) {
+        *state = history->snapshots[entry & ~KEY_HISTORY_SNAPSHOT].before;
+        history->snapshot_position--;
+    } else {
+        key_bitting_set(
+            &state->bitting, KEY_HISTORY_EDIT_PIN(entry), KEY_HISTORY_EDIT_OLD(entry));
+    }
+    return true;
+}
+
+bool key_history_redo(KeyHistory* history, KeyHistoryState* state) {
+    if(history->position == history->count) return false;
+    uint16_t entry = key_history_entry(history, history->position);
+    history->position++;
+    if(entry & KEY_HISTORY_SNAPSHOT) {
+        *state = history->snapshots[entry & ~KEY_HISTORY_SNAPSHOT].after;
+        history->snapshot_position++;
+    } else {
+        key_bitting_set(
+            &state->bitting, KEY_HISTORY_EDIT_PIN(entry), KEY_HISTORY_EDIT_NEW(entry));
+    }
+    return true;
+}
+
+void key_history_span(const KeyHistory* history, uint16_t* first, uint16_t* end) {
+    *first = history->position;
+    while(*first > 0 && !(key_history_entry(history, *first - 1) & KEY_HISTORY_SNAPSHOT)) {
+        (*first)--;
+    }
+    *end = history->position;
+    while(*end < history->count && !(key_history_entry(history, *end) & KEY_HISTORY_SNAPSHOT)) {
+        (*end)++;
+    }
+}
+
+bool key_history_append(KeyHistory* history, uint16_t entry) {
+    if((entry & ~KEY_HISTORY_EDIT_MASK) || history->count == KEY_HISTORY_ENTRIES) return false;
+    history->entries[(history->start + history->count) % KEY_HISTORY_ENTRIES] = entry;
+    history->count++;
+    return true;
+}
+
+// Apply a step to bitting if it starts from the depth there and stays within the format
+static bool key_history_replay(
+    KeyBitting* bitting,
+    const KeyFormat* format,
+    uint8_t pin,
+    uint8_t from,
+    uint8_t to) {
+    if(pin >= format->pin_num || key_bitting_get(bitting, pin) != from ||
+       to < format->min_depth_ind || to > format->max_depth_ind)
+        return false;
+    key_bitting_set(bitting, pin, to);
+    return true;
+}
+
+bool key_history_restore(
+    KeyHistory* history,
+    uint16_t position,
+    const KeyBitting* bitting,
+    const KeyFormat* format) {
+    bool valid = position <= history->count && history->snapshot_count == 0;
+    KeyBitting replay = *bitting;
+    for(uint16_t index = position; valid && index > 0; index--) {
+        uint16_t entry = key_history_entry(history, index - 1);
+        valid = key_history_replay(
+            &replay,
+            format,
+            KEY_HISTORY_EDIT_PIN(entry),
+            KEY_HISTORY_EDIT_NEW(entry),
+            KEY_HISTORY_EDIT_OLD(entry));
+    }
+    replay = *bitting;
+    for(uint16_t index = position; valid && index < history->count; index++) {
+        uint16_t entry = key_history_entry(history, index);
+        valid = key_history_replay(
+            &replay,
+            format,
+            KEY_HISTORY_EDIT_PIN(entry),
+            KEY_HISTORY_EDIT_OLD(entry),
+            KEY_HISTORY_EDIT_NEW(entry));
+    }
+    if(valid) {
+        history->position = position;
+    } else {
+        key_history_init(history);
+    }
+    return valid;
+}
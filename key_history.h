@@ -0,0 +1,78 @@
+#ifndef KEY_HISTORY_H
+#define KEY_HISTORY_H
+
+#include "key_bitting.h"
+#include "key_formats.h"
+
+// Undo history of the measured key. A depth step is one packed 16 bit entry; a new format or a
+// whole new bitting also keeps the key before and after in a small ring of snapshots. All of it
+// lives in sizeof(KeyHistory), a little under 1 KB, and undo and redo never loop.
+#define KEY_HISTORY_ENTRIES 256
+#define KEY_HISTORY_SNAPSHOTS 8
+
+// An entry is pin << 8 | old depth << 4 | new depth, or the snapshot flag and its slot
+#define KEY_HISTORY_SNAPSHOT 0x8000
+#define KEY_HISTORY_EDIT_MASK 0x1FFF
+#define KEY_HISTORY_EDIT(pin, old, new) ((uint16_t)(((pin) << 8) | ((old) << 4) | (new)))
+#define KEY_HISTORY_EDIT_PIN(entry) (((entry) >> 8) & 0x1F)
+#define KEY_HISTORY_EDIT_OLD(entry) (((entry) >> 4) & 0xF)
+#define KEY_HISTORY_EDIT_NEW(entry) ((entry) & 0xF)
+
+typedef struct {
+    uint32_t format_index;
+    KeyBitting bitting;
+} KeyHistoryState;
+
+typedef struct {
+    KeyHistoryState before;
+    KeyHistoryState after;
+} KeyHistorySnapshot;
+
+typedef struct {
+    uint16_t entries[KEY_HISTORY_ENTRIES];
+    KeyHistorySnapshot snapshots[KEY_HISTORY_SNAPSHOTS];
+    uint16_t start; // ring index of the oldest entry
+    uint16_t count; // entries kept; the ones from position on can be redone
+    uint16_t position;
+    // Snapshot slots are handed out in entry order, so the ring of them needs no search either
+    uint8_t snapshot_start; // slot of the oldest snapshot entry
+    uint8_t snapshot_count;
+    uint8_t snapshot_position; // snapshot entries before position
+} KeyHistory;
+
+void key_history_init(KeyHistory* history);
+
+// Record one depth step. Anything that could be redone is dropped, and so is the oldest entry
+// once the ring is full.
+void key_history_edit(KeyHistory* history, uint8_t pin, uint8_t old_depth, uint8_t new_depth);
+
+// Record a change of the whole key, such as a new format or a loaded bitting
+void key_history_replace(
+    KeyHistory* history,
+    const KeyHistoryState* before,
+    const KeyHistoryState* after);
+
+// Step state back or forward one change; false when there is none
+bool key_history_undo(KeyHistory* history, KeyHistoryState* state);
+bool key_history_redo(KeyHistory* history, KeyHistoryState* state);
+
+static inline uint16_t key_history_entry(const KeyHistory* history, uint16_t index) {
+    return history->entries[(history->start + index) % KEY_HISTORY_ENTRIES];
+}
+
+// The depth steps around position back to the last snapshot and on to the next one: the
+// history of the key as it is now, which is the part a saved file carries
+void key_history_span(const KeyHistory* history, uint16_t* first, uint16_t* end);
+
+// Loading: add a depth step read back from a file; false when it is not one or there is no room
+bool key_history_append(KeyHistory* history, uint16_t entry);
+
+// Loading: check that the appended steps, of which position are already done, lead to and from
+// bitting within the format. The history is cleared when they do not.
+bool key_history_restore(
+    KeyHistory* history,
+    uint16_t position,
+    const KeyBitting* bitting,
+    const KeyFormat* format);
+
+#endif // KEY_HISTORY_H
@@ -0,0 +1,41 @@
+#include "key_identify.h"
+
+static inline uint32_t key_identify_diff(uint32_t a, uint32_t b) {
+    return a > b ? a - b : b - a;
+}
+
+uint8_t key_identify_rank(
+    const KeyIdentifyObservation* observation,
+    KeyIdentifyMatch* matches,
+    uint8_t count) {
+    const KeyFormatCatalog* c = &key_format_catalog;
+    // Unknown features get a weight of zero rather than a branch in the loop
+    const uint32_t first_pin_weight = observation->first_pin ? 1 : 0;
+    const uint32_t spacing_weight = observation->pin_increment ? KEY_IDENTIFY_SPACING_WEIGHT : 0;
+    const uint32_t pin_weight = observation->pin_num ? KEY_IDENTIFY_PIN_PENALTY : 0;
+    const uint32_t sides_weight = observation->sides ? KEY_IDENTIFY_SIDES_PENALTY : 0;
+    const uint32_t stop_weight = observation->stop ? KEY_IDENTIFY_STOP_PENALTY : 0;
+    uint8_t kept = 0;
+    if(count == 0) return 0;
+
+    // One pass down the catalog columns, keeping the best few in order as we go
+    for(uint16_t index = 0; index < FORMAT_NUM; index++) {
+        uint32_t spacing = key_identify_diff(c->pin_increment[index], observation->pin_increment);
+        uint32_t score =
+            first_pin_weight * key_identify_diff(c->first_pin[index], observation->first_pin) +
+            spacing_weight * spacing +
+            pin_weight * key_identify_diff(c->pin_num[index], observation->pin_num) +
+            sides_weight * (c->sides[index] != observation->sides) +
+            stop_weight * (c->stop[index] != observation->stop);
+        if(kept == count && score >= matches[kept - 1].score) continue;
+
+        uint8_t slot = kept < count ? kept++ : count - 1;
+        while(slot > 0 && matches[slot - 1].score > score) {
+            matches[slot] = matches[slot - 1];
+            slot--;
+        }
+        matches[slot].format_index = index;
+        matches[slot].score = score;
+    }
+    return kept;
+}
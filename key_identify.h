@@ -0,0 +1,35 @@
+#ifndef KEY_IDENTIFY_H
+#define KEY_IDENTIFY_H
+
+#include "key_formats.h"
+#include <stdbool.h>
+
+#define KEY_IDENTIFY_MATCHES 8
+
+// Penalties, in the same units as the catalog lengths, so a score reads as "this far off"
+#define KEY_IDENTIFY_SPACING_WEIGHT 4 // a spacing error adds up over every cut
+#define KEY_IDENTIFY_PIN_PENALTY 500 // per miscounted cut
+#define KEY_IDENTIFY_SIDES_PENALTY 2000
+#define KEY_IDENTIFY_STOP_PENALTY 1000
+
+// What the user could see or measure on their key. 0 leaves a feature out of the fit.
+typedef struct {
+    uint8_t pin_num;
+    uint8_t sides;
+    uint8_t stop;
+    uint16_t first_pin; // stop to the center of the first cut
+    uint16_t pin_increment; // center to center
+} KeyIdentifyObservation;
+
+typedef struct {
+    uint16_t format_index;
+    uint32_t score; // lower fits better
+} KeyIdentifyMatch;
+
+// Fill matches with up to count best fitting formats, best first; returns how many
+uint8_t key_identify_rank(
+    const KeyIdentifyObservation* observation,
+    KeyIdentifyMatch* matches,
+    uint8_t count);
+
+#endif // KEY_IDENTIFY_H
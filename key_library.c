@@ -0,0 +1,1252 @@
+#include "key_library.h"
+#include "key_copier.h"
+#include "key_formats.h"
+#include <toolbox/path.h>
+
+#define TAG "KeyLibrary"
+
+bool key_library_for_each(Storage* storage, KeyLibraryCallback callback, void* context) {
+    File* dir = storage_file_alloc(storage);
+    bool result = storage_dir_open(dir, STORAGE_APP_DATA_PATH_PREFIX);
+    if(result) {
+        FileInfo info;
+        char name[KEY_LIBRARY_NAME_SIZE + sizeof(KEY_COPIER_FILE_EXTENSION)];
+        const size_t ext_len = strlen(KEY_COPIER_FILE_EXTENSION);
+        while(storage_dir_read(dir, &info, name, sizeof(name))) {
+            if(file_info_is_dir(&info)) continue;
+            size_t len = strlen(name);
+            if(len <= ext_len || strcmp(name + len - ext_len, KEY_COPIER_FILE_EXTENSION)) continue;
+            name[len - ext_len] = '\0';
+            if(!callback(name, context)) break;
+        }
+    }
+    storage_dir_close(dir);
+    storage_file_free(dir);
+    return result;
+}
+
+void key_library_path(FuriString* path, const char* name) {
+    furi_string_printf(
+        path, "%s/%s%s", STORAGE_APP_DATA_PATH_PREFIX, name, KEY_COPIER_FILE_EXTENSION);
+}
+
+static size_t key_library_file_read_chunk(void* data, size_t size, void* context) {
+    return storage_file_read(context, data, size);
+}
+
+KeyFileStatus key_library_read_path(
+    Storage* storage,
+    const char* path,
+    uint32_t* format_index,
+    KeyBitting* bitting,
+    KeyHistory* history) {
+    File* file = storage_file_alloc(storage);
+    KeyFileStatus status = KeyFileIoError;
+    if(storage_file_open(file, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        status =
+            key_file_parse(key_library_file_read_chunk, file, format_index, bitting, history);
+    }
+    storage_file_close(file);
+    storage_file_free(file);
+    return status;
+}
+
+KeyFileStatus key_library_read(
+    Storage* storage,
+    const char* name,
+    uint32_t* format_index,
+    KeyBitting* bitting) {
+    FuriString* path = furi_string_alloc();
+    key_library_path(path, name);
+    KeyFileStatus status =
+        key_library_read_path(storage, furi_string_get_cstr(path), format_index, bitting, NULL);
+    furi_string_free(path);
+    return status;
+}
+
+#define KEY_LIBRARY_LINE_SIZE 64
+
+typedef struct {
+    File* file;
+    uint8_t buffer[128];
+    uint16_t size;
+    uint16_t position;
+} KeyLibraryLineReader;
+
+// Read one line, dropping whatever does not fit. Returns false at the end of the file.
+static bool key_library_read_line(KeyLibraryLineReader* reader, char* line, size_t size) {
+    size_t length = 0;
+    bool any = false;
+    while(true) {
+        if(reader->position == reader->size) {
+            reader->size = storage_file_read(reader->file, reader->buffer, sizeof(reader->buffer));
+            reader->position = 0;
+            if(reader->size == 0) break;
+        }
+        char c = reader->buffer[reader->position++];
+        any = true;
+        if(c == '\n') break;
+        if(length < size - 1) line[length++] = c;
+    }
+    line[length] = '\0';
+    return any;
+}
+
+static bool key_library_file_read(uint32_t offset, void* data, size_t size, void* context) {
+    File* file = context;
+    return storage_file_seek(file, offset, true) && storage_file_read(file, data, size) == size;
+}
+
+static bool
+    key_library_file_write(uint32_t offset, const void* data, size_t size, void* context) {
+    File* file = context;
+    return storage_file_seek(file, offset, true) && storage_file_write(file, data, size) == size;
+}
+
+static KeyCodebookStatus key_library_codebook_compile(
+    Storage* storage,
+    const char* source_path,
+    uint32_t source_size,
+    uint32_t source_timestamp,
+    File* book_file,
+    uint32_t format_index) {
+    uint8_t pin_num = key_format_catalog.pin_num[format_index];
+    File* source = storage_file_alloc(storage);
+    KeyCodebookStatus status = KeyCodebookIoError;
+    if(storage_file_open(source, source_path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        KeyCodebookBuilder* builder =
+            key_codebook_builder_alloc(pin_num, key_library_file_write, book_file);
+        KeyLibraryLineReader* reader = malloc(sizeof(KeyLibraryLineReader));
+        memset(reader, 0, sizeof(KeyLibraryLineReader));
+        reader->file = source;
+        char line[KEY_LIBRARY_LINE_SIZE];
+        char code[KEY_CODEBOOK_CODE_SIZE];
+        KeyBitting bitting;
+        uint32_t line_number = 0;
+        status = KeyCodebookOk;
+        while(status == KeyCodebookOk && key_library_read_line(reader, line, sizeof(line))) {
+            line_number++;
+            if(!key_codebook_parse_line(line, pin_num, code, &bitting)) {
+                if(code[0] == '\0') continue;
+                status = KeyCodebookBadSource;
+            } else if(!key_bitting_in_range(
+                          &bitting,
+                          pin_num,
+                          key_format_catalog.min_depth_ind[format_index],
+                          key_format_catalog.max_depth_ind[format_index])) {
+                status = KeyCodebookBadSource;
+            } else {
+                status = key_codebook_builder_add(builder, code, &bitting);
+            }
+            if(status != KeyCodebookOk) {
+                FURI_LOG_E(TAG, "%s line %lu: %s", source_path, line_number, code);
+            }
+        }
+        if(status == KeyCodebookOk)
+            status = key_codebook_builder_finish(builder, source_size, source_timestamp);
+        free(reader);
+        key_codebook_builder_free(builder);
+    }
+    storage_file_close(source);
+    storage_file_free(source);
+    return status;
+}
+
+KeyCodebookStatus
+    key_library_codebook_open(Storage* storage, uint32_t format_index, KeyCodebook* book) {
+    const char* format_name = key_format_info[format_index].format_name;
+    uint8_t pin_num = key_format_catalog.pin_num[format_index];
+    FuriString* source_path = furi_string_alloc_printf(
+        "%s/%s.txt", KEY_LIBRARY_CODEBOOK_FOLDER, format_name);
+    FuriString* book_path = furi_string_alloc_printf(
+        "%s/%s%s", KEY_LIBRARY_CODEBOOK_FOLDER, format_name, KEY_LIBRARY_CODEBOOK_EXTENSION);
+    storage_simply_mkdir(storage, KEY_LIBRARY_CODEBOOK_FOLDER);
+    FileInfo source_info;
+    bool has_source =
+        storage_common_stat(storage, furi_string_get_cstr(source_path), &source_info) ==
+        FSE_OK;
+    // An edit that keeps the size still moves the time; with no time, only the size is checked
+    uint32_t source_timestamp = 0;
+    if(has_source) {
+        storage_common_timestamp(storage, furi_string_get_cstr(source_path), &source_timestamp);
+    }
+
+    File* file = storage_file_alloc(storage);
+    KeyCodebookStatus status = KeyCodebookMissing;
+    if(storage_file_open(file, furi_string_get_cstr(book_path), FSAM_READ, FSOM_OPEN_EXISTING)) {
+        status = key_codebook_open(book, pin_num, key_library_file_read, file);
+        if(status == KeyCodebookOk && has_source &&
+           (book->header.source_size != (uint32_t)source_info.size ||
+            book->header.source_timestamp != source_timestamp))
+            status = KeyCodebookMissing;
+    }
+    if(status != KeyCodebookOk && has_source) {
+        storage_file_close(file);
+        status = KeyCodebookIoError;
+        if(storage_file_open(
+               file, furi_string_get_cstr(book_path), FSAM_READ_WRITE, FSOM_CREATE_ALWAYS)) {
+            status = key_library_codebook_compile(
+                storage,
+                furi_string_get_cstr(source_path),
+                source_info.size,
+                source_timestamp,
+                file,
+                format_index);
+        }
+        if(status == KeyCodebookOk) {
+            status = key_codebook_open(book, pin_num, key_library_file_read, file);
+        } else {
+            storage_file_close(file);
+            storage_simply_remove(storage, furi_string_get_cstr(book_path));
+        }
+    }
+    if(status != KeyCodebookOk) {
+        storage_file_close(file);
+        storage_file_free(file);
+        book->context = NULL;
+    }
+    furi_string_free(book_path);
+    furi_string_free(source_path);
+    return status;
+}
+
+void key_library_codebook_close(KeyCodebook* book) {
+    if(!book->context) return;
+    storage_file_close(book->context);
+    storage_file_free(book->context);
+    book->context = NULL;
+}
+
+// Bump when key_render_thumbnail draws differently, to retire every cached icon
+#define KEY_LIBRARY_THUMBNAIL_VERSION 2
+
+typedef struct {
+    uint32_t hash; // 0 for an empty slot
+    uint8_t xbm[KEY_RENDER_THUMBNAIL_BYTES];
+} KeyLibraryThumbnailSlot;
+
+// FNV-1a over the path, then the file's size and modification time
+static uint32_t
+    key_library_thumbnail_hash(const char* path, uint64_t size, uint32_t timestamp) {
+    uint32_t hash = 2166136261u ^ KEY_LIBRARY_THUMBNAIL_VERSION;
+    for(const char* c = path; *c; c++) {
+        hash = (hash ^ (uint8_t)*c) * 16777619u;
+    }
+    uint64_t words[] = {size, timestamp};
+    for(size_t word = 0; word < COUNT_OF(words); word++) {
+        for(uint8_t shift = 0; shift < 64; shift += 8) {
+            hash = (hash ^ (uint8_t)(words[word] >> shift)) * 16777619u;
+        }
+    }
+    return hash ? hash : 1;
+}
+
+void key_library_thumbnails_open(KeyLibraryThumbnails* thumbnails, Storage* storage) {
+    const uint32_t cache_size = KEY_LIBRARY_THUMBNAIL_SLOTS * sizeof(KeyLibraryThumbnailSlot);
+    thumbnails->storage = storage;
+    thumbnails->format_index = -1;
+    thumbnails->cache = storage_file_alloc(storage);
+    bool ready = storage_file_open(
+        thumbnails->cache, KEY_LIBRARY_THUMBNAIL_CACHE, FSAM_READ_WRITE, FSOM_OPEN_ALWAYS);
+    if(ready && storage_file_size(thumbnails->cache) != cache_size) {
+        // New or from another build: start with every slot empty
+        KeyLibraryThumbnailSlot empty;
+        memset(&empty, 0, sizeof(empty));
+        ready = storage_file_seek(thumbnails->cache, 0, true) &&
+                storage_file_truncate(thumbnails->cache);
+        for(uint32_t slot = 0; ready && slot < KEY_LIBRARY_THUMBNAIL_SLOTS; slot++) {
+            ready = storage_file_write(thumbnails->cache, &empty, sizeof(empty)) == sizeof(empty);
+        }
+    }
+    if(!ready) {
+        FURI_LOG_W(TAG, "No thumbnail cache");
+        storage_file_close(thumbnails->cache);
+        storage_file_free(thumbnails->cache);
+        thumbnails->cache = NULL;
+    }
+}
+
+bool key_library_thumbnail(KeyLibraryThumbnails* thumbnails, const char* path, uint8_t* xbm) {
+    // Only the directory entry is read for a hit. The card keeps times to 2 seconds, so a key
+    // saved over twice that fast at the same size could keep its first icon.
+    KeyLibraryThumbnailSlot slot;
+    FileInfo info;
+    uint32_t timestamp = 0;
+    if(storage_common_stat(thumbnails->storage, path, &info) != FSE_OK) return false;
+    storage_common_timestamp(thumbnails->storage, path, &timestamp);
+    uint32_t hash = key_library_thumbnail_hash(path, info.size, timestamp);
+    uint32_t offset = (hash % KEY_LIBRARY_THUMBNAIL_SLOTS) * sizeof(KeyLibraryThumbnailSlot);
+    if(thumbnails->cache &&
+       key_library_file_read(offset, &slot, sizeof(slot), thumbnails->cache) &&
+       slot.hash == hash) {
+        memcpy(xbm, slot.xbm, sizeof(slot.xbm));
+        return true;
+    }
+
+    uint32_t format_index;
+    KeyBitting bitting;
+    if(key_library_read_path(thumbnails->storage, path, &format_index, &bitting, NULL) !=
+       KeyFileOk)
+        return false;
+    if(thumbnails->format_index != (int32_t)format_index) {
+        key_format_load(format_index, &thumbnails->format);
+        key_render_geometry(&thumbnails->geometry, &thumbnails->format);
+        thumbnails->format_index = format_index;
+    }
+    slot.hash = hash;
+    key_render_thumbnail(&thumbnails->geometry, &bitting, slot.xbm);
+    if(thumbnails->cache) {
+        key_library_file_write(offset, &slot, sizeof(slot), thumbnails->cache);
+    }
+    memcpy(xbm, slot.xbm, sizeof(slot.xbm));
+    return true;
+}
+
+void key_library_thumbnails_close(KeyLibraryThumbnails* thumbnails) {
+    if(!thumbnails->cache) return;
+    storage_file_close(thumbnails->cache);
+    storage_file_free(thumbnails->cache);
+    thumbnails->cache = NULL;
+}
+
+static bool key_library_names_read(
+    KeyNamesPart part,
+    uint32_t offset,
+    void* data,
+    size_t size,
+    void* context) {
+    KeyLibraryNames* names = context;
+    return key_library_file_read(offset, data, size, names->files[part]);
+}
+
+static bool key_library_names_write(
+    KeyNamesPart part,
+    uint32_t offset,
+    const void* data,
+    size_t size,
+    void* context) {
+    KeyLibraryNames* names = context;
+    return key_library_file_write(offset, data, size, names->files[part]);
+}
+
+static bool key_library_names_truncate(KeyNamesPart part, uint32_t size, void* context) {
+    KeyLibraryNames* names = context;
+    return storage_file_seek(names->files[part], size, true) &&
+           storage_file_truncate(names->files[part]);
+}
+
+typedef struct {
+    KeyNames* index;
+    KeyNamesStatus status;
+} KeyLibraryNamesBuild;
+
+static bool key_library_names_add(const char* name, void* context) {
+    KeyLibraryNamesBuild* build = context;
+    build->status = key_names_insert(build->index, name);
+    // Names too long for the index are still in the file browser
+    if(build->status == KeyNamesBadName) build->status = KeyNamesOk;
+    return build->status == KeyNamesOk;
+}
+
+KeyNamesStatus key_library_names_open(Storage* storage, KeyLibraryNames* names) {
+    const char* paths[] = {KEY_LIBRARY_NAMES_BLOCKS, KEY_LIBRARY_NAMES_DIRECTORY};
+    bool opened = true;
+    storage_simply_mkdir(storage, STORAGE_APP_DATA_PATH_PREFIX);
+    for(size_t part = 0; part < COUNT_OF(paths); part++) {
+        names->files[part] = storage_file_alloc(storage);
+        if(!storage_file_open(names->files[part], paths[part], FSAM_READ_WRITE, FSOM_OPEN_ALWAYS))
+            opened = false;
+    }
+    KeyNamesStatus status = KeyNamesIoError;
+    if(opened) {
+        status = key_names_open(
+            &names->index,
+            key_library_names_read,
+            key_library_names_write,
+            key_library_names_truncate,
+            names);
+    }
+    if(opened && status != KeyNamesOk) {
+        // New, or not to be trusted: one insert per saved key, once, and saves keep it up to
+        // date from then on
+        FURI_LOG_I(TAG, "Indexing saved key names");
+        KeyLibraryNamesBuild build = {.index = &names->index};
+        build.status = key_names_create(
+            &names->index,
+            key_library_names_read,
+            key_library_names_write,
+            key_library_names_truncate,
+            names);
+        if(build.status == KeyNamesOk &&
+           !key_library_for_each(storage, key_library_names_add, &build))
+            build.status = KeyNamesIoError;
+        status = build.status;
+    }
+    if(status != KeyNamesOk) key_library_names_close(names);
+    return status;
+}
+
+void key_library_names_close(KeyLibraryNames* names) {
+    for(size_t part = 0; part < COUNT_OF(names->files); part++) {
+        if(!names->files[part]) continue;
+        storage_file_close(names->files[part]);
+        storage_file_free(names->files[part]);
+        names->files[part] = NULL;
+    }
+}
+
+void key_library_names_update(Storage* storage, const char* old_name, const char* name) {
+    KeyLibraryNames names;
+    if(key_library_names_open(storage, &names) != KeyNamesOk) return;
+    if(old_name) key_names_remove(&names.index, old_name);
+    key_names_insert(&names.index, name);
+    key_library_names_close(&names);
+}
+
+typedef struct {
+    KeyDupes set;
+    File* files[2]; // by KeyDupesPart
+} KeyLibraryDupes;
+
+static bool key_library_dupes_read(
+    KeyDupesPart part,
+    uint32_t offset,
+    void* data,
+    size_t size,
+    void* context) {
+    KeyLibraryDupes* dupes = context;
+    return key_library_file_read(offset, data, size, dupes->files[part]);
+}
+
+static bool key_library_dupes_write(
+    KeyDupesPart part,
+    uint32_t offset,
+    const void* data,
+    size_t size,
+    void* context) {
+    KeyLibraryDupes* dupes = context;
+    return key_library_file_write(offset, data, size, dupes->files[part]);
+}
+
+static void key_library_dupes_close(KeyLibraryDupes* dupes) {
+    for(size_t part = 0; part < COUNT_OF(dupes->files); part++) {
+        if(!dupes->files[part]) continue;
+        storage_file_close(dupes->files[part]);
+        storage_file_free(dupes->files[part]);
+        dupes->files[part] = NULL;
+    }
+}
+
+typedef struct {
+    Storage* storage;
+    KeyDupes* set;
+    KeyDupesStatus status;
+} KeyLibraryDupesBuild;
+
+static bool key_library_dupes_add(const char* name, void* context) {
+    KeyLibraryDupesBuild* build = context;
+    uint32_t format_index;
+    KeyBitting bitting;
+    // Keys that can't be read are left out, as the load screen would refuse them too
+    if(key_library_read(build->storage, name, &format_index, &bitting) != KeyFileOk) return true;
+    KeyDupesStatus status =
+        key_dupes_add(build->set, key_dupes_hash(format_index, &bitting), name, NULL);
+    // and so are keys the set has no room for, such as the ninth copy of one bitting
+    if(status != KeyDupesFull) build->status = status;
+    return build->status == KeyDupesOk;
+}
+
+static KeyDupesStatus key_library_dupes_open(Storage* storage, KeyLibraryDupes* dupes) {
+    const char* paths[] = {KEY_LIBRARY_DUPES_BUCKETS, KEY_LIBRARY_DUPES_NAMES};
+    bool opened = true;
+    storage_simply_mkdir(storage, STORAGE_APP_DATA_PATH_PREFIX);
+    for(size_t part = 0; part < COUNT_OF(paths); part++) {
+        dupes->files[part] = storage_file_alloc(storage);
+        if(!storage_file_open(dupes->files[part], paths[part], FSAM_READ_WRITE, FSOM_OPEN_ALWAYS))
+            opened = false;
+    }
+    KeyDupesStatus status = KeyDupesIoError;
+    if(opened) {
+        status = key_dupes_open(
+            &dupes->set, key_library_dupes_read, key_library_dupes_write, dupes);
+    }
+    if(opened && status != KeyDupesOk) {
+        // Every saved key is read once here; saves keep the set up to date from then on
+        FURI_LOG_I(TAG, "Hashing saved keys");
+        KeyLibraryDupesBuild build = {.storage = storage, .set = &dupes->set};
+        build.status = key_dupes_create(
+            &dupes->set, key_library_dupes_read, key_library_dupes_write, dupes);
+        if(build.status == KeyDupesOk &&
+           !key_library_for_each(storage, key_library_dupes_add, &build))
+            build.status = KeyDupesIoError;
+        status = build.status;
+    }
+    if(status != KeyDupesOk) key_library_dupes_close(dupes);
+    return status;
+}
+
+typedef struct {
+    Storage* storage;
+    uint32_t format_index;
+    const KeyBitting* bitting;
+    uint32_t hash;
+    const char* name; // of the key being saved
+    FuriString* existing; // NULL when adding name rather than looking for another
+    uint32_t stale; // record of a key that is gone or changed, UINT32_MAX if none was seen
+} KeyLibraryDupesMatch;
+
+// Hashes only point at candidates; the key file has the last word
+static bool key_library_dupes_match(const char* name, uint32_t record, void* context) {
+    KeyLibraryDupesMatch* match = context;
+    uint32_t format_index;
+    KeyBitting bitting;
+    if(key_library_read(match->storage, name, &format_index, &bitting) != KeyFileOk ||
+       key_dupes_hash(format_index, &bitting) != match->hash) {
+        match->stale = record;
+        return false;
+    }
+    if(format_index != match->format_index || !key_bitting_equal(&bitting, match->bitting))
+        return false;
+    bool same_name = !strcmp(name, match->name);
+    if(!match->existing) return same_name;
+    if(same_name) return false; // saving over itself
+    furi_string_set(match->existing, name);
+    return true;
+}
+
+bool key_library_find_duplicate(
+    Storage* storage,
+    uint32_t format_index,
+    const KeyBitting* bitting,
+    const char* name,
+    FuriString* existing) {
+    KeyLibraryDupes dupes;
+    if(key_library_dupes_open(storage, &dupes) != KeyDupesOk) return false;
+    KeyLibraryDupesMatch match = {
+        .storage = storage,
+        .format_index = format_index,
+        .bitting = bitting,
+        .hash = key_dupes_hash(format_index, bitting),
+        .name = name,
+        .existing = existing,
+        .stale = UINT32_MAX,
+    };
+    bool found = key_dupes_find(&dupes.set, match.hash, key_library_dupes_match, &match) ==
+                 KeyDupesOk;
+    key_library_dupes_close(&dupes);
+    return found;
+}
+
+static void key_library_dupes_note(
+    KeyLibraryDupes* dupes,
+    Storage* storage,
+    uint32_t format_index,
+    const KeyBitting* bitting,
+    const char* name) {
+    KeyLibraryDupesMatch match = {
+        .storage = storage,
+        .format_index = format_index,
+        .bitting = bitting,
+        .hash = key_dupes_hash(format_index, bitting),
+        .name = name,
+        .stale = UINT32_MAX,
+    };
+    // Nothing to do when this name is there already, as when a key is saved again unchanged.
+    // Otherwise the entry of a key since renamed or changed is taken over before a new one.
+    KeyDupesStatus status =
+        key_dupes_find(&dupes->set, match.hash, key_library_dupes_match, &match);
+    if(status == KeyDupesNotFound && match.stale != UINT32_MAX) {
+        key_dupes_set_name(&dupes->set, match.stale, name);
+    } else if(status == KeyDupesNotFound) {
+        key_dupes_add(&dupes->set, match.hash, name, NULL);
+    }
+}
+
+void key_library_dupes_update(
+    Storage* storage,
+    uint32_t format_index,
+    const KeyBitting* bitting,
+    const char* name) {
+    KeyLibraryDupes dupes;
+    if(key_library_dupes_open(storage, &dupes) != KeyDupesOk) return;
+    key_library_dupes_note(&dupes, storage, format_index, bitting, name);
+    key_library_dupes_close(&dupes);
+}
+
+// The entry of a name itself, such as the old name of a renamed key
+static bool key_library_dupes_named(const char* name, uint32_t record, void* context) {
+    KeyLibraryDupesMatch* match = context;
+    if(strcmp(name, match->name)) return false;
+    match->stale = record;
+    return true;
+}
+
+static void key_library_dupes_rename(Storage* storage, const char* old_name, const char* name) {
+    KeyLibraryDupes dupes;
+    uint32_t format_index;
+    KeyBitting bitting;
+    if(key_library_read(storage, name, &format_index, &bitting) != KeyFileOk ||
+       key_library_dupes_open(storage, &dupes) != KeyDupesOk)
+        return;
+    KeyLibraryDupesMatch match = {.name = old_name, .stale = UINT32_MAX};
+    if(key_dupes_find(
+           &dupes.set,
+           key_dupes_hash(format_index, &bitting),
+           key_library_dupes_named,
+           &match) == KeyDupesOk)
+        key_dupes_set_name(&dupes.set, match.stale, name);
+    key_library_dupes_close(&dupes);
+}
+
+void key_library_backup_note(Storage* storage, const char* name) {
+    File* file = storage_file_alloc(storage);
+    if(storage_file_open(file, KEY_LIBRARY_BACKUP_JOURNAL, FSAM_WRITE, FSOM_OPEN_APPEND)) {
+        storage_file_write(file, name, strlen(name));
+        storage_file_write(file, "\n", 1);
+    }
+    storage_file_close(file);
+    storage_file_free(file);
+}
+
+static void key_library_backup_path(FuriString* path, uint32_t sequence) {
+    furi_string_printf(
+        path,
+        "%s/%04lu%s",
+        KEY_LIBRARY_BACKUP_FOLDER,
+        (unsigned long)sequence,
+        KEY_LIBRARY_BACKUP_EXTENSION);
+}
+
+// Number of the newest archive, 0 when there is none
+static uint32_t key_library_backup_last(Storage* storage) {
+    File* dir = storage_file_alloc(storage);
+    uint32_t last = 0;
+    if(storage_dir_open(dir, KEY_LIBRARY_BACKUP_FOLDER)) {
+        FileInfo info;
+        char name[32];
+        const size_t ext_len = strlen(KEY_LIBRARY_BACKUP_EXTENSION);
+        while(storage_dir_read(dir, &info, name, sizeof(name))) {
+            size_t len = strlen(name);
+            if(file_info_is_dir(&info) || len <= ext_len ||
+               strcmp(name + len - ext_len, KEY_LIBRARY_BACKUP_EXTENSION))
+                continue;
+            uint32_t sequence = strtoul(name, NULL, 10);
+            if(sequence > last) last = sequence;
+        }
+    }
+    storage_dir_close(dir);
+    storage_file_free(dir);
+    return last;
+}
+
+// What the archives hold: the set finds a name's record by name hash, and the hash file has the
+// number of the archive it is up to date with, then the key_backup_hash of each record as last
+// archived, 0 once removed
+typedef struct {
+    KeyDupes set;
+    File* files[3]; // by KeyDupesPart, then the hash file
+} KeyLibraryManifest;
+
+#define KEY_LIBRARY_MANIFEST_HASHES 2
+#define KEY_LIBRARY_MANIFEST_SEQUENCE 0
+#define KEY_LIBRARY_MANIFEST_HASH(record) (((record) + 1) * sizeof(uint32_t))
+
+static bool key_library_manifest_read(
+    KeyDupesPart part,
+    uint32_t offset,
+    void* data,
+    size_t size,
+    void* context) {
+    KeyLibraryManifest* manifest = context;
+    return key_library_file_read(offset, data, size, manifest->files[part]);
+}
+
+static bool key_library_manifest_write(
+    KeyDupesPart part,
+    uint32_t offset,
+    const void* data,
+    size_t size,
+    void* context) {
+    KeyLibraryManifest* manifest = context;
+    return key_library_file_write(offset, data, size, manifest->files[part]);
+}
+
+static bool
+    key_library_manifest_get(KeyLibraryManifest* manifest, uint32_t offset, uint32_t* value) {
+    return key_library_file_read(
+        offset, value, sizeof(uint32_t), manifest->files[KEY_LIBRARY_MANIFEST_HASHES]);
+}
+
+static bool
+    key_library_manifest_set(KeyLibraryManifest* manifest, uint32_t offset, uint32_t value) {
+    return key_library_file_write(
+        offset, &value, sizeof(uint32_t), manifest->files[KEY_LIBRARY_MANIFEST_HASHES]);
+}
+
+static void key_library_manifest_close(KeyLibraryManifest* manifest) {
+    for(size_t part = 0; part < COUNT_OF(manifest->files); part++) {
+        if(!manifest->files[part]) continue;
+        storage_file_close(manifest->files[part]);
+        storage_file_free(manifest->files[part]);
+        manifest->files[part] = NULL;
+    }
+}
+
+// Open the manifest for the backup after archive last. It starts over empty, for a full backup,
+// when it is missing, broken, or was left behind by a backup cut short.
+static bool key_library_manifest_open(
+    Storage* storage,
+    KeyLibraryManifest* manifest,
+    uint32_t last,
+    bool* full) {
+    const char* paths[] = {
+        KEY_LIBRARY_BACKUP_MANIFEST,
+        KEY_LIBRARY_BACKUP_MANIFEST ".names",
+        KEY_LIBRARY_BACKUP_MANIFEST ".hashes",
+    };
+    bool opened = true;
+    for(size_t part = 0; part < COUNT_OF(paths); part++) {
+        manifest->files[part] = storage_file_alloc(storage);
+        if(!storage_file_open(
+               manifest->files[part], paths[part], FSAM_READ_WRITE, FSOM_OPEN_ALWAYS))
+            opened = false;
+    }
+    if(!opened) return false;
+    uint32_t sequence = 0;
+    *full = !last ||
+            key_dupes_open(
+                &manifest->set, key_library_manifest_read, key_library_manifest_write, manifest) !=
+                KeyDupesOk ||
+            !key_library_manifest_get(manifest, KEY_LIBRARY_MANIFEST_SEQUENCE, &sequence) ||
+            sequence != last;
+    return !*full || key_dupes_create(
+                         &manifest->set,
+                         key_library_manifest_read,
+                         key_library_manifest_write,
+                         manifest) == KeyDupesOk;
+}
+
+typedef struct {
+    Storage* storage;
+    KeyLibraryManifest* manifest;
+    KeyBackupWriter* writer;
+    KeyLibraryBackupTotals* totals;
+    uint8_t* data; // KEY_BACKUP_FILE_MAX + 1, to spot files that are too large
+    bool failed;
+} KeyLibraryBackup;
+
+// Archive name if it changed since it was last archived, or its removal if it is gone
+static bool key_library_backup_key(const char* name, void* context) {
+    KeyLibraryBackup* backup = context;
+    KeyLibraryManifest* manifest = backup->manifest;
+    FuriString* path = furi_string_alloc();
+    key_library_path(path, name);
+    File* file = storage_file_alloc(backup->storage);
+    bool exists =
+        storage_file_open(file, furi_string_get_cstr(path), FSAM_READ, FSOM_OPEN_EXISTING);
+    size_t size = exists ? storage_file_read(file, backup->data, KEY_BACKUP_FILE_MAX + 1) : 0;
+    bool removed = !exists && !storage_file_exists(backup->storage, furi_string_get_cstr(path));
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_string_free(path);
+    if((!exists && !removed) || size > KEY_BACKUP_FILE_MAX) {
+        backup->totals->skipped++;
+        return true;
+    }
+
+    KeyLibraryDupesMatch match = {.name = name, .stale = UINT32_MAX};
+    KeyDupesStatus status = key_dupes_find(
+        &manifest->set, key_backup_hash(name, NULL, 0), key_library_dupes_named, &match);
+    uint32_t archived = 0;
+    if(status == KeyDupesOk &&
+       !key_library_manifest_get(manifest, KEY_LIBRARY_MANIFEST_HASH(match.stale), &archived))
+        status = KeyDupesIoError;
+    uint32_t hash = removed ? 0 : key_backup_hash(name, backup->data, size);
+    if(status == KeyDupesOk && hash == archived) return true;
+    if(status == KeyDupesNotFound && removed) return true;
+    if(status == KeyDupesNotFound) {
+        status = key_dupes_add(
+            &manifest->set, key_backup_hash(name, NULL, 0), name, &match.stale);
+    }
+
+    KeyBackupStatus written =
+        removed ? key_backup_writer_add_removed(backup->writer, name) :
+                  key_backup_writer_add_key(backup->writer, name, backup->data, size);
+    if(status != KeyDupesOk || written != KeyBackupOk ||
+       !key_library_manifest_set(manifest, KEY_LIBRARY_MANIFEST_HASH(match.stale), hash)) {
+        backup->failed = true;
+        return false;
+    }
+    if(removed) {
+        backup->totals->removed++;
+    } else {
+        backup->totals->keys++;
+        backup->totals->key_bytes += size;
+    }
+    return true;
+}
+
+static bool key_library_backup_write(const void* data, size_t size, void* context) {
+    return storage_file_write(context, data, size) == size;
+}
+
+static size_t key_library_backup_read(void* data, size_t size, void* context) {
+    return storage_file_read(context, data, size);
+}
+
+bool key_library_backup(
+    Storage* storage,
+    FuriString* archive_path,
+    KeyLibraryBackupTotals* totals) {
+    memset(totals, 0, sizeof(KeyLibraryBackupTotals));
+    storage_simply_mkdir(storage, STORAGE_APP_DATA_PATH_PREFIX);
+    storage_simply_mkdir(storage, KEY_LIBRARY_BACKUP_FOLDER);
+    uint32_t last = key_library_backup_last(storage);
+    KeyLibraryManifest manifest;
+    if(!key_library_manifest_open(storage, &manifest, last, &totals->full)) {
+        key_library_manifest_close(&manifest);
+        return false;
+    }
+    // Until this backup is done the manifest matches no archive, so one cut short is followed
+    // by a full backup
+    bool result = key_library_manifest_set(&manifest, KEY_LIBRARY_MANIFEST_SEQUENCE, 0);
+
+    // The archive only gets its number once it is complete, so a restore never meets one cut
+    // short
+    File* file = storage_file_alloc(storage);
+    result = result &&
+             storage_file_open(file, KEY_LIBRARY_BACKUP_PARTIAL, FSAM_WRITE, FSOM_CREATE_ALWAYS);
+    KeyLibraryBackup backup = {
+        .storage = storage,
+        .manifest = &manifest,
+        .writer = key_backup_writer_alloc(totals->full, last + 1, key_library_backup_write, file),
+        .totals = totals,
+        .data = malloc(KEY_BACKUP_FILE_MAX + 1),
+        .failed = !result,
+    };
+    if(!backup.failed && totals->full) {
+        if(!key_library_for_each(storage, key_library_backup_key, &backup)) backup.failed = true;
+    } else if(!backup.failed) {
+        // Only the keys saved, renamed or removed since the last backup can have changed
+        File* journal = storage_file_alloc(storage);
+        if(storage_file_open(
+               journal, KEY_LIBRARY_BACKUP_JOURNAL, FSAM_READ, FSOM_OPEN_EXISTING)) {
+            KeyLibraryLineReader reader = {.file = journal};
+            char line[KEY_LIBRARY_NAME_SIZE];
+            while(!backup.failed && key_library_read_line(&reader, line, sizeof(line))) {
+                if(line[0]) key_library_backup_key(line, &backup);
+            }
+        }
+        storage_file_close(journal);
+        storage_file_free(journal);
+    }
+    result = !backup.failed && key_backup_writer_finish(backup.writer) == KeyBackupOk;
+    totals->archive_bytes = storage_file_size(file);
+    storage_file_close(file);
+    storage_file_free(file);
+    key_backup_writer_free(backup.writer);
+    free(backup.data);
+
+    // An incremental backup of nothing is left out, so the archives only grow with changes
+    bool changed = totals->full || totals->keys || totals->removed;
+    uint32_t sequence = changed ? last + 1 : last;
+    if(result && changed) {
+        key_library_backup_path(archive_path, sequence);
+        result = storage_common_rename(
+                     storage, KEY_LIBRARY_BACKUP_PARTIAL, furi_string_get_cstr(archive_path)) ==
+                 FSE_OK;
+    }
+    storage_simply_remove(storage, KEY_LIBRARY_BACKUP_PARTIAL);
+    if(result) {
+        result = key_library_manifest_set(&manifest, KEY_LIBRARY_MANIFEST_SEQUENCE, sequence);
+        storage_simply_remove(storage, KEY_LIBRARY_BACKUP_JOURNAL);
+        totals->sequence = changed ? sequence : 0;
+    }
+    key_library_manifest_close(&manifest);
+    return result;
+}
+
+static bool key_library_backup_is_full(Storage* storage, uint32_t sequence) {
+    FuriString* path = furi_string_alloc();
+    key_library_backup_path(path, sequence);
+    File* file = storage_file_alloc(storage);
+    KeyBackupHeader header;
+    bool full =
+        storage_file_open(file, furi_string_get_cstr(path), FSAM_READ, FSOM_OPEN_EXISTING) &&
+        storage_file_read(file, &header, sizeof(header)) == sizeof(header) &&
+        header.magic == KEY_BACKUP_MAGIC && header.full;
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_string_free(path);
+    return full;
+}
+
+static bool key_library_restore_key(Storage* storage, const KeyBackupRecord* record) {
+    FuriString* path = furi_string_alloc();
+    key_library_path(path, record->name);
+    bool result = true;
+    if(record->type == KeyBackupRecordRemoved) {
+        storage_simply_remove(storage, furi_string_get_cstr(path));
+    } else {
+        File* file = storage_file_alloc(storage);
+        result =
+            storage_file_open(file, furi_string_get_cstr(path), FSAM_WRITE, FSOM_CREATE_ALWAYS) &&
+            storage_file_write(file, record->data, record->size) == record->size;
+        storage_file_close(file);
+        storage_file_free(file);
+    }
+    furi_string_free(path);
+    return result;
+}
+
+static bool key_library_restore_archive(
+    Storage* storage,
+    uint32_t sequence,
+    KeyLibraryRestoreTotals* totals) {
+    FuriString* path = furi_string_alloc();
+    key_library_backup_path(path, sequence);
+    File* file = storage_file_alloc(storage);
+    KeyBackupStatus status = KeyBackupIoError;
+    if(storage_file_open(file, furi_string_get_cstr(path), FSAM_READ, FSOM_OPEN_EXISTING)) {
+        KeyBackupReader* reader = key_backup_reader_alloc(key_library_backup_read, file);
+        KeyBackupHeader header;
+        status = key_backup_reader_header(reader, &header);
+        if(status == KeyBackupOk && header.sequence != sequence) status = KeyBackupCorrupt;
+        KeyBackupRecord record;
+        while(status == KeyBackupOk || status == KeyBackupBadHash) {
+            status = key_backup_reader_next(reader, &record);
+            if(status == KeyBackupBadHash) {
+                // The key is left as it is rather than overwritten with something damaged
+                FURI_LOG_E(TAG, "Bad hash for %s", record.name);
+                totals->bad++;
+            } else if(status != KeyBackupOk) {
+                break;
+            } else if(!key_library_restore_key(storage, &record)) {
+                status = KeyBackupIoError;
+            } else if(record.type == KeyBackupRecordRemoved) {
+                totals->removed++;
+            } else {
+                totals->keys++;
+            }
+        }
+        key_backup_reader_free(reader);
+    }
+    storage_file_close(file);
+    storage_file_free(file);
+    if(status != KeyBackupEnd) FURI_LOG_E(TAG, "Restore of %s failed", furi_string_get_cstr(path));
+    furi_string_free(path);
+    totals->archives++;
+    return status == KeyBackupEnd;
+}
+
+bool key_library_restore(Storage* storage, KeyLibraryRestoreTotals* totals) {
+    memset(totals, 0, sizeof(KeyLibraryRestoreTotals));
+    uint32_t last = key_library_backup_last(storage);
+    if(!last) return false;
+    // The newest full archive and the ones after it make up the library as last backed up
+    uint32_t first = last;
+    while(first > 1 && !key_library_backup_is_full(storage, first)) first--;
+    bool result = true;
+    for(uint32_t sequence = first; sequence <= last; sequence++) {
+        result = key_library_restore_archive(storage, sequence, totals) && result;
+    }
+    // The restored keys are rehashed and indexed the next time they are looked for
+    storage_simply_remove(storage, KEY_LIBRARY_NAMES_DIRECTORY);
+    storage_simply_remove(storage, KEY_LIBRARY_DUPES_BUCKETS);
+    return result;
+}
+
+bool key_library_rename(Storage* storage, const char* path, const char* name) {
+    FuriString* old_name = furi_string_alloc();
+    FuriString* new_path = furi_string_alloc();
+    path_extract_filename_no_ext(path, old_name);
+    key_library_path(new_path, name);
+    bool result =
+        !storage_file_exists(storage, furi_string_get_cstr(new_path)) &&
+        storage_common_rename(storage, path, furi_string_get_cstr(new_path)) == FSE_OK;
+    if(result) {
+        key_library_names_update(storage, furi_string_get_cstr(old_name), name);
+        key_library_dupes_rename(storage, furi_string_get_cstr(old_name), name);
+        key_library_backup_note(storage, furi_string_get_cstr(old_name));
+        key_library_backup_note(storage, name);
+    }
+    furi_string_free(new_path);
+    furi_string_free(old_name);
+    return result;
+}
+
+// Gathers small writes into whole buffers, since every storage call is a round trip to the
+// storage thread
+typedef struct {
+    File* file;
+    uint16_t size;
+    char buffer[512];
+} KeyLibraryWriter;
+
+static bool key_library_writer_flush(KeyLibraryWriter* writer) {
+    bool result = storage_file_write(writer->file, writer->buffer, writer->size) == writer->size;
+    writer->size = 0;
+    return result;
+}
+
+static bool key_library_writer_write(const char* text, size_t size, void* context) {
+    KeyLibraryWriter* writer = context;
+    if(writer->size + size > sizeof(writer->buffer) && !key_library_writer_flush(writer))
+        return false;
+    if(size > sizeof(writer->buffer)) return storage_file_write(writer->file, text, size) == size;
+    memcpy(writer->buffer + writer->size, text, size);
+    writer->size += size;
+    return true;
+}
+
+bool key_library_write_path(
+    Storage* storage,
+    const char* path,
+    uint32_t format_index,
+    const KeyBitting* bitting,
+    const KeyHistory* history) {
+    KeyLibraryWriter* writer = malloc(sizeof(KeyLibraryWriter));
+    writer->file = storage_file_alloc(storage);
+    writer->size = 0;
+    bool result =
+        storage_file_open(writer->file, path, FSAM_WRITE, FSOM_CREATE_ALWAYS) &&
+        key_file_write(format_index, bitting, history, key_library_writer_write, writer) &&
+        key_library_writer_flush(writer);
+    storage_file_close(writer->file);
+    storage_file_free(writer->file);
+    free(writer);
+    return result;
+}
+
+// Write a key to a file that must not be there yet. taken is set when one was; a file left half
+// written is removed, so the name is free when the key is tried again.
+static bool key_library_write_new(
+    Storage* storage,
+    const char* path,
+    uint32_t format_index,
+    const KeyBitting* bitting,
+    bool* taken) {
+    KeyLibraryWriter* writer = malloc(sizeof(KeyLibraryWriter));
+    writer->file = storage_file_alloc(storage);
+    writer->size = 0;
+    bool opened = storage_file_open(writer->file, path, FSAM_WRITE, FSOM_CREATE_NEW);
+    bool result = opened &&
+                  key_file_write(format_index, bitting, NULL, key_library_writer_write, writer) &&
+                  key_library_writer_flush(writer);
+    storage_file_close(writer->file);
+    storage_file_free(writer->file);
+    free(writer);
+    *taken = !opened && storage_file_exists(storage, path);
+    if(opened && !result) storage_common_remove(storage, path);
+    return result;
+}
+
+typedef struct {
+    const char* base;
+    size_t base_length;
+    uint32_t last;
+} KeyLibrarySeries;
+
+static bool key_library_series_number(const char* name, void* context) {
+    KeyLibrarySeries* series = context;
+    const char* digits = name + series->base_length + 1;
+    if(name[series->base_length] != ' ' || !*digits) return true;
+    for(const char* c = digits; *c; c++) {
+        if(*c < '0' || *c > '9') return true;
+    }
+    uint32_t number = strtoul(digits, NULL, 10);
+    if(number > series->last) series->last = number;
+    return true;
+}
+
+uint32_t key_library_next_in_series(Storage* storage, const char* base) {
+    KeyLibrarySeries series = {.base = base, .base_length = strlen(base)};
+    KeyLibraryNames names;
+    if(key_library_names_open(storage, &names) == KeyNamesOk) {
+        key_names_search(&names.index, base, key_library_series_number, &series);
+        key_library_names_close(&names);
+    }
+    return series.last + 1;
+}
+
+size_t key_library_save_batch(Storage* storage, KeyLibraryBatchKey* keys, size_t count) {
+    // Each index is opened once for the whole batch rather than once per key. The duplicate set
+    // is noted as keys are written, so each is also checked against those before it.
+    KeyLibraryDupes dupes;
+    bool dupes_open = key_library_dupes_open(storage, &dupes) == KeyDupesOk;
+    FuriString* path = furi_string_alloc();
+    FuriString* existing = furi_string_alloc();
+    size_t done = 0;
+    for(; done < count; done++) {
+        KeyLibraryBatchKey* key = &keys[done];
+        key->duplicate[0] = '\0';
+        key_library_path(path, key->name);
+        if(!key_library_write_new(
+               storage,
+               furi_string_get_cstr(path),
+               key->format_index,
+               &key->bitting,
+               &key->name_taken)) {
+            if(key->name_taken) continue;
+            break;
+        }
+        if(!dupes_open) continue;
+        KeyLibraryDupesMatch match = {
+            .storage = storage,
+            .format_index = key->format_index,
+            .bitting = &key->bitting,
+            .hash = key_dupes_hash(key->format_index, &key->bitting),
+            .name = key->name,
+            .existing = existing,
+            .stale = UINT32_MAX,
+        };
+        if(key_dupes_find(&dupes.set, match.hash, key_library_dupes_match, &match) ==
+           KeyDupesOk) {
+            strncpy(key->duplicate, furi_string_get_cstr(existing), sizeof(key->duplicate) - 1);
+            key->duplicate[sizeof(key->duplicate) - 1] = '\0';
+        }
+        key_library_dupes_note(&dupes, storage, key->format_index, &key->bitting, key->name);
+    }
+    furi_string_free(existing);
+    furi_string_free(path);
+    if(dupes_open) key_library_dupes_close(&dupes);
+
+    KeyLibraryNames names;
+    if(key_library_names_open(storage, &names) == KeyNamesOk) {
+        for(size_t i = 0; i < done; i++) {
+            if(!keys[i].name_taken) key_names_insert(&names.index, keys[i].name);
+        }
+        key_library_names_close(&names);
+    }
+    KeyLibraryWriter* journal = malloc(sizeof(KeyLibraryWriter));
+    journal->file = storage_file_alloc(storage);
+    journal->size = 0;
+    if(storage_file_open(
+           journal->file, KEY_LIBRARY_BACKUP_JOURNAL, FSAM_WRITE, FSOM_OPEN_APPEND)) {
+        for(size_t i = 0; i < done; i++) {
+            if(keys[i].name_taken) continue;
+            key_library_writer_write(keys[i].name, strlen(keys[i].name), journal);
+            key_library_writer_write("\n", 1, journal);
+        }
+        key_library_writer_flush(journal);
+    }
+    storage_file_close(journal->file);
+    storage_file_free(journal->file);
+    free(journal);
+    return done;
+}
+
+typedef struct {
+    KeyLibraryLineReader reader;
+    KeyLibraryWriter plan;
+} KeyLibraryJob;
+
+static bool key_library_job_read_line(char* line, size_t size, void* context) {
+    KeyLibraryJob* job = context;
+    return key_library_read_line(&job->reader, line, size);
+}
+
+// Read the job again from its first line
+static bool key_library_job_rewind(void* context) {
+    KeyLibraryJob* job = context;
+    job->reader.size = 0;
+    job->reader.position = 0;
+    return storage_file_seek(job->reader.file, 0, true);
+}
+
+static bool key_library_job_write(const char* text, size_t size, void* context) {
+    KeyLibraryJob* job = context;
+    return key_library_writer_write(text, size, &job->plan);
+}
+
+// Flush and close a job; returns whether it ran and everything reached the card
+static bool key_library_job_close(KeyLibraryJob* job, bool result) {
+    result = result && key_library_writer_flush(&job->plan);
+    storage_file_close(job->plan.file);
+    storage_file_free(job->plan.file);
+    storage_file_close(job->reader.file);
+    storage_file_free(job->reader.file);
+    free(job);
+    return result;
+}
+
+// Open a job and the output file named after it, ending in output_extension instead of
+// input_extension. Returns NULL when either file can't be opened.
+static KeyLibraryJob* key_library_job_open(
+    Storage* storage,
+    const char* input_path,
+    const char* input_extension,
+    const char* output_extension,
+    FuriString* output_path) {
+    furi_string_set(output_path, input_path);
+    if(furi_string_end_with_str(output_path, input_extension)) {
+        furi_string_left(output_path, furi_string_size(output_path) - strlen(input_extension));
+    }
+    furi_string_cat_str(output_path, output_extension);
+
+    KeyLibraryJob* job = malloc(sizeof(KeyLibraryJob));
+    memset(job, 0, sizeof(KeyLibraryJob));
+    job->reader.file = storage_file_alloc(storage);
+    job->plan.file = storage_file_alloc(storage);
+    if(!storage_file_open(job->reader.file, input_path, FSAM_READ, FSOM_OPEN_EXISTING) ||
+       !storage_file_open(
+           job->plan.file, furi_string_get_cstr(output_path), FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        key_library_job_close(job, false);
+        return NULL;
+    }
+    return job;
+}
+
+bool key_library_plan_job(
+    Storage* storage,
+    const char* job_path,
+    uint32_t format_index,
+    FuriString* plan_path,
+    KeyPinningTotals* totals) {
+    KeyLibraryJob* job = key_library_job_open(
+        storage, job_path, KEY_LIBRARY_JOB_EXTENSION, KEY_LIBRARY_PLAN_EXTENSION, plan_path);
+    if(!job) return false;
+    return key_library_job_close(
+        job,
+        key_pinning_run(
+            format_index, key_library_job_read_line, key_library_job_write, job, totals));
+}
+
+bool key_library_decode_calipers(
+    Storage* storage,
+    const char* batch_path,
+    uint32_t format_index,
+    FuriString* decoded_path,
+    KeyCaliperTotals* totals) {
+    KeyLibraryJob* job = key_library_job_open(
+        storage,
+        batch_path,
+        KEY_LIBRARY_CALIPER_EXTENSION,
+        KEY_LIBRARY_DECODED_EXTENSION,
+        decoded_path);
+    if(!job) return false;
+    return key_library_job_close(
+        job,
+        key_caliper_run(
+            format_index, key_library_job_read_line, key_library_job_write, job, totals));
+}
+
+bool key_library_export_gcode(
+    Storage* storage,
+    const char* queue_path,
+    uint32_t format_index,
+    FuriString* gcode_path,
+    KeyGcodeTotals* totals) {
+    KeyLibraryJob* job = key_library_job_open(
+        storage, queue_path, KEY_LIBRARY_QUEUE_EXTENSION, KEY_LIBRARY_GCODE_EXTENSION, gcode_path);
+    if(!job) return false;
+    return key_library_job_close(
+        job,
+        key_gcode_run(
+            format_index,
+            key_library_job_read_line,
+            key_library_job_rewind,
+            key_library_job_write,
+            job,
+            totals));
+}
@@ -0,0 +1,217 @@
+#ifndef KEY_LIBRARY_H
+#define KEY_LIBRARY_H
+
+#include "key_backup.h"
+#include "key_bitting.h"
+#include "key_caliper.h"
+#include "key_codebook.h"
+#include "key_dupes.h"
+#include "key_file.h"
+#include "key_gcode.h"
+#include "key_names.h"
+#include "key_pinning.h"
+#include "key_render.h"
+#include <applications/services/storage/storage.h>
+#include <furi.h>
+
+#define KEY_LIBRARY_NAME_SIZE KEY_NAMES_NAME_SIZE
+
+// Code books are compiled from "<format name>.txt" sources in this folder
+#define KEY_LIBRARY_CODEBOOK_FOLDER STORAGE_APP_DATA_PATH_PREFIX "/codebooks"
+#define KEY_LIBRARY_CODEBOOK_EXTENSION ".kcb"
+// Rekey jobs are .csv files in the app data folder; each plan is written next to its job
+#define KEY_LIBRARY_JOB_EXTENSION ".csv"
+#define KEY_LIBRARY_PLAN_EXTENSION ".plan.txt"
+// Caliper batches work the same way
+#define KEY_LIBRARY_CALIPER_EXTENSION ".cal"
+#define KEY_LIBRARY_DECODED_EXTENSION ".decoded.txt"
+// And cutting queues, whose toolpath is written as G-code
+#define KEY_LIBRARY_QUEUE_EXTENSION ".queue"
+#define KEY_LIBRARY_GCODE_EXTENSION ".nc"
+
+// Called for every saved key, with the file name minus extension. Return false to stop.
+typedef bool (*KeyLibraryCallback)(const char* name, void* context);
+
+// Walk all .keycopy files in the app data folder
+bool key_library_for_each(Storage* storage, KeyLibraryCallback callback, void* context);
+
+// Full path of a saved key
+void key_library_path(FuriString* path, const char* name);
+
+// Read the format and bitting of a saved key, and its history when history is not NULL
+KeyFileStatus key_library_read_path(
+    Storage* storage,
+    const char* path,
+    uint32_t* format_index,
+    KeyBitting* bitting,
+    KeyHistory* history);
+
+KeyFileStatus key_library_read(
+    Storage* storage,
+    const char* name,
+    uint32_t* format_index,
+    KeyBitting* bitting);
+
+bool key_library_write_path(
+    Storage* storage,
+    const char* path,
+    uint32_t format_index,
+    const KeyBitting* bitting,
+    const KeyHistory* history);
+
+// Open the code book of a format, compiling it first when the source is new or changed
+KeyCodebookStatus
+    key_library_codebook_open(Storage* storage, uint32_t format_index, KeyCodebook* book);
+
+void key_library_codebook_close(KeyCodebook* book);
+
+// Load browser icons are cached in one file of hashed slots. A slot is found by the key's path,
+// size and modification time, so a hit costs no read of the key file, and a key's icon is only
+// rendered again when its file changes.
+#define KEY_LIBRARY_THUMBNAIL_CACHE STORAGE_APP_DATA_PATH_PREFIX "/.thumbnails"
+#define KEY_LIBRARY_THUMBNAIL_SLOTS 256
+
+typedef struct {
+    Storage* storage;
+    File* cache; // NULL when the cache could not be opened; icons are still rendered
+    int32_t format_index; // of geometry, -1 before the first icon
+    KeyFormat format;
+    KeyRenderGeometry geometry;
+} KeyLibraryThumbnails;
+
+void key_library_thumbnails_open(KeyLibraryThumbnails* thumbnails, Storage* storage);
+
+// Fill xbm with the icon of the saved key at path. Safe to call from the file browser worker.
+bool key_library_thumbnail(KeyLibraryThumbnails* thumbnails, const char* path, uint8_t* xbm);
+
+void key_library_thumbnails_close(KeyLibraryThumbnails* thumbnails);
+
+// Saved key names are indexed for search in two files beside the keys, kept up to date as keys
+// are saved
+#define KEY_LIBRARY_NAMES_BLOCKS STORAGE_APP_DATA_PATH_PREFIX "/.names"
+#define KEY_LIBRARY_NAMES_DIRECTORY STORAGE_APP_DATA_PATH_PREFIX "/.names.dir"
+
+typedef struct {
+    KeyNames index;
+    File* files[2]; // by KeyNamesPart
+} KeyLibraryNames;
+
+// Open the name index, building it from the saved keys when it is missing, from another build
+// or an update of it was cut short
+KeyNamesStatus key_library_names_open(Storage* storage, KeyLibraryNames* names);
+
+void key_library_names_close(KeyLibraryNames* names);
+
+// Note a key saved as name, or renamed to it from old_name when that is not NULL. An update cut
+// short leaves the index to be rebuilt when it is next opened.
+void key_library_names_update(Storage* storage, const char* old_name, const char* name);
+
+// Saved keys are also hashed by format and bitting, to catch the same key saved twice
+#define KEY_LIBRARY_DUPES_BUCKETS STORAGE_APP_DATA_PATH_PREFIX "/.dupes"
+#define KEY_LIBRARY_DUPES_NAMES STORAGE_APP_DATA_PATH_PREFIX "/.dupes.names"
+
+// Look for a key of this format and bitting saved under a name other than name, and put its
+// name in existing. The set is built from the saved keys the first time, and whenever an update
+// of it was cut short. False when there is none, or the set can't be read.
+bool key_library_find_duplicate(
+    Storage* storage,
+    uint32_t format_index,
+    const KeyBitting* bitting,
+    const char* name,
+    FuriString* existing);
+
+// Note a key just saved as name in the set
+void key_library_dupes_update(
+    Storage* storage,
+    uint32_t format_index,
+    const KeyBitting* bitting,
+    const char* name);
+
+// Rename the saved key at path, keeping the name index and the set up to date. False when a key
+// of that name already exists or the card refuses.
+bool key_library_rename(Storage* storage, const char* path, const char* name);
+
+// Backups are numbered archives in this folder: a full one, then the keys saved, renamed or
+// removed since the one before. Saves append the name to a journal, which the next backup reads
+// instead of the whole library, and a manifest of what the archives hold drops keys saved again
+// unchanged.
+#define KEY_LIBRARY_BACKUP_FOLDER STORAGE_APP_DATA_PATH_PREFIX "/backups"
+#define KEY_LIBRARY_BACKUP_EXTENSION ".kkb"
+#define KEY_LIBRARY_BACKUP_PARTIAL KEY_LIBRARY_BACKUP_FOLDER "/next.tmp"
+#define KEY_LIBRARY_BACKUP_MANIFEST KEY_LIBRARY_BACKUP_FOLDER "/manifest"
+#define KEY_LIBRARY_BACKUP_JOURNAL STORAGE_APP_DATA_PATH_PREFIX "/.backup.journal"
+
+typedef struct {
+    bool full;
+    uint32_t sequence; // of the archive written, 0 when nothing had changed
+    uint32_t keys;
+    uint32_t removed;
+    uint32_t skipped; // unreadable or too large
+    uint32_t key_bytes;
+    uint32_t archive_bytes;
+} KeyLibraryBackupTotals;
+
+// Queue a key saved, or renamed to or from name, for the next backup
+void key_library_backup_note(Storage* storage, const char* name);
+
+// Write the next archive, to archive_path. It is a full backup the first time, and whenever the
+// manifest does not match the newest archive.
+bool key_library_backup(
+    Storage* storage,
+    FuriString* archive_path,
+    KeyLibraryBackupTotals* totals);
+
+typedef struct {
+    uint32_t archives;
+    uint32_t keys;
+    uint32_t removed;
+    uint32_t bad; // failed their hash and were left alone
+} KeyLibraryRestoreTotals;
+
+// Replay the newest full archive and every one after it. Keys are written one at a time as they
+// stream out, each only once its hash checks out; saved keys the archives never held are kept.
+bool key_library_restore(Storage* storage, KeyLibraryRestoreTotals* totals);
+
+// The number after the highest "<base> <number>" name saved, or 1 for a new series
+uint32_t key_library_next_in_series(Storage* storage, const char* base);
+
+typedef struct {
+    char name[KEY_LIBRARY_NAME_SIZE];
+    uint32_t format_index;
+    KeyBitting bitting;
+    // Set by key_library_save_batch
+    bool name_taken; // another file had the name first; it was left alone and this key not saved
+    char duplicate[KEY_LIBRARY_NAME_SIZE]; // a key saved before with the same bitting, or ""
+} KeyLibraryBatchKey;
+
+// Save keys measured in a row, without history, each only under a name not yet taken. The name
+// index, the duplicate set and the backup journal are each opened once for the lot. Returns how
+// many were dealt with, in order: each of those was saved or had its name taken. The rest could
+// not be written and are not.
+size_t key_library_save_batch(Storage* storage, KeyLibraryBatchKey* keys, size_t count);
+
+// Plan a rekey job file, writing the pin list and totals to plan_path
+bool key_library_plan_job(
+    Storage* storage,
+    const char* job_path,
+    uint32_t format_index,
+    FuriString* plan_path,
+    KeyPinningTotals* totals);
+
+// Decode a caliper batch file, writing the bittings and totals to decoded_path
+bool key_library_decode_calipers(
+    Storage* storage,
+    const char* batch_path,
+    uint32_t format_index,
+    FuriString* decoded_path,
+    KeyCaliperTotals* totals);
+
+// Write the toolpath of a cutting queue file to gcode_path
+bool key_library_export_gcode(
+    Storage* storage,
+    const char* queue_path,
+    uint32_t format_index,
+    FuriString* gcode_path,
+    KeyGcodeTotals* totals);
+
+#endif // KEY_LIBRARY_H
@@ -0,0 +1,49 @@
+#include "key_macs.h"
+
+static uint16_t key_macs_span(uint8_t low, uint8_t high) {
+    return (uint16_t)(((2u << high) - 1) & ~((1u << low) - 1));
+}
+
+// Depths within macs of depth, or every depth for a missing neighbour
+static uint16_t key_macs_near(uint8_t depth, uint8_t macs) {
+    if(depth == KEY_MACS_NONE) return key_macs_span(0, KEY_BITTING_MAX_DEPTH);
+    return key_macs_span(
+        depth > macs ? depth - macs : 0,
+        depth + macs < KEY_BITTING_MAX_DEPTH ? depth + macs : KEY_BITTING_MAX_DEPTH);
+}
+
+void key_macs_table(KeyMacsTable* table, const KeyFormat* format) {
+    uint16_t range = key_macs_span(format->min_depth_ind, format->max_depth_ind);
+    for(uint8_t left = 0; left < KEY_MACS_NEIGHBOURS; left++) {
+        uint16_t near_left = range & key_macs_near(left, format->macs);
+        for(uint8_t right = 0; right < KEY_MACS_NEIGHBOURS; right++) {
+            table->allowed[left][right] = near_left & key_macs_near(right, format->macs);
+        }
+    }
+}
+
+int8_t key_macs_step(
+    const KeyMacsTable* table,
+    const KeyBitting* bitting,
+    uint8_t pin_num,
+    uint8_t pin,
+    bool deeper,
+    uint8_t* blocker) {
+    uint8_t depth = key_bitting_get(bitting, pin);
+    uint16_t allowed = key_macs_allowed(table, bitting, pin_num, pin);
+    uint16_t ahead = deeper ? allowed & ~((2u << depth) - 1) : allowed & ((1u << depth) - 1);
+    if(ahead) return deeper ? __builtin_ctz(ahead) : 31 - __builtin_clz(ahead);
+
+    // Nothing past this depth: blame the neighbour that rules out the very next one
+    uint8_t next = deeper ? depth + 1 : depth - 1;
+    uint8_t left = pin > 0 ? key_bitting_get(bitting, pin - 1) : KEY_MACS_NONE;
+    if(depth == (deeper ? KEY_BITTING_MAX_DEPTH : 0) ||
+       !(table->allowed[KEY_MACS_NONE][KEY_MACS_NONE] & (1u << next))) {
+        *blocker = KEY_MACS_RANGE;
+    } else if(!(table->allowed[left][KEY_MACS_NONE] & (1u << next))) {
+        *blocker = pin - 1;
+    } else {
+        *blocker = pin + 1;
+    }
+    return -1;
+}
@@ -0,0 +1,43 @@
+#ifndef KEY_MACS_H
+#define KEY_MACS_H
+
+#include "key_bitting.h"
+#include "key_formats.h"
+
+// Neighbour index of the missing neighbour of an end pin
+#define KEY_MACS_NONE (KEY_BITTING_MAX_DEPTH + 1)
+#define KEY_MACS_NEIGHBOURS (KEY_MACS_NONE + 1)
+// Blocker of a step that ran into the end of the depth range rather than a neighbour
+#define KEY_MACS_RANGE 0xFF
+
+// Depths a cut may take next to each pair of neighbour depths, bit d for depth d, built once per
+// format. A depth is allowed when it is in the format's range and within the MACS of both
+// neighbours, so checking a cut is one lookup. 578 bytes.
+typedef struct {
+    uint16_t allowed[KEY_MACS_NEIGHBOURS][KEY_MACS_NEIGHBOURS]; // [left][right]
+} KeyMacsTable;
+
+void key_macs_table(KeyMacsTable* table, const KeyFormat* format);
+
+static inline uint16_t key_macs_allowed(
+    const KeyMacsTable* table,
+    const KeyBitting* bitting,
+    uint8_t pin_num,
+    uint8_t pin) {
+    uint8_t left = pin > 0 ? key_bitting_get(bitting, pin - 1) : KEY_MACS_NONE;
+    uint8_t right = pin + 1 < pin_num ? key_bitting_get(bitting, pin + 1) : KEY_MACS_NONE;
+    return table->allowed[left][right];
+}
+
+// The nearest allowed depth of pin past its current one, deeper when deeper is set. Returns -1
+// when there is none, with blocker set to the neighbour pin that stops the step, or to
+// KEY_MACS_RANGE at the end of the range.
+int8_t key_macs_step(
+    const KeyMacsTable* table,
+    const KeyBitting* bitting,
+    uint8_t pin_num,
+    uint8_t pin,
+    bool deeper,
+    uint8_t* blocker);
+
+#endif // KEY_MACS_H
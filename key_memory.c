@@ -0,0 +1,145 @@
+#include "key_memory.h"
+#include <stdio.h>
+
+#define TAG "KeyMemory"
+
+typedef struct {
+    KeyMemoryProbe probes[KEY_MEMORY_PROBES];
+    uint32_t count;
+    FuriThreadId app_thread;
+    uint32_t app_free_stack; // least free stack each thread reached inside a probe
+    uint32_t gui_free_stack;
+} KeyMemory;
+
+static KeyMemory key_memory;
+
+void key_memory_init(void) {
+    memset(&key_memory, 0, sizeof(key_memory));
+    key_memory.app_thread = furi_thread_get_current_id();
+    key_memory.app_free_stack = UINT32_MAX;
+    key_memory.gui_free_stack = UINT32_MAX;
+}
+
+KeyMemorySample key_memory_begin(void) {
+    KeyMemorySample sample = {
+        .free_heap = memmgr_get_free_heap(),
+        .min_free_heap = memmgr_get_minimum_free_heap(),
+        .free_stack = furi_thread_get_stack_space(furi_thread_get_current_id()),
+    };
+    return sample;
+}
+
+static KeyMemoryProbe* key_memory_probe(const char* name, bool gui) {
+    for(uint32_t i = 0; i < key_memory.count; i++) {
+        if(key_memory.probes[i].name == name) return &key_memory.probes[i];
+    }
+    if(key_memory.count == KEY_MEMORY_PROBES) return NULL;
+    KeyMemoryProbe* probe = &key_memory.probes[key_memory.count++];
+    probe->name = name;
+    probe->free_stack = UINT32_MAX;
+    probe->gui = gui;
+    return probe;
+}
+
+static bool key_memory_over(const KeyMemoryProbe* probe) {
+    return probe->free_stack < KEY_MEMORY_STACK_RESERVE ||
+           probe->heap_peak > KEY_MEMORY_HEAP_BUDGET;
+}
+
+void key_memory_end(const char* name, const KeyMemorySample* sample) {
+    FuriThreadId thread = furi_thread_get_current_id();
+    uint32_t free_stack = furi_thread_get_stack_space(thread);
+    uint32_t free_heap = memmgr_get_free_heap();
+    uint32_t min_free_heap = memmgr_get_minimum_free_heap();
+    bool gui = thread != key_memory.app_thread;
+
+    FURI_CRITICAL_ENTER();
+    KeyMemoryProbe* probe = key_memory_probe(name, gui);
+    if(probe) {
+        probe->calls++;
+        probe->heap_delta = (int32_t)(sample->free_heap - free_heap);
+        if(free_stack < sample->free_stack && free_stack < probe->free_stack)
+            probe->free_stack = free_stack;
+        if(min_free_heap < sample->min_free_heap &&
+           sample->free_heap - min_free_heap > probe->heap_peak)
+            probe->heap_peak = sample->free_heap - min_free_heap;
+    }
+    uint32_t* thread_free_stack = gui ? &key_memory.gui_free_stack : &key_memory.app_free_stack;
+    if(free_stack < *thread_free_stack) *thread_free_stack = free_stack;
+    FURI_CRITICAL_EXIT();
+#ifdef KEY_MEMORY_STRICT
+    if(probe && key_memory_over(probe)) {
+        FURI_LOG_E(TAG, "%s is over the memory budget", name);
+        furi_crash("Over the memory budget");
+    }
+#endif
+}
+
+const char* key_memory_check(void) {
+    for(uint32_t i = 0; i < key_memory.count; i++) {
+        if(key_memory_over(&key_memory.probes[i])) return key_memory.probes[i].name;
+    }
+    return NULL;
+}
+
+static size_t key_memory_stack_text(char* text, size_t size, uint32_t free_stack) {
+    if(free_stack == UINT32_MAX) return snprintf(text, size, "-");
+    return snprintf(text, size, "%lu", (unsigned long)free_stack);
+}
+
+size_t key_memory_report(char* text, size_t size) {
+    const char* over = key_memory_check();
+    char app[12];
+    char gui[12];
+    key_memory_stack_text(app, sizeof(app), key_memory.app_free_stack);
+    key_memory_stack_text(gui, sizeof(gui), key_memory.gui_free_stack);
+    size_t length = snprintf(
+        text,
+        size,
+        "Free stack: app %s, gui %s\nFree heap: %lu, low %lu\nBudget: %s%s\n",
+        app,
+        gui,
+        (unsigned long)memmgr_get_free_heap(),
+        (unsigned long)memmgr_get_minimum_free_heap(),
+        over ? "over in " : "ok",
+        over ? over : "");
+    for(uint32_t i = 0; i < key_memory.count && length < size; i++) {
+        const KeyMemoryProbe* probe = &key_memory.probes[i];
+        char stack[12];
+        key_memory_stack_text(stack, sizeof(stack), probe->free_stack);
+        length += snprintf(
+            text + length,
+            size - length,
+            "\n%s x%lu\n stack %s, heap %ld, peak %lu",
+            probe->name,
+            (unsigned long)probe->calls,
+            stack,
+            (long)probe->heap_delta,
+            (unsigned long)probe->heap_peak);
+    }
+    return length < size ? length : size - 1;
+}
+
+void key_memory_log(void) {
+    FURI_LOG_I(
+        TAG,
+        "free stack app %lu gui %lu, free heap %lu low %lu",
+        (unsigned long)key_memory.app_free_stack,
+        (unsigned long)key_memory.gui_free_stack,
+        (unsigned long)memmgr_get_free_heap(),
+        (unsigned long)memmgr_get_minimum_free_heap());
+    for(uint32_t i = 0; i < key_memory.count; i++) {
+        const KeyMemoryProbe* probe = &key_memory.probes[i];
+        FURI_LOG_I(
+            TAG,
+            "%s %s calls %lu free stack %lu heap delta %ld peak %lu",
+            probe->name,
+            probe->gui ? "gui" : "app",
+            (unsigned long)probe->calls,
+            (unsigned long)probe->free_stack,
+            (long)probe->heap_delta,
+            (unsigned long)probe->heap_peak);
+    }
+    const char* over = key_memory_check();
+    if(over) FURI_LOG_E(TAG, "%s is over the memory budget", over);
+}
@@ -0,0 +1,68 @@
+#ifndef KEY_MEMORY_H
+#define KEY_MEMORY_H
+
+#include <furi.h>
+
+// Probes kept, one per view transition and per instrumented call; names past this many are not
+// recorded
+#define KEY_MEMORY_PROBES 64
+
+// Budgets for key_memory_check. The app thread only has the 4 KB set in application.fam, and
+// the firmware calls we make from a callback need some of it after we return.
+#define KEY_MEMORY_STACK_RESERVE 768 // least free stack a probe may leave on its thread
+// Most heap one call may hold at its peak. The analysis holds two blocks of 256 keys at once, for
+// close to 11 KB in all.
+#define KEY_MEMORY_HEAP_BUDGET (16 * 1024)
+// Strict builds stop the app at the first call over budget, so a test session cannot miss a
+// regression. Debug builds are strict; KEY_MEMORY_STRICT in application.fam cdefines makes any
+// build so. host/key_memory_test holds the calls that build on a PC to the same budgets.
+#if defined(FURI_DEBUG) && !defined(KEY_MEMORY_STRICT)
+#define KEY_MEMORY_STRICT
+#endif
+
+#define KEY_MEMORY_REPORT_SIZE 3072
+
+typedef struct {
+    uint32_t free_heap;
+    uint32_t min_free_heap;
+    uint32_t free_stack;
+} KeyMemorySample;
+
+// The stack and heap figures are low-water marks of the thread and of the whole heap, so a probe
+// only gets a peak for the calls that set a new low. Those are the ones that matter for headroom.
+typedef struct {
+    const char* name;
+    uint32_t calls;
+    uint32_t free_stack; // least free stack on its thread at a new low, UINT32_MAX if none
+    uint32_t heap_peak; // most heap taken during one call at a new low
+    int32_t heap_delta; // heap still held after the last call, from every thread
+    bool gui; // runs on the GUI thread rather than the app thread
+} KeyMemoryProbe;
+
+// Remember the calling thread as the app thread. Call once before sampling.
+void key_memory_init(void);
+
+KeyMemorySample key_memory_begin(void);
+
+// Record one call. name must be a string literal, only the pointer is kept.
+void key_memory_end(const char* name, const KeyMemorySample* sample);
+
+// Name of the first probe over budget, or NULL when all are within it
+const char* key_memory_check(void);
+
+// Summary for the memory screen; returns the text length
+size_t key_memory_report(char* text, size_t size);
+
+// Every probe, to the log
+void key_memory_log(void);
+
+#ifdef KEY_MEMORY_DISABLE
+#define KEY_MEMORY_BEGIN()
+#define KEY_MEMORY_END(name)
+#else
+// One pair per function: BEGIN declares the sample that END reads
+#define KEY_MEMORY_BEGIN() KeyMemorySample key_memory_sample = key_memory_begin()
+#define KEY_MEMORY_END(name) key_memory_end(name, &key_memory_sample)
+#endif
+
+#endif // KEY_MEMORY_H
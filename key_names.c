@@ -0,0 +1,389 @@
+#include "key_names.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define KEY_NAMES_BLOCK_DATA (KEY_NAMES_BLOCK_SIZE - sizeof(uint16_t))
+#define KEY_NAMES_MAX_BLOCKS UINT16_MAX
+// Directory entries moved per read and write when one is added or dropped
+#define KEY_NAMES_SHIFT_CHUNK 8
+
+typedef struct {
+    uint16_t used;
+    char data[KEY_NAMES_BLOCK_DATA];
+} KeyNamesBlock;
+
+_Static_assert(sizeof(KeyNamesBlock) == KEY_NAMES_BLOCK_SIZE, "a block is read in one piece");
+
+// A block and room to lay out its names with one more, for inserts and splits
+typedef struct {
+    KeyNamesBlock block;
+    char names[KEY_NAMES_BLOCK_DATA + KEY_NAMES_NAME_SIZE];
+} KeyNamesWork;
+
+static inline char key_names_fold(char c) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static int key_names_compare_folded(const char* a, const char* b) {
+    while(*a && key_names_fold(*a) == key_names_fold(*b)) {
+        a++;
+        b++;
+    }
+    return (unsigned char)key_names_fold(*a) - (unsigned char)key_names_fold(*b);
+}
+
+int key_names_compare(const char* a, const char* b) {
+    int order = key_names_compare_folded(a, b);
+    return order ? order : strcmp(a, b);
+}
+
+bool key_names_has_prefix(const char* name, const char* prefix) {
+    for(; *prefix; name++, prefix++) {
+        if(key_names_fold(*name) != key_names_fold(*prefix)) return false;
+    }
+    return true;
+}
+
+static inline bool key_names_valid(size_t length) {
+    return length > 0 && length < KEY_NAMES_NAME_SIZE;
+}
+
+static inline uint32_t key_names_entry_offset(uint32_t entry) {
+    return sizeof(KeyNamesHeader) + entry * sizeof(KeyNamesDirectoryEntry);
+}
+
+static bool key_names_write_header(KeyNames* names) {
+    return names->write(
+        KeyNamesPartDirectory, 0, &names->header, sizeof(KeyNamesHeader), names->context);
+}
+
+// Updates are bracketed by the dirty flag, so an index left half written by a lost card or a
+// flat battery is rebuilt instead of read
+static KeyNamesStatus key_names_begin(KeyNames* names) {
+    names->header.dirty = 1;
+    return key_names_write_header(names) ? KeyNamesOk : KeyNamesIoError;
+}
+
+static KeyNamesStatus key_names_end(KeyNames* names, KeyNamesStatus status) {
+    if(status != KeyNamesOk) return status;
+    names->header.dirty = 0;
+    return key_names_write_header(names) ? KeyNamesOk : KeyNamesIoError;
+}
+
+static KeyNamesStatus
+    key_names_read_entry(const KeyNames* names, uint32_t index, KeyNamesDirectoryEntry* entry) {
+    if(!names->read(
+           KeyNamesPartDirectory,
+           key_names_entry_offset(index),
+           entry,
+           sizeof(KeyNamesDirectoryEntry),
+           names->context))
+        return KeyNamesIoError;
+    entry->first[KEY_NAMES_NAME_SIZE - 1] = '\0';
+    return entry->block < names->header.blocks ? KeyNamesOk : KeyNamesCorrupt;
+}
+
+static KeyNamesStatus
+    key_names_write_entry(KeyNames* names, uint32_t index, const KeyNamesDirectoryEntry* entry) {
+    return names->write(
+               KeyNamesPartDirectory,
+               key_names_entry_offset(index),
+               entry,
+               sizeof(KeyNamesDirectoryEntry),
+               names->context) ?
+               KeyNamesOk :
+               KeyNamesIoError;
+}
+
+static KeyNamesStatus
+    key_names_read_block(const KeyNames* names, uint32_t block, KeyNamesBlock* data) {
+    if(!names->read(
+           KeyNamesPartBlocks,
+           block * KEY_NAMES_BLOCK_SIZE,
+           data,
+           KEY_NAMES_BLOCK_SIZE,
+           names->context))
+        return KeyNamesIoError;
+    // Names must end inside the block, so walking it never runs off the end
+    if(data->used > KEY_NAMES_BLOCK_DATA || (data->used && data->data[data->used - 1] != '\0'))
+        return KeyNamesCorrupt;
+    return KeyNamesOk;
+}
+
+static KeyNamesStatus
+    key_names_write_block(KeyNames* names, uint32_t block, const KeyNamesBlock* data) {
+    return names->write(
+               KeyNamesPartBlocks,
+               block * KEY_NAMES_BLOCK_SIZE,
+               data,
+               KEY_NAMES_BLOCK_SIZE,
+               names->context) ?
+               KeyNamesOk :
+               KeyNamesIoError;
+}
+
+// Directory entry of the block a name belongs in: the last one whose first name is not past it.
+// With folded set, the last one whose first name is before it when case is ignored, which is
+// where the names starting with it begin.
+static KeyNamesStatus
+    key_names_route(const KeyNames* names, const char* name, bool folded, uint32_t* index) {
+    uint32_t low = 0;
+    uint32_t high = names->header.blocks;
+    while(high - low > 1) {
+        uint32_t middle = low + (high - low) / 2;
+        KeyNamesDirectoryEntry entry;
+        KeyNamesStatus status = key_names_read_entry(names, middle, &entry);
+        if(status != KeyNamesOk) return status;
+        bool before = folded ? key_names_compare_folded(entry.first, name) < 0 :
+                               key_names_compare(entry.first, name) <= 0;
+        if(before) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    *index = low;
+    return KeyNamesOk;
+}
+
+// Move the directory entries from first on one place up, to make room at first, or one place
+// down over the entry at first
+static KeyNamesStatus key_names_shift(KeyNames* names, uint32_t first, bool up) {
+    KeyNamesDirectoryEntry chunk[KEY_NAMES_SHIFT_CHUNK];
+    uint32_t low = up ? first : first + 1;
+    uint32_t high = names->header.blocks;
+    // Start at the end the entries move towards, so none is written over before it is read
+    while(low < high) {
+        uint32_t count = high - low < KEY_NAMES_SHIFT_CHUNK ? high - low : KEY_NAMES_SHIFT_CHUNK;
+        uint32_t from = up ? high - count : low;
+        size_t size = count * sizeof(KeyNamesDirectoryEntry);
+        if(!names->read(
+               KeyNamesPartDirectory, key_names_entry_offset(from), chunk, size, names->context) ||
+           !names->write(
+               KeyNamesPartDirectory,
+               key_names_entry_offset(up ? from + 1 : from - 1),
+               chunk,
+               size,
+               names->context))
+            return KeyNamesIoError;
+        if(up) {
+            high -= count;
+        } else {
+            low += count;
+        }
+    }
+    return KeyNamesOk;
+}
+
+KeyNamesStatus key_names_open(
+    KeyNames* names,
+    KeyNamesReadCallback read,
+    KeyNamesWriteCallback write,
+    KeyNamesTruncateCallback truncate,
+    void* context) {
+    names->read = read;
+    names->write = write;
+    names->truncate = truncate;
+    names->context = context;
+    if(!read(KeyNamesPartDirectory, 0, &names->header, sizeof(KeyNamesHeader), context))
+        return KeyNamesIoError;
+    const KeyNamesHeader* header = &names->header;
+    if(header->magic != KEY_NAMES_MAGIC || header->version != KEY_NAMES_VERSION ||
+       header->dirty || (header->blocks == 0) != (header->names == 0))
+        return KeyNamesCorrupt;
+    return KeyNamesOk;
+}
+
+KeyNamesStatus key_names_create(
+    KeyNames* names,
+    KeyNamesReadCallback read,
+    KeyNamesWriteCallback write,
+    KeyNamesTruncateCallback truncate,
+    void* context) {
+    names->read = read;
+    names->write = write;
+    names->truncate = truncate;
+    names->context = context;
+    memset(&names->header, 0, sizeof(KeyNamesHeader));
+    names->header.magic = KEY_NAMES_MAGIC;
+    names->header.version = KEY_NAMES_VERSION;
+    if(!truncate(KeyNamesPartBlocks, 0, context) || !truncate(KeyNamesPartDirectory, 0, context))
+        return KeyNamesIoError;
+    return key_names_write_header(names) ? KeyNamesOk : KeyNamesIoError;
+}
+
+// Where name is or would go in a block, and whether it is there
+static bool key_names_find(const KeyNamesBlock* block, const char* name, uint16_t* position) {
+    uint16_t offset = 0;
+    while(offset < block->used) {
+        const char* current = block->data + offset;
+        int order = key_names_compare(current, name);
+        if(order >= 0) {
+            *position = offset;
+            return order == 0;
+        }
+        offset += strlen(current) + 1;
+    }
+    *position = offset;
+    return false;
+}
+
+static KeyNamesStatus key_names_add(KeyNames* names, const char* name, KeyNamesWork* work) {
+    const size_t size = strlen(name) + 1;
+    KeyNamesBlock* block = &work->block;
+    KeyNamesDirectoryEntry entry = {.first = "", .block = 0};
+    uint32_t index = 0;
+    KeyNamesStatus status = KeyNamesOk;
+    if(names->header.blocks == 0) {
+        block->used = 0;
+    } else {
+        status = key_names_route(names, name, false, &index);
+        if(status == KeyNamesOk) status = key_names_read_entry(names, index, &entry);
+        if(status == KeyNamesOk) status = key_names_read_block(names, entry.block, block);
+        if(status != KeyNamesOk) return status;
+    }
+    uint16_t position;
+    if(key_names_find(block, name, &position)) return KeyNamesOk;
+    uint16_t total = block->used + size;
+    if(total > KEY_NAMES_BLOCK_DATA && names->header.blocks == KEY_NAMES_MAX_BLOCKS)
+        return KeyNamesFull;
+
+    memcpy(work->names, block->data, position);
+    memcpy(work->names + position, name, size);
+    memcpy(work->names + position + size, block->data + position, block->used - position);
+
+    status = key_names_begin(names);
+    if(status != KeyNamesOk) return status;
+    if(names->header.blocks == 0) {
+        status = key_names_write_entry(names, 0, &entry);
+        names->header.blocks = 1;
+    }
+    if(total <= KEY_NAMES_BLOCK_DATA) {
+        memcpy(block->data, work->names, total);
+        block->used = total;
+        if(status == KeyNamesOk) status = key_names_write_block(names, entry.block, block);
+    } else {
+        // Split at the first name past the middle: the lower half stays, the upper half goes to
+        // a new block at the end of the file and its own directory entry after this one
+        uint16_t split = 0;
+        while(split < total / 2) split += strlen(work->names + split) + 1;
+        block->used = split;
+        memcpy(block->data, work->names, split);
+        if(status == KeyNamesOk) status = key_names_write_block(names, entry.block, block);
+        KeyNamesDirectoryEntry next = {.block = names->header.blocks};
+        memset(next.first, 0, sizeof(next.first));
+        strcpy(next.first, work->names + split);
+        block->used = total - split;
+        memcpy(block->data, work->names + split, block->used);
+        if(status == KeyNamesOk) status = key_names_write_block(names, next.block, block);
+        if(status == KeyNamesOk) status = key_names_shift(names, index + 1, true);
+        if(status == KeyNamesOk) status = key_names_write_entry(names, index + 1, &next);
+        names->header.blocks++;
+    }
+    names->header.names++;
+    return key_names_end(names, status);
+}
+
+KeyNamesStatus key_names_insert(KeyNames* names, const char* name) {
+    if(!key_names_valid(strlen(name))) return KeyNamesBadName;
+    KeyNamesWork* work = malloc(sizeof(KeyNamesWork));
+    KeyNamesStatus status = key_names_add(names, name, work);
+    free(work);
+    return status;
+}
+
+// Drop the empty block of directory entry index. The last block of the file moves into its
+// place, so the file never has holes.
+static KeyNamesStatus
+    key_names_drop(KeyNames* names, uint32_t index, uint32_t block, KeyNamesBlock* data) {
+    const uint32_t last = names->header.blocks - 1;
+    KeyNamesStatus status = key_names_shift(names, index, false);
+    KeyNamesDirectoryEntry entry;
+    if(status == KeyNamesOk && index == 0 && last > 0) {
+        // The new first block takes in everything before it too
+        status = key_names_read_entry(names, 0, &entry);
+        memset(entry.first, 0, sizeof(entry.first));
+        if(status == KeyNamesOk) status = key_names_write_entry(names, 0, &entry);
+    }
+    if(status == KeyNamesOk && block != last) {
+        status = key_names_read_block(names, last, data);
+        if(status == KeyNamesOk) status = key_names_write_block(names, block, data);
+        // The directory is in name order, so the entry of the moved block has to be looked for
+        uint32_t moved = 0;
+        while(status == KeyNamesOk) {
+            status = moved < last ? key_names_read_entry(names, moved, &entry) : KeyNamesCorrupt;
+            if(status == KeyNamesOk && entry.block == last) {
+                entry.block = block;
+                status = key_names_write_entry(names, moved, &entry);
+                break;
+            }
+            moved++;
+        }
+    }
+    names->header.blocks = last;
+    if(status == KeyNamesOk &&
+       (!names->truncate(KeyNamesPartBlocks, last * KEY_NAMES_BLOCK_SIZE, names->context) ||
+        !names->truncate(KeyNamesPartDirectory, key_names_entry_offset(last), names->context)))
+        status = KeyNamesIoError;
+    return status;
+}
+
+KeyNamesStatus key_names_remove(KeyNames* names, const char* name) {
+    size_t size = strlen(name) + 1;
+    if(!key_names_valid(size - 1)) return KeyNamesBadName;
+    if(names->header.blocks == 0) return KeyNamesNotFound;
+    KeyNamesBlock* block = malloc(sizeof(KeyNamesBlock));
+    KeyNamesDirectoryEntry entry;
+    uint32_t index;
+    uint16_t position;
+    KeyNamesStatus status = key_names_route(names, name, false, &index);
+    if(status == KeyNamesOk) status = key_names_read_entry(names, index, &entry);
+    if(status == KeyNamesOk) status = key_names_read_block(names, entry.block, block);
+    if(status == KeyNamesOk && !key_names_find(block, name, &position)) status = KeyNamesNotFound;
+    if(status == KeyNamesOk) status = key_names_begin(names);
+    if(status == KeyNamesOk) {
+        memmove(
+            block->data + position,
+            block->data + position + size,
+            block->used - position - size);
+        block->used -= size;
+        status = block->used ? key_names_write_block(names, entry.block, block) :
+                               key_names_drop(names, index, entry.block, block);
+        names->header.names--;
+        status = key_names_end(names, status);
+    }
+    free(block);
+    return status;
+}
+
+KeyNamesStatus key_names_search(
+    const KeyNames* names,
+    const char* prefix,
+    KeyNamesCallback callback,
+    void* context) {
+    size_t length = strlen(prefix);
+    if(length >= KEY_NAMES_NAME_SIZE) return KeyNamesBadName;
+    if(names->header.blocks == 0) return KeyNamesOk;
+    uint32_t index;
+    KeyNamesStatus status = key_names_route(names, prefix, true, &index);
+    if(status != KeyNamesOk) return status;
+
+    // The names starting with prefix are all together, so walk on from the first of them until
+    // one does not
+    KeyNamesBlock* block = malloc(sizeof(KeyNamesBlock));
+    bool more = true;
+    for(; more && index < names->header.blocks; index++) {
+        KeyNamesDirectoryEntry entry;
+        status = key_names_read_entry(names, index, &entry);
+        if(status == KeyNamesOk) status = key_names_read_block(names, entry.block, block);
+        if(status != KeyNamesOk) break;
+        for(uint16_t offset = 0; more && offset < block->used;) {
+            const char* name = block->data + offset;
+            offset += strlen(name) + 1;
+            if(key_names_compare_folded(name, prefix) < 0) continue;
+            more = key_names_has_prefix(name, prefix) && callback(name, context);
+        }
+    }
+    free(block);
+    return status;
+}
@@ -0,0 +1,109 @@
+#ifndef KEY_NAMES_H
+#define KEY_NAMES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Saved key names are typed into a 32 byte buffer, so this holds any name the app writes
+#define KEY_NAMES_NAME_SIZE 32
+#define KEY_NAMES_BLOCK_SIZE 512
+#define KEY_NAMES_MAGIC 0x314E4B4B // "KKN1"
+#define KEY_NAMES_VERSION 1
+
+// The name index is two files. The block file holds KEY_NAMES_BLOCK_SIZE blocks, each a uint16
+// count of bytes used and then names in key_names_compare order, each ending in '\0'. Every name
+// of a block sorts before every name of the next block in the directory, but the blocks
+// themselves are in no order: a full block is split into a new one at the end of the file, and
+// the last block moves into the place of one that empties. The directory file is the header and
+// then a KeyNamesDirectoryEntry per block in name order, for binary search. A lookup reads
+// log2(blocks) directory entries and then one block.
+typedef enum {
+    KeyNamesPartBlocks,
+    KeyNamesPartDirectory,
+} KeyNamesPart;
+
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t dirty; // set while an update is under way, so one cut short is never trusted
+    uint16_t blocks;
+    uint32_t names;
+} KeyNamesHeader;
+
+typedef struct {
+    char first[KEY_NAMES_NAME_SIZE]; // nothing in the block sorts before it; "" for the first
+    uint32_t block;
+} KeyNamesDirectoryEntry;
+
+typedef enum {
+    KeyNamesOk,
+    KeyNamesNotFound,
+    KeyNamesCorrupt, // bad header, or an update did not finish
+    KeyNamesBadName, // empty or too long
+    KeyNamesFull,
+    KeyNamesIoError,
+} KeyNamesStatus;
+
+// Positional access to either part of the index, so this code does not depend on where it lives
+typedef bool (*KeyNamesReadCallback)(
+    KeyNamesPart part,
+    uint32_t offset,
+    void* data,
+    size_t size,
+    void* context);
+typedef bool (*KeyNamesWriteCallback)(
+    KeyNamesPart part,
+    uint32_t offset,
+    const void* data,
+    size_t size,
+    void* context);
+// Cut a part down to size bytes, which is never more than it holds
+typedef bool (*KeyNamesTruncateCallback)(KeyNamesPart part, uint32_t size, void* context);
+
+// Called for each name found, in order. Return false to stop.
+typedef bool (*KeyNamesCallback)(const char* name, void* context);
+
+typedef struct {
+    KeyNamesReadCallback read;
+    KeyNamesWriteCallback write;
+    KeyNamesTruncateCallback truncate;
+    void* context;
+    KeyNamesHeader header;
+} KeyNames;
+
+// Order of names: letters compare without case, and names equal but for case by their bytes
+int key_names_compare(const char* a, const char* b);
+
+// Whether name starts with prefix, ignoring case
+bool key_names_has_prefix(const char* name, const char* prefix);
+
+KeyNamesStatus key_names_open(
+    KeyNames* names,
+    KeyNamesReadCallback read,
+    KeyNamesWriteCallback write,
+    KeyNamesTruncateCallback truncate,
+    void* context);
+
+// Empty both parts and start a new index
+KeyNamesStatus key_names_create(
+    KeyNames* names,
+    KeyNamesReadCallback read,
+    KeyNamesWriteCallback write,
+    KeyNamesTruncateCallback truncate,
+    void* context);
+
+// Add a name; one already there is left as it is. At most one block and a share of the
+// directory are rewritten.
+KeyNamesStatus key_names_insert(KeyNames* names, const char* name);
+
+KeyNamesStatus key_names_remove(KeyNames* names, const char* name);
+
+// Every name starting with prefix, case aside, in order. "" lists them all.
+KeyNamesStatus key_names_search(
+    const KeyNames* names,
+    const char* prefix,
+    KeyNamesCallback callback,
+    void* context);
+
+#endif // KEY_NAMES_H
@@ -0,0 +1,204 @@
+#include "key_pinning.h"
+#include <stdio.h>
+#include <string.h>
+
+#define KEY_PINNING_FIELDS 3
+
+void key_pinning_stack(
+    const KeyFormat* format,
+    const KeyBitting* change,
+    const KeyBitting* master,
+    KeyPinStack* stack) {
+    if(!master) {
+        // No master key: the bottom pins are the change key
+        stack->bottom = *change;
+        memset(&stack->master, 0, sizeof(KeyBitting));
+        return;
+    }
+    // The shallower cut sets the bottom pin; a wafer as long as the difference
+    // lifts the shear line for the deeper cut
+    for(uint8_t pin = 0; pin < format->pin_num; pin++) {
+        uint8_t a = key_bitting_get(change, pin);
+        uint8_t b = key_bitting_get(master, pin);
+        key_bitting_set(&stack->bottom, pin, a < b ? a : b);
+        key_bitting_set(&stack->master, pin, a < b ? b - a : a - b);
+    }
+    for(uint8_t pin = format->pin_num; pin < KEY_BITTING_MAX_PINS; pin++) {
+        key_bitting_set(&stack->bottom, pin, 0);
+        key_bitting_set(&stack->master, pin, 0);
+    }
+}
+
+void key_pinning_count(KeyPinningTotals* totals, const KeyPinStack* stack, uint8_t pin_num) {
+    totals->cylinders++;
+    totals->chambers += pin_num;
+    totals->driver_pins += pin_num;
+    for(uint8_t pin = 0; pin < pin_num; pin++) {
+        totals->bottom_pins[key_bitting_get(&stack->bottom, pin)]++;
+        uint8_t wafer = key_bitting_get(&stack->master, pin);
+        if(wafer) totals->master_pins[wafer]++;
+    }
+}
+
+// Split a line on commas in place, trimming blanks around each field
+static uint8_t key_pinning_split(char* line, char** fields) {
+    uint8_t count = 0;
+    char* field = line;
+    while(count < KEY_PINNING_FIELDS) {
+        char* end = strchr(field, ',');
+        if(end) *end = '\0';
+        while(*field == ' ' || *field == '\t') field++;
+        size_t length = strlen(field);
+        while(length > 0 && (field[length - 1] == ' ' || field[length - 1] == '\t' ||
+                             field[length - 1] == '\r'))
+            field[--length] = '\0';
+        fields[count++] = field;
+        if(!end) break;
+        field = end + 1;
+    }
+    return count;
+}
+
+static bool
+    key_pinning_parse_key(const KeyFormat* format, const char* text, KeyBitting* bitting) {
+    return key_bitting_from_str(bitting, format->pin_num, text) &&
+           key_bitting_in_range(
+               bitting, format->pin_num, format->min_depth_ind, format->max_depth_ind);
+}
+
+static bool key_pinning_print(KeyPinningWrite write, void* context, const char* text) {
+    return write(text, strlen(text), context);
+}
+
+static bool key_pinning_write_totals(
+    const KeyFormat* format,
+    const KeyPinningTotals* totals,
+    KeyPinningWrite write,
+    void* context) {
+    char out[KEY_PINNING_LINE_SIZE];
+    snprintf(
+        out,
+        sizeof(out),
+        "# cylinders,%lu\n# chambers,%lu\n",
+        (unsigned long)totals->cylinders,
+        (unsigned long)totals->chambers);
+    if(!key_pinning_print(write, context, out)) return false;
+    for(uint8_t pin = 0; pin <= KEY_BITTING_MAX_DEPTH; pin++) {
+        if(!totals->bottom_pins[pin]) continue;
+        snprintf(
+            out,
+            sizeof(out),
+            "# bottom pin %u,%lu\n",
+            pin,
+            (unsigned long)totals->bottom_pins[pin]);
+        if(!key_pinning_print(write, context, out)) return false;
+    }
+    for(uint8_t size = 1; size <= KEY_BITTING_MAX_DEPTH; size++) {
+        if(!totals->master_pins[size]) continue;
+        uint32_t length = (uint32_t)size * format->depth_step;
+        snprintf(
+            out,
+            sizeof(out),
+            "# master wafer %u (%lu.%04lu in),%lu\n",
+            size,
+            (unsigned long)(length / KEY_FORMAT_UNITS_PER_INCH),
+            (unsigned long)(length % KEY_FORMAT_UNITS_PER_INCH),
+            (unsigned long)totals->master_pins[size]);
+        if(!key_pinning_print(write, context, out)) return false;
+    }
+    snprintf(
+        out,
+        sizeof(out),
+        "# driver pins,%lu\n# errors,%lu\n",
+        (unsigned long)totals->driver_pins,
+        (unsigned long)totals->errors);
+    return key_pinning_print(write, context, out);
+}
+
+bool key_pinning_run(
+    uint32_t format_index,
+    KeyPinningReadLine read_line,
+    KeyPinningWrite write,
+    void* context,
+    KeyPinningTotals* totals) {
+    memset(totals, 0, sizeof(KeyPinningTotals));
+    KeyFormat format;
+    key_format_load(format_index, &format);
+    KeyBitting job_master;
+    bool has_job_master = false;
+    char line[KEY_PINNING_LINE_SIZE];
+    char out[KEY_PINNING_LINE_SIZE + 2 * KEY_BITTING_MAX_PINS * 3];
+    char bottom[KEY_BITTING_MAX_PINS * 3];
+    char master[KEY_BITTING_MAX_PINS * 3];
+    uint32_t line_number = 0;
+
+    snprintf(
+        out,
+        sizeof(out),
+        "# format,%s\n# cylinder,bottom pins,master wafers\n",
+        key_format_info[format_index].format_name);
+    if(!key_pinning_print(write, context, out)) return false;
+    while(read_line(line, sizeof(line), context)) {
+        line_number++;
+        char* fields[KEY_PINNING_FIELDS];
+        uint8_t count = key_pinning_split(line, fields);
+        const char* error = NULL;
+        if(fields[0][0] == '\0' || fields[0][0] == '#') continue;
+
+        if(!strcmp(fields[0], "FORMAT")) {
+            int32_t index = count > 1 ? key_format_find(fields[1]) : -1;
+            if(totals->cylinders > 0) {
+                error = "FORMAT must come before the first cylinder";
+            } else if(index < 0) {
+                error = "unknown format";
+            } else {
+                format_index = index;
+                key_format_load(format_index, &format);
+                has_job_master = false;
+                snprintf(out, sizeof(out), "# format,%s\n", key_format_info[index].format_name);
+                if(!key_pinning_print(write, context, out)) return false;
+            }
+        } else if(!strcmp(fields[0], "MASTER")) {
+            has_job_master = count > 1 && fields[1][0] != '\0';
+            if(has_job_master && !key_pinning_parse_key(&format, fields[1], &job_master)) {
+                has_job_master = false;
+                error = "bad master key";
+            }
+        } else {
+            KeyBitting change;
+            KeyBitting line_master;
+            const KeyBitting* master_key = has_job_master ? &job_master : NULL;
+            if(count < 2 || !key_pinning_parse_key(&format, fields[1], &change)) {
+                error = "bad change key";
+            } else if(count > 2 && fields[2][0] != '\0') {
+                if(key_pinning_parse_key(&format, fields[2], &line_master)) {
+                    master_key = &line_master;
+                } else {
+                    error = "bad master key";
+                }
+            }
+            if(!error) {
+                KeyPinStack stack;
+                key_pinning_stack(&format, &change, master_key, &stack);
+                key_pinning_count(totals, &stack, format.pin_num);
+                key_bitting_to_str(&stack.bottom, format.pin_num, bottom, sizeof(bottom));
+                key_bitting_to_str(&stack.master, format.pin_num, master, sizeof(master));
+                snprintf(
+                    out,
+                    sizeof(out),
+                    "%.*s,%s,%s\n",
+                    KEY_PINNING_NAME_SIZE,
+                    fields[0],
+                    bottom,
+                    master);
+                if(!key_pinning_print(write, context, out)) return false;
+            }
+        }
+        if(error) {
+            totals->errors++;
+            snprintf(out, sizeof(out), "# line %lu: %s\n", (unsigned long)line_number, error);
+            if(!key_pinning_print(write, context, out)) return false;
+        }
+    }
+    return key_pinning_write_totals(&format, totals, write, context);
+}
@@ -0,0 +1,51 @@
+#ifndef KEY_PINNING_H
+#define KEY_PINNING_H
+
+#include "key_bitting.h"
+#include "key_formats.h"
+
+// Longest job line read; longer lines are cut
+#define KEY_PINNING_LINE_SIZE 128
+#define KEY_PINNING_NAME_SIZE 32
+
+// Pins of one cylinder. Bottom pins are numbered like the depths of the format. Master wafers
+// are sized in depth steps, 0 for a chamber without one.
+typedef struct {
+    KeyBitting bottom;
+    KeyBitting master;
+} KeyPinStack;
+
+typedef struct {
+    uint32_t cylinders;
+    uint32_t chambers;
+    uint32_t errors; // job lines that could not be planned
+    uint32_t bottom_pins[KEY_BITTING_MAX_DEPTH + 1]; // by pin number
+    uint32_t master_pins[KEY_BITTING_MAX_DEPTH + 1]; // by size
+    uint32_t driver_pins;
+} KeyPinningTotals;
+
+// Feed one line of the job, without the line break. Return false at the end of the job.
+typedef bool (*KeyPinningReadLine)(char* line, size_t size, void* context);
+typedef bool (*KeyPinningWrite)(const char* text, size_t size, void* context);
+
+// Pin a cylinder for a change key, and a master key when master is not NULL
+void key_pinning_stack(
+    const KeyFormat* format,
+    const KeyBitting* change,
+    const KeyBitting* master,
+    KeyPinStack* stack);
+
+void key_pinning_count(KeyPinningTotals* totals, const KeyPinStack* stack, uint8_t pin_num);
+
+// Plan a job of "name,change key[,master key]" lines, one line in and one line out at a time.
+// "FORMAT,<format name>" switches format and "MASTER,<key>" sets the master key of the lines
+// that follow; "MASTER," alone clears it. Blank lines and # comments are skipped. The totals of
+// the whole job are written at the end.
+bool key_pinning_run(
+    uint32_t format_index,
+    KeyPinningReadLine read_line,
+    KeyPinningWrite write,
+    void* context,
+    KeyPinningTotals* totals);
+
+#endif // KEY_PINNING_H
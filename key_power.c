@@ -0,0 +1,67 @@
+#include "key_power.h"
+#include <stdio.h>
+
+void key_power_init(KeyPower* power, uint32_t now) {
+    power->session_ms = 0;
+    power->backlight_ms = 0;
+    power->redraws = 0;
+    power->skipped = 0;
+    power->last_tick = now;
+    power->last_input = now;
+    power->idle_since = now;
+    power->backlight = true; // starting the app took a key press
+    power->pinned = false;
+}
+
+bool key_power_tick(KeyPower* power, uint32_t now, uint32_t last_input) {
+    uint32_t elapsed = now - power->last_tick;
+    power->last_tick = now;
+    power->session_ms += elapsed;
+    if(power->backlight) power->backlight_ms += elapsed;
+
+    if(last_input != power->last_input) {
+        // Any key press lights the display again
+        power->last_input = last_input;
+        power->idle_since = last_input;
+        power->backlight = true;
+    }
+    if(power->backlight && !power->pinned && now - power->idle_since >= KEY_POWER_IDLE_MS) {
+        power->backlight = false;
+        return true;
+    }
+    return false;
+}
+
+void key_power_pin(KeyPower* power, bool pinned, uint32_t now) {
+    key_power_tick(power, now, power->last_input);
+    power->pinned = pinned;
+    power->idle_since = now;
+    if(pinned) power->backlight = true;
+}
+
+uint32_t key_power_estimate_uah(const KeyPower* power) {
+    uint64_t uas = (uint64_t)power->backlight_ms * KEY_POWER_BACKLIGHT_UA / 1000 +
+                   (uint64_t)power->redraws * KEY_POWER_REDRAW_UAS;
+    return (uint32_t)(uas / 3600);
+}
+
+size_t key_power_report(const KeyPower* power, char* text, size_t size) {
+    uint32_t session_s = power->session_ms / 1000;
+    uint32_t backlight_s = power->backlight_ms / 1000;
+    uint32_t uah = key_power_estimate_uah(power);
+    int length = snprintf(
+        text,
+        size,
+        "Session: %lum %02lus\nBacklight on: %lum %02lus\nRedraws: %lu\nSkipped: %lu\n"
+        "Estimate: %lu.%03lu mAh\n\nBacklight at full and redraws only, on top of the idle "
+        "device.",
+        (unsigned long)(session_s / 60),
+        (unsigned long)(session_s % 60),
+        (unsigned long)(backlight_s / 60),
+        (unsigned long)(backlight_s % 60),
+        (unsigned long)power->redraws,
+        (unsigned long)power->skipped,
+        (unsigned long)(uah / 1000),
+        (unsigned long)(uah % 1000));
+    return length < 0 ? 0 : (size_t)length;
+}
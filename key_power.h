@@ -0,0 +1,51 @@
+#ifndef KEY_POWER_H
+#define KEY_POWER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Outside the measure view the backlight goes off after this long without input
+#define KEY_POWER_IDLE_MS 15000
+#define KEY_POWER_TICK_MS 1000
+
+// Rough costs on top of an idle Flipper, for the session estimate only
+#define KEY_POWER_BACKLIGHT_UA 11000 // display backlight at full brightness
+#define KEY_POWER_REDRAW_UAS 40 // render plus one frame over SPI, in microamp seconds
+
+typedef struct {
+    uint32_t session_ms;
+    uint32_t backlight_ms;
+    uint32_t redraws;
+    uint32_t skipped; // inputs that changed nothing, so drew nothing
+
+    uint32_t last_tick;
+    uint32_t last_input; // as last seen by key_power_tick
+    uint32_t idle_since;
+    bool backlight;
+    bool pinned; // the measure view holds the backlight on
+} KeyPower;
+
+void key_power_init(KeyPower* power, uint32_t now);
+
+// Account time up to now. last_input is the time of the most recent input event, which may
+// arrive on another thread. Returns true when the backlight should be turned off.
+bool key_power_tick(KeyPower* power, uint32_t now, uint32_t last_input);
+
+void key_power_pin(KeyPower* power, bool pinned, uint32_t now);
+
+static inline void key_power_redraw(KeyPower* power, bool changed) {
+    if(changed) {
+        power->redraws++;
+    } else {
+        power->skipped++;
+    }
+}
+
+// Charge used by the backlight and redraws this session
+uint32_t key_power_estimate_uah(const KeyPower* power);
+
+// Multi-line summary for the stats screen; returns the text length
+size_t key_power_report(const KeyPower* power, char* text, size_t size);
+
+#endif // KEY_POWER_H
@@ -0,0 +1,540 @@
+#include "key_render.h"
+#include "key_copier.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Set the pixels of a line in a layer, stepping the way u8g2_DrawLine does so a layer matches
+// what key_render_draw draws on the canvas pixel for pixel
+static void key_render_layer_line(uint8_t* layer, int x1, int y1, int x2, int y2) {
+    bool steep = abs(y2 - y1) > abs(x2 - x1);
+    if(steep) {
+        int t = x1;
+        x1 = y1;
+        y1 = t;
+        t = x2;
+        x2 = y2;
+        y2 = t;
+    }
+    if(x1 > x2) {
+        int t = x1;
+        x1 = x2;
+        x2 = t;
+        t = y1;
+        y1 = y2;
+        y2 = t;
+    }
+    const int dx = x2 - x1;
+    const int dy = abs(y2 - y1);
+    const int step_y = y2 > y1 ? 1 : -1;
+    int error = dx / 2;
+    for(int x = x1, y = y1; x <= x2; x++) {
+        int column = steep ? y : x;
+        int row = steep ? x : y;
+        if(row >= 0 && row < KEY_RENDER_HEIGHT && column >= 0 && column < KEY_RENDER_WIDTH)
+            layer[row * KEY_RENDER_STRIDE + column / 8] |= 1 << (column % 8);
+        error -= dy;
+        if(error < 0) {
+            y += step_y;
+            error += dx;
+        }
+    }
+}
+
+// canvas_draw_line with the x range clipped to the screen. u8g2 takes unsigned coordinates,
+// so a line starting off the left edge would otherwise wrap around. With a layer the line goes
+// there instead of to the canvas.
+static inline void
+    key_render_line(Canvas* canvas, uint8_t* layer, int x1, int y1, int x2, int y2) {
+    if(x1 > x2) {
+        int x = x1, y = y1;
+        x1 = x2;
+        y1 = y2;
+        x2 = x;
+        y2 = y;
+    }
+    if(x2 < 0 || x1 >= KEY_RENDER_WIDTH) return;
+    if(x1 < 0) {
+        y1 += (y2 - y1) * -x1 / (x2 - x1);
+        x1 = 0;
+    }
+    if(x2 >= KEY_RENDER_WIDTH) {
+        y2 = y1 + (y2 - y1) * (KEY_RENDER_WIDTH - 1 - x1) / (x2 - x1);
+        x2 = KEY_RENDER_WIDTH - 1;
+    }
+    if(layer) {
+        key_render_layer_line(layer, x1, y1, x2, y2);
+    } else {
+        canvas_draw_line(canvas, x1, y1, x2, y2);
+    }
+}
+
+// Set rows y1 to y2 of column x, in the layer if there is one or else on the canvas
+static inline void key_render_column(Canvas* canvas, uint8_t* layer, int x, int y1, int y2) {
+    if(x < 0 || x >= KEY_RENDER_WIDTH) return;
+    y1 = max(y1, 0);
+    y2 = min(y2, KEY_RENDER_HEIGHT - 1);
+    if(layer) {
+        for(int y = y1; y <= y2; y++) {
+            layer[y * KEY_RENDER_STRIDE + x / 8] |= 1 << (x % 8);
+        }
+    } else if(y1 == y2) {
+        canvas_draw_dot(canvas, x, y1);
+    } else if(y1 < y2) {
+        canvas_draw_line(canvas, x, y1, x, y2);
+    }
+}
+
+// The depth digits and pin center tick of one pin
+static inline void key_render_pin_marks(
+    Canvas* canvas,
+    int pin_center_px,
+    int top_contour_px,
+    uint8_t depth) {
+    char digits[3];
+    digits[0] = depth >= 10 ? '0' + depth / 10 : '0' + depth;
+    digits[1] = depth >= 10 ? '0' + depth % 10 : '\0';
+    digits[2] = '\0';
+    if(pin_center_px >= 0 && pin_center_px < KEY_RENDER_WIDTH) {
+        canvas_draw_str_aligned(
+            canvas, pin_center_px, top_contour_px - 12, AlignCenter, AlignCenter, digits);
+    }
+    key_render_line(
+        canvas,
+        NULL,
+        pin_center_px,
+        top_contour_px - 5,
+        pin_center_px,
+        top_contour_px); // the vertical line to indicate pin center
+}
+
+// Where the right flank of a pin meets the left flank of the next one, from the pin center
+static inline int
+    key_render_post_extra(const KeyRenderGeometry* geometry, int current_depth, int next_depth) {
+    double numerator = (double)current_depth;
+    double denominator = (double)(current_depth + next_depth);
+    double product = (numerator / denominator) * geometry->pin_step_px;
+    return (int)min(
+        max(product, geometry->pin_half_width_px),
+        geometry->pin_step_px - geometry->pin_half_width_px);
+}
+
+// How far below the uncut edge a flank of a cut depth_px deep is, extra_px from the pin center
+static inline int
+    key_render_flank_px(const KeyRenderGeometry* geometry, int depth_px, int extra_px) {
+    int run_px = extra_px - geometry->pin_half_width_px;
+    int rise_px = geometry->rise_px[min(run_px, KEY_RENDER_RUN_PX - 1)];
+    return max(depth_px - rise_px, 0);
+}
+
+// A flank of a cut depth_px deep, from the pin edge at edge_px out over run_px more columns
+// the way step (1 or -1) points. Each column is set at the row rise_px puts it, so no line
+// stepping is left to move it off the drill angle. A column where the flank drops more than
+// a row is filled up to the row beside the last one, so steep flanks stay unbroken. The cut
+// goes from contour_px the way down (1 or -1) points.
+static inline void key_render_flank(
+    Canvas* canvas,
+    uint8_t* layer,
+    const KeyRenderGeometry* geometry,
+    int edge_px,
+    int step,
+    int contour_px,
+    int down,
+    int depth_px,
+    int run_px) {
+    int last_px = depth_px;
+    for(int column = 0; column <= run_px; column++) {
+        int cut_px =
+            key_render_flank_px(geometry, depth_px, geometry->pin_half_width_px + column);
+        int y1 = contour_px + down * cut_px;
+        int y2 = contour_px + down * max(cut_px, last_px - 1);
+        key_render_column(canvas, layer, edge_px + step * column, min(y1, y2), max(y1, y2));
+        last_px = cut_px;
+    }
+}
+
+static void key_render_contour(
+    Canvas* canvas,
+    const KeyRenderGeometry* geometry,
+    const KeyBitting* bitting,
+    int16_t view_px,
+    uint8_t* layer) {
+    const uint8_t sides = geometry->sides;
+    const uint8_t stop = geometry->stop;
+    const int pin_half_width_px = geometry->pin_half_width_px;
+    const int pin_step_px = geometry->pin_step_px;
+    const int top_contour_px = geometry->top_contour_px;
+    const int bottom_contour_px = geometry->bottom_contour_px;
+    const int level_contour_px = geometry->level_contour_px - view_px;
+    const int origin_px = -view_px; // the shoulder or tip of the key
+    const int min_depth_ind = geometry->min_depth_ind;
+    const int pin_num = geometry->pin_num;
+    int post_extra_x_px = 0;
+    int pre_extra_x_px = 0;
+    int bottom_post_extra_x_px = 0;
+    int bottom_pre_extra_x_px = 0;
+
+    // Cull the pins whose cuts can't reach the screen before doing any of their math. A cut
+    // spans less than a pin step to either side, so two steps is a safe margin.
+    int first_pin = 1;
+    int last_pin = pin_num;
+    while(first_pin < pin_num &&
+          geometry->pin_center_px[first_pin - 1] - view_px + 2 * pin_step_px < 0)
+        first_pin++;
+    while(last_pin > first_pin &&
+          geometry->pin_center_px[last_pin - 1] - view_px - 2 * pin_step_px >= KEY_RENDER_WIDTH)
+        last_pin--;
+    if(first_pin > 1) {
+        // The first drawn pin meets its culled neighbour where that one would have ended
+        int last_depth = key_bitting_get(bitting, first_pin - 2) - min_depth_ind;
+        int current_depth = key_bitting_get(bitting, first_pin - 1) - min_depth_ind;
+        if((last_depth + current_depth) > geometry->clearance) {
+            post_extra_x_px = key_render_post_extra(geometry, last_depth, current_depth);
+            bottom_post_extra_x_px = post_extra_x_px;
+        }
+    }
+
+    for(int current_pin = first_pin; current_pin <= last_pin; current_pin += 1) {
+        int pin_center_px = geometry->pin_center_px[current_pin - 1] - view_px;
+        uint8_t depth = key_bitting_get(bitting, current_pin - 1);
+        uint8_t last = current_pin > 1 ? key_bitting_get(bitting, current_pin - 2) :
+                                         min_depth_ind;
+        uint8_t next = current_pin < pin_num ? key_bitting_get(bitting, current_pin) :
+                                               min_depth_ind;
+
+        if(!layer) key_render_pin_marks(canvas, pin_center_px, top_contour_px, depth);
+        int current_depth = depth - min_depth_ind;
+        int last_depth = last - min_depth_ind;
+        int next_depth = next - min_depth_ind;
+        int current_depth_px = geometry->depth_px[depth];
+        int current_run_px = geometry->depth_run_px[depth];
+        int last_run_px = geometry->depth_run_px[last];
+        key_render_line(
+            canvas,
+            layer,
+            pin_center_px - pin_half_width_px,
+            top_contour_px + current_depth_px,
+            pin_center_px + pin_half_width_px,
+            top_contour_px + current_depth_px); // draw top pin width horizontal line
+
+        if(sides == 2) {
+            // Draw horizontal line for bottom pin
+            key_render_line(
+                canvas,
+                layer,
+                pin_center_px - pin_half_width_px,
+                bottom_contour_px - current_depth_px,
+                pin_center_px + pin_half_width_px,
+                bottom_contour_px - current_depth_px);
+
+            // Handle first pin for bottom
+            if(current_pin == 1) {
+                key_render_line(
+                    canvas,
+                    layer,
+                    origin_px,
+                    bottom_contour_px,
+                    pin_center_px - pin_half_width_px - current_run_px,
+                    bottom_contour_px);
+                bottom_pre_extra_x_px = max(current_run_px + pin_half_width_px, 0);
+            }
+
+            // Handle left side intersection for bottom
+            if((last_depth + current_depth) > geometry->clearance) {
+                if(current_pin != 1) {
+                    bottom_pre_extra_x_px =
+                        min(max(pin_step_px - bottom_post_extra_x_px, pin_half_width_px),
+                            pin_step_px - pin_half_width_px);
+                }
+                key_render_flank(
+                    canvas,
+                    layer,
+                    geometry,
+                    pin_center_px - pin_half_width_px,
+                    -1,
+                    bottom_contour_px,
+                    -1,
+                    current_depth_px,
+                    bottom_pre_extra_x_px - pin_half_width_px);
+            } else {
+                int up_slope_start_x_px = pin_center_px - pin_half_width_px - current_run_px;
+                key_render_flank(
+                    canvas,
+                    layer,
+                    geometry,
+                    pin_center_px - pin_half_width_px,
+                    -1,
+                    bottom_contour_px,
+                    -1,
+                    current_depth_px,
+                    current_run_px);
+                key_render_line(
+                    canvas,
+                    layer,
+                    min(pin_center_px - pin_step_px + pin_half_width_px + last_run_px,
+                        up_slope_start_x_px),
+                    bottom_contour_px,
+                    up_slope_start_x_px,
+                    bottom_contour_px);
+            }
+
+            // Handle right side intersection for bottom
+            if((current_depth + next_depth) > geometry->clearance) {
+                bottom_post_extra_x_px =
+                    key_render_post_extra(geometry, current_depth, next_depth);
+                key_render_flank(
+                    canvas,
+                    layer,
+                    geometry,
+                    pin_center_px + pin_half_width_px,
+                    1,
+                    bottom_contour_px,
+                    -1,
+                    current_depth_px,
+                    bottom_post_extra_x_px - pin_half_width_px);
+            } else {
+                key_render_flank(
+                    canvas,
+                    layer,
+                    geometry,
+                    pin_center_px + pin_half_width_px,
+                    1,
+                    bottom_contour_px,
+                    -1,
+                    current_depth_px,
+                    current_run_px);
+            }
+        }
+
+        if(current_pin == 1) {
+            key_render_line(
+                canvas,
+                layer,
+                origin_px,
+                top_contour_px,
+                pin_center_px - pin_half_width_px - current_run_px,
+                top_contour_px); // draw top shoulder
+            pre_extra_x_px = max(current_run_px + pin_half_width_px, 0);
+            if(sides == 2) {
+                key_render_line(
+                    canvas,
+                    layer,
+                    origin_px,
+                    bottom_contour_px,
+                    pin_center_px - pin_half_width_px - current_run_px,
+                    bottom_contour_px); // draw bottom shoulder (hidden by level contour)
+            }
+        }
+        if((last_depth + current_depth) > geometry->clearance) { // yes
+            // intersection
+
+            if(current_pin != 1) {
+                pre_extra_x_px =
+                    min(max(pin_step_px - post_extra_x_px, pin_half_width_px),
+                        pin_step_px - pin_half_width_px);
+            }
+            key_render_flank(
+                canvas,
+                layer,
+                geometry,
+                pin_center_px - pin_half_width_px,
+                -1,
+                top_contour_px,
+                1,
+                current_depth_px,
+                pre_extra_x_px - pin_half_width_px);
+        } else {
+            int down_slope_start_x_px = pin_center_px - pin_half_width_px - current_run_px;
+            key_render_flank(
+                canvas,
+                layer,
+                geometry,
+                pin_center_px - pin_half_width_px,
+                -1,
+                top_contour_px,
+                1,
+                current_depth_px,
+                current_run_px);
+            key_render_line(
+                canvas,
+                layer,
+                min(pin_center_px - pin_step_px + pin_half_width_px + last_run_px,
+                    down_slope_start_x_px),
+                top_contour_px,
+                down_slope_start_x_px,
+                top_contour_px);
+        }
+        if((current_depth + next_depth) > geometry->clearance) { //yes intersection
+            post_extra_x_px = key_render_post_extra(geometry, current_depth, next_depth);
+            key_render_flank(
+                canvas,
+                layer,
+                geometry,
+                pin_center_px + pin_half_width_px,
+                1,
+                top_contour_px,
+                1,
+                current_depth_px,
+                post_extra_x_px - pin_half_width_px);
+        } else { // no intersection
+            key_render_flank(
+                canvas,
+                layer,
+                geometry,
+                pin_center_px + pin_half_width_px,
+                1,
+                top_contour_px,
+                1,
+                current_depth_px,
+                current_run_px);
+        }
+    }
+
+    if(sides == 1) {
+        // the blade bottom spans every pin, so it is drawn even when pin 1 is culled
+        key_render_line(canvas, layer, origin_px, 62, level_contour_px, 62);
+    }
+    key_render_line(
+        canvas,
+        layer,
+        level_contour_px,
+        62,
+        level_contour_px + geometry->elbow_px,
+        62 - geometry->elbow_px);
+    key_render_line(canvas, layer, origin_px, top_contour_px - 6, origin_px, top_contour_px);
+    if(stop == 2) {
+        // Draw a line using level_contour_px if stop equals 2 elbow must be firt pin inch
+        key_render_line(canvas, layer, level_contour_px, top_contour_px, level_contour_px, 63);
+    }
+}
+
+void key_render_draw(
+    Canvas* canvas,
+    const KeyRenderGeometry* geometry,
+    const KeyBitting* bitting,
+    int16_t view_px) {
+    key_render_contour(canvas, geometry, bitting, view_px, NULL);
+}
+
+void key_render_layer(
+    const KeyRenderGeometry* geometry,
+    const KeyBitting* bitting,
+    int16_t view_px,
+    uint8_t* layer) {
+    memset(layer, 0, KEY_RENDER_LAYER_BYTES);
+    key_render_contour(NULL, geometry, bitting, view_px, layer);
+}
+
+void key_render_marks(
+    Canvas* canvas,
+    const KeyRenderGeometry* geometry,
+    const KeyBitting* bitting,
+    const KeyBitting* reference,
+    int16_t view_px) {
+    char delta[4];
+    for(uint8_t pin = 0; pin < geometry->pin_num; pin++) {
+        int pin_center_px = geometry->pin_center_px[pin] - view_px;
+        if(pin_center_px < -geometry->pin_step_px ||
+           pin_center_px >= KEY_RENDER_WIDTH + geometry->pin_step_px)
+            continue;
+        uint8_t depth = key_bitting_get(bitting, pin);
+        key_render_pin_marks(canvas, pin_center_px, geometry->top_contour_px, depth);
+        int difference = depth - key_bitting_get(reference, pin);
+        if(difference == 0 || pin_center_px < 0 || pin_center_px >= KEY_RENDER_WIDTH) continue;
+        snprintf(delta, sizeof(delta), "%+d", difference);
+        canvas_draw_str_aligned(
+            canvas,
+            pin_center_px + (depth >= 10 ? 6 : 3),
+            geometry->top_contour_px - 12,
+            AlignLeft,
+            AlignCenter,
+            delta);
+    }
+}
+
+void key_render_geometry(KeyRenderGeometry* geometry, const KeyFormat* format) {
+    const double units_per_px = (double)INCHES_PER_PX * KEY_FORMAT_UNITS_PER_INCH;
+    double drill_radians =
+        (180 - format->drill_angle) / 2.0 / 180 * (double)M_PI; // Convert angle to radians
+    const double rows_per_column = tan(drill_radians);
+    geometry->pin_half_width_px = (int)round((format->pin_width / units_per_px) / 2);
+    geometry->pin_step_px = (int)round(format->pin_increment / units_per_px);
+    geometry->top_contour_px = (int)round(62 - format->uncut_depth / units_per_px);
+    geometry->bottom_contour_px = 0;
+    if(format->sides == 2)
+        geometry->bottom_contour_px =
+            geometry->top_contour_px + (int)round(format->uncut_depth / units_per_px);
+    geometry->level_contour_px = (int)round((format->last_pin + format->elbow) / units_per_px);
+    geometry->elbow_px = (int)round(format->elbow / units_per_px);
+    geometry->length_px = geometry->level_contour_px + geometry->elbow_px;
+    geometry->sides = format->sides;
+    geometry->stop = format->stop;
+    geometry->pin_num = format->pin_num;
+    geometry->min_depth_ind = format->min_depth_ind;
+    geometry->clearance = format->clearance;
+    for(uint8_t pin = 0; pin < KEY_BITTING_MAX_PINS; pin++) {
+        double center = format->first_pin + pin * format->pin_increment;
+        geometry->pin_center_px[pin] = pin < format->pin_num ? (int)round(center / units_per_px) :
+                                                               0;
+    }
+    // Every column of a flank is rounded to its nearest row, so a flank never strays more than
+    // half a pixel from the drill angle, and all flanks of a format share one step pattern and
+    // look parallel. Drawing only looks them up, so it costs the same at any angle.
+    for(int run_px = 0; run_px < KEY_RENDER_RUN_PX; run_px++) {
+        geometry->rise_px[run_px] = (uint8_t)round(run_px * rows_per_column);
+    }
+    // A flank spans the columns it takes to climb back to the uncut edge
+    for(int depth = 0; depth <= KEY_BITTING_MAX_DEPTH; depth++) {
+        int depth_px =
+            (int)round((depth - format->min_depth_ind) * format->depth_step / units_per_px);
+        int run_px = 0;
+        while(run_px < KEY_RENDER_RUN_PX - 1 && geometry->rise_px[run_px] < depth_px)
+            run_px++;
+        geometry->depth_px[depth] = depth_px;
+        geometry->depth_run_px[depth] = run_px;
+    }
+}
+
+// How far the cuts reach below the uncut edge under column x, by the same flanks drawn on screen
+static int key_render_cut_px(const KeyRenderGeometry* geometry, const KeyBitting* bitting, int x) {
+    int cut_px = 0;
+    for(uint8_t pin = 0; pin < geometry->pin_num; pin++) {
+        uint8_t depth = key_bitting_get(bitting, pin);
+        int extra_px = abs(x - geometry->pin_center_px[pin]);
+        int pin_cut_px = geometry->depth_px[depth];
+        if(extra_px > geometry->pin_half_width_px) {
+            pin_cut_px = key_render_flank_px(geometry, pin_cut_px, extra_px);
+        }
+        cut_px = max(cut_px, pin_cut_px);
+    }
+    return cut_px;
+}
+
+void key_render_thumbnail(
+    const KeyRenderGeometry* geometry,
+    const KeyBitting* bitting,
+    uint8_t* xbm) {
+    const int size = KEY_RENDER_THUMBNAIL_SIZE;
+    const int stride = (size + 7) / 8;
+    const int length_px = max(geometry->length_px, size);
+    const int height_px = max(62 - geometry->top_contour_px, 1); // the uncut blade
+    memset(xbm, 0, KEY_RENDER_THUMBNAIL_BYTES);
+    for(int column = 0; column < size; column++) {
+        // Keep the deepest cut and highest elbow under each column so a notch never
+        // falls between samples
+        int top_px = 0;
+        int bottom_px = 0;
+        for(int x = column * length_px / size; x < (column + 1) * length_px / size; x++) {
+            int cut_px = key_render_cut_px(geometry, bitting, x);
+            top_px = max(top_px, cut_px);
+            bottom_px = max(bottom_px, x - geometry->level_contour_px);
+            if(geometry->sides == 2) bottom_px = max(bottom_px, cut_px);
+        }
+        int top = (top_px * (size - 1) + height_px / 2) / height_px;
+        int bottom = size - 1 - (bottom_px * (size - 1) + height_px / 2) / height_px;
+        for(int row = top; row <= bottom; row++) {
+            xbm[row * stride + column / 8] |= 1 << (column % 8);
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef KEY_RENDER_H
+#define KEY_RENDER_H
+
+#include "key_bitting.h"
+#include "key_formats.h"
+#include <gui/canvas.h>
+
+#define KEY_RENDER_WIDTH 128
+#define KEY_RENDER_HEIGHT 64
+// Layers are screen sized XBM bitmaps for canvas_draw_xbm
+#define KEY_RENDER_STRIDE (KEY_RENDER_WIDTH / 8)
+#define KEY_RENDER_LAYER_BYTES (KEY_RENDER_STRIDE * KEY_RENDER_HEIGHT)
+// Columns of flank slope kept; the last one is already past the deepest cut of any format
+#define KEY_RENDER_RUN_PX 32
+// File browser icons are 10x10 XBM bitmaps, two bytes a row
+#define KEY_RENDER_THUMBNAIL_SIZE 10
+#define KEY_RENDER_THUMBNAIL_BYTES (KEY_RENDER_THUMBNAIL_SIZE * 2)
+
+// Everything the draw callback needs in pixels, computed once when a format is selected
+typedef struct {
+    int16_t pin_half_width_px;
+    int16_t pin_step_px;
+    int16_t top_contour_px;
+    int16_t bottom_contour_px;
+    int16_t level_contour_px;
+    int16_t elbow_px;
+    int16_t length_px; // shoulder to the end of the elbow
+    uint8_t sides;
+    uint8_t stop;
+    uint8_t pin_num;
+    uint8_t min_depth_ind;
+    uint8_t clearance;
+    int16_t pin_center_px[KEY_BITTING_MAX_PINS];
+    int8_t depth_px[KEY_BITTING_MAX_DEPTH + 1]; // by depth index, relative to the shallowest
+    int8_t depth_run_px[KEY_BITTING_MAX_DEPTH + 1]; // columns a flank of each depth spans
+    uint8_t rise_px[KEY_RENDER_RUN_PX]; // rows a flank drops over its first n columns
+} KeyRenderGeometry;
+
+void key_render_geometry(KeyRenderGeometry* geometry, const KeyFormat* format);
+
+// Draws the contour, pin centers and depth digits, with the screen's left edge view_px pixels
+// from the shoulder
+void key_render_draw(
+    Canvas* canvas,
+    const KeyRenderGeometry* geometry,
+    const KeyBitting* bitting,
+    int16_t view_px);
+
+// The contour of key_render_draw, without the digits and pin ticks, into a layer. Needs no canvas.
+void key_render_layer(
+    const KeyRenderGeometry* geometry,
+    const KeyBitting* bitting,
+    int16_t view_px,
+    uint8_t* layer);
+
+// The digits and pin ticks left out of a layer, with each depth's difference from reference
+// beside the digits that differ
+void key_render_marks(
+    Canvas* canvas,
+    const KeyRenderGeometry* geometry,
+    const KeyBitting* bitting,
+    const KeyBitting* reference,
+    int16_t view_px);
+
+// Blade silhouette shrunk to a thumbnail. Needs no canvas, so any thread may call it.
+void key_render_thumbnail(
+    const KeyRenderGeometry* geometry,
+    const KeyBitting* bitting,
+    uint8_t* xbm);
+
+#endif // KEY_RENDER_H
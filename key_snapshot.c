@@ -0,0 +1,34 @@
+#include "key_snapshot.h"
+#include <string.h>
+
+void key_snapshot_init(KeySnapshot* snapshot, void* slots, size_t size) {
+    atomic_init(&snapshot->sequence, 0);
+    snapshot->size = size;
+    snapshot->slots = slots;
+    memset(slots, 0, 2 * size);
+}
+
+void key_snapshot_publish(KeySnapshot* snapshot, const void* state) {
+    unsigned sequence = atomic_load_explicit(&snapshot->sequence, memory_order_relaxed);
+    unsigned next = (sequence | 1) + 1; // the other slot, published
+    uint8_t* slot = snapshot->slots + ((next >> 1) & 1) * snapshot->size;
+
+    atomic_store_explicit(&snapshot->sequence, sequence | 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(slot, state, snapshot->size);
+    atomic_store_explicit(&snapshot->sequence, next, memory_order_release);
+}
+
+uint32_t key_snapshot_read(KeySnapshot* snapshot, void* state) {
+    uint32_t retries = 0;
+    while(true) {
+        unsigned sequence = atomic_load_explicit(&snapshot->sequence, memory_order_acquire);
+        memcpy(state, snapshot->slots + ((sequence >> 1) & 1) * snapshot->size, snapshot->size);
+        atomic_thread_fence(memory_order_acquire);
+        unsigned now = atomic_load_explicit(&snapshot->sequence, memory_order_relaxed);
+        // Our slot is written again only once the writer has published the other slot and
+        // started on the next one: sequence (even part) + 3 or more
+        if(now - (sequence & ~1u) < 3) return retries;
+        retries++;
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef KEY_SNAPSHOT_H
+#define KEY_SNAPSHOT_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Double buffered state with one writer thread and any number of reader threads. The writer
+// fills the slot readers are not using and then flips the sequence; readers copy the published
+// slot and only retry if the writer got all the way round to that slot while they copied.
+// Neither side ever waits on the other, so a reader that preempts the writer can't spin.
+//
+// sequence: bit 1 is the published slot, bit 0 is set while the other slot is being written.
+typedef struct {
+    atomic_uint sequence;
+    size_t size;
+    uint8_t* slots; // two states of size bytes
+} KeySnapshot;
+
+// slots must hold two states
+void key_snapshot_init(KeySnapshot* snapshot, void* slots, size_t size);
+
+// Writer thread only
+void key_snapshot_publish(KeySnapshot* snapshot, const void* state);
+
+// Copy a consistent published state; returns the number of retries
+uint32_t key_snapshot_read(KeySnapshot* snapshot, void* state);
+
+#endif // KEY_SNAPSHOT_H
@@ -0,0 +1,104 @@
+#include "key_trace.h"
+#include <furi_hal.h>
+
+typedef struct {
+    const char* name;
+    uint32_t timestamp_us;
+    char phase;
+    uint8_t thread;
+} KeyTraceEvent;
+
+typedef struct {
+    KeyTraceEvent events[KEY_TRACE_CAPACITY];
+    uint32_t count; // total recorded, the ring index is count % KEY_TRACE_CAPACITY
+    FuriThreadId app_thread;
+    uint32_t last_cycles;
+    uint32_t last_tick;
+    uint32_t now_us;
+} KeyTrace;
+
+static KeyTrace key_trace;
+
+// Thread ids used in the exported file
+#define KEY_TRACE_THREAD_APP 1
+#define KEY_TRACE_THREAD_GUI 2
+
+void key_trace_init(void) {
+    memset(&key_trace, 0, sizeof(key_trace));
+    key_trace.app_thread = furi_thread_get_current_id();
+    key_trace.last_cycles = DWT->CYCCNT;
+    key_trace.last_tick = furi_get_tick();
+}
+
+void key_trace_record(const char* name, char phase) {
+    uint8_t thread = furi_thread_get_current_id() == key_trace.app_thread ? KEY_TRACE_THREAD_APP :
+                                                                             KEY_TRACE_THREAD_GUI;
+    FURI_CRITICAL_ENTER();
+    // The cycle counter wraps about once a minute, so fall back to ticks after long idle gaps
+    uint32_t cycles = DWT->CYCCNT;
+    uint32_t tick = furi_get_tick();
+    if(tick - key_trace.last_tick > 30000) {
+        key_trace.now_us += (tick - key_trace.last_tick) * 1000;
+    } else {
+        key_trace.now_us +=
+            (cycles - key_trace.last_cycles) / furi_hal_cortex_instructions_per_microsecond();
+    }
+    key_trace.last_cycles = cycles;
+    key_trace.last_tick = tick;
+    KeyTraceEvent* event = &key_trace.events[key_trace.count++ % KEY_TRACE_CAPACITY];
+    event->name = name;
+    event->timestamp_us = key_trace.now_us;
+    event->phase = phase;
+    event->thread = thread;
+    FURI_CRITICAL_EXIT();
+}
+
+static bool key_trace_write(File* file, const FuriString* line) {
+    size_t size = furi_string_size(line);
+    return storage_file_write(file, furi_string_get_cstr(line), size) == size;
+}
+
+bool key_trace_export(Storage* storage, const char* path) {
+    // Copy the ring first so the file write does not race new events
+    KeyTraceEvent* events = malloc(sizeof(key_trace.events));
+    FURI_CRITICAL_ENTER();
+    uint32_t total = key_trace.count;
+    memcpy(events, key_trace.events, sizeof(key_trace.events));
+    FURI_CRITICAL_EXIT();
+    uint32_t count = total < KEY_TRACE_CAPACITY ? total : KEY_TRACE_CAPACITY;
+    uint32_t first = total - count;
+
+    File* file = storage_file_alloc(storage);
+    FuriString* line = furi_string_alloc();
+    bool result = storage_file_open(file, path, FSAM_WRITE, FSOM_CREATE_ALWAYS);
+    if(result) {
+        furi_string_printf(
+            line,
+            "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+            "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+            "\"args\":{\"name\":\"app\"}},\n"
+            "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+            "\"args\":{\"name\":\"gui\"}}",
+            KEY_TRACE_THREAD_APP,
+            KEY_TRACE_THREAD_GUI);
+        result = key_trace_write(file, line);
+        for(uint32_t i = first; i < total && result; i++) {
+            const KeyTraceEvent* event = &events[i % KEY_TRACE_CAPACITY];
+            furi_string_printf(
+                line,
+                ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lu,\"pid\":1,\"tid\":%u}",
+                event->name,
+                event->phase,
+                event->timestamp_us,
+                event->thread);
+            result = key_trace_write(file, line);
+        }
+        furi_string_set(line, "\n]}\n");
+        result = result && key_trace_write(file, line);
+    }
+    storage_file_close(file);
+    furi_string_free(line);
+    storage_file_free(file);
+    free(events);
+    return result;
+}
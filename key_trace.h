@@ -0,0 +1,28 @@
+#ifndef KEY_TRACE_H
+#define KEY_TRACE_H
+
+#include <applications/services/storage/storage.h>
+#include <furi.h>
+
+// Events kept in RAM; older ones are overwritten
+#define KEY_TRACE_CAPACITY 256
+#define KEY_TRACE_PATH STORAGE_APP_DATA_PATH_PREFIX "/trace.json"
+
+// Remember the calling thread as the app thread. Call once before recording.
+void key_trace_init(void);
+
+// Record one event. name must be a string literal, only the pointer is kept.
+void key_trace_record(const char* name, char phase);
+
+// Write the buffer as a Chrome trace_event JSON file
+bool key_trace_export(Storage* storage, const char* path);
+
+#ifdef KEY_TRACE_DISABLE
+#define KEY_TRACE_BEGIN(name)
+#define KEY_TRACE_END(name)
+#else
+#define KEY_TRACE_BEGIN(name) key_trace_record(name, 'B')
+#define KEY_TRACE_END(name) key_trace_record(name, 'E')
+#endif
+
+#endif // KEY_TRACE_H